@@ -7,18 +7,51 @@
  * @date 3/24/2008
  */
 
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
 #include "BTreeIndex.h"
 #include "BTreeNode.h"
 
 using namespace std;
 
+template <class Key, class Compare>
+atomic<unsigned long> BTreeIndexT<Key, Compare>::opens(0);
+
+template <class Key, class Compare>
+thread_local typename BTreeIndexT<Key, Compare>::LeafCache BTreeIndexT<Key, Compare>::leafCache;
+
 /*
  * BTreeIndex constructor
  */
-BTreeIndex::BTreeIndex()
+template <class Key, class Compare>
+BTreeIndexT<Key, Compare>::BTreeIndexT()
 {
     rootPid = -1;
     treeHeight = 0;
+    compressed = false;
+    clustered = false;
+    bulkLeafPid = -1;
+    fillPercent = 100;
+    buffered = false;
+    pending = 0;
+    dirty = false;
+    nextPid = 0;
+    openId = ++opens;
+    for (int i = 0; i < LATCH_CHUNKS; i++) {
+        latchChunks[i] = NULL;
+    }
+}
+
+/*
+ * BTreeIndex destructor
+ */
+template <class Key, class Compare>
+BTreeIndexT<Key, Compare>::~BTreeIndexT()
+{
+    for (int i = 0; i < LATCH_CHUNKS; i++) {
+        delete[] latchChunks[i].load();
+    }
 }
 
 /*
@@ -28,7 +61,8 @@ BTreeIndex::BTreeIndex()
  * @param mode[IN] 'r' for read, 'w' for write
  * @return error code. 0 if no error
  */
-RC BTreeIndex::open(const string& indexname, char mode)
+template <class Key, class Compare>
+RC BTreeIndexT<Key, Compare>::open(const string& indexname, char mode)
 {
 	RC rc = pf.open(indexname, mode);
 	if (rc != 0) {
@@ -36,13 +70,29 @@ RC BTreeIndex::open(const string& indexname, char mode)
 		return rc;
 	}
 
-	//rootPid = 0;
+	rootPid = -1;
+	treeHeight = 0;
+	compressed = false;
+	clustered = false;
+	bulkLeafPid = -1;
+	bulkLeaves.clear();
+	buffers.clear();
+	pending = 0;
+	dirty = false;
+	nextPid = 0;
+	openId = ++opens;
 
-	// If no pid initialize a new root node
-	if (pf.endPid() != 0) {
+	// Page 0 stores rootPid and treeHeight. For a new index file, save the
+	// empty header right away so that the tree nodes start from page 1.
+	if (pf.endPid() == 0) {
+		if (mode == 'w' || mode == 'W') {
+			dirty = true;
+		}
+	} else {
 		char buffer[PageFile::PAGE_SIZE];
 		if (pf.read(0, buffer) != 0) {
 			fprintf(stdout, "Could not read\n");
+			pf.close();
 			return RC_FILE_READ_FAILED;
 		}
 
@@ -50,8 +100,15 @@ RC BTreeIndex::open(const string& indexname, char mode)
 		memcpy(&rootPid, iter, sizeof(PageId));
 		iter += sizeof(PageId);
 		memcpy(&treeHeight, iter, sizeof(int));
+		iter += sizeof(int);
+		memcpy(&compressed, iter, sizeof(bool));
+		iter += sizeof(int);
+		memcpy(&clustered, iter, sizeof(bool));
 	}
 
+	if (dirty) {
+		return writeHeader();
+	}
     return 0;
 }
 
@@ -59,19 +116,148 @@ RC BTreeIndex::open(const string& indexname, char mode)
  * Close the index file.
  * @return error code. 0 if no error
  */
-RC BTreeIndex::close()
+template <class Key, class Compare>
+RC BTreeIndexT<Key, Compare>::close()
+{
+	if (pending > 0 && flushBuffers() != 0) {
+		pf.close();
+		return RC_FILE_WRITE_FAILED;
+	}
+	if (dirty && writeHeader() != 0) {
+		pf.close();
+		return RC_FILE_WRITE_FAILED;
+	}
+    return pf.close();
+}
+
+/*
+ * Choose whether new leaves are compressed.
+ * @param compress[IN] true to compress the leaves
+ */
+template <class Key, class Compare>
+void BTreeIndexT<Key, Compare>::setCompressed(bool compress)
+{
+	compressed = compress && LeafPacking<Key>::ENABLED;
+	dirty = true;
+}
+
+/*
+ * Record whether the table of the index is stored in key order.
+ * @param inKeyOrder[IN] true if the table is clustered on the key
+ */
+template <class Key, class Compare>
+void BTreeIndexT<Key, Compare>::setClustered(bool inKeyOrder)
+{
+	clustered = inKeyOrder;
+	dirty = true;
+}
+
+/*
+ * Return the latch of the node at pid.
+ * Chunk i holds the latches of the pages from LATCH_CHUNK * (2^i - 1)
+ * on. Two threads may create the same chunk at once; the one that loses
+ * the race deletes its own.
+ */
+template <class Key, class Compare>
+typename BTreeIndexT<Key, Compare>::NodeLatch& BTreeIndexT<Key, Compare>::latchOf(PageId pid)
+{
+	unsigned n = (unsigned) pid / LATCH_CHUNK + 1;
+	int i = 0;
+	while ((n >> (i + 1)) != 0) {
+		i++;
+	}
+
+	NodeLatch* chunk = latchChunks[i].load(memory_order_acquire);
+	if (chunk == NULL) {
+		NodeLatch* created = new NodeLatch[(size_t) LATCH_CHUNK << i];
+		for (size_t j = 0; j < ((size_t) LATCH_CHUNK << i); j++) {
+			created[j].version = 1;
+		}
+		if (latchChunks[i].compare_exchange_strong(chunk, created)) {
+			chunk = created;
+		} else {
+			delete[] created;
+		}
+	}
+	return chunk[(unsigned) pid - LATCH_CHUNK * ((1u << i) - 1)];
+}
+
+/*
+ * Read a leaf through the one-node cache of the calling thread. A scan
+ * reads every entry of a leaf in turn, so the page is read and, for a
+ * compressed leaf, decoded once rather than once per entry. The copy is
+ * used only while the version of the leaf is the one it was read at.
+ * @param pid[IN] the leaf to read
+ * @param node[OUT] the cached node. valid until the next readLeaf
+ * @return error code. 0 if no error
+ */
+template <class Key, class Compare>
+RC BTreeIndexT<Key, Compare>::readLeaf(PageId pid, LeafNode*& node)
+{
+	RC rc;
+	unsigned version = latchOf(pid).version;
+
+	if (leafCache.owner != openId || leafCache.pid != pid || leafCache.version != version) {
+		leafCache.owner = 0;
+		if ((rc = leafCache.node.read(pid, pf)) != 0) {
+			return rc;
+		}
+		leafCache.owner = openId;
+		leafCache.pid = pid;
+		leafCache.version = version;
+	}
+	node = &leafCache.node;
+	return 0;
+}
+
+/*
+ * Write a node and bump its version, so that the threads that cached
+ * the node read it again.
+ */
+template <class Key, class Compare>
+template <class Node>
+RC BTreeIndexT<Key, Compare>::writeNode(Node& node, PageId pid)
+{
+	RC rc = node.write(pid, pf);
+	latchOf(pid).version++;
+	return rc;
+}
+
+/*
+ * Return a new page for a node. A page is written some time after it is
+ * handed out, so pf.endPid() alone would give it to the next thread too.
+ */
+template <class Key, class Compare>
+PageId BTreeIndexT<Key, Compare>::allocatePage()
+{
+	lock_guard<mutex> guard(allocMutex);
+	PageId pid = max(pf.endPid(), nextPid);
+	nextPid = pid + 1;
+	return pid;
+}
+
+/*
+ * Save rootPid and treeHeight to page 0 of the index file.
+ * @return error code. 0 if no error
+ */
+template <class Key, class Compare>
+RC BTreeIndexT<Key, Compare>::writeHeader()
 {
-	//rootPid = -1;
 	char buffer[PageFile::PAGE_SIZE];
 	char* iter = &(buffer[0]);
 	memset(iter, 0, PageFile::PAGE_SIZE);
 	memcpy(iter, &rootPid, sizeof(PageId));
 	iter += sizeof(PageId);
-	memcpy(iter, &treeHeight, sizeof(PageId));
-	if( pf.write(0, buffer) != 0) {
+	memcpy(iter, &treeHeight, sizeof(int));
+	iter += sizeof(int);
+	memcpy(iter, &compressed, sizeof(bool));
+	iter += sizeof(int);
+	memcpy(iter, &clustered, sizeof(bool));
+	if (pf.write(0, buffer) != 0) {
 		return RC_FILE_WRITE_FAILED;
 	}
-    return pf.close();
+	dirty = false;
+	return 0;
 }
 
 /*
@@ -80,110 +266,590 @@ RC BTreeIndex::close()
  * @param rid[IN] the RecordId for the record being inserted into the index
  * @return error code. 0 if no error
  */
-RC BTreeIndex::insert(int key, const RecordId& rid)
+template <class Key, class Compare>
+RC BTreeIndexT<Key, Compare>::insert(const Key& key, const RecordId& rid)
 {
-	int currentHeight = 0;
-	int siblingKey;
-	int siblingPid;
-	return insertHelper(rootPid, key, rid, currentHeight, siblingPid, siblingKey);
+	if (buffered) {
+		shared_lock<shared_mutex> header(headerLatch);
+		PageId pid = rootPid;
+		int level = treeHeight - 1;
+		header.unlock();
+
+		// a tree of one leaf has no buffer yet
+		if (level > 0) {
+			lock_guard<mutex> guard(bufferMutex);
+			NodeBuffer& buffer = buffers[pid];
+			buffer.level = level;
+			buffer.entries.push_back(make_pair(key, rid));
+			pending++;
+			return (buffer.entries.size() < BUFFER_ENTRIES) ? 0 : flushBuffer(pid);
+		}
+	}
+	return insertIntoTree(key, rid);
 }
 
-RC BTreeIndex::insertHelper(PageId pid, int key, const RecordId& rid,
-						    int curHeight, int& siblingPid, int& siblingKey)
+/*
+ * Insert (key, RecordId) pair down to its leaf.
+ * @return error code. 0 if no error
+ */
+template <class Key, class Compare>
+RC BTreeIndexT<Key, Compare>::insertIntoTree(const Key& key, const RecordId& rid)
 {
-	if (curHeight < treeHeight)
-	{
-		//not at a leaf node yet
-		int rc = 0;
-		BTNonLeafNode curHead;
-		rc = curHead.read(pid, pf);
-		if (rc != 0) {
+	RC rc;
+	Key siblingKey;
+	PageId siblingPid;
+
+	// most inserts fit into their leaf and need no exclusive latch above it
+	if ((rc = insertIntoLeaf(key, rid)) != RC_NODE_FULL) {
+		return rc;
+	}
+
+	// the leaf must be split, or the tree is empty. descend again with
+	// exclusive latches, starting with the header
+	unique_lock<shared_mutex> header(headerLatch);
+	vector<unique_lock<shared_mutex> > held;
+
+	// the first key creates a root that is also a leaf
+	if (treeHeight == 0) {
+		LeafNode root;
+		root.setCompressed(compressed);
+		root.insert(key, rid);
+		rootPid = allocatePage();
+		if ((rc = writeNode(root, rootPid)) != 0) {
 			return rc;
 		}
+		treeHeight = 1;
+		dirty = true;
+		return 0;
+	}
+
+	rc = insertHelper(rootPid, key, rid, 1, treeHeight, siblingPid, siblingKey, header, held);
+	if (rc != RC_NODE_FULL) {
+		return rc;
+	}
+
+	// the root was split, so the header latch is still held. grow the
+	// tree by one level
+	NonLeafNode newRoot;
+	newRoot.initializeRoot(rootPid, siblingKey, siblingPid);
+	PageId newRootPid = allocatePage();
+	if ((rc = writeNode(newRoot, newRootPid)) != 0) {
+		return rc;
+	}
+	rootPid = newRootPid;
+	treeHeight++;
+	dirty = true;
+	return 0;
+}
+
+/*
+ * Insert (key, rid) if it fits into its leaf. The non-leaf nodes are
+ * only read on the way down, so they get shared latches, and the leaf an
+ * exclusive one.
+ * @return error code. RC_NODE_FULL if the leaf is full or the tree empty
+ */
+template <class Key, class Compare>
+RC BTreeIndexT<Key, Compare>::insertIntoLeaf(const Key& key, const RecordId& rid)
+{
+	RC rc;
+
+	shared_lock<shared_mutex> latch(headerLatch);
+	if (treeHeight == 0) {
+		return RC_NODE_FULL;
+	}
+	int height = treeHeight;
+	PageId pid = rootPid;
 
+	NonLeafNode curHead;
+	for (int curHeight = 1; curHeight < height; curHeight++) {
+		latch = shared_lock<shared_mutex>(latchOf(pid).latch);
+		if ((rc = curHead.read(pid, pf)) != 0) {
+			return rc;
+		}
 		curHead.locateChildPtr(key, pid);
+	}
+
+	unique_lock<shared_mutex> leafLatch(latchOf(pid).latch);
+	latch.unlock();
 
-		rc = insertHelper(pid, key, rid, curHeight+1, siblingPid, siblingKey); //rc will be NODE_FULL if it split
+	LeafNode leaf;
+	if ((rc = leaf.read(pid, pf)) != 0) {
+		return rc;
+	}
+	if ((rc = leaf.insert(key, rid)) != 0) {
+		return rc;
+	}
+	return writeNode(leaf, pid);
+}
 
-		if (rc == RC_NODE_FULL && curHeight != 0) //not the root
-		{//check to split the "parent" node
-			int rc2 = curHead.insert(siblingKey, siblingPid);
-			if(rc2 == RC_NODE_FULL)
-			{
-				BTNonLeafNode newNode;
-				siblingPid = pf.endPid();
-				curHead.insertAndSplit(key, pid, newNode, siblingKey);
+/*
+ * Insert (key, RecordId) pairs in key order, a leaf at a time.
+ * @param entries[IN] the pairs, in ascending key order
+ * @return error code. 0 if no error
+ */
+template <class Key, class Compare>
+RC BTreeIndexT<Key, Compare>::insertBatch(const vector<pair<Key, RecordId> >& entries)
+{
+	RC rc;
+	unsigned i = 0;
 
-				curHead.write(pid, pf);
-				newNode.write(siblingPid, pf);
+	while (i < entries.size()) {
+		unsigned inserted;
+		rc = insertRunIntoLeaf(entries, i, inserted);
+		if (rc == RC_NODE_FULL) {
+			// insertIntoTree() splits the leaf, and the next run goes into
+			// one of the two halves
+			rc = insertIntoTree(entries[i].first, entries[i].second);
+			inserted = 1;
+		}
+		if (rc != 0) {
+			return rc;
+		}
+		i += inserted;
+	}
+	return 0;
+}
 
-				//create new child node, set the right hand pointer to it
-			} else if (rc2 == 0) {
-				return curHead.write(pid, pf);
-			}
+/*
+ * Insert entries[begin] and the entries after it that fit into the same
+ * leaf. The separator keys met on the way down give the upper end of the
+ * key range of the leaf.
+ * @return error code. RC_NODE_FULL if entries[begin] does not fit or the
+ * tree is empty
+ */
+template <class Key, class Compare>
+RC BTreeIndexT<Key, Compare>::insertRunIntoLeaf(const vector<pair<Key, RecordId> >& entries,
+                                                unsigned begin, unsigned& inserted)
+{
+	RC rc;
+	Key upper;
+	bool bounded = false;
+
+	inserted = 0;
+	shared_lock<shared_mutex> latch(headerLatch);
+	if (treeHeight == 0) {
+		return RC_NODE_FULL;
+	}
+	int height = treeHeight;
+	PageId pid = rootPid;
 
-			return rc2; //RC_NODE_FULL
+	NonLeafNode curHead;
+	for (int curHeight = 1; curHeight < height; curHeight++) {
+		latch = shared_lock<shared_mutex>(latchOf(pid).latch);
+		if ((rc = curHead.read(pid, pf)) != 0) {
+			return rc;
 		}
-		else if (rc == RC_NODE_FULL) //full, and at root
-		{
-			int rc2 = curHead.insert(siblingKey, siblingPid);
-			if(rc2 == RC_NODE_FULL)
-			{
-				BTNonLeafNode newNode;
-				siblingPid = pf.endPid();
-				curHead.insertAndSplit(key, pid, newNode, siblingKey);
-				BTNonLeafNode newRoot;
-				rootPid = pf.endPid();
-
-				newRoot.initializeRoot(pid, siblingKey, siblingPid);
-
-				treeHeight++;
-
-				newRoot.write(rootPid, pf);
-				curHead.write(pid, pf);
-				newNode.write(siblingPid, pf);
-				return 0;
+		// a lower level has the tighter bound
+		Key next;
+		if (curHead.locateChildPtr(entries[begin].first, pid, next) == 0) {
+			upper = next;
+			bounded = true;
+		}
+	}
 
-			} else if (rc2 == 0) {
-				return curHead.write(pid, pf);
-			}
+	unique_lock<shared_mutex> leafLatch(latchOf(pid).latch);
+	latch.unlock();
 
-			return rc2;  //error in insert function that isn't RC_NODE_FULL
+	LeafNode leaf;
+	if ((rc = leaf.read(pid, pf)) != 0) {
+		return rc;
+	}
+	unsigned i = begin;
+	while (i < entries.size() && (!bounded || Compare()(entries[i].first, upper))) {
+		if (leaf.insert(entries[i].first, entries[i].second) != 0) {
+			break;
 		}
-	} else {
-		//at a leaf node
+		i++;
+	}
+	if (i == begin) {
+		return RC_NODE_FULL;
+	}
+	inserted = i - begin;
+	return writeNode(leaf, pid);
+}
 
-		int rc = 0;
-		BTLeafNode curHead;
-		rc = curHead.read(pid, pf);
-		if(rc != 0)
-		{
+/*
+ * Order (key, RecordId) pairs by key only.
+ */
+template <class Key, class Compare>
+static bool keyLess(const pair<Key, RecordId>& a, const pair<Key, RecordId>& b)
+{
+	return Compare()(a.first, b.first);
+}
+
+/*
+ * Pass the buffer of the node at pid down one level. The entries are
+ * sorted by key, keeping the order of equal keys, and split among the
+ * children with the separators of the node. A node that was split since
+ * an entry reached its buffer only sends the entry to a neighbour of its
+ * leaf; insertBatch() descends from the root, so the entry still ends up
+ * in the right leaf.
+ * @param pid[IN] the node with a buffer
+ * @return error code. 0 if no error
+ */
+template <class Key, class Compare>
+RC BTreeIndexT<Key, Compare>::flushBuffer(PageId pid)
+{
+	RC rc = 0;
+
+	typename map<PageId, NodeBuffer>::iterator it = buffers.find(pid);
+	int level = it->second.level;
+	vector<pair<Key, RecordId> > entries;
+	entries.swap(it->second.entries);
+	buffers.erase(it);
+
+	// the entries count as pending until they are in the leaves or in
+	// other buffers, so that a reader that sees no pending entry can skip
+	// flushBuffers() without missing the ones being passed down
+	stable_sort(entries.begin(), entries.end(), keyLess<Key, Compare>);
+	if (level == 1) {
+		rc = insertBatch(entries);
+		pending -= entries.size();
+		return rc;
+	}
+
+	NonLeafNode node;
+	{
+		shared_lock<shared_mutex> latch(latchOf(pid).latch);
+		if ((rc = node.read(pid, pf)) != 0) {
+			return rc;
+		}
+	}
+
+	// the entries below the next separator go to the same child
+	unsigned i = 0;
+	while (i < entries.size()) {
+		PageId child;
+		Key upper;
+		bool bounded = (node.locateChildPtr(entries[i].first, child, upper) == 0);
+
+		NodeBuffer& buffer = buffers[child];
+		buffer.level = level - 1;
+		do {
+			buffer.entries.push_back(entries[i++]);
+			pending++;
+		} while (i < entries.size() && (!bounded || Compare()(entries[i].first, upper)));
+
+		if (buffer.entries.size() >= BUFFER_ENTRIES && (rc = flushBuffer(child)) != 0) {
+			break;
+		}
+	}
+	pending -= entries.size();
+	return rc;
+}
+
+/*
+ * Push every buffered entry down to the leaves. A buffer is passed down
+ * only after the buffers above it, so each entry goes down each level once.
+ * @return error code. 0 if no error
+ */
+template <class Key, class Compare>
+RC BTreeIndexT<Key, Compare>::flushBuffers()
+{
+	RC rc;
+
+	lock_guard<mutex> guard(bufferMutex);
+	while (!buffers.empty()) {
+		typename map<PageId, NodeBuffer>::iterator top = buffers.begin();
+		for (typename map<PageId, NodeBuffer>::iterator it = buffers.begin(); it != buffers.end(); ++it) {
+			if (it->second.level > top->second.level) {
+				top = it;
+			}
+		}
+		if ((rc = flushBuffer(top->first)) != 0) {
+			return rc;
+		}
+	}
+	return 0;
+}
+
+template <class Key, class Compare>
+RC BTreeIndexT<Key, Compare>::insertHelper(PageId pid, const Key& key, const RecordId& rid,
+                                           int curHeight, int height, PageId& siblingPid, Key& siblingKey,
+                                           unique_lock<shared_mutex>& header,
+                                           vector<unique_lock<shared_mutex> >& held)
+{
+	RC rc;
+
+	held.push_back(unique_lock<shared_mutex>(latchOf(pid).latch));
+
+	if (curHeight == height) {
+		//at a leaf node
+		LeafNode curHead;
+		if ((rc = curHead.read(pid, pf)) != 0) {
 			return rc;
 		}
 
 		rc = curHead.insert(key, rid);
-		if(rc == 0)
-		{
+		if (rc == 0) {
 			// Success, easiest case, insert works
-			return curHead.write(pid, pf);
+			return writeNode(curHead, pid);
 		}
-		else if (rc == RC_NODE_FULL)
-		{
-			// Need to insert and split
-			BTLeafNode newNode;
-			siblingPid = pf.endPid();
+		if (rc != RC_NODE_FULL) {
+			return rc;
+		}
+
+		// Need to insert and split
+		LeafNode newNode;
+		siblingPid = allocatePage();
+		curHead.insertAndSplit(key, rid, newNode, siblingKey);
+
+		// Need to link the sibling between this leaf and the next one
+		PageId nextPid = curHead.getNextNodePtr();
+		curHead.setNextNodePtr(siblingPid);
+		newNode.setPrevNodePtr(pid);
+
+		if ((rc = writeNode(newNode, siblingPid)) != 0) {
+			return rc;
+		}
+		if (nextPid != 0) {
+			// a writer latches leaves only from left to right, and a
+			// reader one leaf at a time, so this cannot deadlock
+			unique_lock<shared_mutex> nextLatch(latchOf(nextPid).latch);
+			LeafNode next;
+			if ((rc = next.read(nextPid, pf)) != 0) {
+				return rc;
+			}
+			next.setPrevNodePtr(siblingPid);
+			if ((rc = writeNode(next, nextPid)) != 0) {
+				return rc;
+			}
+		}
+		if ((rc = writeNode(curHead, pid)) != 0) {
+			return rc;
+		}
+		return RC_NODE_FULL;
+	}
+
+	//not at a leaf node yet
+	NonLeafNode curHead;
+	if ((rc = curHead.read(pid, pf)) != 0) {
+		return rc;
+	}
+
+	// a node with room for one more key takes a split of its child
+	// without splitting itself, so nothing above it changes
+	if (curHead.getKeyCount() < NonLeafNode::MAX_KEY_COUNT) {
+		if (header.owns_lock()) {
+			header.unlock();
+		}
+		for (unsigned i = 0; i + 1 < held.size(); i++) {
+			if (held[i].owns_lock()) {
+				held[i].unlock();
+			}
+		}
+	}
+
+	PageId childPid;
+	curHead.locateChildPtr(key, childPid);
 
-			curHead.insertAndSplit(key, rid, newNode, siblingKey);
+	rc = insertHelper(childPid, key, rid, curHeight + 1, height, siblingPid, siblingKey, header, held);
+	if (rc != RC_NODE_FULL) {
+		return rc;
+	}
+
+	// the child was split. add the new sibling to this node
+	rc = curHead.insert(siblingKey, siblingPid);
+	if (rc == 0) {
+		return writeNode(curHead, pid);
+	}
+	if (rc != RC_NODE_FULL) {
+		return rc;
+	}
+
+	// this node is full as well. split it and push midKey up to the parent
+	NonLeafNode newNode;
+	Key midKey;
+	curHead.insertAndSplit(siblingKey, siblingPid, newNode, midKey);
+
+	siblingPid = allocatePage();
+	siblingKey = midKey;
+	if ((rc = writeNode(newNode, siblingPid)) != 0) {
+		return rc;
+	}
+	if ((rc = writeNode(curHead, pid)) != 0) {
+		return rc;
+	}
+	return RC_NODE_FULL;
+}
+
+/*
+ * Choose how full bulkInsert() and finishBulkLoad() make the nodes.
+ * @param percent[IN] the fill factor in percent, from 10 to 100
+ * @return error code. RC_INVALID_ATTRIBUTE if percent is out of range
+ */
+template <class Key, class Compare>
+RC BTreeIndexT<Key, Compare>::setFillFactor(int percent)
+{
+	if (percent < 10 || percent > 100) {
+		return RC_INVALID_ATTRIBUTE;
+	}
+	fillPercent = percent;
+	return 0;
+}
+
+/*
+ * Choose whether insert() buffers the new entries in the non-leaf nodes.
+ * @param buffer[IN] true to buffer the inserts
+ * @return error code. 0 if no error
+ */
+template <class Key, class Compare>
+RC BTreeIndexT<Key, Compare>::setBuffered(bool buffer)
+{
+	buffered = buffer;
+	return (!buffer && pending > 0) ? flushBuffers() : 0;
+}
+
+/*
+ * Add (key, RecordId) pair to an index that is built bottom-up.
+ * Nothing else is written to the index file during the build, so the leaf
+ * after bulkLeaf is always stored on the next page.
+ * @param key[IN] the key for the value inserted into the index
+ * @param rid[IN] the RecordId for the record being inserted into the index
+ * @return error code. RC_INVALID_FILE_MODE if the index is not empty
+ */
+template <class Key, class Compare>
+RC BTreeIndexT<Key, Compare>::bulkInsert(const Key& key, const RecordId& rid)
+{
+	RC rc;
 
-			// Need to set the sibling pointer
-			curHead.setNextNodePtr(siblingPid);
+	if (bulkLeafPid < 0) {
+		if (treeHeight != 0) {
+			return RC_INVALID_FILE_MODE;
+		}
+		// forget the leaves that the threads cached from this index
+		openId = ++opens;
+		bulkLeaves.clear();
+		bulkLeaf = LeafNode();
+		bulkLeaf.setCompressed(compressed);
+		bulkLeafPid = pf.endPid();
+	}
 
-			curHead.write(pid, pf);
-			newNode.write(siblingPid, pf);
+	// the leaf is full once it reaches the fill factor
+	int limit = (compressed ? LeafNode::MAX_PACKED_KEY_COUNT : LeafNode::MAX_KEY_COUNT) * fillPercent / 100;
+	if (bulkLeaf.getKeyCount() < limit || bulkLeaf.getKeyCount() == 0) {
+		rc = bulkLeaf.insert(key, rid);
+	} else {
+		rc = RC_NODE_FULL;
+	}
+	if (rc != RC_NODE_FULL) {
+		if (rc == 0 && bulkLeaf.getKeyCount() == 1) {
+			bulkLeaves.push_back(make_pair(key, bulkLeafPid));
 		}
 		return rc;
 	}
 
+	// the leaf is full. store it and start the next one
+	bulkLeaf.setNextNodePtr(bulkLeafPid + 1);
+	if ((rc = bulkLeaf.write(bulkLeafPid, pf)) != 0) {
+		return rc;
+	}
+	bulkLeaf = LeafNode();
+	bulkLeaf.setCompressed(compressed);
+	bulkLeaf.setPrevNodePtr(bulkLeafPid);
+	bulkLeafPid++;
+	bulkLeaves.push_back(make_pair(key, bulkLeafPid));
+	return bulkLeaf.insert(key, rid);
+}
+
+/*
+ * Write the last leaf of a bottom-up build and the non-leaf levels.
+ * Every level is built from the (first key, PageId) pairs of the level
+ * below, with the children spread evenly over as few nodes as possible.
+ * @return error code. 0 if no error
+ */
+template <class Key, class Compare>
+RC BTreeIndexT<Key, Compare>::finishBulkLoad()
+{
+	RC rc;
+
+	if (bulkLeafPid < 0) {
+		return 0;
+	}
+
+	if ((rc = bulkLeaf.write(bulkLeafPid, pf)) != 0) {
+		return rc;
+	}
+	bulkLeafPid = -1;
+
+	vector<pair<Key, PageId> > level;
+	level.swap(bulkLeaves);
+	rootPid = level[0].second;
+	treeHeight = 1;
+	dirty = true;
+
+	while (level.size() > 1) {
+		vector<pair<Key, PageId> > parents;
+		int n = level.size();
+		int fanout = (NonLeafNode::MAX_KEY_COUNT + 1) * fillPercent / 100;
+		if (fanout < 3) fanout = 3;
+		int nodes = (n + fanout - 1) / fanout;
+
+		for (int i = 0; i < nodes; i++) {
+			int first = (int) ((long long) i * n / nodes);
+			int last = (int) ((long long) (i + 1) * n / nodes);
+			NonLeafNode node;
+
+			node.initializeRoot(level[first].second, level[first + 1].first, level[first + 1].second);
+			for (int j = first + 2; j < last; j++) {
+				if ((rc = node.insert(level[j].first, level[j].second)) != 0) {
+					return rc;
+				}
+			}
+			PageId pid = pf.endPid();
+			if ((rc = node.write(pid, pf)) != 0) {
+				return rc;
+			}
+			parents.push_back(make_pair(level[first].first, pid));
+		}
+
+		level.swap(parents);
+		rootPid = level[0].second;
+		treeHeight++;
+	}
+	return 0;
+}
+
+/*
+ * Descend from the root to the leaf whose key range holds searchKey.
+ * The header latch keeps the root from being replaced until the root is
+ * latched, and the latch of each node is released once the latch of its
+ * child is held.
+ * @param searchKey[IN] the key to find
+ * @param leafLatch[OUT] the shared latch of the leaf
+ * @param pid[OUT] the leaf
+ * @return error code. RC_NO_SUCH_RECORD if the tree is empty
+ */
+template <class Key, class Compare>
+RC BTreeIndexT<Key, Compare>::descend(const Key& searchKey, bool first,
+                                      shared_lock<shared_mutex>& leafLatch, PageId& pid)
+{
+	RC rc;
+
+	shared_lock<shared_mutex> latch(headerLatch);
+	if (treeHeight == 0) {
+		return RC_NO_SUCH_RECORD;
+	}
+	int height = treeHeight;
+	pid = rootPid;
+
+	NonLeafNode curHead;
+	for (int curHeight = 1; curHeight < height; curHeight++) {
+		latch = shared_lock<shared_mutex>(latchOf(pid).latch);
+		// Read contents of PageFile into NonLeafNode
+		if ((rc = curHead.read(pid, pf)) != 0) {
+			return rc;
+		}
+		// Find the child to go down to
+		rc = first ? curHead.locateFirstChildPtr(searchKey, pid)
+		           : curHead.locateChildPtr(searchKey, pid);
+		if (rc != 0) {
+			return rc;
+		}
+	}
+
+	leafLatch = shared_lock<shared_mutex>(latchOf(pid).latch);
+	return 0;
 }
 
 /*
@@ -205,50 +871,267 @@ RC BTreeIndex::insertHelper(PageId pid, int key, const RecordId& rid,
  *                    with the key value.
  * @return error code. 0 if no error.
  */
-RC BTreeIndex::locate(int searchKey, IndexCursor& cursor)
+template <class Key, class Compare>
+RC BTreeIndexT<Key, Compare>::locate(const Key& searchKey, IndexCursor& cursor)
 {
 	RC rc;
 
-	// If the tree is empty, return error
-	if (treeHeight == 0) {
-		return RC_NO_SUCH_RECORD;
+	// the cursor is past the end of the tree unless we find an entry
+	cursor.pid = 0;
+	cursor.eid = 0;
+	cursor.version = 0;
+
+	// the buffered entries may belong anywhere in the scan that follows
+	if (pending > 0 && (rc = flushBuffers()) != 0) {
+		return rc;
 	}
 
-	// Initialize a temp node
-	BTNonLeafNode curHead;
-	PageId pid = rootPid;
-	//curHead.initalizeRoot(0, -1, -1);
-	for (int curHeight = 1; curHeight < treeHeight; curHeight++) {
-		// Read contents of PageFile into NonLeafNode
-		rc = curHead.read(pid, pf);
-		if (rc != 0) {
-			return rc;
-		}
-		// Find the leaf node by traversing through the tree
-		rc = curHead.locateChildPtr(searchKey, pid);
-		if (rc != 0) {
-			return rc;
-		}
+	// Find the leaf node by traversing through the tree. If the tree is
+	// empty, return error
+	shared_lock<shared_mutex> latch;
+	PageId pid;
+	if ((rc = descend(searchKey, true, latch, pid)) != 0) {
+		return rc;
 	}
 
 	// Initialize a new leaf node
-	BTLeafNode leaf;
-	// Read contents of PageFile into LeafNode
-	rc = leaf.read(pid, pf);
+	LeafNode* leaf;
+	// Read contents of PageFile into LeafNode. the scan that follows
+	// starts with this leaf, so it goes through the leaf cache
+	rc = readLeaf(pid, leaf);
 	if (rc != 0) {
 		return rc;
 	}
-	// Find eid of LeafNode that contains searchKey
-	rc = leaf.locate(searchKey, cursor.eid);
-	if (rc != 0) {
-		return rc;
+
+	// Find eid of LeafNode that contains searchKey. If every key in this
+	// leaf is smaller, the first entry of the next leaf is the answer.
+	if (leaf->locate(searchKey, cursor.eid) != 0) {
+		cursor.eid = 0;
+		cursor.pid = leaf->getNextNodePtr();
+		return (cursor.pid == 0) ? RC_NO_SUCH_RECORD : 0;
 	}
 
 	// Load the pid of the LeafNode into the cursor
 	cursor.pid = pid;
+	tie(cursor, leaf);
     return 0;
 }
 
+/*
+ * Find the index entries of many keys at once.
+ * @param searchKeys[IN] the keys to find, in ascending order
+ * @param entries[OUT] the (key, RecordId) pairs of the entries whose key
+ *                     is one of searchKeys, in key order
+ * @return error code. 0 if no error
+ */
+template <class Key, class Compare>
+RC BTreeIndexT<Key, Compare>::lookupBatch(const vector<Key>& searchKeys,
+                                          vector<pair<Key, RecordId> >& entries)
+{
+	RC rc;
+
+	entries.clear();
+	if (searchKeys.empty()) {
+		return 0;
+	}
+	if (pending > 0 && (rc = flushBuffers()) != 0) {
+		return rc;
+	}
+
+	shared_lock<shared_mutex> header(headerLatch);
+	if (treeHeight == 0) {
+		return 0;
+	}
+	return lookupBatchHelper(rootPid, 1, treeHeight, searchKeys, 0, searchKeys.size(), entries);
+}
+
+/*
+ * Recursive helper of lookupBatch(). Finds the entries of
+ * searchKeys[begin..end) in the subtree rooted at pid, which sits at
+ * level curHeight of a tree of the given height. A non-leaf node stays
+ * latched until all of its children have been searched.
+ */
+template <class Key, class Compare>
+RC BTreeIndexT<Key, Compare>::lookupBatchHelper(PageId pid, int curHeight, int height,
+                                                const vector<Key>& searchKeys,
+                                                unsigned begin, unsigned end,
+                                                vector<pair<Key, RecordId> >& entries)
+{
+	RC rc;
+
+	if (curHeight < height) {
+		shared_lock<shared_mutex> latch(latchOf(pid).latch);
+		NonLeafNode node;
+		if ((rc = node.read(pid, pf)) != 0) {
+			return rc;
+		}
+
+		// the keys are sorted, so the keys that go to the same child
+		// follow each other and are passed down in one call
+		while (begin < end) {
+			PageId child, next;
+			unsigned last = begin + 1;
+			node.locateFirstChildPtr(searchKeys[begin], child);
+			while (last < end && node.locateFirstChildPtr(searchKeys[last], next) == 0 && next == child) {
+				last++;
+			}
+			if ((rc = lookupBatchHelper(child, curHeight + 1, height, searchKeys, begin, last, entries)) != 0) {
+				return rc;
+			}
+			begin = last;
+		}
+		return 0;
+	}
+
+	for (unsigned i = begin; i < end; i++) {
+		// a key that repeats the previous one has been looked up already
+		if (i > 0 && !Compare()(searchKeys[i - 1], searchKeys[i])) {
+			continue;
+		}
+
+		// the entries of the key start in this leaf, or at the first entry
+		// of the next leaf if every key in this leaf is smaller. the leaf
+		// is read again only if the last key ran into the next leaves.
+		LeafNode* leaf;
+		IndexCursor cursor;
+		{
+			shared_lock<shared_mutex> latch(latchOf(pid).latch);
+			if ((rc = readLeaf(pid, leaf)) != 0) {
+				return rc;
+			}
+			cursor.pid = pid;
+			cursor.version = 0;
+			if (leaf->locate(searchKeys[i], cursor.eid) != 0) {
+				cursor.pid = leaf->getNextNodePtr();
+				cursor.eid = 0;
+			} else {
+				tie(cursor, leaf);
+			}
+		}
+
+		Key key;
+		RecordId rid;
+		while ((rc = readForward(cursor, key, rid)) == 0 && !Compare()(searchKeys[i], key)) {
+			entries.push_back(make_pair(key, rid));
+		}
+		if (rc != 0 && rc != RC_END_OF_TREE) {
+			return rc;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Tie the cursor to the entry at its eid in the leaf node, which the
+ * caller holds the latch of, so that the entry can be found again if the
+ * leaf changes. eid -1, the position before the first entry, is tied to
+ * the first entry. A cursor past the end of the leaf is not tied.
+ */
+template <class Key, class Compare>
+void BTreeIndexT<Key, Compare>::tie(IndexCursor& cursor, LeafNode* node)
+{
+	Key key;
+
+	if (node->readEntry(max(cursor.eid, 0), key, cursor.rid) == 0) {
+		cursor.version = latchOf(cursor.pid).version;
+	} else {
+		cursor.version = 0;
+	}
+}
+
+/*
+ * Latch and read the leaf of the cursor. If the cursor is tied to an
+ * entry and the leaf has changed since, the cursor is moved to where the
+ * entry is now. Entries only move to the right, by an insert before them
+ * or to a new leaf by a split, so the entry is searched from eid on, in
+ * this leaf and the ones after it.
+ * @param cursor[IN/OUT] the cursor
+ * @param latch[OUT] the shared latch of the leaf of the cursor
+ * @param node[OUT] the leaf of the cursor, from the leaf cache
+ * @return error code. RC_END_OF_TREE if the cursor is past the last leaf
+ */
+template <class Key, class Compare>
+RC BTreeIndexT<Key, Compare>::seek(IndexCursor& cursor, shared_lock<shared_mutex>& latch, LeafNode*& node)
+{
+	RC rc;
+	bool moved = false;
+	bool before = cursor.eid < 0;
+
+	for (;;) {
+		// pid 0 is the header page, so it marks the end of the leaf chain
+		latch = shared_lock<shared_mutex>();
+		if (cursor.pid <= 0) {
+			return RC_END_OF_TREE;
+		}
+
+		NodeLatch& nodeLatch = latchOf(cursor.pid);
+		latch = shared_lock<shared_mutex>(nodeLatch.latch);
+		if ((rc = readLeaf(cursor.pid, node)) != 0) {
+			return rc;
+		}
+		if (cursor.version == 0 || (!moved && cursor.version == nodeLatch.version)) {
+			return 0;
+		}
+
+		Key key;
+		RecordId rid;
+		for (int eid = max(cursor.eid, 0); node->readEntry(eid, key, rid) == 0; eid++) {
+			if (rid == cursor.rid) {
+				cursor.eid = before ? eid - 1 : eid;
+				cursor.version = nodeLatch.version;
+				return 0;
+			}
+		}
+		cursor.pid = node->getNextNodePtr();
+		cursor.eid = 0;
+		moved = true;
+	}
+}
+
+/*
+ * Move the cursor to the last entry of the leaf before the given leaf.
+ * The previous leaf is latched only after the given one is released, so
+ * it may have been split in between; then its next pointer no longer
+ * leads to the given leaf, and the previous leaf is looked up again.
+ * @param cursor[OUT] the cursor
+ * @param pid[IN] the leaf
+ * @param prevPid[IN] the previous leaf, as read from the leaf
+ * @return error code. 0 if no error
+ */
+template <class Key, class Compare>
+RC BTreeIndexT<Key, Compare>::moveToPrevLeaf(IndexCursor& cursor, PageId pid, PageId prevPid)
+{
+	RC rc;
+	LeafNode* node;
+
+	for (;;) {
+		cursor.pid = prevPid;
+		cursor.eid = -1;
+		cursor.version = 0;
+		if (prevPid == 0) {
+			return 0;
+		}
+
+		{
+			shared_lock<shared_mutex> latch(latchOf(prevPid).latch);
+			if ((rc = readLeaf(prevPid, node)) != 0) {
+				return rc;
+			}
+			if (node->getNextNodePtr() == pid) {
+				cursor.eid = node->getKeyCount() - 1;
+				tie(cursor, node);
+				return 0;
+			}
+		}
+
+		shared_lock<shared_mutex> latch(latchOf(pid).latch);
+		if ((rc = readLeaf(pid, node)) != 0) {
+			return rc;
+		}
+		prevPid = node->getPrevNodePtr();
+	}
+}
+
 /*
  * Read the (key, rid) pair at the location specified by the index cursor,
  * and move foward the cursor to the next entry.
@@ -257,30 +1140,209 @@ RC BTreeIndex::locate(int searchKey, IndexCursor& cursor)
  * @param rid[OUT] the RecordId stored at the index cursor location.
  * @return error code. 0 if no error
  */
-RC BTreeIndex::readForward(IndexCursor& cursor, int& key, RecordId& rid)
+template <class Key, class Compare>
+RC BTreeIndexT<Key, Compare>::readForward(IndexCursor& cursor, Key& key, RecordId& rid)
 {
-	//node is a temp node that we can read from
-	BTLeafNode node;
-	int nodeSize = (sizeof(RecordId) + sizeof(int));
+	//node is the leaf of the cursor, shared with the previous call
+	LeafNode* node;
+	shared_lock<shared_mutex> latch;
 
 	//return code
-	int rc = 0;
-	rc = node.read(cursor.pid, pf);
+	RC rc = seek(cursor, latch, node);
 
 	//if rc has an error code
-	if( rc != 0) {
+	if (rc != 0) {
 		return rc;
 	}
 
-	rc = node.readEntry(cursor.eid, key, rid);
+	rc = node->readEntry(cursor.eid, key, rid);
+	if (rc != 0) {
+		return RC_INVALID_CURSOR;
+	}
+
+	// the first entry of the next leaf does not move, so the cursor is
+	// tied only within a leaf
 	cursor.eid++;
+	if (cursor.eid >= node->getKeyCount()) {
+		cursor.eid = 0;
+		cursor.version = 0;
+		cursor.pid = node->getNextNodePtr();
+	} else {
+		tie(cursor, node);
+	}
+
+	return 0;
+}
+
+/*
+ * Move the cursor forward by count entries without reading them.
+ * @param cursor[IN/OUT] the cursor pointing to an leaf-node index entry in the b+tree
+ * @param count[IN] the number of entries to skip
+ * @return error code. RC_END_OF_TREE if the tree ended before count entries
+ */
+template <class Key, class Compare>
+RC BTreeIndexT<Key, Compare>::skipForward(IndexCursor& cursor, int count)
+{
+	LeafNode* node;
+	shared_lock<shared_mutex> latch;
+	RC rc;
+
+	while (count > 0) {
+		if ((rc = seek(cursor, latch, node)) != 0) {
+			return rc;
+		}
 
-	int testKey;
-	RecordId testRid;
-	if(node.readEntry(cursor.eid, testKey, testRid) == RC_NO_SUCH_RECORD) {
+		// skip within this leaf, or skip the rest of it at once
+		int remaining = node->getKeyCount() - cursor.eid;
+		if (count < remaining) {
+			cursor.eid += count;
+			tie(cursor, node);
+			return 0;
+		}
+		count -= remaining;
 		cursor.eid = 0;
-		cursor.pid = node.getNextNodePtr();
+		cursor.version = 0;
+		cursor.pid = node->getNextNodePtr();
+	}
+
+	return 0;
+}
+
+/*
+ * Find the last leaf-node index entry whose key value is smaller than
+ * or equal to searchKey, and output its location in IndexCursor.
+ * @param searchKey[IN] the key to find
+ * @param cursor[OUT] the cursor pointing to the last index entry
+ *                    with a key value <= searchKey
+ * @return error code. RC_NO_SUCH_RECORD if every key is larger
+ */
+template <class Key, class Compare>
+RC BTreeIndexT<Key, Compare>::locateLast(const Key& searchKey, IndexCursor& cursor)
+{
+	RC rc;
+
+	cursor.pid = 0;
+	cursor.eid = -1;
+	cursor.version = 0;
+
+	if (pending > 0 && (rc = flushBuffers()) != 0) {
+		return rc;
+	}
+
+	// the entries equal to a separator end in the subtree to its right,
+	// so this finds the leaf with the last key <= searchKey, unless
+	// searchKey is smaller than every key of that leaf
+	shared_lock<shared_mutex> latch;
+	PageId pid;
+	if ((rc = descend(searchKey, false, latch, pid)) != 0) {
+		return rc;
+	}
+
+	LeafNode* leaf;
+	if ((rc = readLeaf(pid, leaf)) != 0) {
+		return rc;
+	}
+
+	// if every key in this leaf is larger, the answer is the last entry
+	// of the previous leaf, which readBackward() moves to
+	if (leaf->locateLast(searchKey, cursor.eid) != 0) {
+		if (leaf->getPrevNodePtr() == 0) {
+			return RC_NO_SUCH_RECORD;
+		}
+		cursor.eid = -1;
+	}
+
+	cursor.pid = pid;
+	tie(cursor, leaf);
+	return 0;
+}
+
+/*
+ * Read the (key, rid) pair at the location specified by the index cursor,
+ * and move the cursor backward to the previous entry.
+ * @param cursor[IN/OUT] the cursor pointing to an leaf-node index entry in the b+tree
+ * @param key[OUT] the key stored at the index cursor location.
+ * @param rid[OUT] the RecordId stored at the index cursor location.
+ * @return error code. RC_END_OF_TREE if the cursor is before the first entry
+ */
+template <class Key, class Compare>
+RC BTreeIndexT<Key, Compare>::readBackward(IndexCursor& cursor, Key& key, RecordId& rid)
+{
+	LeafNode* node;
+	shared_lock<shared_mutex> latch;
+	RC rc;
+
+	if ((rc = seek(cursor, latch, node)) != 0) {
+		return rc;
+	}
+
+	// eid -1 stands for the position before the first entry of the leaf.
+	// the cursor moves to the previous leaf only now, so that a scan that
+	// stops at the first entry of a leaf does not read one more leaf
+	if (cursor.eid < 0) {
+		PageId pid = cursor.pid;
+		PageId prevPid = node->getPrevNodePtr();
+		latch.unlock();
+		if ((rc = moveToPrevLeaf(cursor, pid, prevPid)) != 0) {
+			return rc;
+		}
+		if ((rc = seek(cursor, latch, node)) != 0) {
+			return rc;
+		}
+	}
+
+	if (node->readEntry(cursor.eid, key, rid) != 0) {
+		return RC_INVALID_CURSOR;
+	}
+
+	cursor.eid--;
+	tie(cursor, node);
+
+	return 0;
+}
+
+/*
+ * Move the cursor backward by count entries without reading them.
+ * @param cursor[IN/OUT] the cursor pointing to an leaf-node index entry in the b+tree
+ * @param count[IN] the number of entries to skip
+ * @return error code. RC_END_OF_TREE if the tree ended before count entries
+ */
+template <class Key, class Compare>
+RC BTreeIndexT<Key, Compare>::skipBackward(IndexCursor& cursor, int count)
+{
+	LeafNode* node;
+	shared_lock<shared_mutex> latch;
+	RC rc;
+
+	while (count > 0) {
+		if ((rc = seek(cursor, latch, node)) != 0) {
+			return rc;
+		}
+
+		// entries 0..eid are left in this leaf
+		int remaining = cursor.eid + 1;
+		if (count < remaining) {
+			cursor.eid -= count;
+			tie(cursor, node);
+			return 0;
+		}
+		count -= remaining;
+		cursor.eid = -1;
+		tie(cursor, node);
+		if (count == 0) {
+			return 0;
+		}
+
+		PageId pid = cursor.pid;
+		PageId prevPid = node->getPrevNodePtr();
+		latch.unlock();
+		if ((rc = moveToPrevLeaf(cursor, pid, prevPid)) != 0) {
+			return rc;
+		}
 	}
 
 	return 0;
 }
+
+// the key types that the index is compiled for
+template class BTreeIndexT<int>;
@@ -10,30 +10,71 @@
 #ifndef BTREEINDEX_H
 #define BTREEINDEX_H
 
+#include <vector>
+#include <map>
+#include <utility>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
 #include "Bruinbase.h"
 #include "PageFile.h"
 #include "RecordFile.h"
+#include "BTreeNode.h"
 
 /**
  * The data structure to point to a particular entry at a b+tree leaf node.
  * An IndexCursor consists of pid (PageId of the leaf node) and
  * eid (the location of the index entry inside the node).
  * IndexCursor is used for index lookup and traversal.
+ * The index also ties the cursor to the entry at eid, so that the entry
+ * can be found again if another thread changes the leaf in the meantime.
  */
 typedef struct {
   // PageId of the index entry
-  PageId  pid;
+  PageId   pid;
   // The entry number inside the node
-  int     eid;
+  int      eid;
+  // The version of the node when eid was set. 0 if not tied to an entry
+  unsigned version;
+  // The RecordId of the entry at eid when the cursor was tied to it
+  RecordId rid;
 } IndexCursor;
 
 /**
  * Implements a B-Tree index for bruinbase.
+ * The index is generic in the type of its keys and their order, with
+ * the same restrictions as BTLeafNodeT. BTreeIndex is the index on the
+ * int key of a table.
  *
+ * Several threads may use one open index at the same time: locate(),
+ * lookupBatch(), the read and skip calls, insert() and insertBatch() can
+ * run together.
+ * Every node has a latch. A descent holds the latch of a node until the
+ * latch of its child is taken (latch crabbing): readers take shared
+ * latches, and insert() takes a shared latch on each non-leaf node and an
+ * exclusive one on the leaf. If the leaf is full, insert() descends again
+ * with exclusive latches and keeps the latches of the nodes that the split
+ * may reach, i.e., from the lowest node with room left down to the leaf.
+ * A cursor holds no latch between calls. It remembers the RecordId of its
+ * entry and finds it again if the leaf has changed, so a scan running
+ * during inserts returns each entry at most once and misses none that was
+ * in the index when the scan started.
+ *
+ * With setBuffered(true), insert() does not go down to a leaf at once.
+ * The entry waits in the buffer of the root, and a full buffer of a node
+ * is passed down to the buffers of its children in key order, as in a
+ * B-epsilon tree. The buffers of the nodes just above the leaves go into
+ * the leaves with insertBatch(), so a leaf is read and written once for
+ * all the buffered entries it gets rather than once per entry. locate(),
+ * locateLast() and lookupBatch() push every buffered entry down to the
+ * leaves before they descend, and so does close().
+ * open(), close(), the bulk load and the setters are not thread-safe.
  */
-class BTreeIndex {
+template <class Key, class Compare = std::less<Key> >
+class BTreeIndexT {
  public:
-  BTreeIndex();
+  BTreeIndexT();
+  ~BTreeIndexT();
 
   /**
    * Open the index file in read or write mode.
@@ -56,14 +97,75 @@ class BTreeIndex {
    * @param rid[IN] the RecordId for the record being inserted into the index
    * @return error code. 0 if no error
    */
-  RC insert(int key, const RecordId& rid);
+  RC insert(const Key& key, const RecordId& rid);
+
+  /**
+   * Insert many (key, RecordId) pairs. The pairs that go to the same leaf
+   * are inserted with one descent and one write of the leaf, as long as
+   * they fit. A pair that does not fit goes through insert(), which splits
+   * the leaf, and the rest continue from there.
+   * @param entries[IN] the (key, RecordId) pairs, in ascending key order
+   * @return error code. 0 if no error
+   */
+  RC insertBatch(const std::vector<std::pair<Key, RecordId> >& entries);
+
+  /**
+   * Recursive helper. Inserts (key, rid) into the subtree rooted at pid,
+   * which sits at level curHeight (the root is at level 1) of a tree of
+   * the given height. The exclusive latch of each node is added to held,
+   * and the latches above a node that has room for one more entry are
+   * released, together with the header latch.
+   * Returns RC_NODE_FULL if the node at pid was split; the new sibling
+   * must then be inserted into the parent as (siblingKey, siblingPid).
+   */
+  RC insertHelper(PageId pid, const Key& key, const RecordId& rid,
+                int curHeight, int height, PageId& siblingPid, Key& siblingKey,
+                std::unique_lock<std::shared_mutex>& header,
+                std::vector<std::unique_lock<std::shared_mutex> >& held);
 
+  /**
+   * Add (key, RecordId) pair to an index that is built bottom-up.
+   * The pairs must come in ascending key order, and the index must be
+   * empty when the first pair is added. Each leaf is filled before the
+   * next one is started, and the leaves are stored on consecutive pages.
+   * Call finishBulkLoad() after the last pair; the index cannot be read
+   * or changed in any other way until then.
+   * @param key[IN] the key for the value inserted into the index
+   * @param rid[IN] the RecordId for the record being inserted into the index
+   * @return error code. RC_INVALID_FILE_MODE if the index is not empty
+   */
+  RC bulkInsert(const Key& key, const RecordId& rid);
 
   /**
-   * Recursive helper
+   * Choose how full bulkInsert() and finishBulkLoad() make the nodes.
+   * Free room in the nodes lets later inserts go in without splits.
+   * The fill applies to the number of entries; a compressed leaf may
+   * still run out of space first.
+   * @param percent[IN] the fill factor in percent, from 10 to 100
+   * @return error code. RC_INVALID_ATTRIBUTE if percent is out of range
+   */
+  RC setFillFactor(int percent);
+
+  /**
+   * Choose whether insert() buffers the new entries in the non-leaf nodes.
+   * The buffers are kept in memory; turning buffering off pushes the
+   * buffered entries down to the leaves.
+   * @param buffer[IN] true to buffer the inserts
+   * @return error code. 0 if no error
    */
-  RC insertHelper(PageId pid, int key, const RecordId& rid,
-                int curHeight, int& siblingPid, int& siblingKey);
+  RC setBuffered(bool buffer);
+
+  /**
+   * @return true if insert() buffers the new entries
+   */
+  bool isBuffered() const { return buffered; }
+
+  /**
+   * Write the last leaf of a bottom-up build and the non-leaf levels above
+   * the leaves. Does nothing if bulkInsert() was not called.
+   * @return error code. 0 if no error
+   */
+  RC finishBulkLoad();
 
   /**
    * Find the leaf-node index entry whose key value is larger than or
@@ -85,7 +187,20 @@ class BTreeIndex {
    * with the key value
    * @return error code. 0 if no error.
    */
-  RC locate(int searchKey, IndexCursor& cursor);
+  RC locate(const Key& searchKey, IndexCursor& cursor);
+
+  /**
+   * Find the index entries of many keys at once. The tree is descended
+   * once for all of them: the keys that lead to the same child are passed
+   * down together, so each node on the way is read once, and the leaves
+   * are visited from left to right.
+   * @param searchKeys[IN] the keys to find, in ascending order
+   * @param entries[OUT] the (key, RecordId) pairs of the entries whose key
+   * is one of searchKeys, in key order
+   * @return error code. 0 if no error
+   */
+  RC lookupBatch(const std::vector<Key>& searchKeys,
+                 std::vector<std::pair<Key, RecordId> >& entries);
 
   /**
    * Read the (key, rid) pair at the location specified by the index cursor,
@@ -95,17 +210,277 @@ class BTreeIndex {
    * @param rid[OUT] the RecordId stored at the index cursor location
    * @return error code. 0 if no error
    */
-  RC readForward(IndexCursor& cursor, int& key, RecordId& rid);
+  RC readForward(IndexCursor& cursor, Key& key, RecordId& rid);
+
+  /**
+   * Move the cursor forward by count entries without reading them.
+   * Entries are counted at the leaf level: a whole leaf is skipped
+   * with a single page read, and no RecordFile access is needed.
+   * @param cursor[IN/OUT] the cursor pointing to an leaf-node index entry in the b+tree
+   * @param count[IN] the number of entries to skip
+   * @return error code. RC_END_OF_TREE if the tree ended before count entries
+   */
+  RC skipForward(IndexCursor& cursor, int count);
+
+  /**
+   * Find the last leaf-node index entry whose key value is smaller than
+   * or equal to searchKey and output its location in cursor.
+   * Use readBackward() with the cursor to scan the keys in descending order.
+   * Call it with the largest key, e.g. INT_MAX, to find the last entry
+   * of the tree.
+   * @param searchKey[IN] the key to find
+   * @param cursor[OUT] the cursor pointing to the last index entry
+   * with a key value &lt;= searchKey
+   * @return error code. RC_NO_SUCH_RECORD if every key is larger
+   */
+  RC locateLast(const Key& searchKey, IndexCursor& cursor);
+
+  /**
+   * Read the (key, rid) pair at the location specified by the index cursor,
+   * and move the cursor backward to the previous entry.
+   * After the first entry of a leaf, the eid of the cursor is set to -1,
+   * which stands for the position before the first entry. The cursor
+   * moves on to the previous leaf on the next call. Such a cursor can only
+   * be used with readBackward() and skipBackward().
+   * @param cursor[IN/OUT] the cursor pointing to an leaf-node index entry in the b+tree
+   * @param key[OUT] the key stored at the index cursor location
+   * @param rid[OUT] the RecordId stored at the index cursor location
+   * @return error code. RC_END_OF_TREE if the cursor is before the first entry
+   */
+  RC readBackward(IndexCursor& cursor, Key& key, RecordId& rid);
+
+  /**
+   * Move the cursor backward by count entries without reading them.
+   * @param cursor[IN/OUT] the cursor pointing to an leaf-node index entry in the b+tree
+   * @param count[IN] the number of entries to skip
+   * @return error code. RC_END_OF_TREE if the tree ended before count entries
+   */
+  RC skipBackward(IndexCursor& cursor, int count);
+
+  /**
+   * @return the height of the tree. 0 if the tree is empty.
+   * not synchronized with concurrent inserts
+   */
+  int getTreeHeight() const { return treeHeight; }
+
+  /**
+   * Choose whether the leaves created from now on are compressed.
+   * The choice is saved in the index file. Every leaf records its own
+   * format, so an index can mix both. Only int keys are compressed.
+   * @param compress[IN] true to compress the leaves
+   */
+  void setCompressed(bool compress);
+
+  /**
+   * @return true if new leaves are compressed
+   */
+  bool isCompressed() const { return compressed; }
+
+  /**
+   * Record whether the table of the index is stored in key order, i.e.,
+   * whether the rids of the leaf entries are in ascending order as well.
+   * The flag is saved in the index file.
+   * @param inKeyOrder[IN] true if the table is clustered on the key
+   */
+  void setClustered(bool inKeyOrder);
+
+  /**
+   * @return true if the table of the index is stored in key order
+   */
+  bool isClustered() const { return clustered; }
 
  private:
+  typedef BTLeafNodeT<Key, Compare> LeafNode;
+  typedef BTNonLeafNodeT<Key, Compare> NonLeafNode;
+
+  // # of entries that the buffer of a non-leaf node holds before it is
+  // passed down to the children
+  static const unsigned BUFFER_ENTRIES = 4096;
+
+  // the entries that wait at a non-leaf node to go down the tree
+  struct NodeBuffer {
+    int level;  // # of levels from the node down to the leaves. 1 above a leaf
+    std::vector<std::pair<Key, RecordId> > entries;
+  };
+
+  // the latch of a node, and its version: 1 plus the # of times the node
+  // has been written, which tells a thread whether its cached copy of a
+  // leaf, or a cursor into it, is current
+  struct NodeLatch {
+    std::shared_mutex     latch;
+    std::atomic<unsigned> version;
+  };
+
+  // the latches are kept in chunks of growing size: chunk i holds the
+  // latches of LATCH_CHUNK << i pages. a chunk is created when one of its
+  // pages is first latched and is never moved, so no lock is needed to
+  // find a latch
+  static const int LATCH_CHUNK = 1024;
+  static const int LATCH_CHUNKS = 32;
+
+  // the leaf that the last scan step of a thread read
+  struct LeafCache {
+    unsigned long owner;   // the openId of the index. 0 if none
+    PageId        pid;
+    unsigned      version; // the version of the node when it was read
+    LeafNode      node;
+  };
+
+  /**
+   * @return the latch of the node at pid
+   */
+  NodeLatch& latchOf(PageId pid);
+
+  /**
+   * Read a leaf through the one-node cache of the calling thread.
+   * The caller must hold the latch of the leaf.
+   * @param pid[IN] the leaf to read
+   * @param node[OUT] the cached node. valid until the next readLeaf
+   * @return error code. 0 if no error
+   */
+  RC readLeaf(PageId pid, LeafNode*& node);
+
+  /**
+   * Tie the cursor to the entry at its eid in node, the leaf of the cursor.
+   * The caller must hold the latch of the leaf.
+   */
+  void tie(IndexCursor& cursor, LeafNode* node);
+
+  /**
+   * Latch and read the leaf of the cursor, and move the cursor to where
+   * its entry is now if the leaf has changed since it was tied.
+   * @param cursor[IN/OUT] the cursor
+   * @param latch[OUT] the shared latch of the leaf of the cursor
+   * @param node[OUT] the leaf of the cursor, from the leaf cache
+   * @return error code. RC_END_OF_TREE if the cursor is past the last leaf
+   */
+  RC seek(IndexCursor& cursor, std::shared_lock<std::shared_mutex>& latch, LeafNode*& node);
+
+  /**
+   * Move the cursor to the last entry of the leaf before the leaf pid.
+   * @param cursor[OUT] the cursor. its pid is 0 if pid is the first leaf
+   * @param pid[IN] the leaf
+   * @param prevPid[IN] the previous leaf, as read from the leaf
+   * @return error code. 0 if no error
+   */
+  RC moveToPrevLeaf(IndexCursor& cursor, PageId pid, PageId prevPid);
+
+  /**
+   * Write a node and bump its version. The caller must hold the exclusive
+   * latch of the node, or be the only user of the index.
+   */
+  template <class Node>
+  RC writeNode(Node& node, PageId pid);
+
+  /**
+   * @return a new page for a node. unlike pf.endPid(), two threads
+   * never get the same page
+   */
+  PageId allocatePage();
+
+  /**
+   * Insert (key, rid) if it fits into its leaf, with an exclusive latch on
+   * the leaf only.
+   * @return error code. RC_NODE_FULL if the leaf is full or the tree empty
+   */
+  RC insertIntoLeaf(const Key& key, const RecordId& rid);
+
+  /**
+   * Insert (key, rid) down to its leaf, splitting the nodes on the way if
+   * needed. insert() without buffering.
+   * @return error code. 0 if no error
+   */
+  RC insertIntoTree(const Key& key, const RecordId& rid);
+
+  /**
+   * Pass the buffer of the node at pid down: into the leaves if the node
+   * is just above them, into the buffers of its children otherwise, which
+   * are passed down in turn once full. The caller holds bufferMutex.
+   * @param pid[IN] the node with a buffer
+   * @return error code. 0 if no error
+   */
+  RC flushBuffer(PageId pid);
+
+  /**
+   * Push every buffered entry down to the leaves, the buffers nearest to
+   * the root first.
+   * @return error code. 0 if no error
+   */
+  RC flushBuffers();
+
+  /**
+   * Insert entries[begin], and the entries after it that belong to the
+   * same leaf and fit into it, with an exclusive latch on the leaf only.
+   * @param inserted[OUT] the # of entries inserted
+   * @return error code. RC_NODE_FULL if entries[begin] does not fit or
+   * the tree is empty
+   */
+  RC insertRunIntoLeaf(const std::vector<std::pair<Key, RecordId> >& entries,
+                       unsigned begin, unsigned& inserted);
+
+  /**
+   * Descend from the root to the leaf whose key range holds searchKey,
+   * with shared latches.
+   * @param searchKey[IN] the key to find
+   * @param first[IN] true to find the leaf of the first entry with a key
+   *                  >= searchKey, false for the last entry <= searchKey
+   * @param leafLatch[OUT] the shared latch of the leaf
+   * @param pid[OUT] the leaf
+   * @return error code. RC_NO_SUCH_RECORD if the tree is empty
+   */
+  RC descend(const Key& searchKey, bool first,
+             std::shared_lock<std::shared_mutex>& leafLatch, PageId& pid);
+
+  /**
+   * Recursive helper of lookupBatch(). Finds the entries of
+   * searchKeys[begin..end) in the subtree rooted at pid, which sits at
+   * level curHeight of a tree of the given height. The caller holds the
+   * shared latch of the parent of pid.
+   */
+  RC lookupBatchHelper(PageId pid, int curHeight, int height,
+                       const std::vector<Key>& searchKeys,
+                       unsigned begin, unsigned end,
+                       std::vector<std::pair<Key, RecordId> >& entries);
+
+  /**
+   * Save rootPid and treeHeight to page 0 of the index file.
+   * @return error code. 0 if no error
+   */
+  RC writeHeader();
+
   PageFile pf;         /// the PageFile used to store the actual b+tree in disk
 
   PageId   rootPid;    /// the PageId of the root node
   int      treeHeight; /// the height of the tree
-  /// Note that the content of the above two variables will be gone when
+  bool     dirty;      /// true if rootPid or treeHeight must be saved on close
+  bool     compressed; /// true if new leaves are compressed
+  bool     clustered;  /// true if the table is stored in key order
+
+  int      fillPercent;   /// how full bulkInsert() makes the nodes
+  bool     buffered;      /// true if insert() buffers the new entries
+  std::map<PageId, NodeBuffer> buffers; /// the buffers of the non-leaf nodes
+  std::mutex bufferMutex;              /// guards buffers
+  std::atomic<long> pending;           /// # of entries in the buffers
+  LeafNode bulkLeaf;      /// the leaf that bulkInsert() is filling
+  PageId   bulkLeafPid;   /// the PageId of bulkLeaf. -1 if no bulk load is running
+  std::vector<std::pair<Key, PageId> > bulkLeaves; /// the first key and PageId of the stored leaves
+
+  std::shared_mutex headerLatch; /// guards rootPid, treeHeight and dirty
+  std::atomic<NodeLatch*> latchChunks[LATCH_CHUNKS]; /// the node latches
+
+  std::mutex allocMutex;  /// guards nextPid
+  PageId     nextPid;     /// the next page allocatePage() may return
+
+  unsigned long openId;   /// tells the leaf caches of this open index apart
+  static std::atomic<unsigned long> opens;          /// # of opens of any index
+  static thread_local LeafCache leafCache;          /// the leaf cache of a thread
+  /// Note that the content of rootPid and treeHeight will be gone when
   /// this class is destructed. Make sure to store the values of the two
   /// variables in disk, so that they can be reconstructed when the index
   /// is opened again later.
 };
 
+// the index on the key column of a table
+typedef BTreeIndexT<int> BTreeIndex;
+
 #endif /* BTREEINDEX_H */
@@ -1,24 +1,97 @@
 #include "BTreeNode.h"
 #include <climits>
+#include <cstring>
 
 using namespace std;
 
+//
+// Page layout of the nodes.
+//
+// leaf node:    [rid key] [rid key] ... [rid key] ... prevPid keyCount nextPid
+// nonleaf node: pid [key pid] [key pid] ... [key pid] ... keyCount
+//
+// The key count is kept at a fixed location at the end of the page, so a node
+// can be read back without scanning the entries for an end marker.
+// A key takes sizeof(Key) bytes.
+//
+
+// location of prevPid, keyCount and nextPid in a leaf page
+static const int LEAF_PREV_OFFSET = PageFile::PAGE_SIZE - 3 * sizeof(int);
+static const int LEAF_COUNT_OFFSET = PageFile::PAGE_SIZE - 2 * sizeof(int);
+static const int LEAF_NEXT_OFFSET = PageFile::PAGE_SIZE - sizeof(int);
+
+// location of keyCount in a nonleaf page
+static const int NONLEAF_COUNT_OFFSET = PageFile::PAGE_SIZE - sizeof(int);
+
+//
+// A compressed leaf keeps the same trailer, with PACKED_FLAG set in keyCount:
+//
+//   baseKey basePid keyBits pidBits sidBits - [key offsets] [pid offsets] [sids]
+//   ... prevPid keyCount|PACKED_FLAG nextPid
+//
+// entry i has the key baseKey + (the i'th keyBits-bit key offset) and the
+// rid (basePid + the i'th pid offset, the i'th sid). each of the three
+// bit streams starts at a byte boundary. the bases are the smallest key
+// and pid of the leaf, so dense keys and rids take only a few bits each.
+//
+static const int PACKED_FLAG = 0x40000000;
+static const int PACKED_HEADER_SIZE = 3 * sizeof(int);
+
+// bytes needed for n values of the given bit width
+static int streamSize(int n, int width)
+{
+	return (n * width + 7) / 8;
+}
+
+// bits needed to store the value
+static int bitWidth(unsigned value)
+{
+	int width = 0;
+	while (value != 0) {
+		width++;
+		value >>= 1;
+	}
+	return width;
+}
+
+// write n values of the given bit width to a zeroed stream
+static void packBits(unsigned char* stream, int width, int n, const unsigned* values)
+{
+	unsigned long long word;
+
+	for (int i = 0; i < n; i++) {
+		int bit = i * width;
+		memcpy(&word, stream + (bit >> 3), sizeof(word));
+		word |= (unsigned long long) values[i] << (bit & 7);
+		memcpy(stream + (bit >> 3), &word, sizeof(word));
+	}
+}
+
+// read n values of the given bit width. every value is one unaligned
+// 64-bit load, a shift and a mask, with no branch in the loop.
+// the stream must be followed by 8 readable bytes.
+static void unpackBits(const unsigned char* stream, int width, int n, unsigned* values)
+{
+	unsigned long long mask = (1ULL << width) - 1;
+	unsigned long long word;
+
+	for (int i = 0; i < n; i++) {
+		int bit = i * width;
+		memcpy(&word, stream + (bit >> 3), sizeof(word));
+		values[i] = (unsigned) ((word >> (bit & 7)) & mask);
+	}
+}
+
 // BTLeafNode constructor.  Keeps track of the current key count; be sure to
 //	increment whenever adding a new element
-
-const int NULL_VALUE = INT_MIN; //int min +1 for portability
-BTLeafNode::BTLeafNode()
+template <class Key, class Compare>
+BTLeafNodeT<Key, Compare>::BTLeafNodeT()
 {
 	keyCount = 0;
 	nextPid = 0;
-	int i = 0;
-	char* iter = &(buffer[0]);
-	const int neg = NULL_VALUE;
-	while(i < sizeof(buffer)) {
-		memcpy(iter, &neg, sizeof(int));
-		i += sizeof(int);
-		iter += sizeof(int);
-	}
+	prevPid = 0;
+	packed = false;
+	memset(buffer, 0, sizeof(buffer));
 }
 
 /*
@@ -27,25 +100,38 @@ BTLeafNode::BTLeafNode()
  * @param pf[IN] PageFile to read from
  * @return 0 if successful. Return an error code if there is an error.
  */
-RC BTLeafNode::read(PageId pid, const PageFile& pf)
+template <class Key, class Compare>
+RC BTLeafNodeT<Key, Compare>::read(PageId pid, const PageFile& pf)
 {
-	RC ret =  pf.read(pid, buffer);
-	char* iter = &(buffer[0]);
-	int check;
-	int i = 0;
-	int nodeSize = sizeof(RecordId) + sizeof(int);
-	memcpy(&check, iter, sizeof(int));
-	while (check != NULL_VALUE && iter < &(buffer[PageFile::PAGE_SIZE])) {
-		keyCount++;
-		iter += nodeSize;
-		memcpy(&check, iter, sizeof(int));
+	RC rc = pf.read(pid, buffer);
+	if (rc < 0) {
+		return rc;
+	}
+
+	memcpy(&keyCount, buffer + LEAF_COUNT_OFFSET, sizeof(int));
+	memcpy(&nextPid, buffer + LEAF_NEXT_OFFSET, sizeof(PageId));
+	memcpy(&prevPid, buffer + LEAF_PREV_OFFSET, sizeof(PageId));
+
+	packed = (keyCount & PACKED_FLAG) != 0;
+	if (packed) {
+		keyCount &= ~PACKED_FLAG;
+		if (!LeafPacking<Key>::ENABLED || keyCount > MAX_PACKED_KEY_COUNT) {
+			keyCount = 0;
+			return RC_INVALID_FILE_FORMAT;
+		}
+
+		char page[PageFile::PAGE_SIZE];
+		memcpy(page, buffer, PageFile::PAGE_SIZE);
+		unpack(page);
+		return 0;
 	}
 
-	iter -= nodeSize;
-	iter += sizeof(int);
-	memcpy(&nextPid, iter, sizeof(int));
+	if (keyCount < 0 || keyCount > MAX_KEY_COUNT) {
+		keyCount = 0;
+		return RC_INVALID_FILE_FORMAT;
+	}
 
-	return ret;
+	return 0;
 }
 
 /*
@@ -54,18 +140,133 @@ RC BTLeafNode::read(PageId pid, const PageFile& pf)
  * @param pf[IN] PageFile to write to
  * @return 0 if successful. Return an error code if there is an error.
  */
-RC BTLeafNode::write(PageId pid, PageFile& pf)
+template <class Key, class Compare>
+RC BTLeafNodeT<Key, Compare>::write(PageId pid, PageFile& pf)
 {
+	if (packed) {
+		char page[PageFile::PAGE_SIZE];
+		if (!pack(page)) {
+			return RC_INVALID_FILE_FORMAT;
+		}
+		return pf.write(pid, page);
+	}
+
+	memcpy(buffer + LEAF_COUNT_OFFSET, &keyCount, sizeof(int));
+	memcpy(buffer + LEAF_NEXT_OFFSET, &nextPid, sizeof(PageId));
+	memcpy(buffer + LEAF_PREV_OFFSET, &prevPid, sizeof(PageId));
 	return pf.write(pid, buffer);
 }
 
+/*
+ * Encode the entries of a compressed node into page.
+ * @param page[OUT] the page to write
+ * @return false if the entries do not fit in a page
+ */
+template <class Key, class Compare>
+bool BTLeafNodeT<Key, Compare>::pack(char* page) const
+{
+	unsigned keys[MAX_PACKED_KEY_COUNT];
+	unsigned pids[MAX_PACKED_KEY_COUNT];
+	unsigned sids[MAX_PACKED_KEY_COUNT];
+	unsigned baseKey = 0;
+	unsigned basePid = 0;
+	unsigned maxKey = 0;
+	unsigned maxPid = 0;
+	unsigned maxSid = 0;
+	RecordId rid;
+
+	for (int i = 0; i < keyCount; i++) {
+		memcpy(&rid, buffer + i * ENTRY_SIZE, sizeof(RecordId));
+		keys[i] = LeafPacking<Key>::toUnsigned(keyAt(i));
+		pids[i] = rid.pid;
+		sids[i] = rid.sid;
+		if (i == 0 || keys[i] < baseKey) baseKey = keys[i];
+		if (i == 0 || pids[i] < basePid) basePid = pids[i];
+		if (keys[i] > maxKey) maxKey = keys[i];
+		if (pids[i] > maxPid) maxPid = pids[i];
+		if (sids[i] > maxSid) maxSid = sids[i];
+	}
+	for (int i = 0; i < keyCount; i++) {
+		keys[i] -= baseKey;
+		pids[i] -= basePid;
+	}
+
+	unsigned char widths[3];
+	widths[0] = bitWidth(maxKey - baseKey);
+	widths[1] = bitWidth(maxPid - basePid);
+	widths[2] = bitWidth(maxSid);
+
+	int keySize = streamSize(keyCount, widths[0]);
+	int pidSize = streamSize(keyCount, widths[1]);
+	int sidSize = streamSize(keyCount, widths[2]);
+	if (PACKED_HEADER_SIZE + keySize + pidSize + sidSize > LEAF_PREV_OFFSET) {
+		return false;
+	}
+
+	memset(page, 0, PageFile::PAGE_SIZE);
+	memcpy(page, &baseKey, sizeof(unsigned));
+	memcpy(page + sizeof(unsigned), &basePid, sizeof(unsigned));
+	memcpy(page + 2 * sizeof(unsigned), widths, sizeof(widths));
+
+	unsigned char* stream = (unsigned char*) page + PACKED_HEADER_SIZE;
+	packBits(stream, widths[0], keyCount, keys);
+	packBits(stream + keySize, widths[1], keyCount, pids);
+	packBits(stream + keySize + pidSize, widths[2], keyCount, sids);
+
+	int count = keyCount | PACKED_FLAG;
+	memcpy(page + LEAF_COUNT_OFFSET, &count, sizeof(int));
+	memcpy(page + LEAF_NEXT_OFFSET, &nextPid, sizeof(PageId));
+	memcpy(page + LEAF_PREV_OFFSET, &prevPid, sizeof(PageId));
+	return true;
+}
+
+/*
+ * Decode the entries of a compressed node from page into buffer.
+ * keyCount must be set already.
+ * @param page[IN] the page that was read
+ */
+template <class Key, class Compare>
+void BTLeafNodeT<Key, Compare>::unpack(const char* page)
+{
+	unsigned keys[MAX_PACKED_KEY_COUNT];
+	unsigned pids[MAX_PACKED_KEY_COUNT];
+	unsigned sids[MAX_PACKED_KEY_COUNT];
+	unsigned baseKey;
+	unsigned basePid;
+	unsigned char widths[3];
+
+	memcpy(&baseKey, page, sizeof(unsigned));
+	memcpy(&basePid, page + sizeof(unsigned), sizeof(unsigned));
+	memcpy(widths, page + 2 * sizeof(unsigned), sizeof(widths));
+
+	// the streams end before the trailer, so the 64-bit loads of
+	// unpackBits() stay within the page
+	const unsigned char* stream = (const unsigned char*) page + PACKED_HEADER_SIZE;
+	int keySize = streamSize(keyCount, widths[0]);
+	int pidSize = streamSize(keyCount, widths[1]);
+	unpackBits(stream, widths[0], keyCount, keys);
+	unpackBits(stream + keySize, widths[1], keyCount, pids);
+	unpackBits(stream + keySize + pidSize, widths[2], keyCount, sids);
+
+	char* iter = buffer;
+	for (int i = 0; i < keyCount; i++) {
+		RecordId rid;
+		Key key = LeafPacking<Key>::fromUnsigned(keys[i] + baseKey);
+		rid.pid = pids[i] + basePid;
+		rid.sid = sids[i];
+		memcpy(iter, &rid, sizeof(RecordId));
+		memcpy(iter + sizeof(RecordId), &key, sizeof(Key));
+		iter += ENTRY_SIZE;
+	}
+}
+
 /*
  * Return the number of keys stored in the node.
  * @return the number of keys in the node
  */
-int BTLeafNode::getKeyCount()
+template <class Key, class Compare>
+int BTLeafNodeT<Key, Compare>::getKeyCount()
 {
-	//fprintf(stdout, "Key count is %d\n", keyCount);
 	return keyCount;
 }
 
@@ -75,33 +276,39 @@ int BTLeafNode::getKeyCount()
  * @param rid[IN] the RecordId to insert
  * @return 0 if successful. Return an error code if the node is full.
  */
-RC BTLeafNode::insert(int key, const RecordId& rid)
+template <class Key, class Compare>
+RC BTLeafNodeT<Key, Compare>::insert(const Key& key, const RecordId& rid)
 {
-	int nodeSize = sizeof(int) + sizeof(RecordId);
-	int maxSize = ((PageFile::PAGE_SIZE) - sizeof(PageId))/nodeSize;
-	if (keyCount >= maxSize) {
-		//fprintf(stderr, "Error: nodes are full\n");
-		return RC_NODE_FULL;
+	int position;
 
-	} else {
-		int position;
-		char* iter = &(buffer[0]);
-
-		if (locate(key, position) == RC_NO_SUCH_RECORD) {
-			position = keyCount; //at the end if it can't be found
-			//position should contain where the stuff should go
-		}
-		keyCount++;
+	if (keyCount >= (packed ? MAX_PACKED_KEY_COUNT : MAX_KEY_COUNT)) {
+		return RC_NODE_FULL;
+	}
 
-		memmove(buffer + position*nodeSize + nodeSize, buffer + position*nodeSize, nodeSize*((keyCount-1)-position) + sizeof(PageId));
-		memcpy(buffer + position*nodeSize, &rid, sizeof(RecordId));
-		memcpy(buffer + position*nodeSize + sizeof(RecordId), &key, sizeof(int));
+	if (locate(key, position) == RC_NO_SUCH_RECORD) {
+		position = keyCount; //at the end if it can't be found
+	}
+	// equal keys stay in the order they were inserted
+	while (position < keyCount && !keyLess(key, keyAt(position))) {
+		position++;
+	}
 
-		//fprintf(stdout, "Successfully wrote node with key: %d, RecordId pid: %d, sid: %d\n",
-		//	key, (int)rid.pid, rid.sid);
+	// shift the entries after position by one slot
+	char* iter = buffer + position * ENTRY_SIZE;
+	memmove(iter + ENTRY_SIZE, iter, (keyCount - position) * ENTRY_SIZE);
+	memcpy(iter, &rid, sizeof(RecordId));
+	memcpy(iter + sizeof(RecordId), &key, sizeof(Key));
+	keyCount++;
 
-		return 0;
+	// a compressed node is full once the offsets get too wide to fit
+	char page[PageFile::PAGE_SIZE];
+	if (packed && !pack(page)) {
+		keyCount--;
+		memmove(iter, iter + ENTRY_SIZE, (keyCount - position) * ENTRY_SIZE);
+		return RC_NODE_FULL;
 	}
+
+	return 0;
 }
 
 /*
@@ -114,40 +321,48 @@ RC BTLeafNode::insert(int key, const RecordId& rid)
  * @param siblingKey[OUT] the first key in the sibling node after split.
  * @return 0 if successful. Return an error code if there is an error.
  */
-RC BTLeafNode::insertAndSplit(int key, const RecordId& rid,
-                              BTLeafNode& sibling, int& siblingKey)
+template <class Key, class Compare>
+RC BTLeafNodeT<Key, Compare>::insertAndSplit(const Key& key, const RecordId& rid,
+                                             BTLeafNodeT& sibling, Key& siblingKey)
 {
-	int nodeSize = sizeof(int) + sizeof(RecordId);
-	int splitter = keyCount / 2;
-	char* iter = &(buffer[0]);
-	int position = 0;
+	char merged[(MAX_PACKED_KEY_COUNT + 1) * ENTRY_SIZE];
+	int position;
+
+	if (sibling.getKeyCount() != 0) {
+		return RC_INVALID_ATTRIBUTE;
+	}
 
 	if (locate(key, position) == RC_NO_SUCH_RECORD) {
 		position = keyCount;
 	}
+	while (position < keyCount && !keyLess(key, keyAt(position))) {
+		position++;
+	}
 
-	iter += splitter * nodeSize;
-	memcpy(sibling.getBuffer(), iter, (keyCount - splitter) * nodeSize + sizeof(PageId));
-
-	sibling.setKeyCount(keyCount - splitter);
-	keyCount = splitter;
+	// build the sorted list of all entries including the new one
+	memcpy(merged, buffer, position * ENTRY_SIZE);
+	memcpy(merged + position * ENTRY_SIZE, &rid, sizeof(RecordId));
+	memcpy(merged + position * ENTRY_SIZE + sizeof(RecordId), &key, sizeof(Key));
+	memcpy(merged + (position + 1) * ENTRY_SIZE, buffer + position * ENTRY_SIZE,
+	       (keyCount - position) * ENTRY_SIZE);
 
-	memcpy(&siblingKey, sibling.getBuffer() + sizeof(RecordId), sizeof(int));
+	// the left half stays here, the right half moves to the sibling
+	int total = keyCount + 1;
+	int splitter = (total + 1) / 2;
 
-	char* pos = iter;
-	while (iter < pos + nodeSize) {
-		iter += nodeSize;
-		memcpy(iter, &NULL_VALUE, sizeof(int));
-	}
+	memset(buffer, 0, sizeof(buffer));
+	memcpy(buffer, merged, splitter * ENTRY_SIZE);
+	keyCount = splitter;
 
-	if (key > siblingKey)  //add to the right
-		sibling.insert(key, rid);
-	else
-		insert(key, rid);
+	memcpy(sibling.getBuffer(), merged + splitter * ENTRY_SIZE,
+	       (total - splitter) * ENTRY_SIZE);
+	sibling.setKeyCount(total - splitter);
+	memcpy(&siblingKey, sibling.getBuffer() + sizeof(RecordId), sizeof(Key));
 
-	//memcpy(&siblingKey, sibling.getBuffer() + sizeof(RecordId), sizeof(key));
+	// the sibling takes over our next pointer. the caller links us and
+	// the next leaf to the sibling, as only the caller knows the page ids
 	sibling.setNextNodePtr(getNextNodePtr());
-	//setNextNodePtr(getNextNodePtr());
+	sibling.setCompressed(packed);
 	return 0;
 }
 
@@ -159,27 +374,61 @@ RC BTLeafNode::insertAndSplit(int key, const RecordId& rid,
  * @param eid[OUT] the entry number that contains a key larger than or equalty to searchKey
  * @return 0 if successful. Return an error code if there is an error.
  */
-RC BTLeafNode::locate(int searchKey, int& eid)
+template <class Key, class Compare>
+RC BTLeafNodeT<Key, Compare>::locate(const Key& searchKey, int& eid)
 {
-	int nodeSize =  sizeof(RecordId) + sizeof(int);
-	int key = 0;
-	int cur;
-	char* iter = &(buffer[0]);
-	iter += sizeof(RecordId);
+	int low = 0;
+	int high = keyCount;
+
+	// binary search for the first key >= searchKey
+	while (low < high) {
+		int mid = (low + high) / 2;
+		if (keyLess(keyAt(mid), searchKey)) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+
+	if (low >= keyCount) {
+		eid = -1;
+		return RC_NO_SUCH_RECORD;
+	}
 
-	while(key < keyCount) {
-		memcpy(&cur, iter, sizeof(int));
-		if (cur >= searchKey) {
-			eid = key;
-			return 0;
+	eid = low;
+	return 0;
+}
+
+/*
+ * Find the last entry whose key value is smaller than or equal to searchKey
+ * and output its eid (entry number).
+ * @param searchKey[IN] the key to search for
+ * @param eid[OUT] the last entry number whose key value <= searchKey
+ * @return 0 if successful. RC_NO_SUCH_RECORD if every key is larger.
+ */
+template <class Key, class Compare>
+RC BTLeafNodeT<Key, Compare>::locateLast(const Key& searchKey, int& eid)
+{
+	int low = 0;
+	int high = keyCount;
+
+	// binary search for the first key > searchKey
+	while (low < high) {
+		int mid = (low + high) / 2;
+		if (!keyLess(searchKey, keyAt(mid))) {
+			low = mid + 1;
+		} else {
+			high = mid;
 		}
-		key++;
-		iter += nodeSize;
 	}
 
-	eid = -1;
-	//fprintf(stderr, "Error: The record does not exist\n");
-	return RC_NO_SUCH_RECORD;
+	if (low == 0) {
+		eid = -1;
+		return RC_NO_SUCH_RECORD;
+	}
+
+	eid = low - 1;
+	return 0;
 }
 
 /*
@@ -189,25 +438,16 @@ RC BTLeafNode::locate(int searchKey, int& eid)
  * @param rid[OUT] the RecordId from the entry
  * @return 0 if successful. Return an error code if there is an error.
  */
-RC BTLeafNode::readEntry(int eid, int& key, RecordId& rid)
+template <class Key, class Compare>
+RC BTLeafNodeT<Key, Compare>::readEntry(int eid, Key& key, RecordId& rid)
 {
-	int nodeSize =  sizeof(RecordId) + sizeof(int);
-	char* iter = &(buffer[0]);
-	int i = 0;
-
-	if (eid > keyCount) {
-		//fprintf(stderr, "Error: The record does not exist\n");
+	if (eid < 0 || eid >= keyCount) {
 		return RC_NO_SUCH_RECORD;
 	}
 
-	while (i < eid) {
-		iter += nodeSize;
-		i++;
-	}
-
+	char* iter = buffer + eid * ENTRY_SIZE;
 	memcpy(&rid, iter, sizeof(RecordId));
-	iter += sizeof(RecordId);
-	memcpy(&key, iter, sizeof(int));
+	memcpy(&key, iter + sizeof(RecordId), sizeof(Key));
 
 	return 0;
 }
@@ -216,7 +456,8 @@ RC BTLeafNode::readEntry(int eid, int& key, RecordId& rid)
  * Return the pid of the next sibling node.
  * @return the PageId of the next sibling node
  */
-PageId BTLeafNode::getNextNodePtr()
+template <class Key, class Compare>
+PageId BTLeafNodeT<Key, Compare>::getNextNodePtr()
 {
 	return nextPid;
 }
@@ -226,28 +467,43 @@ PageId BTLeafNode::getNextNodePtr()
  * @param pid[IN] the PageId of the next sibling node
  * @return 0 if successful. Return an error code if there is an error.
  */
-RC BTLeafNode::setNextNodePtr(PageId pid)
+template <class Key, class Compare>
+RC BTLeafNodeT<Key, Compare>::setNextNodePtr(PageId pid)
 {
 	nextPid = pid;
-	int nodeSize = sizeof(RecordId) + sizeof(int);
-	memcpy(buffer + nodeSize * keyCount, &pid, sizeof(PageId));
+	return 0;
+}
+
+/*
+ * Return the pid of the previous sibling node.
+ * @return the PageId of the previous sibling node. 0 for the first leaf
+ */
+template <class Key, class Compare>
+PageId BTLeafNodeT<Key, Compare>::getPrevNodePtr()
+{
+	return prevPid;
+}
+
+/*
+ * Set the pid of the previous sibling node.
+ * @param pid[IN] the PageId of the previous sibling node
+ * @return 0 if successful. Return an error code if there is an error.
+ */
+template <class Key, class Compare>
+RC BTLeafNodeT<Key, Compare>::setPrevNodePtr(PageId pid)
+{
+	prevPid = pid;
 	return 0;
 }
  //*******************************************************************//
 
 // BTLeafNode constructor.  Keeps track of the current key count; be sure to
 //	increment whenever adding a new element
-BTNonLeafNode::BTNonLeafNode()
+template <class Key, class Compare>
+BTNonLeafNodeT<Key, Compare>::BTNonLeafNodeT()
 {
 	keyCount = 0;
-	int i = 0;
-	char* iter = &(buffer[0]);
-	const int neg = NULL_VALUE;
-	while(i < PageFile::PAGE_SIZE) {
-		memcpy(iter, &neg, sizeof(int));
-		i += sizeof(int);
-		iter += sizeof(int);
-	}
+	memset(buffer, 0, PageFile::PAGE_SIZE);
 }
 
 /*
@@ -257,20 +513,21 @@ BTNonLeafNode::BTNonLeafNode()
  * @return 0 if successful. Return an error code if there is an error.
  */
 
-RC BTNonLeafNode::read(PageId pid, const PageFile& pf)
+template <class Key, class Compare>
+RC BTNonLeafNodeT<Key, Compare>::read(PageId pid, const PageFile& pf)
 {
-	RC ret =  pf.read(pid, buffer);
-	char* iter = &(buffer[0]) + sizeof(PageId);
-	int check;
-	int nodeSize = sizeof(PageId) + sizeof(int);
-	memcpy(&check, iter, sizeof(int));
-	while (check != NULL_VALUE) {
-		keyCount++;
-		iter += nodeSize;
-		memcpy(&check, iter, sizeof(int));
-	}
-
-	return ret;
+	RC rc = pf.read(pid, buffer);
+	if (rc < 0) {
+		return rc;
+	}
+
+	memcpy(&keyCount, buffer + NONLEAF_COUNT_OFFSET, sizeof(int));
+	if (keyCount < 0 || keyCount > MAX_KEY_COUNT) {
+		keyCount = 0;
+		return RC_INVALID_FILE_FORMAT;
+	}
+
+	return 0;
 }
 
 /*
@@ -279,8 +536,10 @@ RC BTNonLeafNode::read(PageId pid, const PageFile& pf)
  * @param pf[IN] PageFile to write to
  * @return 0 if successful. Return an error code if there is an error.
  */
-RC BTNonLeafNode::write(PageId pid, PageFile& pf)
+template <class Key, class Compare>
+RC BTNonLeafNodeT<Key, Compare>::write(PageId pid, PageFile& pf)
 {
+	memcpy(buffer + NONLEAF_COUNT_OFFSET, &keyCount, sizeof(int));
 	return pf.write(pid, buffer);
 }
 
@@ -288,7 +547,8 @@ RC BTNonLeafNode::write(PageId pid, PageFile& pf)
  * Return the number of keys stored in the node.
  * @return the number of keys in the node
  */
-int BTNonLeafNode::getKeyCount()
+template <class Key, class Compare>
+int BTNonLeafNodeT<Key, Compare>::getKeyCount()
 {
 	return keyCount;
 }
@@ -300,43 +560,29 @@ int BTNonLeafNode::getKeyCount()
  * @param pid[IN] the PageId to insert
  * @return 0 if successful. Return an error code if the node is full.
  */
-RC BTNonLeafNode::insert(int key, PageId pid)
+template <class Key, class Compare>
+RC BTNonLeafNodeT<Key, Compare>::insert(const Key& key, PageId pid)
 {
-	int nodeSize = sizeof(PageId) + sizeof(int);
-	char* iter = &(buffer[0]);
-	int cur = 0;
+	char* iter = buffer + sizeof(PageId);
 	int i = 0;
 
-	if((keyCount+1) * nodeSize + sizeof(int) >= sizeof(buffer))
+	if (keyCount >= MAX_KEY_COUNT) {
 		return RC_NODE_FULL;
+	}
 
-	iter += sizeof(PageId);
-	memcpy(&cur, iter, sizeof(int));
-
-	while(cur < key  && i != keyCount) //iterate the iter until you reach a key that's greater or equal
-	{
+	// skip the keys that are smaller than or equal to the new key
+	while (i < keyCount) {
+		if (keyLess(key, keyAt(i))) break;
 		i++;
-		iter += nodeSize;
-		memcpy(&cur, iter, sizeof(int));
+		iter += ENTRY_SIZE;
 	}
 
-	if(&(buffer[PageFile::PAGE_SIZE - 1]) - iter < sizeof(PageId) + sizeof(int))
-		return RC_NODE_FULL;
-
-	if(i > 0)
-	{
-		memmove(iter + nodeSize, iter, &(buffer[PageFile::PAGE_SIZE - 1]) - iter - nodeSize);
-		memcpy(iter, &key, sizeof(int));
-		memcpy(iter + sizeof(int), &pid, sizeof(PageId));
-	}
-	else
-	{
-		iter -= sizeof(PageId); //move it to the beginning of the buffer
-		memmove(iter + nodeSize, iter, &(buffer[PageFile::PAGE_SIZE - 1]) - iter - nodeSize);
-		memcpy(iter, &pid, sizeof(PageId));
-		memcpy(iter + sizeof(int), &key, sizeof(key));
-	}
+	// the new pid is the right child of the new key
+	memmove(iter + ENTRY_SIZE, iter, (keyCount - i) * ENTRY_SIZE);
+	memcpy(iter, &key, sizeof(Key));
+	memcpy(iter + sizeof(Key), &pid, sizeof(PageId));
 	keyCount++;
+
 	return 0;
 }
 
@@ -350,45 +596,43 @@ RC BTNonLeafNode::insert(int key, PageId pid)
  * @param midKey[OUT] the key in the middle after the split. This key should be inserted to the parent node.
  * @return 0 if successful. Return an error code if there is an error.
  */
-RC BTNonLeafNode::insertAndSplit(int key, PageId pid, BTNonLeafNode& sibling, int& midKey)
+template <class Key, class Compare>
+RC BTNonLeafNodeT<Key, Compare>::insertAndSplit(const Key& key, PageId pid,
+                                                BTNonLeafNodeT& sibling, Key& midKey)
 {
-	int nodeSize = sizeof(PageId) + sizeof(int);
-	char* iter = &(buffer[0]);
-	int cur = 0;
-	int splitter = keyCount/ 2;
-	char* splitPoint = iter + (splitter * nodeSize) + sizeof(PageId);// set to midkey
+	char merged[sizeof(PageId) + (MAX_KEY_COUNT + 1) * ENTRY_SIZE];
 	int i = 0;
-	// if (splitter == 0)
-		// return RC_NODE_FULL;//actually empty
 
-	iter += sizeof(PageId);
-	memcpy(&cur, iter, sizeof(int));
-
-	while(cur < key  && i < keyCount) //iterate the iter until you reach a key that's greater or equal
-	{
-		i++;
-		iter += nodeSize;
-		memcpy(&cur, iter, sizeof(int));
+	if (sibling.getKeyCount() != 0) {
+		return RC_INVALID_ATTRIBUTE;
 	}
 
-
-	memcpy(sibling.getBuffer(), splitPoint + sizeof(int), PageFile::PAGE_SIZE - (splitPoint - &(buffer[0])));
-	char* splitIter = splitPoint;
-	memcpy(&midKey, splitPoint, sizeof(int));
-
-	while (splitIter < &(buffer[PageFile::PAGE_SIZE])) {
-		memcpy(splitIter, &NULL_VALUE, sizeof(int));
-		splitIter += nodeSize;
+	while (i < keyCount) {
+		if (keyLess(key, keyAt(i))) break;
+		i++;
 	}
 
-	sibling.setKeyCount((keyCount - splitter) - 1); //don't include the midkey
+	// build the sorted list of all (key, pid) pairs including the new one
+	int head = sizeof(PageId) + i * ENTRY_SIZE;
+	memcpy(merged, buffer, head);
+	memcpy(merged + head, &key, sizeof(Key));
+	memcpy(merged + head + sizeof(Key), &pid, sizeof(PageId));
+	memcpy(merged + head + ENTRY_SIZE, buffer + head, (keyCount - i) * ENTRY_SIZE);
+
+	// keys [0, splitter) stay here, key splitter moves up to the parent,
+	// and the rest moves to the sibling together with the pid after midKey
+	int total = keyCount + 1;
+	int splitter = total / 2;
+	char* splitPoint = merged + sizeof(PageId) + splitter * ENTRY_SIZE;
+
+	memset(buffer, 0, NONLEAF_COUNT_OFFSET);
+	memcpy(buffer, merged, splitPoint - merged);
 	keyCount = splitter;
 
-	if(key > midKey)
-	//if (i > splitter)  //add to the right
-		sibling.insert(key, pid);
-	else
-		insert(key, pid);
+	memcpy(&midKey, splitPoint, sizeof(Key));
+	memcpy(sibling.getBuffer(), splitPoint + sizeof(Key),
+	       sizeof(PageId) + (total - splitter - 1) * ENTRY_SIZE);
+	sibling.setKeyCount(total - splitter - 1); //don't include the midkey
 
 	return 0;
 }
@@ -400,36 +644,75 @@ RC BTNonLeafNode::insertAndSplit(int key, PageId pid, BTNonLeafNode& sibling, in
  * @param pid[OUT] the pointer to the child node to follow.
  * @return 0 if successful. Return an error code if there is an error.
  */
-RC BTNonLeafNode::locateChildPtr(int searchKey, PageId& pid)
+template <class Key, class Compare>
+RC BTNonLeafNodeT<Key, Compare>::locateChildPtr(const Key& searchKey, PageId& pid)
 {
-	int nodeSize =  sizeof(PageId) + sizeof(int);
-	char* iter = &(buffer[0]);
-	int key = 0;
-	int cur = 0;
+	Key upper;
+	locateChildPtr(searchKey, pid, upper);
+	return 0;
+}
 
-	iter += sizeof(PageId);
-	memcpy(&cur, iter, sizeof(int));
-	if (keyCount > 0 && searchKey < cur) {
-		iter -= sizeof(PageId);
-		memcpy(&pid, iter, sizeof(PageId));
-		return 0;
+/*
+ * Given the searchKey, find the child-node pointer to follow and the
+ * separator key after it.
+ * @param searchKey[IN] the searchKey that is being looked up.
+ * @param pid[OUT] the pointer to the child node to follow.
+ * @param upper[OUT] the key after the child, if there is one
+ * @return 0 if successful. RC_NO_SUCH_RECORD if the child is the last one.
+ */
+template <class Key, class Compare>
+RC BTNonLeafNodeT<Key, Compare>::locateChildPtr(const Key& searchKey, PageId& pid, Key& upper)
+{
+	int low = 0;
+	int high = keyCount;
+
+	// binary search for the first key > searchKey. new keys equal to a
+	// separator key go to the subtree to the right of it.
+	while (low < high) {
+		int mid = (low + high) / 2;
+		if (!keyLess(searchKey, keyAt(mid))) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
 	}
 
-	while (key < keyCount) {
-		memcpy(&cur, iter, sizeof(int));
+	// the pid in front of the low'th key
+	memcpy(&pid, buffer + low * ENTRY_SIZE, sizeof(PageId));
+	if (low == keyCount) {
+		return RC_NO_SUCH_RECORD;
+	}
+	upper = keyAt(low);
+	return 0;
+}
 
-		if (cur >= searchKey) {
-			iter -= sizeof(PageId);
-			memcpy(&pid, iter, sizeof(PageId));
-			return 0;
+/*
+ * Given the searchKey, find the child-node pointer to follow to the first
+ * entry whose key is larger than or equal to searchKey.
+ * @param searchKey[IN] the searchKey that is being looked up.
+ * @param pid[OUT] the pointer to the child node to follow.
+ * @return 0 if successful. Return an error code if there is an error.
+ */
+template <class Key, class Compare>
+RC BTNonLeafNodeT<Key, Compare>::locateFirstChildPtr(const Key& searchKey, PageId& pid)
+{
+	int low = 0;
+	int high = keyCount;
+
+	// binary search for the first key >= searchKey. a split of a leaf
+	// or a bottom-up build may leave keys equal to a separator key on
+	// both sides of it, so they start in the subtree to its left.
+	while (low < high) {
+		int mid = (low + high) / 2;
+		if (keyLess(keyAt(mid), searchKey)) {
+			low = mid + 1;
+		} else {
+			high = mid;
 		}
-		key++;
-		iter += nodeSize;
 	}
 
-	iter -= nodeSize;
-	iter += sizeof(key);
-	memcpy(&pid, iter, sizeof(PageId));
+	// the pid in front of the low'th key
+	memcpy(&pid, buffer + low * ENTRY_SIZE, sizeof(PageId));
 	return 0;
 }
 
@@ -440,14 +723,19 @@ RC BTNonLeafNode::locateChildPtr(int searchKey, PageId& pid)
  * @param pid2[IN] the PageId to insert behind the key
  * @return 0 if successful. Return an error code if there is an error.
  */
-RC BTNonLeafNode::initializeRoot(PageId pid1, int key, PageId pid2)
+template <class Key, class Compare>
+RC BTNonLeafNodeT<Key, Compare>::initializeRoot(PageId pid1, const Key& key, PageId pid2)
 {
-	keyCount++;
+	keyCount = 1;
 	char* iter = &(buffer[0]);
 	memcpy(iter, &pid1, sizeof(PageId));
 	iter += sizeof(PageId);
-	memcpy(iter, &key, sizeof(int));
-	iter += sizeof(int);
+	memcpy(iter, &key, sizeof(Key));
+	iter += sizeof(Key);
 	memcpy(iter, &pid2, sizeof(PageId));
 	return 0;
 }
+
+// the key types that the indexes are compiled for
+template class BTLeafNodeT<int>;
+template class BTNonLeafNodeT<int>;
@@ -10,15 +10,40 @@
 #ifndef BTNODE_H
 #define BTNODE_H
 
+#include <cstring>
+#include <functional>
 #include "RecordFile.h"
 #include "PageFile.h"
 
 /**
- * BTLeafNode: The class representing a B+tree leaf node.
+ * Whether leaves with keys of type Key can be stored compressed.
+ * A compressed leaf stores each key as its offset from the smallest key
+ * of the leaf, so Key must map to an unsigned integer in the same order.
  */
-class BTLeafNode {
+template <class Key>
+struct LeafPacking {
+    static const bool ENABLED = false;
+    static unsigned toUnsigned(const Key&) { return 0; }
+    static Key fromUnsigned(unsigned) { return Key(); }
+};
+
+template <>
+struct LeafPacking<int> {
+    static const bool ENABLED = true;
+    static unsigned toUnsigned(int key) { return (unsigned) key ^ 0x80000000u; }
+    static int fromUnsigned(unsigned u) { return (int) (u ^ 0x80000000u); }
+};
+
+/**
+ * BTLeafNodeT: The class representing a B+tree leaf node.
+ * Key is the type of the keys. It is copied to and from the page with
+ * memcpy(), so it must be a plain fixed-size type. Keys are ordered by
+ * Compare.
+ */
+template <class Key, class Compare = std::less<Key> >
+class BTLeafNodeT {
   public:
-    BTLeafNode();
+    BTLeafNodeT();
    /**
     * Insert the (key, rid) pair to the node.
     * Remember that all keys inside a B+tree node should be kept sorted.
@@ -26,7 +51,7 @@ class BTLeafNode {
     * @param rid[IN] the RecordId to insert
     * @return 0 if successful. Return an error code if the node is full.
     */
-    RC insert(int key, const RecordId& rid);
+    RC insert(const Key& key, const RecordId& rid);
 
    /**
     * Insert the (key, rid) pair to the node
@@ -39,7 +64,7 @@ class BTLeafNode {
     * @param siblingKey[OUT] the first key in the sibling node after split.
     * @return 0 if successful. Return an error code if there is an error.
     */
-    RC insertAndSplit(int key, const RecordId& rid, BTLeafNode& sibling, int& siblingKey);
+    RC insertAndSplit(const Key& key, const RecordId& rid, BTLeafNodeT& sibling, Key& siblingKey);
 
    /**
     * Find the index entry whose key value is larger than or equal to searchKey
@@ -50,7 +75,16 @@ class BTLeafNode {
     *                 than or equalty to searchKey.
     * @return 0 if successful. Return an error code if there is an error.
     */
-    RC locate(int searchKey, int& eid);
+    RC locate(const Key& searchKey, int& eid);
+
+   /**
+    * Find the last index entry whose key value is smaller than or equal
+    * to searchKey and output its eid (entry id).
+    * @param searchKey[IN] the key to search for.
+    * @param eid[OUT] the last entry number whose key value &lt;= searchKey.
+    * @return 0 if successful. RC_NO_SUCH_RECORD if every key is larger.
+    */
+    RC locateLast(const Key& searchKey, int& eid);
 
    /**
     * Read the (key, rid) pair from the eid entry.
@@ -59,7 +93,7 @@ class BTLeafNode {
     * @param rid[OUT] the RecordId from the slot
     * @return 0 if successful. Return an error code if there is an error.
     */
-    RC readEntry(int eid, int& key, RecordId& rid);
+    RC readEntry(int eid, Key& key, RecordId& rid);
 
    /**
     * Return the pid of the next slibling node.
@@ -75,6 +109,19 @@ class BTLeafNode {
     */
     RC setNextNodePtr(PageId pid);
 
+   /**
+    * Return the pid of the previous slibling node.
+    * @return the PageId of the previous sibling node. 0 for the first leaf
+    */
+    PageId getPrevNodePtr();
+
+   /**
+    * Set the previous slibling node PageId.
+    * @param pid[IN] the PageId of the previous sibling node
+    * @return 0 if successful. Return an error code if there is an error.
+    */
+    RC setPrevNodePtr(PageId pid);
+
    /**
     * Return the number of keys stored in the node.
     * @return the number of keys in the node
@@ -111,32 +158,110 @@ class BTLeafNode {
         keyCount = count;
     }
 
+   /**
+    * The size of a (rid, key) entry in a leaf page.
+    */
+    static const int ENTRY_SIZE = sizeof(RecordId) + sizeof(Key);
+
+   /**
+    * The maximum number of (key, rid) entries that fit in a leaf page.
+    * The last three integers of the page store prevPid, keyCount and nextPid.
+    */
+    static const int MAX_KEY_COUNT = (PageFile::PAGE_SIZE - 3 * sizeof(int)) / ENTRY_SIZE;
+
+   /**
+    * The maximum number of entries in a compressed leaf page.
+    * A compressed entry takes at most 68 bits (32-bit key and pid offsets
+    * and a 4-bit sid). The limit is chosen so that either half of a split
+    * fits in a page even at that width.
+    */
+    static const int MAX_PACKED_KEY_COUNT = LeafPacking<Key>::ENABLED ?
+        2 * (((PageFile::PAGE_SIZE - 6 * (int) sizeof(int) - 3) * 8) / 68) - 1 : MAX_KEY_COUNT;
+
+   /**
+    * Choose whether the node is written in the compressed format.
+    * Nodes read from a page keep the format of the page. Only key types
+    * with LeafPacking<Key>::ENABLED can be compressed.
+    * @param compressed[IN] true to compress the node
+    */
+    void setCompressed(bool compressed) {
+        packed = compressed && LeafPacking<Key>::ENABLED;
+    }
+
+   /**
+    * @return true if the node is written in the compressed format
+    */
+    bool isCompressed() const {
+        return packed;
+    }
+
   private:
+   /**
+    * Encode the entries of a compressed node into page.
+    * @return false if they do not fit in a page
+    */
+    bool pack(char* page) const;
+
+   /**
+    * Decode the entries of a compressed node from page into buffer.
+    */
+    void unpack(const char* page);
+
+   /**
+    * Read the key of the eid entry.
+    */
+    Key keyAt(int eid) const {
+        Key key;
+        memcpy(&key, buffer + eid * ENTRY_SIZE + sizeof(RecordId), sizeof(Key));
+        return key;
+    }
+
+   /**
+    * Compare two keys. The comparator has no state, so this inlines.
+    */
+    static bool keyLess(const Key& a, const Key& b) {
+        return Compare()(a, b);
+    }
+
    /**
     * The main memory buffer for loading the content of the disk page
-    * that contains the node.
+    * that contains the node. A compressed node is decoded into it, so it
+    * may hold more entries than a page.
     */
-    char buffer[PageFile::PAGE_SIZE];
+    char buffer[(MAX_PACKED_KEY_COUNT > MAX_KEY_COUNT) ?
+                MAX_PACKED_KEY_COUNT * ENTRY_SIZE : PageFile::PAGE_SIZE];
 
    /**
     * Keeps track of the number of Keys in the Tree node.
     */
     int keyCount;
 
+   /**
+    * True if the node is stored in the compressed format
+    */
+    bool packed;
+
    /**
     * PageId of the next pageid in the buffer
     */
     PageId nextPid;
 
+   /**
+    * PageId of the previous leaf node
+    */
+    PageId prevPid;
+
 };
 
 
 /**
- * BTNonLeafNode: The class representing a B+tree nonleaf node.
+ * BTNonLeafNodeT: The class representing a B+tree nonleaf node.
+ * Key and Compare are the same as in BTLeafNodeT.
  */
-class BTNonLeafNode {
+template <class Key, class Compare = std::less<Key> >
+class BTNonLeafNodeT {
   public:
-    BTNonLeafNode();
+    BTNonLeafNodeT();
    /**
     * Insert a (key, pid) pair to the node.
     * Remember that all keys inside a B+tree node should be kept sorted.
@@ -144,7 +269,7 @@ class BTNonLeafNode {
     * @param pid[IN] the PageId to insert
     * @return 0 if successful. Return an error code if the node is full.
     */
-    RC insert(int key, PageId pid);
+    RC insert(const Key& key, PageId pid);
 
    /**
     * Insert the (key, pid) pair to the node
@@ -158,7 +283,7 @@ class BTNonLeafNode {
     * @param midKey[OUT] the key in the middle after the split. This key should be inserted to the parent node.
     * @return 0 if successful. Return an error code if there is an error.
     */
-    RC insertAndSplit(int key, PageId pid, BTNonLeafNode& sibling, int& midKey);
+    RC insertAndSplit(const Key& key, PageId pid, BTNonLeafNodeT& sibling, Key& midKey);
 
    /**
     * Given the searchKey, find the child-node pointer to follow and
@@ -168,7 +293,29 @@ class BTNonLeafNode {
     * @param pid[OUT] the pointer to the child node to follow.
     * @return 0 if successful. Return an error code if there is an error.
     */
-    RC locateChildPtr(int searchKey, PageId& pid);
+    RC locateChildPtr(const Key& searchKey, PageId& pid);
+
+   /**
+    * Like locateChildPtr(), and also output the separator key after the
+    * child. The keys in the subtree of the child are smaller than it.
+    * @param searchKey[IN] the searchKey that is being looked up.
+    * @param pid[OUT] the pointer to the child node to follow.
+    * @param upper[OUT] the key after the child, if there is one
+    * @return 0 if successful. RC_NO_SUCH_RECORD if the child is the last
+    *         one, with no key after it.
+    */
+    RC locateChildPtr(const Key& searchKey, PageId& pid, Key& upper);
+
+   /**
+    * Given the searchKey, find the child-node pointer to follow to the
+    * first entry whose key is larger than or equal to searchKey. Unlike
+    * locateChildPtr(), a key equal to searchKey leads to the child on its
+    * left, as entries equal to a separator key may be on both sides of it.
+    * @param searchKey[IN] the searchKey that is being looked up.
+    * @param pid[OUT] the pointer to the child node to follow.
+    * @return 0 if successful. Return an error code if there is an error.
+    */
+    RC locateFirstChildPtr(const Key& searchKey, PageId& pid);
 
    /**
     * Initialize the root node with (pid1, key, pid2).
@@ -177,7 +324,7 @@ class BTNonLeafNode {
     * @param pid2[IN] the PageId to insert behind the key
     * @return 0 if successful. Return an error code if there is an error.
     */
-    RC initializeRoot(PageId pid1, int key, PageId pid2);
+    RC initializeRoot(PageId pid1, const Key& key, PageId pid2);
 
    /**
     * Return the number of keys stored in the node.
@@ -215,7 +362,35 @@ class BTNonLeafNode {
         keyCount = count;
     }
 
+   /**
+    * The size of a (key, pid) entry in a nonleaf page.
+    */
+    static const int ENTRY_SIZE = sizeof(Key) + sizeof(PageId);
+
+   /**
+    * The maximum number of keys that fit in a nonleaf page.
+    * The page starts with the first child pointer, followed by the
+    * (key, pid) pairs. The last integer of the page stores keyCount.
+    */
+    static const int MAX_KEY_COUNT = (PageFile::PAGE_SIZE - sizeof(PageId) - sizeof(int)) / ENTRY_SIZE;
+
   private:
+   /**
+    * Read the i'th key of the node.
+    */
+    Key keyAt(int i) const {
+        Key key;
+        memcpy(&key, buffer + sizeof(PageId) + i * ENTRY_SIZE, sizeof(Key));
+        return key;
+    }
+
+   /**
+    * Compare two keys. The comparator has no state, so this inlines.
+    */
+    static bool keyLess(const Key& a, const Key& b) {
+        return Compare()(a, b);
+    }
+
    /**
     * The main memory buffer for loading the content of the disk page
     * that contains the node.
@@ -228,4 +403,8 @@ class BTNonLeafNode {
     int keyCount;
 };
 
+// the nodes of the int-keyed index of a table
+typedef BTLeafNodeT<int> BTLeafNode;
+typedef BTNonLeafNodeT<int> BTNonLeafNode;
+
 #endif /* BTNODE_H */
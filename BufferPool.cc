@@ -0,0 +1,110 @@
+#include <cstring>
+#include "BufferPool.h"
+
+using namespace std;
+
+BufferPool::BufferPool()
+{
+  for (int s = 0; s < SHARDS; s++) {
+    shards[s].clock = 0;
+    shards[s].epoch = 0;
+    for (int i = 0; i < FRAMES_PER_SHARD; i++) {
+      shards[s].frames[i].fd = -1;
+      shards[s].frames[i].pid = 0;
+      shards[s].frames[i].lastAccessed = 0;
+      shards[s].frames[i].pins = 0;
+    }
+  }
+}
+
+BufferPool::Shard& BufferPool::shardOf(int fd, PageId pid)
+{
+  // consecutive pages of a file go to different shards
+  unsigned h = (unsigned) pid * 2654435761u + (unsigned) fd * 40503u;
+  return shards[(h >> 16) % SHARDS];
+}
+
+bool BufferPool::read(int fd, PageId pid, void* buffer, unsigned& epoch)
+{
+  Shard& shard = shardOf(fd, pid);
+  Frame* frame;
+
+  {
+    lock_guard<mutex> guard(shard.mutex);
+    unordered_map<long long, int>::iterator it = shard.frameOf.find(pageKey(fd, pid));
+    if (it == shard.frameOf.end()) {
+      epoch = shard.epoch;
+      return false;
+    }
+    frame = &shard.frames[it->second];
+    frame->lastAccessed = ++shard.clock;
+    frame->pins++;
+  }
+
+  // the frame is not refilled while it is pinned
+  memcpy(buffer, frame->buffer, PageFile::PAGE_SIZE);
+  frame->pins--;
+  return true;
+}
+
+void BufferPool::insert(int fd, PageId pid, const void* buffer, unsigned epoch)
+{
+  Shard& shard = shardOf(fd, pid);
+  lock_guard<mutex> guard(shard.mutex);
+
+  // a write may have changed the page after it was read from the disk
+  if (shard.epoch != epoch) return;
+
+  // another thread may have added the page in the meantime
+  long long key = pageKey(fd, pid);
+  if (shard.frameOf.count(key) > 0) return;
+
+  // a free frame, or else the least recently used unpinned one
+  int victim = -1;
+  for (int i = 0; i < FRAMES_PER_SHARD; i++) {
+    Frame& f = shard.frames[i];
+    if (f.pins > 0) continue;
+    if (f.fd < 0) {
+      victim = i;
+      break;
+    }
+    if (victim < 0 || f.lastAccessed < shard.frames[victim].lastAccessed) victim = i;
+  }
+  if (victim < 0) return;
+
+  Frame& frame = shard.frames[victim];
+  if (frame.fd >= 0) shard.frameOf.erase(pageKey(frame.fd, frame.pid));
+  memcpy(frame.buffer, buffer, PageFile::PAGE_SIZE);
+  frame.fd = fd;
+  frame.pid = pid;
+  frame.lastAccessed = ++shard.clock;
+  shard.frameOf[key] = victim;
+}
+
+void BufferPool::invalidate(int fd, PageId pid)
+{
+  Shard& shard = shardOf(fd, pid);
+  lock_guard<mutex> guard(shard.mutex);
+
+  // even if the page is not here, a reader may be about to add it
+  shard.epoch++;
+  unordered_map<long long, int>::iterator it = shard.frameOf.find(pageKey(fd, pid));
+  if (it == shard.frameOf.end()) return;
+  shard.frames[it->second].fd = -1;
+  shard.frameOf.erase(it);
+}
+
+void BufferPool::invalidateFile(int fd)
+{
+  for (int s = 0; s < SHARDS; s++) {
+    Shard& shard = shards[s];
+    lock_guard<mutex> guard(shard.mutex);
+    for (int i = 0; i < FRAMES_PER_SHARD; i++) {
+      Frame& f = shard.frames[i];
+      if (f.fd == fd) {
+        shard.frameOf.erase(pageKey(f.fd, f.pid));
+        f.fd = -1;
+      }
+    }
+  }
+}
@@ -0,0 +1,93 @@
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include "Bruinbase.h"
+#include "PageFile.h"
+
+/**
+ * The cache of disk pages shared by every PageFile.
+ * The frames are split into SHARDS shards by a hash of (file, page),
+ * and each shard has its own lock, hash table and LRU clock, so threads
+ * that read different pages rarely wait for each other. A shard lock is
+ * held only to look up or replace a frame, never during disk I/O.
+ *
+ * A reader pins the frame it copies from. A frame is refilled only when
+ * it is unpinned and no longer in the hash table, so the page can be
+ * copied out without the shard lock.
+ *
+ * A page that is not in the pool is read from the disk and then added.
+ * A write may drop the page in between, so every shard counts the pages
+ * it drops, and a page is added only if its shard has dropped none since
+ * the read missed it.
+ */
+class BufferPool {
+ public:
+  // # of shards, and # of frames per shard
+  static const int SHARDS = 16;
+  static const int FRAMES_PER_SHARD = 8;
+
+  BufferPool();
+
+  /**
+   * copy a page from the pool.
+   * @param fd[IN] the unix file descriptor of the file of the page
+   * @param pid[IN] the page to read
+   * @param buffer[OUT] the memory buffer to copy the page to
+   * @param epoch[OUT] if the page was not in the pool, the write epoch of
+   *                   its shard, to pass to insert()
+   * @return true if the page was in the pool
+   */
+  bool read(int fd, PageId pid, void* buffer, unsigned& epoch);
+
+  /**
+   * add a page read from the disk, replacing the least recently used
+   * unpinned frame of its shard. nothing is done if the page is in the
+   * pool already, every frame of the shard is pinned, or a page of the
+   * shard was dropped after read() missed the page.
+   * @param fd[IN] the unix file descriptor of the file of the page
+   * @param pid[IN] the page
+   * @param buffer[IN] the content of the page
+   * @param epoch[IN] the write epoch that read() returned
+   */
+  void insert(int fd, PageId pid, const void* buffer, unsigned epoch);
+
+  /**
+   * drop a page from the pool, e.g., because it is written.
+   * @param fd[IN] the unix file descriptor of the file of the page
+   * @param pid[IN] the page
+   */
+  void invalidate(int fd, PageId pid);
+
+  /**
+   * drop every page of a file from the pool, e.g., because it is closed.
+   * @param fd[IN] the unix file descriptor of the file
+   */
+  void invalidateFile(int fd);
+
+ private:
+  struct Frame {
+    int              fd;            // file of the page. -1 if the frame is free
+    PageId           pid;           // the page in the frame
+    int              lastAccessed;  // LRU clock tick of the last access
+    std::atomic<int> pins;          // # of readers copying the page
+    char             buffer[PageFile::PAGE_SIZE];
+  };
+
+  struct Shard {
+    std::mutex                          mutex;
+    std::unordered_map<long long, int>  frameOf;  // (fd, pid) -> frame
+    Frame                               frames[FRAMES_PER_SHARD];
+    int                                 clock;    // LRU clock of the shard
+    unsigned                            epoch;    // # of invalidate() calls
+  };
+
+  static long long pageKey(int fd, PageId pid) { return ((long long) fd << 32) | (unsigned) pid; }
+  Shard& shardOf(int fd, PageId pid);
+
+  Shard shards[SHARDS];
+};
+
+#endif /* BUFFERPOOL_H */
@@ -0,0 +1,210 @@
+#include <cstring>
+#include "HashAggregator.h"
+
+using std::string;
+using std::vector;
+
+// initial # of slots of the hash table
+static const int INITIAL_SLOTS = 64;
+
+// partitions are not split further after this many steps. all groups of
+// such a partition are aggregated in memory regardless of the budget.
+static const int MAX_LEVEL = 8;
+
+HashAggregator::HashAggregator(int memPages)
+{
+  if (memPages < 4) memPages = 4;
+
+  memBytes = memPages * PageFile::PAGE_SIZE;
+  partitionCount = 0;
+  reading = false;
+  for (int i = 0; i < PARTITIONS; i++) spilled[i] = NULL;
+  reset(0);
+}
+
+HashAggregator::~HashAggregator()
+{
+  clearPartitions();
+}
+
+unsigned HashAggregator::hashValue(const char* value, int len) const
+{
+  // FNV-1a seeded by the level, so that a partition is split
+  // differently from its parent
+  unsigned h = 2166136261u ^ (level * 0x9e3779b9u);
+  for (int i = 0; i < len; i++) {
+    h = (h ^ (unsigned char) value[i]) * 16777619u;
+  }
+
+  // mix the bits, as both the low and the high bits are used
+  h ^= h >> 16;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35u;
+  h ^= h >> 16;
+  return h;
+}
+
+void HashAggregator::reset(int newLevel)
+{
+  Slot empty;
+  memset(&empty, 0, sizeof(empty));
+  empty.offset = -1;
+
+  level = newLevel;
+  arena.clear();
+  slots.assign(INITIAL_SLOTS, empty);
+  groupCount = 0;
+  nextSlot = 0;
+}
+
+void HashAggregator::grow()
+{
+  Slot empty;
+  memset(&empty, 0, sizeof(empty));
+  empty.offset = -1;
+
+  vector<Slot> old;
+  old.swap(slots);
+  slots.assign(old.size() * 2, empty);
+
+  // the hash value is kept in the slot, so only the slots move
+  unsigned mask = slots.size() - 1;
+  for (unsigned i = 0; i < old.size(); i++) {
+    if (old[i].offset < 0) continue;
+    unsigned j = old[i].hash & mask;
+    while (slots[j].offset >= 0) j = (j + 1) & mask;
+    slots[j] = old[i];
+  }
+}
+
+RC HashAggregator::add(int key, const string& value)
+{
+  int      len = value.size();
+  unsigned h = hashValue(value.data(), len);
+  unsigned mask = slots.size() - 1;
+  unsigned i;
+
+  if (reading) return RC_INVALID_FILE_MODE;
+
+  // find the group with linear probing
+  for (i = h & mask; slots[i].offset >= 0; i = (i + 1) & mask) {
+    Slot& s = slots[i];
+    if (s.hash == h && s.len == len && memcmp(arena.data() + s.offset, value.data(), len) == 0) {
+      s.state.count++;
+      s.state.sum += key;
+      if (key < s.state.minKey) s.state.minKey = key;
+      if (key > s.state.maxKey) s.state.maxKey = key;
+      return 0;
+    }
+  }
+
+  // a new group. the table is kept at most half full
+  bool full = 2 * (groupCount + 1) > (int) slots.size();
+  unsigned need = arena.size() + len + (full ? 3 : 1) * slots.size() * sizeof(Slot);
+  if (need > (unsigned) memBytes && level < MAX_LEVEL) {
+    return spill(key, value, h);
+  }
+
+  if (full) {
+    grow();
+    mask = slots.size() - 1;
+    for (i = h & mask; slots[i].offset >= 0; i = (i + 1) & mask) ;
+  }
+
+  Slot& s = slots[i];
+  s.hash = h;
+  s.len = len;
+  s.offset = arena.size();
+  s.state.count = 1;
+  s.state.sum = key;
+  s.state.minKey = key;
+  s.state.maxKey = key;
+  arena.insert(arena.end(), value.begin(), value.end());
+  groupCount++;
+
+  return 0;
+}
+
+RC HashAggregator::spill(int key, const string& value, unsigned hash)
+{
+  RC rc;
+
+  // the high bits pick the partition, the low bits the slot
+  int p = hash >> 28;
+  if (spilled[p] == NULL) {
+    spilled[p] = new TempFile();
+    if ((rc = spilled[p]->create()) < 0) {
+      delete spilled[p];
+      spilled[p] = NULL;
+      return rc;
+    }
+    partitionCount++;
+  }
+
+  return spilled[p]->append(key, value);
+}
+
+RC HashAggregator::next(string& value, GroupState& state)
+{
+  RC rc;
+
+  if (!reading) {
+    reading = true;
+    nextSlot = 0;
+  }
+
+  for (;;) {
+    while (nextSlot < slots.size()) {
+      const Slot& s = slots[nextSlot++];
+      if (s.offset < 0) continue;
+      value.assign(arena.data() + s.offset, s.len);
+      state = s.state;
+      return 0;
+    }
+
+    // the groups in memory are done. queue the partitions of this input
+    for (int i = 0; i < PARTITIONS; i++) {
+      if (spilled[i] == NULL) continue;
+      Partition p;
+      p.file = spilled[i];
+      p.level = level + 1;
+      pending.push_back(p);
+      spilled[i] = NULL;
+    }
+    if (pending.empty()) return RC_END_OF_STREAM;
+
+    // aggregate the next partition
+    Partition p = pending.back();
+    pending.pop_back();
+    reset(p.level);
+    reading = false;
+
+    int    key;
+    string v;
+    if ((rc = p.file->rewind()) == 0) {
+      while ((rc = p.file->next(key, v)) == 0) {
+        if ((rc = add(key, v)) < 0) break;
+      }
+    }
+    p.file->close();
+    delete p.file;
+    reading = true;
+    if (rc != RC_END_OF_STREAM) return rc;
+  }
+}
+
+void HashAggregator::clearPartitions()
+{
+  for (int i = 0; i < PARTITIONS; i++) {
+    if (spilled[i] == NULL) continue;
+    spilled[i]->close();
+    delete spilled[i];
+    spilled[i] = NULL;
+  }
+  for (unsigned i = 0; i < pending.size(); i++) {
+    pending[i].file->close();
+    delete pending[i].file;
+  }
+  pending.clear();
+}
@@ -0,0 +1,100 @@
+#ifndef HASHAGGREGATOR_H
+#define HASHAGGREGATOR_H
+
+#include <string>
+#include <vector>
+#include "Bruinbase.h"
+#include "PageFile.h"
+#include "TempFile.h"
+
+/**
+ * The aggregates of the keys in a group
+ */
+struct GroupState {
+  long long count;   // # of tuples in the group
+  long long sum;     // sum of the keys
+  int       minKey;  // smallest key
+  int       maxKey;  // largest key
+};
+
+/**
+ * Hash aggregation of (key, value) tuples grouped by value.
+ * The groups are kept in an open-addressing hash table whose values are
+ * stored in an arena owned by the operator. Once the table reaches the
+ * memory budget, tuples of the groups already in the table are still
+ * aggregated in memory, and tuples of new groups are written to one of
+ * PARTITIONS TempFiles by their hash value. After the groups in memory
+ * are returned, each partition is aggregated in turn the same way,
+ * with a different hash function.
+ */
+class HashAggregator {
+ public:
+  // default memory budget, in pages, for the hash table and its arena
+  static const int MEM_PAGES = 256;
+
+  // # of partitions a full hash table spills to
+  static const int PARTITIONS = 16;
+
+  /**
+   * @param memPages[IN] the memory budget in pages. at least 4
+   */
+  HashAggregator(int memPages = MEM_PAGES);
+  ~HashAggregator();
+
+  /**
+   * add a tuple to its group. may write the tuple to a partition.
+   * @param key[IN] the key of the tuple
+   * @param value[IN] the value of the tuple, which is the group
+   * @return error code. 0 if no error
+   */
+  RC add(int key, const std::string& value);
+
+  /**
+   * return the next group. the groups are returned in no particular order.
+   * @param value[OUT] the value of the group
+   * @param state[OUT] the aggregates of the group
+   * @return error code. RC_END_OF_STREAM if all groups have been returned
+   */
+  RC next(std::string& value, GroupState& state);
+
+  /**
+   * @return the number of partitions written to disk
+   */
+  int getPartitionCount() const { return partitionCount; }
+
+ private:
+  // a slot of the hash table. offset is -1 for an empty slot.
+  struct Slot {
+    unsigned   hash;
+    int        len;
+    int        offset;
+    GroupState state;
+  };
+
+  // a partition waiting to be aggregated
+  struct Partition {
+    TempFile* file;
+    int       level;
+  };
+
+  unsigned hashValue(const char* value, int len) const;
+  void grow();
+  void reset(int newLevel);
+  RC   spill(int key, const std::string& value, unsigned hash);
+  void clearPartitions();
+
+  int memBytes;    // the memory budget in bytes
+  int level;       // # of partitioning steps of the current input. seeds the hash
+
+  std::vector<char> arena;   // values of the groups
+  std::vector<Slot> slots;   // the hash table. the size is a power of 2
+  int groupCount;            // # of groups in the table
+  unsigned nextSlot;         // the next slot returned by next()
+
+  std::vector<Partition> pending;  // partitions to aggregate
+  TempFile* spilled[PARTITIONS];   // the partitions of the current input
+  int  partitionCount;
+  bool reading;                    // true once next() has been called
+};
+
+#endif // HASHAGGREGATOR_H
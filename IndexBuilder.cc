@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include "IndexBuilder.h"
+
+using namespace std;
+
+IndexBuilder::IndexBuilder()
+{
+  closed = false;
+  batch.reserve(BATCH_ENTRIES);
+  sorter = thread(&IndexBuilder::work, this);
+}
+
+IndexBuilder::~IndexBuilder()
+{
+  {
+    lock_guard<std::mutex> guard(mutex);
+    closed = true;
+  }
+  queued.notify_all();
+  if (sorter.joinable()) sorter.join();
+}
+
+void IndexBuilder::add(int key, const RecordId& rid)
+{
+  batch.push_back(Entry(key, rid));
+  if ((int) batch.size() == BATCH_ENTRIES) push();
+}
+
+void IndexBuilder::push()
+{
+  {
+    unique_lock<std::mutex> guard(mutex);
+    while ((int) queue.size() >= QUEUE_BATCHES) dequeued.wait(guard);
+    queue.push_back(vector<Entry>());
+    queue.back().swap(batch);
+  }
+  queued.notify_one();
+  batch.reserve(BATCH_ENTRIES);
+}
+
+void IndexBuilder::work()
+{
+  vector<Entry> run;
+
+  for (;;) {
+    {
+      unique_lock<std::mutex> guard(mutex);
+      while (queue.empty() && !closed) queued.wait(guard);
+      if (queue.empty()) return;
+      run.swap(queue.front());
+      queue.pop_front();
+    }
+    dequeued.notify_one();
+
+    // a key that appears twice keeps its entries in table order
+    sort(run.begin(), run.end());
+    runs.push_back(vector<Entry>());
+    runs.back().swap(run);
+  }
+}
+
+RC IndexBuilder::finish(BTreeIndex& idx)
+{
+  typedef pair<Entry, int> Head;  // the next entry of a run, and the run
+  priority_queue<Head, vector<Head>, greater<Head> > heads;
+  vector<unsigned> next;
+  vector<Entry> merged;
+  bool grow = idx.getTreeHeight() > 0;
+  RC rc;
+
+  // the thread sorts the last batch, then ends
+  if (!batch.empty()) push();
+  {
+    lock_guard<std::mutex> guard(mutex);
+    closed = true;
+  }
+  queued.notify_all();
+  sorter.join();
+
+  next.assign(runs.size(), 1);
+  for (unsigned r = 0; r < runs.size(); r++) {
+    if (!runs[r].empty()) heads.push(Head(runs[r][0], r));
+  }
+
+  while (!heads.empty()) {
+    Head head = heads.top();
+    heads.pop();
+    if (!grow) {
+      if ((rc = idx.bulkInsert(head.first.first, head.first.second)) < 0) return rc;
+    } else {
+      // an index that has entries takes the merged entries in sorted
+      // chunks, so that neighbours share the descent to their leaf
+      merged.push_back(head.first);
+      if ((int) merged.size() == BATCH_ENTRIES) {
+        if ((rc = idx.insertBatch(merged)) < 0) return rc;
+        merged.clear();
+      }
+    }
+
+    // release a run once it is merged
+    int r = head.second;
+    if (next[r] < runs[r].size()) {
+      heads.push(Head(runs[r][next[r]++], r));
+    } else {
+      vector<Entry>().swap(runs[r]);
+    }
+  }
+  runs.clear();
+
+  if (grow) return idx.insertBatch(merged);
+  return idx.finishBulkLoad();
+}
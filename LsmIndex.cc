@@ -0,0 +1,732 @@
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include "LsmIndex.h"
+
+using std::string;
+using std::vector;
+using std::shared_ptr;
+using std::unique_lock;
+using std::lock_guard;
+
+//
+// Layout of a run file:
+//   page 0                the header (RunHeader)
+//   pages 1..dataPages    the entries in (key, rid) order, ENTRIES_PER_PAGE
+//                         to a page. an entry is [key] [pid] [sid]
+//   fence level 0         the first key of every data page
+//   fence level 1         the first key of every page of level 0, and so on
+//   the Bloom filter      one block of BLOOM_BITS_PER_PAGE bits a page
+// the fence levels stop once the first keys of the pages of a level fit
+// into the header, which keeps them in top.
+//
+// Layout of the manifest:
+//   [next run id] [# runs] [id] [level] [id] [level] ...
+//
+
+static const int ENTRY_SIZE = sizeof(int) + sizeof(PageId) + sizeof(int);
+static const int ENTRIES_PER_PAGE = PageFile::PAGE_SIZE / ENTRY_SIZE;
+static const int KEYS_PER_PAGE = PageFile::PAGE_SIZE / sizeof(int);
+static const int MAX_FENCE_LEVELS = 4;
+static const int TOP_KEYS = 240;
+static const int MAX_RUNS = (PageFile::PAGE_SIZE - 2 * sizeof(int)) / (2 * sizeof(int));
+
+// a key sets BLOOM_HASHES bits of one page of the filter, which has about
+// BLOOM_BITS_PER_KEY bits for each entry of the run. 1% of the keys that
+// are not in the run pass the filter
+static const int BLOOM_BITS_PER_KEY = 10;
+static const int BLOOM_HASHES = 7;
+static const int BLOOM_BITS_PER_PAGE = PageFile::PAGE_SIZE * 8;
+
+struct RunHeader {
+  int    entries;
+  int    dataPages;
+  int    levels;                        // # of fence levels on pages
+  PageId levelStart[MAX_FENCE_LEVELS];  // the first page of each fence level
+  int    levelKeys[MAX_FENCE_LEVELS];   // # of keys of each fence level
+  PageId bloomStart;
+  int    bloomPages;
+  int    minKey;
+  int    maxKey;
+  int    topKeys;                       // # of keys in top
+  int    top[TOP_KEYS];                 // the first keys of the highest level
+};
+
+static_assert(sizeof(RunHeader) <= PageFile::PAGE_SIZE, "a run header must fit in a page");
+
+static void getEntry(const char* page, int eid, int& key, RecordId& rid)
+{
+  const char* entry = page + eid * ENTRY_SIZE;
+  memcpy(&key, entry, sizeof(int));
+  memcpy(&rid.pid, entry + sizeof(int), sizeof(PageId));
+  memcpy(&rid.sid, entry + sizeof(int) + sizeof(PageId), sizeof(int));
+}
+
+static void putEntry(char* page, int eid, int key, const RecordId& rid)
+{
+  char* entry = page + eid * ENTRY_SIZE;
+  memcpy(entry, &key, sizeof(int));
+  memcpy(entry + sizeof(int), &rid.pid, sizeof(PageId));
+  memcpy(entry + sizeof(int) + sizeof(PageId), &rid.sid, sizeof(int));
+}
+
+// the child whose key range holds the first entry >= key, given the first
+// key of every child
+static int childOf(const int* keys, int count, int key)
+{
+  int i = std::lower_bound(keys, keys + count, key) - keys;
+  return (i > 0) ? i - 1 : 0;
+}
+
+static unsigned mix(unsigned h)
+{
+  h ^= h >> 16;
+  h *= 0x85ebca6b;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35;
+  h ^= h >> 16;
+  return h;
+}
+
+// the page of the Bloom filter for a key, and the bits the key sets in it
+static int bloomPage(int key, int pages, unsigned bits[])
+{
+  unsigned h = mix((unsigned) key);
+  unsigned a = mix(h ^ 0x9e3779b9);
+  unsigned b = (a >> 16) | 1;
+  for (int i = 0; i < BLOOM_HASHES; i++) {
+    bits[i] = (a + i * b) % BLOOM_BITS_PER_PAGE;
+  }
+  return h % pages;
+}
+
+static string runName(const string& indexname, int id)
+{
+  return indexname + "." + std::to_string(id);
+}
+
+/**
+ * an immutable sorted run. its file is removed with the last reference
+ * to it once a compaction has replaced it.
+ */
+class LsmRun {
+ public:
+  LsmRun() : id(0), level(0), obsolete(false) { }
+
+  ~LsmRun()
+  {
+    pf.close();
+    if (obsolete) remove(filename.c_str());
+  }
+
+  RC open(const string& name)
+  {
+    char page[PageFile::PAGE_SIZE];
+    RC rc;
+
+    filename = name;
+    if ((rc = pf.open(name, 'r')) < 0) return rc;
+    if ((rc = pf.read(0, page)) < 0) return rc;
+    memcpy(&header, page, sizeof(header));
+    return 0;
+  }
+
+  // false if the key is not in the run
+  bool mayContain(int key) const
+  {
+    unsigned char page[PageFile::PAGE_SIZE];
+    unsigned bits[BLOOM_HASHES];
+    PageId pid = header.bloomStart + bloomPage(key, header.bloomPages, bits);
+
+    if (pf.read(pid, page) < 0) return true;
+    for (int i = 0; i < BLOOM_HASHES; i++) {
+      if ((page[bits[i] / 8] & (1 << (bits[i] % 8))) == 0) return false;
+    }
+    return true;
+  }
+
+  // find the first entry with a key >= key. entry is the # of entries if
+  // there is none
+  RC seek(int key, int& entry) const
+  {
+    char page[PageFile::PAGE_SIZE];
+    int keys[KEYS_PER_PAGE];
+    int child = childOf(header.top, header.topKeys, key);
+    RC rc;
+
+    // the fence levels lead to the data page
+    for (int l = header.levels - 1; l >= 0; l--) {
+      int count = std::min(KEYS_PER_PAGE, header.levelKeys[l] - child * KEYS_PER_PAGE);
+      if ((rc = pf.read(header.levelStart[l] + child, page)) < 0) return rc;
+      memcpy(keys, page, count * sizeof(int));
+      child = child * KEYS_PER_PAGE + childOf(keys, count, key);
+    }
+
+    if ((rc = pf.read(1 + child, page)) < 0) return rc;
+    int low = 0;
+    int high = std::min(ENTRIES_PER_PAGE, header.entries - child * ENTRIES_PER_PAGE);
+    while (low < high) {
+      int mid = (low + high) / 2;
+      int midKey;
+      RecordId rid;
+      getEntry(page, mid, midKey, rid);
+      if (midKey < key) low = mid + 1;
+      else high = mid;
+    }
+    entry = child * ENTRIES_PER_PAGE + low;
+    return 0;
+  }
+
+  int       id;
+  int       level;
+  string    filename;
+  RunHeader header;
+  PageFile  pf;
+  bool      obsolete;  // a compaction has replaced the run
+};
+
+/**
+ * writes the entries of a new run in (key, rid) order.
+ */
+class RunWriter {
+ public:
+  ~RunWriter() { pf.close(); }
+
+  // the # of entries sizes the Bloom filter
+  RC open(const string& filename, int entries)
+  {
+    RC rc;
+
+    // a run of an interrupted compaction may be left over
+    remove(filename.c_str());
+    if ((rc = pf.open(filename, 'w')) < 0) return rc;
+
+    memset(&header, 0, sizeof(header));
+    header.bloomPages = std::max(1, (int) (((long long) entries * BLOOM_BITS_PER_KEY +
+                                            BLOOM_BITS_PER_PAGE - 1) / BLOOM_BITS_PER_PAGE));
+    bloom.assign(header.bloomPages * PageFile::PAGE_SIZE, 0);
+    count = 0;
+    return 0;
+  }
+
+  RC add(int key, const RecordId& rid)
+  {
+    unsigned bits[BLOOM_HASHES];
+    RC rc;
+    int eid = count % ENTRIES_PER_PAGE;
+
+    if (eid == 0) {
+      if (count > 0 && (rc = pf.write(count / ENTRIES_PER_PAGE, page)) < 0) return rc;
+      memset(page, 0, sizeof(page));
+      firstKeys.push_back(key);
+    }
+    putEntry(page, eid, key, rid);
+
+    int pid = bloomPage(key, header.bloomPages, bits);
+    for (int i = 0; i < BLOOM_HASHES; i++) {
+      bloom[pid * PageFile::PAGE_SIZE + bits[i] / 8] |= 1 << (bits[i] % 8);
+    }
+
+    if (count == 0) header.minKey = key;
+    header.maxKey = key;
+    count++;
+    return 0;
+  }
+
+  RC finish()
+  {
+    RC rc;
+    vector<int> keys(firstKeys);
+
+    if (count > 0 && (rc = pf.write((count - 1) / ENTRIES_PER_PAGE + 1, page)) < 0) return rc;
+    header.entries = count;
+    header.dataPages = firstKeys.size();
+    PageId next = header.dataPages + 1;
+
+    // every fence level has the first keys of the pages of the level below
+    while ((int) keys.size() > TOP_KEYS) {
+      vector<int> upper;
+      if (header.levels == MAX_FENCE_LEVELS) return RC_NODE_FULL;
+      header.levelStart[header.levels] = next;
+      header.levelKeys[header.levels] = keys.size();
+      for (unsigned i = 0; i < keys.size(); i += KEYS_PER_PAGE) {
+        memset(page, 0, sizeof(page));
+        memcpy(page, &keys[i], std::min(KEYS_PER_PAGE, (int) (keys.size() - i)) * sizeof(int));
+        if ((rc = pf.write(next++, page)) < 0) return rc;
+        upper.push_back(keys[i]);
+      }
+      keys.swap(upper);
+      header.levels++;
+    }
+    header.topKeys = keys.size();
+    std::copy(keys.begin(), keys.end(), header.top);
+
+    header.bloomStart = next;
+    for (int i = 0; i < header.bloomPages; i++) {
+      if ((rc = pf.write(next++, &bloom[i * PageFile::PAGE_SIZE])) < 0) return rc;
+    }
+
+    memset(page, 0, sizeof(page));
+    memcpy(page, &header, sizeof(header));
+    if ((rc = pf.write(0, page)) < 0) return rc;
+    return pf.close();
+  }
+
+ private:
+  PageFile    pf;
+  RunHeader   header;
+  char        page[PageFile::PAGE_SIZE];  // the data page being filled
+  int         count;                      // # of entries added
+  vector<int> firstKeys;                  // the first key of every data page
+  vector<unsigned char> bloom;
+};
+
+static int countLevel(const vector<shared_ptr<LsmRun> >& runs, int level)
+{
+  int count = 0;
+  for (unsigned i = 0; i < runs.size(); i++) {
+    if (runs[i]->level == level) count++;
+  }
+  return count;
+}
+
+LsmIndex::LsmIndex()
+{
+  mode = 0;
+  sorted = true;
+  nextId = 0;
+  closing = false;
+  error = 0;
+}
+
+LsmIndex::~LsmIndex()
+{
+  if (mode != 0) close();
+}
+
+RC LsmIndex::open(const string& indexname, char m)
+{
+  vector<int> ids;
+  vector<int> levels;
+  RC rc;
+
+  if (mode != 0) return RC_FILE_OPEN_FAILED;
+  if ((rc = manifest.open(indexname, m)) < 0) return rc;
+  if ((rc = readManifest(manifest, ids, levels, nextId)) < 0) {
+    manifest.close();
+    return rc;
+  }
+
+  name = indexname;
+  for (unsigned i = 0; i < ids.size(); i++) {
+    shared_ptr<LsmRun> run(new LsmRun());
+    run->id = ids[i];
+    run->level = levels[i];
+    if ((rc = run->open(runName(name, ids[i]))) < 0) {
+      runs.clear();
+      manifest.close();
+      return rc;
+    }
+    runs.push_back(run);
+  }
+
+  mode = (m == 'w' || m == 'W') ? 'w' : 'r';
+  memtable.clear();
+  sorted = true;
+  closing = false;
+  error = 0;
+  if (mode == 'w') compactor = std::thread(&LsmIndex::work, this);
+  return 0;
+}
+
+RC LsmIndex::close()
+{
+  RC rc = 0;
+
+  if (mode == 0) return RC_FILE_CLOSE_FAILED;
+
+  // the compaction merges every full level before the thread ends, so the
+  // index is left with few runs to read
+  if (mode == 'w') {
+    if (!memtable.empty()) rc = flush();
+    {
+      lock_guard<std::mutex> guard(mutex);
+      closing = true;
+    }
+    changed.notify_all();
+    compactor.join();
+    if (rc == 0) rc = error;
+  }
+
+  runs.clear();
+  vector<Entry>().swap(memtable);
+  if (manifest.close() < 0 && rc == 0) rc = RC_FILE_CLOSE_FAILED;
+  mode = 0;
+  return rc;
+}
+
+RC LsmIndex::readManifest(const PageFile& pf, vector<int>& ids, vector<int>& levels, int& nextId)
+{
+  int page[KEYS_PER_PAGE];
+  RC rc;
+
+  ids.clear();
+  levels.clear();
+  nextId = 0;
+
+  // a new index has no manifest page yet
+  if (pf.endPid() == 0) return 0;
+  if ((rc = pf.read(0, page)) < 0) return rc;
+
+  nextId = page[0];
+  if (page[1] < 0 || page[1] > MAX_RUNS) return RC_INVALID_FILE_FORMAT;
+  for (int i = 0; i < page[1]; i++) {
+    ids.push_back(page[2 + 2 * i]);
+    levels.push_back(page[3 + 2 * i]);
+  }
+  return 0;
+}
+
+RC LsmIndex::writeManifest()
+{
+  int page[KEYS_PER_PAGE];
+
+  if ((int) runs.size() > MAX_RUNS) return RC_NODE_FULL;
+  memset(page, 0, sizeof(page));
+  page[0] = nextId;
+  page[1] = runs.size();
+  for (unsigned i = 0; i < runs.size(); i++) {
+    page[2 + 2 * i] = runs[i]->id;
+    page[3 + 2 * i] = runs[i]->level;
+  }
+  return manifest.write(0, page);
+}
+
+RC LsmIndex::insert(int key, const RecordId& rid)
+{
+  if (mode != 'w') return RC_INVALID_FILE_MODE;
+
+  Entry entry(key, rid);
+  if (sorted && !memtable.empty() && entry < memtable.back()) sorted = false;
+  memtable.push_back(entry);
+
+  if ((int) memtable.size() >= MEMTABLE_ENTRIES) return flush();
+  return 0;
+}
+
+RC LsmIndex::flush()
+{
+  RunWriter writer;
+  shared_ptr<LsmRun> run(new LsmRun());
+  int id;
+  RC rc;
+
+  if (!sorted) std::sort(memtable.begin(), memtable.end());
+  sorted = true;
+
+  // wait while the compaction is too far behind
+  {
+    unique_lock<std::mutex> lock(mutex);
+    while (error == 0 && countLevel(runs, 0) >= L0_STALL) changed.wait(lock);
+    if (error != 0) return error;
+    id = nextId++;
+  }
+
+  // the run is written in one sequential pass
+  if ((rc = writer.open(runName(name, id), memtable.size())) < 0) return rc;
+  for (unsigned i = 0; i < memtable.size(); i++) {
+    if ((rc = writer.add(memtable[i].first, memtable[i].second)) < 0) return rc;
+  }
+  if ((rc = writer.finish()) < 0) return rc;
+
+  run->id = id;
+  run->level = 0;
+  if ((rc = run->open(runName(name, id))) < 0) return rc;
+  memtable.clear();
+
+  {
+    lock_guard<std::mutex> guard(mutex);
+    runs.insert(runs.begin(), run);
+    rc = writeManifest();
+  }
+  changed.notify_all();
+  return rc;
+}
+
+bool LsmIndex::pickCompaction(vector<shared_ptr<LsmRun> >& inputs, int& level)
+{
+  inputs.clear();
+  if (error != 0) return false;
+
+  // the level-0 runs overlap, so they are merged into level 1 all at once
+  if (countLevel(runs, 0) >= L0_RUNS) {
+    for (unsigned i = 0; i < runs.size(); i++) {
+      if (runs[i]->level <= 1) inputs.push_back(runs[i]);
+    }
+    level = 1;
+    return true;
+  }
+
+  // a full level is merged into the next one
+  for (unsigned i = 0; i < runs.size(); i++) {
+    if (runs[i]->level == 0) continue;
+    long long capacity = (long long) L0_RUNS * MEMTABLE_ENTRIES;
+    for (int l = 1; l < runs[i]->level; l++) capacity *= LEVEL_RATIO;
+    if (runs[i]->header.entries <= capacity) continue;
+
+    level = runs[i]->level + 1;
+    inputs.push_back(runs[i]);
+    if (i + 1 < runs.size() && runs[i + 1]->level == level) inputs.push_back(runs[i + 1]);
+    return true;
+  }
+  return false;
+}
+
+void LsmIndex::work()
+{
+  vector<shared_ptr<LsmRun> > inputs;
+  shared_ptr<LsmRun> output;
+  int level;
+  RC rc;
+  unique_lock<std::mutex> lock(mutex);
+
+  for (;;) {
+    if (!pickCompaction(inputs, level)) {
+      if (closing) return;
+      changed.wait(lock);
+      continue;
+    }
+    int id = nextId++;
+
+    // the runs are immutable, so they are merged without the lock
+    lock.unlock();
+    rc = merge(inputs, id, level, output);
+    lock.lock();
+    if (rc < 0) {
+      error = rc;
+      changed.notify_all();
+      continue;
+    }
+
+    // the merged run replaces its inputs. their files are removed once no
+    // cursor reads them
+    for (unsigned i = 0; i < inputs.size(); i++) {
+      runs.erase(std::find(runs.begin(), runs.end(), inputs[i]));
+      inputs[i]->obsolete = true;
+    }
+    unsigned pos = 0;
+    while (pos < runs.size() && runs[pos]->level < level) pos++;
+    runs.insert(runs.begin() + pos, output);
+    if ((rc = writeManifest()) < 0) error = rc;
+    inputs.clear();
+    output.reset();
+    changed.notify_all();
+  }
+}
+
+RC LsmIndex::merge(const vector<shared_ptr<LsmRun> >& inputs, int id, int level,
+                   shared_ptr<LsmRun>& output)
+{
+  RunWriter writer;
+  LsmCursor cursor;
+  int entries = 0;
+  int key;
+  RecordId rid;
+  RC rc;
+
+  cursor.sources.resize(inputs.size());
+  for (unsigned i = 0; i < inputs.size(); i++) {
+    LsmSource& source = cursor.sources[i];
+    source.run = inputs[i];
+    source.next = 0;
+    source.loaded = -1;
+    if ((rc = advance(source)) < 0) return rc;
+    entries += inputs[i]->header.entries;
+  }
+
+  if ((rc = writer.open(runName(name, id), entries)) < 0) return rc;
+  while ((rc = readForward(cursor, key, rid)) == 0) {
+    if ((rc = writer.add(key, rid)) < 0) return rc;
+  }
+  if (rc != RC_END_OF_TREE) return rc;
+  if ((rc = writer.finish()) < 0) return rc;
+
+  output.reset(new LsmRun());
+  output->id = id;
+  output->level = level;
+  return output->open(runName(name, id));
+}
+
+RC LsmIndex::advance(LsmSource& source)
+{
+  RC rc;
+
+  source.valid = false;
+  if (source.run == NULL) {
+    if (source.next >= (int) memtable.size()) return 0;
+    source.key = memtable[source.next].first;
+    source.rid = memtable[source.next].second;
+  } else {
+    if (source.next >= source.run->header.entries) return 0;
+    PageId pid = 1 + source.next / ENTRIES_PER_PAGE;
+    if (source.loaded != pid) {
+      if ((rc = source.run->pf.read(pid, source.page)) < 0) return rc;
+      source.loaded = pid;
+    }
+    getEntry(source.page, source.next % ENTRIES_PER_PAGE, source.key, source.rid);
+  }
+  source.next++;
+  source.valid = true;
+  return 0;
+}
+
+static bool keyLess(const std::pair<int, RecordId>& entry, int key)
+{
+  return entry.first < key;
+}
+
+RC LsmIndex::locate(int searchKey, LsmCursor& cursor)
+{
+  vector<shared_ptr<LsmRun> > snapshot;
+  bool found = false;
+  RC rc;
+
+  {
+    lock_guard<std::mutex> guard(mutex);
+    snapshot = runs;
+  }
+
+  cursor.sources.clear();
+  cursor.sources.reserve(snapshot.size() + 1);
+  if (!memtable.empty()) {
+    if (!sorted) std::sort(memtable.begin(), memtable.end());
+    sorted = true;
+    cursor.sources.resize(1);
+    LsmSource& source = cursor.sources.back();
+    source.next = std::lower_bound(memtable.begin(), memtable.end(), searchKey, keyLess) -
+                  memtable.begin();
+    source.loaded = -1;
+    advance(source);
+    found = source.valid;
+  }
+
+  // a run whose keys are all smaller has nothing to add
+  for (unsigned i = 0; i < snapshot.size(); i++) {
+    if (snapshot[i]->header.maxKey < searchKey) continue;
+    cursor.sources.resize(cursor.sources.size() + 1);
+    LsmSource& source = cursor.sources.back();
+    source.run = snapshot[i];
+    source.loaded = -1;
+    if ((rc = snapshot[i]->seek(searchKey, source.next)) < 0) return rc;
+    if ((rc = advance(source)) < 0) return rc;
+    if (source.valid) found = true;
+  }
+
+  return found ? 0 : RC_NO_SUCH_RECORD;
+}
+
+RC LsmIndex::readForward(LsmCursor& cursor, int& key, RecordId& rid)
+{
+  LsmSource* first = NULL;
+
+  // the sources are few, so the smallest entry is found by a linear search
+  for (unsigned i = 0; i < cursor.sources.size(); i++) {
+    LsmSource& source = cursor.sources[i];
+    if (!source.valid) continue;
+    if (first == NULL || source.key < first->key ||
+        (source.key == first->key && source.rid < first->rid)) {
+      first = &source;
+    }
+  }
+  if (first == NULL) return RC_END_OF_TREE;
+
+  key = first->key;
+  rid = first->rid;
+  return advance(*first);
+}
+
+RC LsmIndex::lookup(int searchKey, vector<RecordId>& rids)
+{
+  vector<shared_ptr<LsmRun> > snapshot;
+  LsmSource source;
+  RC rc;
+
+  {
+    lock_guard<std::mutex> guard(mutex);
+    snapshot = runs;
+  }
+
+  rids.clear();
+  if (!sorted) std::sort(memtable.begin(), memtable.end());
+  sorted = true;
+  vector<Entry>::const_iterator it =
+    std::lower_bound(memtable.begin(), memtable.end(), searchKey, keyLess);
+  for (; it != memtable.end() && it->first == searchKey; ++it) {
+    rids.push_back(it->second);
+  }
+
+  for (unsigned i = 0; i < snapshot.size(); i++) {
+    const RunHeader& header = snapshot[i]->header;
+    if (searchKey < header.minKey || searchKey > header.maxKey) continue;
+    if (!snapshot[i]->mayContain(searchKey)) continue;
+
+    source.run = snapshot[i];
+    source.loaded = -1;
+    if ((rc = snapshot[i]->seek(searchKey, source.next)) < 0) return rc;
+    while ((rc = advance(source)) == 0 && source.valid && source.key == searchKey) {
+      rids.push_back(source.rid);
+    }
+    if (rc < 0) return rc;
+  }
+
+  std::sort(rids.begin(), rids.end());
+  return 0;
+}
+
+int LsmIndex::getRunCount()
+{
+  lock_guard<std::mutex> guard(mutex);
+  return runs.size();
+}
+
+RC LsmIndex::drop(const string& indexname)
+{
+  PageFile pf;
+  vector<int> ids;
+  vector<int> levels;
+  int nextId;
+  RC rc;
+
+  if ((rc = pf.open(indexname, 'r')) < 0) return rc;
+  rc = readManifest(pf, ids, levels, nextId);
+  pf.close();
+  if (rc < 0) return rc;
+
+  for (unsigned i = 0; i < ids.size(); i++) {
+    remove(runName(indexname, ids[i]).c_str());
+  }
+  if (remove(indexname.c_str()) != 0) return RC_FILE_WRITE_FAILED;
+  return 0;
+}
+
+RC LsmIndex::rename(const string& from, const string& to)
+{
+  PageFile pf;
+  vector<int> ids;
+  vector<int> levels;
+  int nextId;
+  RC rc;
+
+  if ((rc = pf.open(from, 'r')) < 0) return rc;
+  rc = readManifest(pf, ids, levels, nextId);
+  pf.close();
+  if (rc < 0) return rc;
+
+  for (unsigned i = 0; i < ids.size(); i++) {
+    if (::rename(runName(from, ids[i]).c_str(), runName(to, ids[i]).c_str()) != 0) {
+      return RC_FILE_WRITE_FAILED;
+    }
+  }
+  if (::rename(from.c_str(), to.c_str()) != 0) return RC_FILE_WRITE_FAILED;
+  return 0;
+}
@@ -0,0 +1,220 @@
+#ifndef LSMINDEX_H
+#define LSMINDEX_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "Bruinbase.h"
+#include "PageFile.h"
+#include "RecordFile.h"
+
+class LsmRun;  // an immutable sorted run of an LsmIndex, in LsmIndex.cc
+
+/**
+ * the position of an LsmCursor in the memtable or in one run
+ */
+struct LsmSource {
+  std::shared_ptr<LsmRun> run;  // NULL for the memtable
+  int      next;                // the entry after the current one
+  bool     valid;               // false once the source is exhausted
+  int      key;                 // the current entry
+  RecordId rid;
+  PageId   loaded;              // the data page in page. -1 if none
+  char     page[PageFile::PAGE_SIZE];
+};
+
+/**
+ * a scan of an LsmIndex. it merges the memtable and the runs, and keeps
+ * the runs it reads even if a compaction replaces them in the meantime.
+ */
+typedef struct {
+  std::vector<LsmSource> sources;
+} LsmCursor;
+
+/**
+ * A write-optimized index on the int key of a table (a log-structured
+ * merge tree). New entries go to a sorted in-memory memtable. A full
+ * memtable is written out as an immutable sorted run, so an insert costs
+ * a share of a sequential write instead of a path of random page reads
+ * and writes. Level 0 holds the runs of the memtable, whose key ranges
+ * overlap. Every level below holds a single run that is LEVEL_RATIO times
+ * larger than the one above; a thread of the index merges a level into
+ * the next one in the background once it is full (leveled compaction).
+ *
+ * A run stores its entries in (key, rid) order, a few levels of fence
+ * keys to find the page of a key, and a Bloom filter on the keys, so that
+ * lookup() reads no data page of a run that does not have the key.
+ * The index file is a manifest that lists the runs; the run with id N is
+ * stored in the file named indexname.N.
+ *
+ * There are no deletes, so the entries of all runs and the memtable are
+ * merged as they are. insert() and the reads must not run at the same
+ * time; the compaction may run with either.
+ */
+class LsmIndex {
+ public:
+  // # of entries of a memtable, which becomes a level-0 run
+  static const int MEMTABLE_ENTRIES = 65536;
+
+  // # of level-0 runs that start a compaction into level 1
+  static const int L0_RUNS = 4;
+
+  // # of level-0 runs at which insert() waits for the compaction
+  static const int L0_STALL = 12;
+
+  // the ratio between the sizes of two levels
+  static const int LEVEL_RATIO = 10;
+
+  LsmIndex();
+  ~LsmIndex();
+
+  /**
+   * Open the index in read or write mode.
+   * Under 'w' mode, the index is created if it does not exist, and the
+   * compaction thread is started.
+   * @param indexname[IN] the name of the manifest of the index
+   * @param mode[IN] 'r' for read, 'w' for write
+   * @return error code. 0 if no error
+   */
+  RC open(const std::string& indexname, char mode);
+
+  /**
+   * Write the memtable out, wait for the compaction to finish and close
+   * the index.
+   * @return error code. 0 if no error
+   */
+  RC close();
+
+  /**
+   * Insert (key, RecordId) pair to the index.
+   * @param key[IN] the key of the record
+   * @param rid[IN] the RecordId of the record
+   * @return error code. RC_INVALID_FILE_MODE if the index is not open
+   * for writing
+   */
+  RC insert(int key, const RecordId& rid);
+
+  /**
+   * Find the first entry whose key is larger than or equal to searchKey
+   * in the memtable and every run, and output the positions in cursor.
+   * Call readForward() with the cursor to scan the keys in ascending order.
+   * @param searchKey[IN] the key to find
+   * @param cursor[OUT] the cursor
+   * @return error code. RC_NO_SUCH_RECORD if the index is empty
+   */
+  RC locate(int searchKey, LsmCursor& cursor);
+
+  /**
+   * Read the entry with the smallest (key, rid) at the cursor, and move
+   * the cursor forward to the next entry.
+   * @param cursor[IN/OUT] the cursor
+   * @param key[OUT] the key of the entry
+   * @param rid[OUT] the RecordId of the entry
+   * @return error code. RC_END_OF_TREE if the cursor is past the last entry
+   */
+  RC readForward(LsmCursor& cursor, int& key, RecordId& rid);
+
+  /**
+   * Find the entries with a key. A run whose Bloom filter does not have
+   * the key is skipped.
+   * @param searchKey[IN] the key to find
+   * @param rids[OUT] the RecordIds of the entries, in ascending order
+   * @return error code. 0 if no error
+   */
+  RC lookup(int searchKey, std::vector<RecordId>& rids);
+
+  /**
+   * @return the # of runs of the index
+   */
+  int getRunCount();
+
+  /**
+   * Remove the manifest and the runs of an index.
+   * @param indexname[IN] the name of the manifest of the index
+   * @return error code. RC_FILE_OPEN_FAILED if there is no such index
+   */
+  static RC drop(const std::string& indexname);
+
+  /**
+   * Rename an index that is not open. Its runs are renamed with it.
+   * @param from[IN] the name of the manifest of the index
+   * @param to[IN] the new name
+   * @return error code. 0 if no error
+   */
+  static RC rename(const std::string& from, const std::string& to);
+
+ private:
+  typedef std::pair<int, RecordId> Entry;
+
+  /**
+   * read the manifest of an index.
+   * @param pf[IN] the open manifest
+   * @param ids[OUT] the ids of the runs
+   * @param levels[OUT] the level of each run
+   * @param nextId[OUT] the id of the next new run
+   * @return error code. 0 if no error
+   */
+  static RC readManifest(const PageFile& pf, std::vector<int>& ids,
+                         std::vector<int>& levels, int& nextId);
+
+  /**
+   * write the runs to the manifest. the caller holds the mutex.
+   */
+  RC writeManifest();
+
+  /**
+   * write the memtable out as a new level-0 run.
+   */
+  RC flush();
+
+  /**
+   * choose the runs to merge next. the caller holds the mutex.
+   * @param inputs[OUT] the runs to merge
+   * @param level[OUT] the level of the merged run
+   * @return true if a level is full
+   */
+  bool pickCompaction(std::vector<std::shared_ptr<LsmRun> >& inputs, int& level);
+
+  /**
+   * the compaction thread. it merges full levels until the index is closed.
+   */
+  void work();
+
+  /**
+   * merge runs into a new run.
+   * @param inputs[IN] the runs to merge
+   * @param id[IN] the id of the new run
+   * @param level[IN] the level of the new run
+   * @param output[OUT] the new run
+   * @return error code. 0 if no error
+   */
+  RC merge(const std::vector<std::shared_ptr<LsmRun> >& inputs, int id, int level,
+           std::shared_ptr<LsmRun>& output);
+
+  /**
+   * add the next entry of a source to it, reading its page if needed.
+   */
+  RC advance(LsmSource& source);
+
+  std::string name;       // the name of the manifest
+  char        mode;       // 'r' or 'w'. 0 if not open
+  PageFile    manifest;
+
+  std::vector<Entry> memtable;  // the new entries
+  bool               sorted;    // the memtable is in (key, rid) order
+
+  // the runs, level 0 first. the mutex guards runs and nextId
+  std::vector<std::shared_ptr<LsmRun> > runs;
+  int                     nextId;
+  std::thread             compactor;
+  std::mutex              mutex;
+  std::condition_variable changed;  // a run was added or merged, or the index closes
+  bool                    closing;
+  RC                      error;    // the error of the compaction thread
+};
+
+#endif /* LSMINDEX_H */
@@ -11,13 +11,19 @@
 #include "PageFile.h"
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <unistd.h>
+#include <cstring>
+#include "BufferPool.h"
 
 using std::string;
 
-int PageFile::readCount = 0;
-int PageFile::writeCount = 0;
-int PageFile::cacheClock = 1;
-struct PageFile::cacheStruct PageFile::readCache[PageFile::CACHE_COUNT];
+// the cache of the pages of every PageFile. the pages are read and written
+// with pread() and pwrite(), which do not move the file offset, so several
+// threads can read the same file
+static BufferPool pool;
+
+std::atomic<int> PageFile::readCount(0);
+std::atomic<int> PageFile::writeCount(0);
 
 PageFile::PageFile() 
 { 
@@ -70,18 +76,13 @@ RC PageFile::close()
 {
   if (fd <= 0) return RC_FILE_CLOSE_FAILED;
 
+  // evict all cached pages for this file. once the file is closed, the
+  // next file opened may get the same fd
+  pool.invalidateFile(fd);
+
   // close the file
   if (::close(fd) < 0) return RC_FILE_CLOSE_FAILED;
 
-  // evict all cached pages for this file
-  for (int i = 0; i < CACHE_COUNT; i++) {
-    if (readCache[i].fd == fd && readCache[i].lastAccessed != 0) {
-       readCache[i].fd = 0;
-       readCache[i].pid = 0;
-       readCache[i].lastAccessed = 0;
-    }
-  }
-
   // set the fd and epid to the initial state
   fd = -1; 
   epid = 0;
@@ -93,35 +94,20 @@ PageId PageFile::endPid() const
   return epid;
 }
 
-RC PageFile::seek(PageId pid) const
-{
-  return (::lseek(fd, pid * PAGE_SIZE, SEEK_SET) < 0) ? RC_FILE_SEEK_FAILED : 0;
-}
-
 RC PageFile::write(PageId pid, const void* buffer)
 {
-  RC rc;
   if (pid < 0) return RC_INVALID_PID; 
 
-  // seek to the location of the page
-  if ((rc = seek(pid) < 0)) return rc;
-
   // write the buffer to the disk page
-  if (::write(fd, buffer, PAGE_SIZE) < 0) return RC_FILE_WRITE_FAILED;
+  if (::pwrite(fd, buffer, PAGE_SIZE, (off_t) pid * PAGE_SIZE) < 0) return RC_FILE_WRITE_FAILED;
 
   // if the page is in read cache, invalidate it
-  for (int i = 0; i < CACHE_COUNT; i++) {
-    if (readCache[i].fd == fd && readCache[i].pid == pid &&
-        readCache[i].lastAccessed != 0) {
-       readCache[i].fd = 0;
-       readCache[i].pid = 0;
-       readCache[i].lastAccessed = 0;
-       break;
-    }
-  }
+  pool.invalidate(fd, pid);
 
-  // if the written pid >= end pid, update the end pid
-  if (pid >= epid) epid = pid + 1;
+  // if the written pid >= end pid, update the end pid, unless another
+  // thread has moved it further in the meantime
+  PageId end = epid;
+  while (pid >= end && !epid.compare_exchange_weak(end, pid + 1)) { }
 
   // increase page write count
   writeCount++;
@@ -131,45 +117,18 @@ RC PageFile::write(PageId pid, const void* buffer)
 
 RC PageFile::read(PageId pid, void* buffer) const
 {
-  RC rc;
-
   if (pid < 0 || pid >= epid) return RC_INVALID_PID; 
 
-  //
   // if the page is in cache, read it from there
-  //
-  for (int i = 0; i < CACHE_COUNT; i++) {
-    if (readCache[i].fd == fd && readCache[i].pid == pid && 
-        readCache[i].lastAccessed != 0) {
-       memcpy(buffer, readCache[i].buffer, PAGE_SIZE);
-       readCache[i].lastAccessed = ++cacheClock;
-       return 0;
-    }
-  }
+  unsigned epoch;
+  if (pool.read(fd, pid, buffer, epoch)) return 0;
 
-  // seek to the page
-  if ((rc = seek(pid) < 0)) return rc;
-  
-  // find the cache slot to evict
-  int toEvict = 0; 
-  for (int i = 0; i < CACHE_COUNT; i++) {
-    if (readCache[i].lastAccessed == 0) {
-      toEvict = i;
-      break;
-    }
-    if (readCache[i].lastAccessed < readCache[toEvict].lastAccessed) {
-      toEvict = i;
-    }
-  }
-  readCache[toEvict].fd = fd;
-  readCache[toEvict].pid = pid;
-  readCache[toEvict].lastAccessed = ++cacheClock;
- 
-  // read the page to cache first and copy it to the buffer
-  if (::read(fd, readCache[toEvict].buffer, PAGE_SIZE) < 0) {
+  // read the page and add it to the cache, unless a write has dropped a
+  // page of its shard since
+  if (::pread(fd, buffer, PAGE_SIZE, (off_t) pid * PAGE_SIZE) < 0) {
     return RC_FILE_READ_FAILED;
   }
-  memcpy(buffer, readCache[toEvict].buffer, PAGE_SIZE);
+  pool.insert(fd, pid, buffer, epoch);
 
   // increase the page read count
   readCount++;
@@ -11,6 +11,7 @@
 #define PAGEFILE_H
 
 #include <string>
+#include <atomic>
 #include "Bruinbase.h"
 
 typedef int PageId;
@@ -43,6 +44,8 @@ class PageFile {
   
   /**
    * read a disk page into memory buffer.
+   * several threads may read the same PageFile at the same time, as long
+   * as no thread writes to it.
    * @param pid[IN] the page to read
    * @param buffer[OUT] pointer to memory buffer
    * @return error code. 0 if no error
@@ -76,37 +79,15 @@ class PageFile {
    */
   static int getPageWriteCount() { return writeCount; }
 
- protected:
-  /**
-   * move the file cursor to the beginning of a page.
-   * this is an internal function not exposed to public.
-   * @param pid[IN] page to seek to
-   * @return error code. 0 if no error
-   */
-  RC seek(PageId pid) const;
-
  private:
   int     fd;     // file descriptor of the associated unix file
-  PageId  epid;   // (last page id + 1) of the file
-
-  //
-  // the following set of members implement LRU caching 
-  //
-  static const int CACHE_COUNT = 10;
-
-  static int cacheClock; // clock tick counter for LRU policy
-
-  // the actual cache data structure
-  static struct cacheStruct {
-    int    fd;              // file id of the cached page
-    PageId pid;             // page id of the cached page
-    int    lastAccessed;    // the last time the cached page was accessed
-                            //   (lastAccessed == 0) means that the buffer is empty
-    char buffer[PAGE_SIZE]; // the buffer used for caching
-  } readCache[CACHE_COUNT];
+  std::atomic<PageId> epid; // (last page id + 1) of the file. atomic, as
+                            // threads may write new pages at once
 
-  static int readCount;  // total # of page reads 
-  static int writeCount; // total # of page writes 
+  // the pages are cached in a BufferPool shared by every PageFile.
+  // the counters are atomic, as several threads may read pages at once
+  static std::atomic<int> readCount;  // total # of page reads 
+  static std::atomic<int> writeCount; // total # of page writes 
 };
   
 #endif // PAGEFILE_H
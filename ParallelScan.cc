@@ -0,0 +1,216 @@
+#include <algorithm>
+#include "ParallelScan.h"
+
+using namespace std;
+
+int ParallelScan::defaultThreads()
+{
+  int cores = (int) thread::hardware_concurrency();
+  if (cores < 1) return 1;
+  return min(cores, (int) MAX_THREADS);
+}
+
+ParallelScan::ParallelScan()
+{
+  task = NULL;
+  current = -1;
+  position = 0;
+  gathered = 0;
+  stopped = false;
+  error = 0;
+}
+
+ParallelScan::~ParallelScan()
+{
+  finish();
+}
+
+RC ParallelScan::start(Task& t, PageId begin, PageId end, int threads, bool inOrder)
+{
+  int count = (end > begin) ? (end - begin + MORSEL_PAGES - 1) / MORSEL_PAGES : 0;
+
+  if (!workers.empty()) return RC_INVALID_FILE_MODE;
+
+  task = &t;
+  beginPid = begin;
+  endPid = end;
+  ordered = inOrder;
+  threads = max(1, min(threads, count));
+  window = WINDOW_PER_THREAD * threads;
+
+  morsels.assign(count, Morsel());
+  for (int m = 0; m < count; m++) {
+    morsels[m].done = false;
+    morsels[m].rc = 0;
+  }
+  finished.clear();
+  gathered = 0;
+  last = count;
+  current = -1;
+  position = 0;
+  stopped = false;
+  error = 0;
+
+  // deal the morsels out in turn, so that every thread starts at the
+  // beginning of the pages
+  queues.assign(threads, deque<int>());
+  for (int m = 0; m < count; m++) queues[m % threads].push_back(m);
+
+  if (count == 0) return 0;
+  for (int i = 0; i < threads; i++) {
+    workers.push_back(thread(&ParallelScan::work, this, i));
+  }
+  return 0;
+}
+
+int ParallelScan::pickQueue(int thread) const
+{
+  // the own queue first. otherwise steal from the queue with the most
+  // morsels left, which is the one that would finish last
+  if (!queues[thread].empty()) return thread;
+
+  int victim = -1;
+  for (unsigned q = 0; q < queues.size(); q++) {
+    if (!queues[q].empty() && (victim < 0 || queues[q].size() > queues[victim].size())) {
+      victim = q;
+    }
+  }
+  return victim;
+}
+
+void ParallelScan::work(int thread)
+{
+  vector<int>    keys;
+  vector<string> values;
+  vector<string_view> views;
+  RC rc;
+
+  for (;;) {
+    int m;
+    {
+      unique_lock<std::mutex> guard(mutex);
+      for (;;) {
+        if (stopped) return;
+        int q = pickQueue(thread);
+        if (q < 0) return;
+
+        // the morsels after the end of an ordered scan are dropped
+        m = queues[q].front();
+        if (ordered && m > last) {
+          queues[q].pop_front();
+          continue;
+        }
+
+        // wait while too many morsels are waiting to be gathered
+        if (ordered ? m < gathered + window : (int) finished.size() < window) {
+          queues[q].pop_front();
+          break;
+        }
+        windowMoved.wait(guard);
+      }
+    }
+
+    PageId begin = beginPid + m * MORSEL_PAGES;
+    PageId end = min(endPid, begin + MORSEL_PAGES);
+    keys.clear();
+    values.clear();
+    views.clear();
+    rc = task->scan(thread, begin, end, keys, values, views);
+
+    {
+      lock_guard<std::mutex> guard(mutex);
+      if (rc != 0 && ordered) {
+        // the earlier morsels are still gathered
+        if (m < last) last = m;
+        windowMoved.notify_all();
+      } else if (rc < 0) {
+        if (error == 0) error = rc;
+        stopped = true;
+        windowMoved.notify_all();
+      }
+      morsels[m].keys.swap(keys);
+      morsels[m].values.swap(values);
+      morsels[m].views.swap(views);
+      morsels[m].done = true;
+      morsels[m].rc = rc;
+      if (!ordered) finished.push_back(m);
+    }
+    morselDone.notify_all();
+  }
+}
+
+RC ParallelScan::next(int& key, string& value)
+{
+  string_view view;
+  RC rc;
+
+  // a string of the task is handed over as it is
+  if ((rc = next(key, view)) == 0) {
+    Morsel& morsel = morsels[current];
+    if (morsel.views.empty()) {
+      value.swap(morsel.values[position - 1]);
+    } else {
+      value.assign(view.data(), view.size());
+    }
+  }
+  return rc;
+}
+
+RC ParallelScan::next(int& key, string_view& value)
+{
+  for (;;) {
+    // the tuples of a morsel are not changed once it is done, so they are
+    // read without the lock
+    if (current >= 0 && position < morsels[current].keys.size()) {
+      Morsel& morsel = morsels[current];
+      key = morsel.keys[position];
+      value = morsel.views.empty() ? string_view(morsel.values[position]) : morsel.views[position];
+      position++;
+      return 0;
+    }
+
+    unique_lock<std::mutex> guard(mutex);
+
+    // release the tuples of the morsel we are done with
+    if (current >= 0) {
+      vector<int>().swap(morsels[current].keys);
+      vector<string>().swap(morsels[current].values);
+      vector<string_view>().swap(morsels[current].views);
+      current = -1;
+      gathered++;
+      windowMoved.notify_all();
+    }
+
+    for (;;) {
+      if (error != 0) return error;
+      if (ordered && gathered > last) return morsels[last].rc;
+      if (gathered == (int) morsels.size()) return RC_END_OF_STREAM;
+      if (ordered && morsels[gathered].done) {
+        current = gathered;
+        break;
+      }
+      if (!ordered && !finished.empty()) {
+        current = finished.front();
+        finished.pop_front();
+        break;
+      }
+      morselDone.wait(guard);
+    }
+    position = 0;
+  }
+}
+
+RC ParallelScan::finish()
+{
+  {
+    lock_guard<std::mutex> guard(mutex);
+    stopped = true;
+  }
+  windowMoved.notify_all();
+
+  for (unsigned i = 0; i < workers.size(); i++) {
+    workers[i].join();
+  }
+  workers.clear();
+  return error;
+}
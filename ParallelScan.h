@@ -0,0 +1,158 @@
+#ifndef PARALLELSCAN_H
+#define PARALLELSCAN_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "Bruinbase.h"
+#include "PageFile.h"
+
+/**
+ * A scan of a range of pages by a pool of threads.
+ * The pages are split into morsels of MORSEL_PAGES consecutive pages.
+ * Thread i starts with a queue of its own holding morsels i, i + threads,
+ * i + 2 * threads, ... and, once its queue is empty, steals from the queue
+ * with the most morsels left. A thread always takes the first morsel of
+ * a queue, so the scan moves through the pages roughly in order.
+ *
+ * A Task does the work on each morsel and may return tuples, which the
+ * calling thread gathers with next(), either in page order or in the
+ * order the morsels finish. The tuples of at most WINDOW_PER_THREAD
+ * morsels per thread wait to be gathered at any time, so a slow consumer
+ * holds the threads back instead of having the whole file buffered.
+ */
+class ParallelScan {
+ public:
+  // # of pages in a morsel, the unit of work of a thread
+  static const int MORSEL_PAGES = 16;
+
+  // a scan of fewer pages is not worth starting the threads
+  static const int MIN_PAGES = 16 * MORSEL_PAGES;
+
+  // the largest # of threads of a scan
+  static const int MAX_THREADS = 32;
+
+  // # of morsels per thread whose tuples may wait to be gathered
+  static const int WINDOW_PER_THREAD = 4;
+
+  /**
+   * The work done on each morsel. scan() is called by several threads at
+   * the same time, so it must keep any state per thread.
+   */
+  class Task {
+   public:
+    virtual ~Task() { }
+
+    /**
+     * process the pages of a morsel. a task returns the values of its
+     * tuples either as strings in values, or as views in views if they
+     * point into memory that outlives the scan.
+     * @param thread[IN] the thread that runs the task, from 0 to # threads - 1
+     * @param begin[IN] the first page of the morsel
+     * @param end[IN] the page after the last page of the morsel
+     * @param keys[OUT] the keys of the tuples to gather
+     * @param values[OUT] the values of the tuples to gather
+     * @param views[OUT] the values of the tuples to gather, if not in values
+     * @return error code. 0 if no error. an error, or RC_END_OF_STREAM,
+     * ends the scan: an ordered scan first gathers the tuples of this and
+     * the earlier morsels, then next() returns the error. an unordered
+     * scan stops at once on an error
+     */
+    virtual RC scan(int thread, PageId begin, PageId end,
+                    std::vector<int>& keys, std::vector<std::string>& values,
+                    std::vector<std::string_view>& views) = 0;
+  };
+
+  /**
+   * @return the # of threads of a scan: the # of cores, at most MAX_THREADS
+   */
+  static int defaultThreads();
+
+  ParallelScan();
+  ~ParallelScan();
+
+  /**
+   * start the threads on the pages [begin, end).
+   * @param task[IN] the work done on each morsel
+   * @param begin[IN] the first page to scan
+   * @param end[IN] the page after the last page to scan
+   * @param threads[IN] the # of threads. fewer are used if there are
+   * fewer morsels
+   * @param ordered[IN] true to gather the tuples in page order
+   * @return error code. 0 if no error
+   */
+  RC start(Task& task, PageId begin, PageId end, int threads, bool ordered);
+
+  /**
+   * gather the next tuple returned by the task.
+   * @param key[OUT] the key of the tuple
+   * @param value[OUT] the value of the tuple
+   * @return error code. RC_END_OF_STREAM once every morsel has been
+   * gathered, or the error of a task that ended the scan
+   */
+  RC next(int& key, std::string& value);
+
+  /**
+   * gather the next tuple returned by the task without copying its value.
+   * @param key[OUT] the key of the tuple
+   * @param value[OUT] the value of the tuple. a view that the task
+   * returned stays valid as long as the memory it points into; a view of
+   * a string that the task returned, only until the next call
+   * @return error code. RC_END_OF_STREAM once every morsel has been
+   * gathered, or the error of a task that ended the scan
+   */
+  RC next(int& key, std::string_view& value);
+
+  /**
+   * stop the threads, even if some morsels have not been scanned, and
+   * wait for them to end.
+   * @return the error of a task. 0 if no error
+   */
+  RC finish();
+
+  /**
+   * @return the # of threads of the running scan
+   */
+  int getThreads() const { return (int) workers.size(); }
+
+ private:
+  // the tuples of a morsel
+  struct Morsel {
+    std::vector<int>         keys;
+    std::vector<std::string> values;
+    std::vector<std::string_view> views;
+    bool                     done;
+    RC                       rc;    // the result of the task
+  };
+
+  void work(int thread);
+  int  pickQueue(int thread) const;
+
+  Task*  task;
+  PageId beginPid;
+  PageId endPid;
+  bool   ordered;
+  int    window;    // # of morsels that may wait to be gathered
+
+  std::vector<std::thread>      workers;
+  std::vector<std::deque<int> > queues;   // the morsels left, per thread
+  std::vector<Morsel>           morsels;
+  std::deque<int>               finished; // done but not gathered, unordered scan
+
+  int      gathered;  // # of morsels gathered, and the next one of an ordered scan
+  int      last;      // the first morsel whose task ended an ordered scan
+  int      current;   // the morsel being gathered. -1 if none
+  unsigned position;  // the next tuple of the current morsel
+  bool     stopped;
+  RC       error;
+
+  std::mutex              mutex;      // guards the queues and the morsel states
+  std::condition_variable morselDone; // a morsel is done, or the scan failed
+  std::condition_variable windowMoved; // a morsel is gathered, or the scan stopped
+};
+
+#endif /* PARALLELSCAN_H */
@@ -7,10 +7,12 @@
  * @date 3/24/2008
  */
 
+#include <cstring>
 #include "Bruinbase.h"
 #include "RecordFile.h"
 
 using std::string;
+using std::string_view;
 
 //
 // helper functions for page manipultation
@@ -23,7 +25,7 @@ static char* slotPtr(char* page, int n);
 static void readSlot(const char* page, int n, int& key, std::string& value);
 
 // write the record to the n'th slot in the page
-static void writeSlot(char* page, int n, int key, const std::string& value);
+static void writeSlot(char* page, int n, int key, std::string_view value);
 
 // get # records stored in the page
 static int getRecordCount(const char* page);
@@ -183,6 +185,27 @@ RC RecordFile::read(const RecordId& rid, int& key, string& value) const
   return 0;
 }
 
+RC RecordFile::readPage(PageId pid, int& count, int keys[RECORDS_PER_PAGE],
+                        string values[RECORDS_PER_PAGE]) const
+{
+  RC   rc;
+  char page[PageFile::PAGE_SIZE];
+
+  // check whether the page is in the valid range
+  if (pid < 0 || pid > erid.pid || (pid == erid.pid && erid.sid == 0)) return RC_INVALID_PID;
+
+  if ((rc = pf.read(pid, page)) < 0) return rc;
+
+  // only the slots before the end record id are in use
+  count = (pid == erid.pid) ? erid.sid : getRecordCount(page);
+  if (count < 0 || count > RECORDS_PER_PAGE) return RC_INVALID_FILE_FORMAT;
+  for (int i = 0; i < count; i++) {
+    readSlot(page, i, keys[i], values[i]);
+  }
+
+  return 0;
+}
+
 RC RecordFile::append(int key, const std::string& value, RecordId& rid)
 {
   RC   rc;
@@ -217,6 +240,40 @@ RC RecordFile::append(int key, const std::string& value, RecordId& rid)
   return 0;
 }
 
+RC RecordFile::append(int count, const int keys[], const string_view values[], RecordId& rid)
+{
+  RC   rc;
+  char page[PageFile::PAGE_SIZE];
+  int  i = 0;
+
+  rid = erid;
+  while (i < count) {
+    // a partly filled last page is read first, as in append()
+    if (erid.sid > 0) {
+      if ((rc = pf.read(erid.pid, page)) < 0) return rc;
+    } else {
+      memset(page, 0, PageFile::PAGE_SIZE);
+    }
+
+    // fill the rest of the page, then write it once
+    int sid = erid.sid;
+    for (; sid < RECORDS_PER_PAGE && i < count; sid++, i++) {
+      writeSlot(page, sid, keys[i], values[i]);
+    }
+    setRecordCount(page, sid);
+    if ((rc = pf.write(erid.pid, page)) < 0) return rc;
+
+    if (sid == RECORDS_PER_PAGE) {
+      erid.pid++;
+      erid.sid = 0;
+    } else {
+      erid.sid = sid;
+    }
+  }
+
+  return 0;
+}
+
 const RecordId& RecordFile::endRid() const
 {
   return erid;
@@ -258,7 +315,7 @@ static void readSlot(const char* page, int n, int& key, std::string& value)
   value.assign(ptr + sizeof(int));
 }
 
-static void writeSlot(char* page, int n, int key, const std::string& value)
+static void writeSlot(char* page, int n, int key, std::string_view value)
 {
   // compute the location of the record
   char *ptr = slotPtr(page, n);
@@ -266,12 +323,12 @@ static void writeSlot(char* page, int n, int key, const std::string& value)
   // store the key
   memcpy(ptr, &key, sizeof(int));
 
-  // store the value. 
-  if ((int)value.size() >= RecordFile::MAX_VALUE_LENGTH) {
-    // when the string is longer than MAX_VALUE_LENGTH, truncate it.
-    memcpy(ptr + sizeof(int), value.c_str(), RecordFile::MAX_VALUE_LENGTH -1);
-    *(ptr + sizeof(int) + RecordFile::MAX_VALUE_LENGTH - 1) = 0;
-  } else {
-    strcpy(ptr + sizeof(int), value.c_str());
-  }
+  // store the value up to its first NUL. when the string is longer than
+  // MAX_VALUE_LENGTH, truncate it.
+  size_t len = value.size();
+  const void* nul = memchr(value.data(), 0, len);
+  if (nul != NULL) len = (const char*) nul - value.data();
+  if (len >= (size_t) RecordFile::MAX_VALUE_LENGTH) len = RecordFile::MAX_VALUE_LENGTH - 1;
+  memcpy(ptr + sizeof(int), value.data(), len);
+  ptr[sizeof(int) + len] = 0;
 }
@@ -11,6 +11,7 @@
 #define RECORDFILE_H
 
 #include <string>
+#include <string_view>
 #include "PageFile.h"
 
 /**
@@ -79,6 +80,17 @@ class RecordFile {
    */
   RC read(const RecordId& rid, int& key, std::string& value) const;
 
+  /**
+   * read every record of a page with a single page read.
+   * @param pid[IN] the page to read
+   * @param count[OUT] the # of records in the page
+   * @param keys[OUT] the keys of the records, in slot order
+   * @param values[OUT] the values of the records, in slot order
+   * @return error code. 0 if no error
+   */
+  RC readPage(PageId pid, int& count, int keys[RECORDS_PER_PAGE],
+              std::string values[RECORDS_PER_PAGE]) const;
+
   /**
    * append a new record at the end of the file.
    * note that RecordFile does not have write() function.
@@ -90,6 +102,18 @@ class RecordFile {
    */
   RC append(int key, const std::string& value, RecordId& rid);
 
+  /**
+   * append a batch of records at the end of the file. every page is
+   * filled in memory and written once.
+   * @param count[IN] the # of records to append
+   * @param keys[IN] the record keys
+   * @param values[IN] the record values
+   * @param rid[OUT] the location of the first stored record. the others
+   * follow it in order
+   * @return error code. 0 if no error
+   */
+  RC append(int count, const int keys[], const std::string_view values[], RecordId& rid);
+
   /**
    * note the +1 part. The rid of the last record is endRid()-1.
    * @return (last record id + 1) of the RecordFile
@@ -9,10 +9,27 @@
 
 #include <cstdio>
 #include <iostream>
-#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <cerrno>
+#include <algorithm>
+#include <chrono>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "Bruinbase.h"
 #include "SqlEngine.h"
 #include "BTreeIndex.h"
+#include "ValueIndex.h"
+#include "TupleSorter.h"
+#include "HashAggregator.h"
+#include "TableJoin.h"
+#include "TableStats.h"
+#include "ParallelScan.h"
+#include "IndexBuilder.h"
+#include "LsmIndex.h"
 
 using namespace std;
 
@@ -20,6 +37,11 @@ using namespace std;
 extern FILE* sqlin;
 int sqlparse(void);
 
+// orders index entries by the record id of their tuple
+static bool ridLess(const pair<int, RecordId>& a, const pair<int, RecordId>& b)
+{
+  return a.second < b.second;
+}
 
 RC SqlEngine::run(FILE* commandline)
 {
@@ -33,669 +55,1966 @@ RC SqlEngine::run(FILE* commandline)
   return 0;
 }
 
-RC SqlEngine::select(int attr, const string& table, const vector<SelCond>& cond)
+RC SqlEngine::select(int attr, const string& table, const vector<SelCond>& cond, const SelOpts& opts)
 {
-  /*RecordFile rf;   // RecordFile containing the table
+  RecordFile rf;   // RecordFile containing the table
   RecordId   rid;  // record cursor for table scanning
+  BTreeIndex idx;  // index for the table
+  LsmIndex   lsm;  // write-optimized index on the key, if the table has no idx
+  ValueIndex vidx; // index on the value column of the table
+  IndexCursor cursor;
+  LsmCursor  lsmCursor;
 
   RC     rc;
   int    key;
   string value;
-  int    count;
-  int    diff;
-
-  BTreeIndex index;
-  IndexCursor cursor;
-  int neCount = 0;
+  int    count = 0;
+  int    skip;
+  int    limit;
+  bool   terminate = false;
+  bool   grouped = (opts.groupAttr != 0);
+  bool   aggregate = (attr >= 4 && !grouped);
+  bool   keyOrder;
+  bool   backward;
+  bool   valueOrder;
+  bool   keyEqual = false;
+  bool   valueEqual = false;
+  bool   valueCond = false;    // some condition is on the value
+  bool   keyBounded = false;   // some key condition narrows down the key range
+  vector<KeyRange> ranges;     // the key ranges that the index scans
+  AggState agg;                // running aggregate of the matching tuples
+  TupleSorter* sorter = NULL;  // sorts the result unless it comes in order
+  HashAggregator* grouper = NULL;  // the groups of GROUP BY
+
+  vector<SelCond> indexConds;  // key conditions that the index can evaluate
+  vector<SelCond> tableConds;  // conditions that need the tuple itself
+  vector<SelCond> valueConds;  // value conditions that the value index can evaluate
+  vector<SelCond> otherConds;  // conditions the value index cannot evaluate
+
+  // COUNT(*) of the whole table is the row count of its statistics if
+  // they are current, so no page of the table is read
+  if (attr == 4 && cond.empty() && !grouped && !opts.showGroup && countFromStats(table, count)) {
+    if (opts.offset == 0 && opts.limit != 0) fprintf(stdout, "%d\n", count);
+    return 0;
+  }
 
   // open the table file
-  if ((rc = rf.open((table + ".tbl").c_str(), 'r')) < 0) {
-    fprintf(stderr, "Error: first table %s does not exist\n", table.c_str());
+  if ((rc = rf.open(table + ".tbl", 'r')) < 0) {
+    fprintf(stderr, "Error: table %s does not exist\n", table.c_str());
     return rc;
   }
 
-  rc = index.open((table + ".idx").c_str(), 'r');
-
-  vector<SelCond> keyCond;
-  vector<SelCond> valCond;
+  // a condition may name the table, but a join needs a second table
+  for (unsigned i = 0; i < cond.size(); i++) {
+    if (cond[i].joinTable != NULL || (cond[i].table != NULL && table != cond[i].table)) {
+      fprintf(stderr, "Error: the condition names a table not in the FROM clause\n");
+      rc = RC_INVALID_ATTRIBUTE;
+      goto exit_select;
+    }
+  }
 
-  int low = -1;
-  bool greater_equal = false;
+  processConditions(cond, indexConds, tableConds);
 
-  int high = -1;
-  bool less_equal = false;
+  // "key <> X" leaves all but one key, so it does not narrow down the range
+  for (unsigned i = 0; i < indexConds.size(); i++) {
+    if (indexConds[i].comp != SelCond::NE) keyBounded = true;
+  }
 
-  if (rc != 0) {
-    goto scan;
-  } else {
-    for (int i = 0; i < cond.size(); i++) {
-      // Check if we have a key condition
-      if (cond[i].attr == 1) {
-        int keyVal = atoi(cond[i].value);
-        switch (cond[i].comp) {
-          case SelCond::EQ:
-            keyCond.push_back(cond[i]);
-            break;
-          case SelCond::NE:
-            keyCond.push_back(cond[i]);
-            neCount++;
-            break;
-          case SelCond::GT:
-            if (keyVal > low || low == -1) {
-              low = keyVal;
-              greater_equal = false;
-            }
-            break;
-          case SelCond::LT:
-            if (keyVal < high || high == -1) {
-              high = keyVal;
-              less_equal = false;
-            }
-            break;
-          case SelCond::GE:
-            if (keyVal >= low || low == -1) {
-              low = keyVal;
-              greater_equal = true;
-            }
-            break;
-          case SelCond::LE:
-            if (keyVal <= high || high == -1) {
-              high = keyVal;
-              less_equal = true;
-            }
-            break;
-        }
-      }
-      // Check if we have a value condition
-      else if (cond[i].attr == 2) {
-        valCond.push_back(cond[i]);
-      }
+  // GROUP BY value returns the distinct values or an aggregate per value
+  if (grouped || opts.showGroup) {
+    if (opts.groupAttr != 2 || (attr != 2 && attr < 4) || (opts.showGroup && attr < 4)) {
+      fprintf(stderr, "Error: only GROUP BY value with value and aggregates is supported\n");
+      rc = RC_INVALID_ATTRIBUTE;
+      goto exit_select;
+    }
+    if (opts.orderAttr != 0) {
+      fprintf(stderr, "Error: ORDER BY cannot be used with GROUP BY\n");
+      rc = RC_INVALID_ATTRIBUTE;
+      goto exit_select;
     }
   }
-  // Use the index if there are no "not equals"
-  if (neCount == 0) {
-    // Make sure that there are no conflicts in our conditions
-    int prev = -1;
-    for (int i = 0; i < keyCond.size(); i++) {
-      int val = atoi(keyCond[i].value);
 
-      // Searching for two equal keys at the same time
-      if (val != prev && prev != -1) {
-        count = 0;
-        goto counter;
-      }
-      // The equal is not in the range
-      else if (((val < high && !less_equal || val <= high && less_equal) ||
-        (high != - 1)) && ((val > low && !greater_equal || val >= low && greater_equal)
-        || low == -1)) {
-        count = 0;
-        goto counter;
-      }
-      prev = val;
-    }
+  // OFFSET skips matching tuples. an aggregate returns a single row,
+  // so for aggregates, LIMIT and OFFSET apply to that row instead.
+  // for GROUP BY, they apply to the groups after the scan.
+  skip = (aggregate || grouped) ? 0 : opts.offset;
+  limit = (aggregate || grouped) ? -1 : opts.limit;
+  if (opts.limit == 0 || (aggregate && opts.offset > 0)) {
+    goto exit_select;
+  }
+
+  // otherwise COUNT(*) of the whole table follows from the end of the
+  // record file, which open() has already found
+  if (aggregate && attr == 4 && cond.empty()) {
+    count = rf.endRid().pid * RecordFile::RECORDS_PER_PAGE + rf.endRid().sid;
+    rc = 0;
+    goto counter;
+  }
 
-    unsigned mSize = keyCond.size();
-    if (mSize > 0) {
-      high = atoi(keyCond[0].value);
-      greater_equal = true;
+  // ORDER BY does not change an aggregate. the index returns the tuples
+  // in key order in either direction, so only value order needs a sort.
+  // MIN(key) and MAX(key) are the first tuple in ascending or descending
+  // key order.
+  keyOrder = (!aggregate && opts.orderAttr == 1) || (aggregate && (attr == 5 || attr == 6));
+  backward = (!aggregate && opts.orderAttr == 1 && opts.desc) || (aggregate && attr == 6);
+  valueOrder = (!aggregate && opts.orderAttr == 2 && !opts.desc) || (aggregate && attr == 9);
+  if (grouped) grouper = new HashAggregator();
 
-      low = atoi(keyCond[0].value);
-      less_equal = true;
+  // the value index can search for a value range, but not for "value <> X"
+  for (unsigned i = 0; i < cond.size(); i++) {
+    if (cond[i].attr == 2) valueCond = true;
+    if (cond[i].attr == 2 && cond[i].comp != SelCond::NE) {
+      valueConds.push_back(cond[i]);
+      if (cond[i].comp == SelCond::EQ) valueEqual = true;
+    } else {
+      otherConds.push_back(cond[i]);
+      if (cond[i].attr == 1 && cond[i].comp == SelCond::EQ) keyEqual = true;
     }
+  }
 
-    // Search the low end of bound
-    if (low == -1) {
-      low = 0;
+  // use the value index if the query looks for a value but not for a key,
+  // if value is the only column with a range, or if it returns the tuples
+  // in order. the key index is still better for key order.
+  if (!keyOrder && ((valueEqual && !keyEqual) ||
+                    (!keyBounded && (!valueConds.empty() || valueOrder))) &&
+      vidx.open(table + ".vdx", 'r') == 0) {
+    // find the lower bound of the value range. the scan stops once the
+    // value passes the upper bound of a condition.
+    string low;
+    for (unsigned i = 0; i < valueConds.size(); i++) {
+      if (valueConds[i].comp != SelCond::LT && valueConds[i].comp != SelCond::LE &&
+          low < valueConds[i].value) {
+        low = valueConds[i].value;
+      }
     }
 
-    count = 0;
-    index.locate(low, cursor);
+    startSort(attr, opts, valueOrder, sorter, skip, limit);
 
-    int myKey;
-    RecordId myRid;
-    rc = index.readForward(cursor, myKey, myRid);
+    // the first matching tuple is the answer for MIN(value)
+    if (aggregate && attr == 9) limit = 1;
 
-    if (!greater_equal) {
-      while (myKey == low && rc == 0) {
-        rc = index.readForward(cursor, myKey, myRid);
-      }
+    // the index entry has the value, so we need to read the tuple only if
+    // we print the key, check it, aggregate or group it, or sort on it
+    bool needTuple = (attr == 1 || attr == 3 || (attr >= 5 && attr <= 8) || grouped ||
+                      !otherConds.empty() || (sorter != NULL && opts.orderAttr == 1));
+
+    rc = vidx.locate(low, cursor);
+    if (rc < 0 && rc != RC_NO_SUCH_RECORD) {
+      fprintf(stderr, "Error: while reading the value index of table %s\n", table.c_str());
+      goto exit_value;
     }
 
-    rc = 0;
-    // Read the tuples for our range
-    while (rc == 0 && (high == -1 || (myKey <= high && less_equal ||
-      myKey < high && !less_equal))) {
-
-      // If we are counting, we don't need to read values
-      if (attr != 4) {
-        rc = rf.read(myRid, key, value);
-        if (rc != 0) {
-          fprintf(stderr, "Error: could not read tuple from table %s\n", table.c_str());
-          goto exit_select;
-        }
+    while (!terminate && (limit < 0 || count < limit)) {
+      if ((rc = vidx.readForward(cursor, value, rid)) < 0) {
+        if (rc == RC_END_OF_TREE) break;
+        fprintf(stderr, "Error: while reading the value index of table %s\n", table.c_str());
+        goto exit_value;
       }
 
-      // check the conditions on the tuple
-      for (unsigned i = 0; i < valCond.size(); i++) {
-        // compute the difference between the tuple value and the condition value
-        switch (valCond[i].attr) {
-          case 1:
-            diff = key - atoi(valCond[i].value);
-            break;
-          case 2:
-            diff = strcmp(value.c_str(), valCond[i].value);
-            break;
-        }
+      // check the value conditions on the index entry
+      for (unsigned i = 0; i < valueConds.size(); i++) {
+        if (!matchesCondition(valueConds[i], key, value, terminate)) goto next_value;
+      }
 
-        // skip the tuple if any condition is not met
-        switch (valCond[i].comp) {
-          case SelCond::EQ:
-            if (diff != 0) goto next_record;
-            break;
-          case SelCond::NE:
-            if (diff == 0) goto next_record;
-            break;
-          case SelCond::GT:
-            if (diff <= 0) goto next_record;
-            break;
-          case SelCond::LT:
-            if (diff >= 0) goto next_record;
-            break;
-          case SelCond::GE:
-            if (diff < 0) goto next_record;
-            break;
-          case SelCond::LE:
-            if (diff > 0) goto next_record;
-            break;
+      if (needTuple) {
+        if ((rc = rf.read(rid, key, value)) < 0) {
+          fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+          goto exit_value;
         }
       }
 
-      // the condition is met for the tuple.
-      // increase matching tuple counter
-      count++;
+      // check the rest of the conditions on the tuple
+      for (unsigned i = 0; i < otherConds.size(); i++) {
+        bool ignored = false;
+        if (!matchesCondition(otherConds[i], key, value, ignored)) goto next_value;
+      }
 
-      // print the tuple
-      switch (attr) {
-      case 1:  // SELECT key
-        fprintf(stdout, "%d\n", key);
-        break;
-      case 2:  // SELECT value
-        fprintf(stdout, "%s\n", value.c_str());
-        break;
-      case 3:  // SELECT *
-        fprintf(stdout, "%d '%s'\n", key, value.c_str());
-        break;
+      // skip the tuple if it is within OFFSET
+      if (skip > 0) {
+        skip--;
+        goto next_value;
       }
 
-      next_record:
-      rc = index.readForward(cursor, myKey, myRid);
+      count++;
+      if ((rc = emitTuple(attr, key, value, agg, sorter, grouper)) < 0) goto exit_value;
+
+      next_value:
+      ;
     }
+    rc = 0;
 
+    exit_value:
+    vidx.close();
     goto counter;
   }
 
-  scan:
-  // scan the table file from the beginning
-  rid.pid = rid.sid = 0;
-  count = 0;
-  while (rid < rf.endRid()) {
-    // read the tuple
-    if ((rc = rf.read(rid, key, value)) < 0) {
-      fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
-      goto exit_select;
+  // use the index if it can narrow down the key range, if the aggregate
+  // only needs the keys, or if it returns the tuples in order
+  if (idx.open(table + ".idx", 'r') == 0) {
+    if (!keyBounded && !(attr <= 8 && aggregate && !valueCond) && !keyOrder) {
+      idx.close();
+      goto tablescan;
     }
 
-    // check the conditions on the tuple
-    for (unsigned i = 0; i < cond.size(); i++) {
-      // compute the difference between the tuple value and the condition value
-      switch (cond[i].attr) {
-        case 1:
-        	diff = key - atoi(cond[i].value);
-        	break;
-        case 2:
-        	diff = strcmp(value.c_str(), cond[i].value);
-        	break;
-      }
+    // the key conditions become a sorted list of disjoint key ranges,
+    // and each range is scanned in turn
+    keyRanges(indexConds, ranges);
 
-      // skip the tuple if any condition is not met
-      switch (cond[i].comp) {
-        case SelCond::EQ:
-        	if (diff != 0) goto next_tuple;
-        	break;
-        case SelCond::NE:
-        	if (diff == 0) goto next_tuple;
-        	break;
-        case SelCond::GT:
-        	if (diff <= 0) goto next_tuple;
-        	break;
-        case SelCond::LT:
-        	if (diff >= 0) goto next_tuple;
-        	break;
-        case SelCond::GE:
-        	if (diff < 0) goto next_tuple;
-        	break;
-        case SelCond::LE:
-        	if (diff > 0) goto next_tuple;
-        	break;
-      }
-    }
+    startSort(attr, opts, keyOrder, sorter, skip, limit);
 
-    // the condition is met for the tuple.
-    // increase matching tuple counter
-    count++;
+    // the first matching tuple is the answer for MIN(key) and MAX(key)
+    if (aggregate && (attr == 5 || attr == 6)) limit = 1;
 
-    // print the tuple
-    switch (attr) {
-    case 1:  // SELECT key
-      fprintf(stdout, "%d\n", key);
-      break;
-    case 2:  // SELECT value
-      fprintf(stdout, "%s\n", value.c_str());
-      break;
-    case 3:  // SELECT *
-      fprintf(stdout, "%d '%s'\n", key, value.c_str());
-      break;
-    }
+    // we need to read the tuple only if we print the value, check it,
+    // group on it or sort on it
+    bool needTuple = (attr == 2 || attr == 3 || attr == 9 || attr == 10 || grouped ||
+                      valueCond || (sorter != NULL && opts.orderAttr == 2));
 
-    // move to the next tuple
-    next_tuple:
-    ++rid;
-  }
+    // the tuples of a clustered table are stored in key order, so a forward
+    // scan that reads them only needs the index to find the first one
+    bool sequential = idx.isClustered() && !backward && needTuple;
 
-  counter:
-  // print matching tuple count if "select count(*)"
-  if (attr == 4) {
-    fprintf(stdout, "%d\n", count);
-  }
-  rc = 0;
+    // an IN list of single keys is looked up in one descent of the tree
+    bool points = ranges.size() > 1;
+    for (unsigned r = 0; r < ranges.size(); r++) {
+      if (ranges[r].low != ranges[r].high) points = false;
+    }
+    if (points) {
+      vector<int> keys;
+      vector<pair<int, RecordId> > entries;
+      for (unsigned r = 0; r < ranges.size(); r++) keys.push_back(ranges[r].low);
+      if ((rc = idx.lookupBatch(keys, entries)) < 0) {
+        fprintf(stderr, "Error: while reading the index of table %s\n", table.c_str());
+        goto exit_index;
+      }
 
-  // close the table file and return
-  exit_select:
-  rf.close();
-  return rc;*/
+      // unless the result must come in key order, the tuples are read in
+      // the order of their record ids, so each page of the table is read once
+      if (needTuple && !keyOrder) std::sort(entries.begin(), entries.end(), ridLess);
+      else if (backward) std::reverse(entries.begin(), entries.end());
+
+      for (unsigned i = 0; i < entries.size() && (limit < 0 || count < limit); i++) {
+        key = entries[i].first;
+        rid = entries[i].second;
+        if (needTuple) {
+          if ((rc = rf.read(rid, key, value)) < 0) {
+            fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+            goto exit_index;
+          }
+        }
 
+        // check the rest of the conditions on the tuple
+        for (unsigned j = 0; j < tableConds.size(); j++) {
+          bool ignored = false;
+          if (!matchesCondition(tableConds[j], key, value, ignored)) goto next_point;
+        }
 
-  RecordFile rf;   // RecordFile containing the table
-  RecordId   rid;  // record cursor for table scanning
-  BTreeIndex idx; // index for the table
+        // skip the tuple if it is within OFFSET
+        if (skip > 0) {
+          skip--;
+          goto next_point;
+        }
 
-  bool hasNotEquals = false;
+        count++;
+        if ((rc = emitTuple(attr, key, value, agg, sorter, grouper)) < 0) goto exit_index;
 
-  RC     rc;
-  int    key;
-  string value;
-  int    count = 0;
-  int    diff;
-  int  idxState = 0;
+        next_point:
+        ;
+      }
+      rc = 0;
+      goto exit_index;
+    }
 
-  // open the table file
-  if ((rc = rf.open(table + ".tbl", 'r')) < 0) {
-    fprintf(stderr, "Error: table %s does not exist\n", table.c_str());
-    return rc;
-  }
+    for (unsigned r = 0; r < ranges.size() && (limit < 0 || count < limit); r++) {
+      // a descending scan visits the ranges from the last one, and walks
+      // the leaves backward from the upper bound of each range
+      const KeyRange& range = backward ? ranges[ranges.size() - 1 - r] : ranges[r];
+
+      // no key is left in this direction if the range has no entry
+      rc = backward ? idx.locateLast(range.high, cursor) : idx.locate(range.low, cursor);
+      if (rc == RC_NO_SUCH_RECORD) break;
+      if (rc < 0) {
+        fprintf(stderr, "Error: while reading the index of table %s\n", table.c_str());
+        goto exit_index;
+      }
 
-  SelCond* keyIs = NULL;
-  SelCond* keyMax = NULL;
-  SelCond* keyMin = NULL;
-  SelCond* keyNe = NULL;
+      // every entry in a single key range qualifies when there is no other
+      // condition, so OFFSET can be skipped at the leaf level
+      if (skip > 0 && tableConds.empty() && ranges.size() == 1) {
+        if (backward) idx.skipBackward(cursor, skip);
+        else idx.skipForward(cursor, skip);
+        skip = 0;
+      }
 
-  SelCond* valIs = NULL;
-  SelCond* valMax = NULL;
-  SelCond* valMin = NULL;
-  SelCond* valNe = NULL;
+      if (sequential) {
+        IndexCursor first = cursor;
+        if (idx.readForward(first, key, rid) != 0) break;
+      }
 
-  int temp;
+      while (limit < 0 || count < limit) {
+        if (sequential) {
+          if (rid >= rf.endRid()) break;
+          if ((rc = rf.read(rid, key, value)) < 0) {
+            fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+            goto exit_index;
+          }
+          ++rid;
+        } else {
+          if (backward) rc = idx.readBackward(cursor, key, rid);
+          else rc = idx.readForward(cursor, key, rid);
+          if (rc < 0) {
+            if (rc == RC_END_OF_TREE) break;
+            fprintf(stderr, "Error: while reading the index of table %s\n", table.c_str());
+            goto exit_index;
+          }
+        }
 
-  int keyGe = 0;
-  int keyLe = 0;
+        // the range ends at the first key beyond its bound
+        if (backward ? key < range.low : key > range.high) break;
 
-  for (unsigned i = 0; i < cond.size(); i++) {
-  temp = atoi(cond[i].value);
-  switch(cond[i].attr) {
-  case 1:   // Key
-    switch (cond[i].comp) {
-    case SelCond::EQ:
-      keyIs = (SelCond*) &cond[i];
-      break;
-    case SelCond::NE:
-      hasNotEquals = true;
-      keyNe = (SelCond*) &cond[i];
-      break;
-    case SelCond::LE:
-      temp++;
-    case SelCond::LT:
-      if (keyMax == NULL || atoi(keyMax->value) < temp) {
-        keyMax = (SelCond*) &cond[i];
-        if(keyMax->comp == SelCond::LE) {
-          keyLe = 1;
-        } else {
-          keyLe = 0;
+        if (needTuple && !sequential) {
+          if ((rc = rf.read(rid, key, value)) < 0) {
+            fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+            goto exit_index;
+          }
         }
-      }
-      break;
-    case SelCond::GE:
-      temp--;
-    case SelCond::GT:
-      if (keyMin == NULL || atoi(keyMin->value) > temp) {
-        keyMin = (SelCond*) &cond[i];
-        if(keyMin->comp == SelCond::GE) {
-          keyGe = 1;
-        } else {
-          keyGe = 0;
+
+        // check the rest of the conditions on the tuple
+        for (unsigned i = 0; i < tableConds.size(); i++) {
+          bool ignored = false;
+          if (!matchesCondition(tableConds[i], key, value, ignored)) goto next_entry;
+        }
+
+        // skip the tuple if it is within OFFSET
+        if (skip > 0) {
+          skip--;
+          goto next_entry;
         }
+
+        // the condition is met for the tuple.
+        // increase matching tuple counter
+        count++;
+        if ((rc = emitTuple(attr, key, value, agg, sorter, grouper)) < 0) goto exit_index;
+
+        next_entry:
+        ;
       }
-      break;
-    }
-    break;
-  case 2:   // Value
-    switch (cond[i].comp) {
-    case SelCond::EQ:
-      valIs = (SelCond*) &cond[i];
-      break;
-    case SelCond::NE:
-      hasNotEquals = true;
-      valNe = (SelCond*) &cond[i];
-      break;
-    case SelCond::LE:
-      temp++;
-    case SelCond::LT:
-      if (valMax == NULL || atoi(valMax->value) < temp)
-        valMax = (SelCond*) &cond[i];
-      break;
-    case SelCond::GE:
-      temp--;
-    case SelCond::GT:
-      if (valMin == NULL || atoi(valMin->value) > temp)
-        valMin = (SelCond*) &cond[i];
-      break;
     }
-    break;
+    rc = 0;
+
+    exit_index:
+    idx.close();
+    goto counter;
   }
-}
 
-  if ((idx.open(table + ".idx", 'r')) == 0) {
-  idxState = 1;
-
-  IndexCursor ic;
-
-  // Use the index lookup
-  if (keyIs || keyMin || keyMax || keyNe) {
-    /*
-    * The idea here is to look up the minimum key value needed via the index and then iterate from there
-    * Once I have those values I'll parse the rest of the constraints and iterate through the returned tuples checking those
-    * So, if the query calls for a = condition, keyToFind is automatically set to that (since they're all ANDs, = overrides >
-    * If there's a > or >=, I'll iterate from there
-    * Unfortunately I still don't know if I'm reading from the index correctly
-    * However, it looks like the conditions are being checked correctly
-    */
-    int keyToFind;
-    int keyLow;
-    int keyHigh;
-    int keyNot;
-    if (keyIs)
-      keyToFind = atoi(keyIs->value);
-    else if(keyMin) {
-      keyLow = atoi(keyMin->value);
-      keyToFind = keyLow;
-    }
-
-    if(keyMax) {
-      keyHigh = atoi(keyMax->value);
-      if(! keyMin) {
-        keyToFind = keyHigh;
-      }
+  // an LSM index scans the key ranges forward, and finds single keys with
+  // the help of its Bloom filters. a descending scan reads the table
+  if (!backward && lsm.open(table + ".lsm", 'r') == 0) {
+    if (!keyBounded && !(attr <= 8 && aggregate && !valueCond) && !keyOrder) {
+      lsm.close();
+      goto tablescan;
     }
 
-    if(keyNe) {
-      keyNot = atoi(keyNe->value);
-    }
+    keyRanges(indexConds, ranges);
 
-    // Location error
-    if(keyMax) {
-      if((rc = idx.locate(0, ic)) != 0) {
-        idx.close();
-        return rc;
-      }
-    } else if(! keyNe){
-      if ((rc = idx.locate(keyToFind, ic)) != 0) {
-        idx.close();
-        return rc;
-      }
-    }
+    startSort(attr, opts, keyOrder, sorter, skip, limit);
 
-    // We read forward
-    // If we have a keyIs, we read while the key is equal
-    // If we have a keyMin, we read until the end (I think that works like this)
+    // the first matching tuple is the answer for MIN(key)
+    if (aggregate && attr == 5) limit = 1;
 
-    while (idx.readForward(ic, key, rid) == 0 ) {
-      if(keyIs && key != keyToFind) continue;
-      if(keyMin && ((keyGe==1)?(key < keyLow):(key <= keyLow))) continue;
-      if(keyMax && ((keyLe==1)?(key > keyHigh):(key >= keyHigh))) break;
-      if(keyNe && key == keyNot) continue;
+    // we need to read the tuple only if we print the value, check it,
+    // group on it or sort on it
+    bool needTuple = (attr == 2 || attr == 3 || attr == 9 || attr == 10 || grouped ||
+                      valueCond || (sorter != NULL && opts.orderAttr == 2));
 
-       if ((rc = rf.read(rid, key, value)) != 0) {
-        fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
-        idx.close();
-        return rc;
+    for (unsigned r = 0; r < ranges.size() && (limit < 0 || count < limit); r++) {
+      const KeyRange& range = ranges[r];
+      bool point = (range.low == range.high);
+      vector<RecordId> rids;
+      unsigned next = 0;
+
+      rc = point ? lsm.lookup(range.low, rids) : lsm.locate(range.low, lsmCursor);
+      if (rc == RC_NO_SUCH_RECORD) break;
+      if (rc < 0) {
+        fprintf(stderr, "Error: while reading the index of table %s\n", table.c_str());
+        goto exit_lsm;
       }
 
-        // check the conditions on the tuple
-      if (valIs != NULL && value != valIs->value)   continue;
-      if (valMax != NULL &&  value >= valMax->value)  continue;
-      if (valMin != NULL && value <= valMin->value) continue;
-      if (valNe && value <= valNe->value) continue;
+      while (limit < 0 || count < limit) {
+        if (point) {
+          if (next == rids.size()) break;
+          key = range.low;
+          rid = rids[next++];
+        } else {
+          if ((rc = lsm.readForward(lsmCursor, key, rid)) < 0) {
+            if (rc == RC_END_OF_TREE) break;
+            fprintf(stderr, "Error: while reading the index of table %s\n", table.c_str());
+            goto exit_lsm;
+          }
 
-      // the condition is met for the tuple.
-      // increase matching tuple counter
-      count++;
+          // the range ends at the first key beyond its bound
+          if (key > range.high) break;
+        }
 
-      // print the tuple
-      switch (attr) {
-      case 1:  // SELECT key
-        fprintf(stdout, "%d\n", key);
-        break;
-      case 2:  // SELECT value
-        fprintf(stdout, "%s\n", value.c_str());
-        break;
-      case 3:  // SELECT *
-        fprintf(stdout, "%d '%s'\n", key, value.c_str());
-        break;
-      }
+        if (needTuple) {
+          if ((rc = rf.read(rid, key, value)) < 0) {
+            fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+            goto exit_lsm;
+          }
+        }
 
-      if(keyIs && key == keyToFind) break;
-      if(keyNe && key != keyNot) break;
-    }
-  }
+        // check the rest of the conditions on the tuple
+        for (unsigned i = 0; i < tableConds.size(); i++) {
+          bool ignored = false;
+          if (!matchesCondition(tableConds[i], key, value, ignored)) goto next_lsm;
+        }
 
-  if(keyIs || keyMin || keyMax || keyNe) {
-    if(attr == 4) {
-      fprintf(stdout, "%d\n", count);
+        // skip the tuple if it is within OFFSET
+        if (skip > 0) {
+          skip--;
+          goto next_lsm;
+        }
+
+        count++;
+        if ((rc = emitTuple(attr, key, value, agg, sorter, grouper)) < 0) goto exit_lsm;
+
+        next_lsm:
+        ;
+      }
     }
-  }
+    rc = 0;
 
-  if(! (keyIs || keyMin || keyMax)) {
-    idx.close();
-    goto tablescan;
+    exit_lsm:
+    lsm.close();
+    goto counter;
   }
 
-  idx.close();
-  }
+  tablescan:
+  // the table is not sorted by key
+  startSort(attr, opts, false, sorter, skip, limit);
 
-  //end B+ tree index code
-  if(! idxState) {
   // scan the table file from the beginning
-tablescan:
   rid.pid = rid.sid = 0;
-  count = 0;
-  while (rid < rf.endRid()) {
+
+  // without any condition, the first OFFSET tuples can be skipped
+  // by computing the record id directly
+  if (cond.empty() && skip > 0) {
+    rid.pid = skip / RecordFile::RECORDS_PER_PAGE;
+    rid.sid = skip % RecordFile::RECORDS_PER_PAGE;
+    skip = 0;
+  }
+
+  // a large table is scanned by a pool of threads, unless LIMIT may end
+  // the scan early. the tuples skipped in the first page are skipped from
+  // the gathered tuples instead
+  if (limit < 0 && rf.endRid().pid - rid.pid >= ParallelScan::MIN_PAGES &&
+      ParallelScan::defaultThreads() > 1) {
+    skip += rid.sid;
+    rc = parallelScan(attr, rf, rid.pid, cond, skip, limit, count, agg, sorter, grouper);
+    if (rc < 0) {
+      fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+      goto exit_select;
+    }
+    goto counter;
+  }
+
+  while (rid < rf.endRid() && (limit < 0 || count < limit)) {
     // read the tuple
     if ((rc = rf.read(rid, key, value)) < 0) {
       fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
       goto exit_select;
     }
 
-    // check the conditions on the tuple
-    if (keyIs != NULL && (int) key != atoi(keyIs->value)) goto next_tuple;
-    if (keyMax != NULL && (int) key >= atoi(keyMax->value)) goto next_tuple;
-    if (keyMin != NULL && (int) key <= atoi(keyMin->value)) goto next_tuple;
-    if (keyNe && (int) key == atoi(keyNe->value)) goto next_tuple;
+    // check the conditions on the tuple. the table is not sorted by key,
+    // so we cannot stop early when a key condition fails.
+    for (unsigned i = 0; i < cond.size(); i++) {
+      bool ignored = false;
+      if (!matchesCondition(cond[i], key, value, ignored)) goto next_tuple;
+    }
 
-    if (valIs != NULL && value != valIs->value)   goto next_tuple;
-    if (valMax != NULL &&  value >= valMax->value)  goto next_tuple;
-    if (valMin != NULL && value <= valMin->value) goto next_tuple;
-    if (valNe && value == valNe->value) goto next_tuple;
+    // skip the tuple if it is within OFFSET
+    if (skip > 0) {
+      skip--;
+      goto next_tuple;
+    }
 
     // the condition is met for the tuple.
     // increase matching tuple counter
     count++;
+    if ((rc = emitTuple(attr, key, value, agg, sorter, grouper)) < 0) goto exit_select;
 
-    // print the tuple
-    switch (attr) {
-    case 1:  // SELECT key
-      fprintf(stdout, "%d\n", key);
-      break;
-    case 2:  // SELECT value
-      fprintf(stdout, "%s\n", value.c_str());
-      break;
-    case 3:  // SELECT *
-      fprintf(stdout, "%d '%s'\n", key, value.c_str());
-      break;
+    // move to the next tuple
+    next_tuple:
+    ++rid;
   }
+  rc = 0;
 
-  // move to the next tuple
-  next_tuple:
-  ++rid;
+  counter:
+  // print matching tuple count if "select count(*)", or the other aggregate
+  if (aggregate && rc == 0 && opts.offset == 0 && opts.limit != 0) {
+    if (attr == 4) fprintf(stdout, "%d\n", count);
+    else printAggregate(attr, agg);
   }
 
-  // print matching tuple count if "select count(*)"
-  if (attr == 4) {
-  fprintf(stdout, "%d\n", count);
+  // print the groups within OFFSET and LIMIT
+  if (grouper != NULL && rc == 0) {
+    rc = printGroups(attr, opts, *grouper);
+    if (rc < 0) {
+      fprintf(stderr, "Error: while grouping the tuples of table %s\n", table.c_str());
+    }
+  }
+
+  // print the sorted tuples within OFFSET and LIMIT
+  if (sorter != NULL && rc == 0) {
+    rc = printSorted(attr, opts, *sorter);
+    if (rc < 0) {
+      fprintf(stderr, "Error: while sorting the tuples of table %s\n", table.c_str());
+    }
   }
-  rc = 0;
 
   // close the table file and return
   exit_select:
+  delete grouper;
+  delete sorter;
   rf.close();
-  }
   return rc;
-
 }
 
-RC SqlEngine::load(const string& table, const string& loadfile, bool index)
+void SqlEngine::startSort(int attr, const SelOpts& opts, bool inOrder,
+                        TupleSorter*& sorter, int& skip, int& limit)
 {
-  RC rc = 0;
-  RecordFile rf;
-  ifstream input;
-  string line;
-
-  // Index of our tree
-  BTreeIndex dbIndex;
-
-  input.open(loadfile.c_str(), std::ifstream::in);
-  if (input.fail()) {
-    input.close();
-    return RC_FILE_OPEN_FAILED;
-  }
+  if (attr >= 4 || opts.orderAttr == 0 || inOrder) return;
 
-  rc = dbIndex.open(table + ".idx", 'w');
-  if (index && rc != 0) {
-    fprintf(stderr, "Error opening index for table %s\n", table.c_str());
-    return rc;
+  TupleSorter::Order order;
+  if (opts.orderAttr == 1) {
+    order = opts.desc ? TupleSorter::KEY_DESC : TupleSorter::KEY_ASC;
+  } else {
+    order = opts.desc ? TupleSorter::VALUE_DESC : TupleSorter::VALUE_ASC;
   }
+  sorter = new TupleSorter(order);
 
-  rc = rf.open((table + ".tbl").c_str(), 'w');
-  if (rc != 0) {
-    fprintf(stderr, "Error in record file for table %s\n", table.c_str());
-    return rc;
-  }
-  if (input.is_open()) {
-    while (!input.eof()) {
-      getline(input, line);
+  // OFFSET and LIMIT apply to the sorted result, so the scan collects
+  // every matching tuple
+  skip = 0;
+  limit = -1;
+}
 
-      if (line == "") {
-        break;
-      }
+RC SqlEngine::printSorted(int attr, const SelOpts& opts, TupleSorter& sorter)
+{
+  RC     rc;
+  int    key;
+  string value;
+  int    count = 0;
 
-      RecordId rid;
-      int key;
-      string val;
+  if ((rc = sorter.sort()) < 0) return rc;
 
-      rc = parseLoadLine(line, key, val);
-      if (rc == 0) {
-        rid = rf.endRid();
-        rc = rf.append(key, val, rid);
-        if (rc != 0) {
-          fprintf(stderr, "Error appending data to table %s\n", table.c_str());
-          break;
-        }
-        if (index) {
-          rc = dbIndex.insert(key, rid);
-          if (rc != 0) {
-            //fprintf(stderr, "Error inserting into index for table %s\n", table.c_str());
-            //break;
-          }
-        }
-      } else {
-        fprintf(stderr, "Error while parsing loadfile %s\n", loadfile.c_str());
-        break;
-      }
+  for (int i = 0; i < opts.offset; i++) {
+    if ((rc = sorter.next(key, value)) < 0) {
+      return (rc == RC_END_OF_STREAM) ? 0 : rc;
     }
   }
 
-  try {
-    input.close();
-  } catch(...) {
-    return RC_FILE_CLOSE_FAILED;
+  while (opts.limit < 0 || count < opts.limit) {
+    if ((rc = sorter.next(key, value)) < 0) {
+      return (rc == RC_END_OF_STREAM) ? 0 : rc;
+    }
+    printTuple(attr, key, value);
+    count++;
   }
 
-  if (rf.close() != 0) {
-    return rf.close();
+  return 0;
+}
+
+RC SqlEngine::join(int attr, const vector<SelAttr>& attrs, const string& table1,
+                   const string& table2, const vector<SelCond>& conds, const SelOpts& opts)
+{
+  TableJoin join;
+  TableJoin::Method method;
+  int outer;
+  RC  rc;
+
+  if (opts.groupAttr != 0 || opts.orderAttr != 0) {
+    fprintf(stderr, "Error: GROUP BY and ORDER BY cannot be used with a join\n");
+    return RC_INVALID_ATTRIBUTE;
+  }
+  if (table1 == table2) {
+    fprintf(stderr, "Error: a table cannot be joined with itself\n");
+    return RC_INVALID_ATTRIBUTE;
   }
 
-  if (index) {
-    rc = dbIndex.close();
+  // "SELECT COUNT(*)" returns a single row, so LIMIT and OFFSET apply to
+  // that row instead
+  if (opts.limit == 0 || (attr == 4 && opts.offset > 0)) return 0;
+
+  if ((rc = join.open(table1, table2, conds)) < 0) return rc;
+  if (attr == 4) rc = join.setOutput(attr, attrs, 0, -1);
+  else rc = join.setOutput(attr, attrs, opts.offset, opts.limit);
+  if (rc < 0) return rc;
+
+  method = join.plan(outer);
+  if ((rc = join.run(method, outer)) < 0) {
+    fprintf(stderr, "Error: while joining tables %s and %s\n", table1.c_str(), table2.c_str());
+    return rc;
   }
 
-  return rc;
+  if (attr == 4) fprintf(stdout, "%d\n", join.getCount());
+  return 0;
 }
 
-RC SqlEngine::parseLoadLine(const string& line, int& key, string& value)
+RC SqlEngine::processConditions(const vector<SelCond>& conds,
+                                vector<SelCond>& indexConds, vector<SelCond>& tableConds)
 {
-    const char *s;
+  for (unsigned i = 0; i < conds.size(); i++) {
+    // "key <> X" is searched as the two ranges on either side of X
+    if (conds[i].attr == 1) {
+      indexConds.push_back(conds[i]);
+    } else {
+      tableConds.push_back(conds[i]);
+    }
+  }
+
+  return 0;
+}
+
+bool SqlEngine::matchesCondition(const SelCond& cond, const int key, const string& value, bool& terminate)
+{
+  int diff;
+
+  // find the first range that does not end below the key. the key is
+  // above every range once it is past the last one
+  if (cond.comp == SelCond::IN) {
+    const vector<KeyRange>& ranges = *cond.ranges;
+    int low = 0;
+    int high = ranges.size();
+    while (low < high) {
+      int mid = (low + high) / 2;
+      if (ranges[mid].high < key) low = mid + 1;
+      else high = mid;
+    }
+    if (low == (int) ranges.size()) {
+      terminate = true;
+      return false;
+    }
+    return key >= ranges[low].low;
+  }
+
+  // compute the difference between the tuple value and the condition value
+  switch (cond.attr) {
+  case 1:
+    {
+      int val = atoi(cond.value);
+      diff = (key < val) ? -1 : ((key > val) ? 1 : 0);
+    }
+    break;
+  case 2:
+    diff = strcmp(value.c_str(), cond.value);
+    break;
+  default:
+    return false;
+  }
+
+  // a key or value larger than the upper bound fails every later one as well
+  switch (cond.comp) {
+  case SelCond::EQ:
+    if (diff > 0) terminate = true;
+    return diff == 0;
+  case SelCond::NE:
+    return diff != 0;
+  case SelCond::GT:
+    return diff > 0;
+  case SelCond::LT:
+    if (diff >= 0) terminate = true;
+    return diff < 0;
+  case SelCond::GE:
+    return diff >= 0;
+  case SelCond::LE:
+    if (diff > 0) terminate = true;
+    return diff <= 0;
+  case SelCond::IN:
+    break;
+  }
+
+  return false;
+}
+
+static bool rangeLess(const KeyRange& a, const KeyRange& b)
+{
+  return a.low < b.low;
+}
+
+void SqlEngine::mergeRanges(vector<KeyRange>& ranges)
+{
+  vector<KeyRange> merged;
+
+  std::sort(ranges.begin(), ranges.end(), rangeLess);
+  for (unsigned i = 0; i < ranges.size(); i++) {
+    if (ranges[i].low > ranges[i].high) continue;
+
+    // a range that overlaps the last one extends it. ranges that only
+    // touch stay apart, so the keys of an IN list remain single keys
+    if (!merged.empty() && ranges[i].low <= merged.back().high) {
+      if (ranges[i].high > merged.back().high) merged.back().high = ranges[i].high;
+    } else {
+      merged.push_back(ranges[i]);
+    }
+  }
+  ranges.swap(merged);
+}
+
+void SqlEngine::keyRanges(const vector<SelCond>& conds, vector<KeyRange>& ranges)
+{
+  KeyRange all = { INT_MIN, INT_MAX };
+
+  ranges.assign(1, all);
+  for (unsigned i = 0; i < conds.size(); i++) {
+    const SelCond& c = conds[i];
+    vector<KeyRange> match;  // the ranges that satisfy this condition
+    KeyRange range = all;
+
+    if (c.comp == SelCond::IN) {
+      match = *c.ranges;
+    } else {
+      int val = atoi(c.value);
+      switch (c.comp) {
+      case SelCond::EQ:
+        range.low = range.high = val;
+        break;
+      case SelCond::LT:
+        range.high = val - 1;
+        if (val == INT_MIN) range.low = INT_MAX;
+        break;
+      case SelCond::LE:
+        range.high = val;
+        break;
+      case SelCond::GT:
+        range.low = val + 1;
+        if (val == INT_MAX) range.high = INT_MIN;
+        break;
+      case SelCond::GE:
+        range.low = val;
+        break;
+      case SelCond::NE:
+        if (val != INT_MIN) {
+          range.high = val - 1;
+          match.push_back(range);
+        }
+        range.low = val + 1;
+        range.high = INT_MAX;
+        if (val == INT_MAX) range.high = INT_MIN;
+        break;
+      default:
+        break;
+      }
+      if (range.low <= range.high) match.push_back(range);
+    }
+
+    // intersect the two sorted lists of ranges
+    vector<KeyRange> both;
+    unsigned a = 0, b = 0;
+    while (a < ranges.size() && b < match.size()) {
+      KeyRange r;
+      r.low = std::max(ranges[a].low, match[b].low);
+      r.high = std::min(ranges[a].high, match[b].high);
+      if (r.low <= r.high) both.push_back(r);
+      if (ranges[a].high < match[b].high) a++;
+      else b++;
+    }
+    ranges.swap(both);
+  }
+}
+
+void SqlEngine::printTuple(int attr, int key, const string& value)
+{
+  switch (attr) {
+  case 1:  // SELECT key
+    fprintf(stdout, "%d\n", key);
+    break;
+  case 2:  // SELECT value
+    fprintf(stdout, "%s\n", value.c_str());
+    break;
+  case 3:  // SELECT *
+    fprintf(stdout, "%d '%s'\n", key, value.c_str());
+    break;
+  }
+}
+
+RC SqlEngine::emitTuple(int attr, int key, const string& value, AggState& agg,
+                        TupleSorter* sorter, HashAggregator* grouper)
+{
+  if (grouper != NULL) return grouper->add(key, value);
+  if (attr >= 4) {
+    accumulate(attr, key, value, agg);
+    return 0;
+  }
+  if (sorter != NULL) return sorter->add(key, value);
+
+  printTuple(attr, key, value);
+  return 0;
+}
+
+void SqlEngine::accumulate(int attr, int key, const string& value, AggState& agg)
+{
+  switch (attr) {
+  case 5:  // MIN(key)
+    if (agg.count == 0 || key < agg.minKey) agg.minKey = key;
+    break;
+  case 6:  // MAX(key)
+    if (agg.count == 0 || key > agg.maxKey) agg.maxKey = key;
+    break;
+  case 7:  // SUM(key)
+  case 8:  // AVG(key)
+    agg.sum += key;
+    break;
+  case 9:  // MIN(value)
+    if (agg.count == 0 || value < agg.minValue) agg.minValue = value;
+    break;
+  case 10: // MAX(value)
+    if (agg.count == 0 || value > agg.maxValue) agg.maxValue = value;
+    break;
+  }
+  agg.count++;
+}
+
+void SqlEngine::mergeAggregate(int attr, const AggState& part, AggState& agg)
+{
+  if (part.count == 0) return;
+
+  switch (attr) {
+  case 5:  // MIN(key)
+    if (agg.count == 0 || part.minKey < agg.minKey) agg.minKey = part.minKey;
+    break;
+  case 6:  // MAX(key)
+    if (agg.count == 0 || part.maxKey > agg.maxKey) agg.maxKey = part.maxKey;
+    break;
+  case 7:  // SUM(key)
+  case 8:  // AVG(key)
+    agg.sum += part.sum;
+    break;
+  case 9:  // MIN(value)
+    if (agg.count == 0 || part.minValue < agg.minValue) agg.minValue = part.minValue;
+    break;
+  case 10: // MAX(value)
+    if (agg.count == 0 || part.maxValue > agg.maxValue) agg.maxValue = part.maxValue;
+    break;
+  }
+  agg.count += part.count;
+}
+
+/**
+ * the work of parallelScan() on a morsel of pages: check the conditions
+ * on every tuple, and either add a matching tuple to the aggregate of the
+ * thread or return it to be gathered.
+ */
+class ScanTask : public ParallelScan::Task {
+ public:
+  ScanTask(int attr, const RecordFile& rf, const vector<SelCond>& cond, bool aggregate)
+    : attr(attr), rf(rf), cond(cond), aggregate(aggregate), aggs(ParallelScan::MAX_THREADS) { }
+
+  RC scan(int thread, PageId begin, PageId end, vector<int>& keys, vector<string>& values,
+          vector<string_view>& /* views */)
+  {
+    RC     rc;
+    int    count;
+    int    pageKeys[RecordFile::RECORDS_PER_PAGE];
+    string pageValues[RecordFile::RECORDS_PER_PAGE];
+
+    for (PageId pid = begin; pid < end; pid++) {
+      if ((rc = rf.readPage(pid, count, pageKeys, pageValues)) < 0) return rc;
+
+      for (int i = 0; i < count; i++) {
+        for (unsigned j = 0; j < cond.size(); j++) {
+          bool ignored = false;
+          if (!SqlEngine::matchesCondition(cond[j], pageKeys[i], pageValues[i], ignored)) goto next_tuple;
+        }
+
+        if (aggregate) {
+          SqlEngine::accumulate(attr, pageKeys[i], pageValues[i], aggs[thread]);
+        } else {
+          keys.push_back(pageKeys[i]);
+          values.push_back(string());
+          values.back().swap(pageValues[i]);
+        }
+
+        next_tuple:
+        ;
+      }
+    }
+    return 0;
+  }
+
+  int                      attr;
+  const RecordFile&        rf;
+  const vector<SelCond>&   cond;
+  bool                     aggregate;
+  vector<AggState>         aggs;  // the partial aggregate of each thread
+};
+
+RC SqlEngine::parallelScan(int attr, const RecordFile& rf, PageId pid,
+                           const vector<SelCond>& cond, int& skip, int limit,
+                           int& count, AggState& agg, TupleSorter* sorter,
+                           HashAggregator* grouper)
+{
+  RC     rc;
+  int    key;
+  string value;
+
+  // the threads compute an aggregate without GROUP BY themselves, so only
+  // the other queries gather the matching tuples
+  bool aggregate = (attr >= 4 && grouper == NULL);
+  ScanTask task(attr, rf, cond, aggregate);
+  ParallelScan scan;
+
+  // OFFSET and LIMIT take the first tuples in table order, unless the
+  // tuples are sorted or grouped after the scan
+  bool ordered = (sorter == NULL && grouper == NULL);
+  PageId end = rf.endRid().pid + (rf.endRid().sid > 0 ? 1 : 0);
+  if ((rc = scan.start(task, pid, end, ParallelScan::defaultThreads(), ordered)) < 0) return rc;
+
+  while (limit < 0 || count < limit) {
+    if ((rc = scan.next(key, value)) < 0) break;
+
+    // skip the tuple if it is within OFFSET
+    if (skip > 0) {
+      skip--;
+      continue;
+    }
+
+    count++;
+    if ((rc = emitTuple(attr, key, value, agg, sorter, grouper)) < 0) break;
+  }
+
+  // stop the threads if LIMIT ended the scan early
+  RC error = scan.finish();
+  if (rc == RC_END_OF_STREAM || rc == 0) rc = error;
+  if (rc < 0) return rc;
+
+  // COUNT(*) is the count of matching tuples, and the other aggregates
+  // are the merged aggregates of the threads
+  if (aggregate) {
+    for (unsigned i = 0; i < task.aggs.size(); i++) {
+      count += task.aggs[i].count;
+      mergeAggregate(attr, task.aggs[i], agg);
+    }
+  }
+  return 0;
+}
+
+void SqlEngine::printAggregate(int attr, const AggState& agg)
+{
+  if (attr == 4) {
+    fprintf(stdout, "%lld\n", agg.count);
+    return;
+  }
+
+  // aggregates other than count are NULL over no tuples
+  if (agg.count == 0) {
+    fprintf(stdout, "NULL\n");
+    return;
+  }
+
+  switch (attr) {
+  case 5:  // MIN(key)
+    fprintf(stdout, "%d\n", agg.minKey);
+    break;
+  case 6:  // MAX(key)
+    fprintf(stdout, "%d\n", agg.maxKey);
+    break;
+  case 7:  // SUM(key)
+    fprintf(stdout, "%lld\n", agg.sum);
+    break;
+  case 8:  // AVG(key)
+    fprintf(stdout, "%.4f\n", (double) agg.sum / agg.count);
+    break;
+  case 9:  // MIN(value)
+    fprintf(stdout, "%s\n", agg.minValue.c_str());
+    break;
+  case 10: // MAX(value)
+    fprintf(stdout, "%s\n", agg.maxValue.c_str());
+    break;
+  }
+}
+
+RC SqlEngine::printGroups(int attr, const SelOpts& opts, HashAggregator& grouper)
+{
+  RC         rc;
+  string     value;
+  GroupState state;
+  int        count = 0;
+
+  for (int i = 0; i < opts.offset; i++) {
+    if ((rc = grouper.next(value, state)) < 0) {
+      return (rc == RC_END_OF_STREAM) ? 0 : rc;
+    }
+  }
+
+  while (opts.limit < 0 || count < opts.limit) {
+    if ((rc = grouper.next(value, state)) < 0) {
+      return (rc == RC_END_OF_STREAM) ? 0 : rc;
+    }
+    count++;
+
+    // SELECT value ... GROUP BY value returns the distinct values
+    if (attr == 2) {
+      fprintf(stdout, "%s\n", value.c_str());
+      continue;
+    }
+
+    AggState agg;
+    agg.count = state.count;
+    agg.sum = state.sum;
+    agg.minKey = state.minKey;
+    agg.maxKey = state.maxKey;
+    agg.minValue = agg.maxValue = value;
+
+    if (opts.showGroup) fprintf(stdout, "%s ", value.c_str());
+    printAggregate(attr, agg);
+  }
+
+  return 0;
+}
+
+/**
+ * a load file. a regular file is mapped into memory, and the mapping is
+ * removed when the object is destroyed. the standard input ("-"), a pipe
+ * or a device is read as a stream, a line at a time.
+ */
+class LoadFile {
+ public:
+  LoadFile() : data(NULL), size(0), stream(NULL), line(NULL), capacity(0), bytes(0) { }
+  ~LoadFile()
+  {
+    if (data != NULL) munmap((void*) data, size);
+    if (stream != NULL && stream != stdin) fclose(stream);
+    free(line);
+  }
+
+  // map or open the file. an empty file has no mapping
+  RC open(const string& name)
+  {
+    int fd;
+    struct stat st;
+
+    if (name == "-") {
+      stream = stdin;
+      return 0;
+    }
+
+    if ((fd = ::open(name.c_str(), O_RDONLY)) < 0) return RC_FILE_OPEN_FAILED;
+    if (fstat(fd, &st) < 0) {
+      ::close(fd);
+      return RC_FILE_OPEN_FAILED;
+    }
+
+    // a pipe has no size to map
+    if (!S_ISREG(st.st_mode)) {
+      if ((stream = fdopen(fd, "r")) == NULL) {
+        ::close(fd);
+        return RC_FILE_OPEN_FAILED;
+      }
+      return 0;
+    }
+
+    size = st.st_size;
+    if (size > 0) {
+      void* mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mapped == MAP_FAILED) {
+        ::close(fd);
+        return RC_FILE_OPEN_FAILED;
+      }
+      data = (const char*) mapped;
+      madvise(mapped, size, MADV_SEQUENTIAL);
+    }
+    ::close(fd);
+    return 0;
+  }
+
+  // read and parse the next line of a stream. RC_END_OF_STREAM at the end
+  // of the stream or at an empty line. nothing after the line is read, so
+  // the commands that follow the tuples on the standard input stay there
+  RC next(int& key, string& value)
+  {
+    RC          rc;
+    string_view view;
+
+    ssize_t n = ::getline(&line, &capacity, stream);
+    if (n < 0) return ferror(stream) ? RC_FILE_READ_FAILED : RC_END_OF_STREAM;
+    bytes += n;
+
+    if (n > 0 && line[n - 1] == '\n') n--;
+    if (n == 0) return RC_END_OF_STREAM;
+    if ((rc = SqlEngine::parseLoadLine(line, line + n, key, view)) < 0) return rc;
+    value.assign(view.data(), view.size());
+    return 0;
+  }
+
+  // skip the lines of the standard input up to the empty line that ends
+  // the tuples, so that they are not taken for commands
+  void skipTuples()
+  {
+    ssize_t n;
+    if (stream != stdin) return;
+    while ((n = ::getline(&line, &capacity, stream)) > 0 && line[0] != '\n') { }
+  }
+
+  const char* data;
+  size_t      size;
+  FILE*       stream;     // the stream of a file that is not mapped
+  char*       line;       // the line read from the stream
+  size_t      capacity;   // the size of the line buffer
+  long long   bytes;      // # of bytes read from the stream
+};
+
+/**
+ * parses the lines of a mapped load file for a ParallelScan. the pages of
+ * the scan are blocks of BLOCK_SIZE bytes of the file, and a line belongs
+ * to the morsel it starts in.
+ */
+class LoadTask : public ParallelScan::Task {
+ public:
+  // the size of a block of the load file
+  static const int BLOCK_SIZE = 64 * 1024;
+
+  LoadTask(const char* data, size_t size) : data(data), size(size) { }
+
+  // the values are returned as views into the mapped file
+  RC scan(int /* thread */, PageId begin, PageId end, vector<int>& keys,
+          vector<string>& /* values */, vector<string_view>& views)
+  {
+    RC          rc;
+    const char* eof = data + size;
+    const char* p = data + (size_t) begin * BLOCK_SIZE;
+    const char* stop = data + min(size, (size_t) end * BLOCK_SIZE);
+    int         key;
+    string_view value;
+
+    // skip the end of a line that started in an earlier morsel
+    if (p > data && p[-1] != '\n') {
+      if ((p = (const char*) memchr(p, '\n', stop - p)) == NULL) return 0;
+      p++;
+    }
+
+    while (p < stop) {
+      // the last line of the morsel may end in a later one
+      const char* eol = (const char*) memchr(p, '\n', eof - p);
+      if (eol == NULL) eol = eof;
+
+      // an empty line ends the load file
+      if (eol == p) return RC_END_OF_STREAM;
+      if ((rc = SqlEngine::parseLoadLine(p, eol, key, value)) < 0) return rc;
+      keys.push_back(key);
+      views.push_back(value);
+      p = eol + 1;
+    }
+    return 0;
+  }
+
+ private:
+  const char* data;
+  size_t      size;
+};
+
+RC SqlEngine::load(const string& table, const string& loadfile, bool index)
+{
+  LoadOpts opts;
+  opts.index = index;
+  return load(table, loadfile, opts);
+}
+
+RC SqlEngine::load(const string& table, const string& loadfile, const LoadOpts& opts)
+{
+  RC rc = 0;
+  RecordFile rf;
+  LoadFile input;
+  string val;  // the value of a line. its buffer is reused for every line
+  bool index = opts.index || opts.clustered;
+  bool valueIndex = opts.valueIndex;
+  bool lsm = opts.lsm;
+  bool pipeline;
+  TupleSorter* sorter = NULL;  // puts the tuples of a CLUSTERED table in key order
+  IndexBuilder* builder = NULL;  // sorts the key index entries of the new tuples
+  RecordId start;              // the first new tuple
+  TableStats stats;
+  bool indexOpen = false;      // the files that the load has opened
+  bool lsmOpen = false;
+  bool valueOpen = false;
+  bool tableOpen = false;
+  RC closed;
+
+  // Index of our tree
+  BTreeIndex dbIndex;
+  LsmIndex lsmIndex;
+  ValueIndex valIndex;
+
+  if (input.open(loadfile) != 0) {
+    return RC_FILE_OPEN_FAILED;
+  }
+
+  // APPEND keeps every index of the table up to date. a new index would
+  // only get the appended tuples, so APPEND cannot create one
+  if (opts.append) {
+    if (rf.open(table + ".tbl", 'r') != 0) {
+      fprintf(stderr, "Error: table %s does not exist\n", table.c_str());
+      input.skipTuples();
+      return RC_FILE_OPEN_FAILED;
+    }
+    rf.close();
+    bool hasIndex = false, hasLsm = false, hasValueIndex = false;
+    if (dbIndex.open(table + ".idx", 'r') == 0) {
+      index = hasIndex = true;
+      dbIndex.close();
+    }
+    if (lsmIndex.open(table + ".lsm", 'r') == 0) {
+      lsm = hasLsm = true;
+      lsmIndex.close();
+    }
+    if (valIndex.open(table + ".vdx", 'r') == 0) {
+      valueIndex = hasValueIndex = true;
+      valIndex.close();
+    }
+    if ((opts.index && !hasIndex) || (opts.lsm && !hasLsm) || (opts.valueIndex && !hasValueIndex)) {
+      fprintf(stderr, "Error: APPEND cannot add an index to table %s; create the index first\n", table.c_str());
+      input.skipTuples();
+      return RC_FILE_OPEN_FAILED;
+    }
+  }
+
+  // the tuples already in a table are not in order with the new ones. the
+  // table is checked read-only, so that a rejected load leaves no file
+  if (opts.clustered) {
+    bool exists = false;
+    if (rf.open(table + ".tbl", 'r') == 0) {
+      exists = rf.endRid().pid != 0 || rf.endRid().sid != 0;
+      rf.close();
+    }
+    if (dbIndex.open(table + ".idx", 'r') == 0) {
+      exists = exists || dbIndex.getTreeHeight() != 0;
+      dbIndex.close();
+    }
+    if (exists) {
+      fprintf(stderr, "Error: CLUSTERED needs a new table, but table %s exists\n", table.c_str());
+      input.skipTuples();
+      return RC_FILE_OPEN_FAILED;
+    }
+  }
+
+  if (index) {
+    rc = dbIndex.open(table + ".idx", 'w');
+    if (rc != 0) {
+      fprintf(stderr, "Error opening index for table %s\n", table.c_str());
+      input.skipTuples();
+      goto exit_load;
+    }
+    indexOpen = true;
+    if (opts.compressed) dbIndex.setCompressed(true);
+  }
+
+  if (lsm) {
+    rc = lsmIndex.open(table + ".lsm", 'w');
+    if (rc != 0) {
+      fprintf(stderr, "Error opening LSM index for table %s\n", table.c_str());
+      input.skipTuples();
+      goto exit_load;
+    }
+    lsmOpen = true;
+  }
+
+  if (valueIndex) {
+    rc = valIndex.open(table + ".vdx", 'w');
+    if (rc != 0) {
+      fprintf(stderr, "Error opening value index for table %s\n", table.c_str());
+      input.skipTuples();
+      goto exit_load;
+    }
+    valueOpen = true;
+  }
+
+  rc = rf.open((table + ".tbl").c_str(), 'w');
+  if (rc != 0) {
+    fprintf(stderr, "Error in record file for table %s\n", table.c_str());
+    input.skipTuples();
+    goto exit_load;
+  }
+  tableOpen = true;
+
+  if (opts.clustered) sorter = new TupleSorter(TupleSorter::KEY_ASC);
+  start = rf.endRid();
+
+  // the statistics cover the tuples already in the table. if they are
+  // missing or out of date, they are computed from the table first
+  if (stats.load(table + ".stats") != 0 ||
+      stats.getRowCount() != (long long) rf.endRid().pid * RecordFile::RECORDS_PER_PAGE + rf.endRid().sid) {
+    if ((rc = collectStats(rf, stats)) < 0) {
+      fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+      input.skipTuples();
+      goto exit_load;
+    }
+  }
+
+  // until the new statistics are saved, they do not give the row count
+  if ((rc = TableStats::markStale(table + ".stats")) < 0) {
+    fprintf(stderr, "Error: cannot update the statistics of table %s\n", table.c_str());
+    input.skipTuples();
+    goto exit_load;
+  }
+
+  // the key index of a CLUSTERED table is built by storeSorted(). a large
+  // load builds a new key index bottom-up, and the entries for an index
+  // that has entries already are sorted and inserted a leaf at a time
+  pipeline = input.stream != NULL ||
+             input.size >= (size_t) ParallelScan::MIN_PAGES * LoadTask::BLOCK_SIZE;
+  if (index && sorter == NULL && (pipeline || dbIndex.getTreeHeight() > 0)) {
+    builder = new IndexBuilder();
+  }
+
+  // the keys of a small load come in file order, so the rest are
+  // buffered in the index and reach each leaf in batches
+  if (index && sorter == NULL && builder == NULL) {
+    dbIndex.setBuffered(true);
+  }
+
+  // a large load file is parsed by a pool of threads, and a stream is
+  // appended and indexed in batches as well
+  if (pipeline) {
+    rc = loadPipeline(table, loadfile, input, rf, builder, lsm ? &lsmIndex : NULL,
+                      valueIndex ? &valIndex : NULL, sorter, stats);
+  } else {
+    const char* line = input.data;
+    const char* eof = input.data + input.size;
+    while (line < eof) {
+      const char* eol = (const char*) memchr(line, '\n', eof - line);
+      if (eol == NULL) eol = eof;
+
+      if (eol == line) {
+        break;
+      }
+
+      int key;
+      string_view value;
+
+      rc = parseLoadLine(line, eol, key, value);
+      line = eol + 1;
+      if (rc == 0) {
+        val.assign(value.data(), value.size());
+        stats.add(key, val);
+        if (sorter != NULL) {
+          rc = sorter->add(key, val);
+          if (rc != 0) {
+            fprintf(stderr, "Error sorting the tuples of table %s\n", table.c_str());
+            break;
+          }
+          continue;
+        }
+        rc = appendTuple(table, rf, (index && builder == NULL) ? &dbIndex : NULL, builder,
+                         lsm ? &lsmIndex : NULL, valueIndex ? &valIndex : NULL, key, val);
+        if (rc != 0) break;
+      } else {
+        fprintf(stderr, "Error while parsing loadfile %s\n", loadfile.c_str());
+        break;
+      }
+    }
+  }
+
+  // every appended tuple is indexed, even if the load stopped early
+  if (builder != NULL) {
+    RC finished = builder->finish(dbIndex);
+    if (finished < 0) {
+      fprintf(stderr, "Error inserting into index for table %s\n", table.c_str());
+      if (rc == 0) rc = finished;
+    }
+    delete builder;
+  }
+
+  // store the sorted tuples of a CLUSTERED table
+  if (sorter != NULL) {
+    if (rc == 0) rc = storeSorted(table, *sorter, rf, dbIndex, lsm ? &lsmIndex : NULL,
+                                  valueIndex ? &valIndex : NULL);
+    delete sorter;
+  }
+
+  // the new tuples follow the old ones in load order, not in key order
+  if (index && sorter == NULL && dbIndex.isClustered() && start < rf.endRid()) {
+    dbIndex.setClustered(false);
+  }
+
+  if (rc == 0 && stats.save(table + ".stats", rf.endRid()) != 0) {
+    fprintf(stderr, "Error: cannot save the statistics of table %s\n", table.c_str());
+  }
+
+  // close the files that were opened, and return the first error
+  exit_load:
+  if (tableOpen) {
+    closed = rf.close();
+    if (rc == 0) rc = closed;
+  }
+
+  if (indexOpen) {
+    closed = dbIndex.close();
+    if (rc == 0) rc = closed;
+  }
+
+  if (lsmOpen) {
+    closed = lsmIndex.close();
+    if (rc == 0) rc = closed;
+  }
+
+  if (valueOpen && valIndex.close() != 0 && rc == 0) {
+    rc = RC_FILE_CLOSE_FAILED;
+  }
+
+  return rc;
+}
+
+RC SqlEngine::optimize(const string& table)
+{
+  RecordFile rf;   // the table as it is now
+  RecordFile out;  // the table in key order
+  BTreeIndex idx;
+  LsmIndex lsm;
+  ValueIndex vidx;
+  TupleSorter sorter(TupleSorter::KEY_ASC);
+  RecordId rid;
+  RC rc;
+  int key;
+  string value;
+  bool compressed = false;
+  bool lsmIndex = false;
+  bool valueIndex = false;
+  string tmpTable = table + ".tmp";
+
+  if ((rc = rf.open(table + ".tbl", 'r')) < 0) {
+    fprintf(stderr, "Error: table %s does not exist\n", table.c_str());
+    return rc;
+  }
+
+  // read every tuple into the sorter
+  for (rid.pid = rid.sid = 0; rid < rf.endRid(); ++rid) {
+    if ((rc = rf.read(rid, key, value)) < 0 || (rc = sorter.add(key, value)) < 0) {
+      fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+      rf.close();
+      return rc;
+    }
+  }
+  rf.close();
+
+  // keep the leaf format of the key index, and the LSM and value indexes
+  // if there are any
+  if (idx.open(table + ".idx", 'r') == 0) {
+    compressed = idx.isCompressed();
+    idx.close();
+  }
+  if (lsm.open(table + ".lsm", 'r') == 0) {
+    lsmIndex = true;
+    lsm.close();
+  }
+  if (vidx.open(table + ".vdx", 'r') == 0) {
+    valueIndex = true;
+    vidx.close();
+  }
+
+  // write the new files next to the old ones, and replace them at the end
+  remove((tmpTable + ".tbl").c_str());
+  remove((tmpTable + ".idx").c_str());
+  remove((tmpTable + ".vdx").c_str());
+  LsmIndex::drop(tmpTable + ".lsm");
+  if ((rc = out.open(tmpTable + ".tbl", 'w')) < 0) {
+    fprintf(stderr, "Error: cannot create the new file of table %s\n", table.c_str());
+    return rc;
+  }
+  if ((rc = idx.open(tmpTable + ".idx", 'w')) < 0) {
+    fprintf(stderr, "Error: cannot create the new index of table %s\n", table.c_str());
+    out.close();
+    return rc;
+  }
+  idx.setCompressed(compressed);
+  if (lsmIndex && (rc = lsm.open(tmpTable + ".lsm", 'w')) < 0) {
+    fprintf(stderr, "Error: cannot create the new LSM index of table %s\n", table.c_str());
+    out.close();
+    idx.close();
+    return rc;
+  }
+  if (valueIndex && (rc = vidx.open(tmpTable + ".vdx", 'w')) < 0) {
+    fprintf(stderr, "Error: cannot create the new value index of table %s\n", table.c_str());
+    out.close();
+    idx.close();
+    if (lsmIndex) lsm.close();
+    return rc;
+  }
+
+  rc = storeSorted(table, sorter, out, idx, lsmIndex ? &lsm : NULL, valueIndex ? &vidx : NULL);
+
+  if (out.close() < 0 && rc == 0) rc = RC_FILE_CLOSE_FAILED;
+  if (idx.close() < 0 && rc == 0) rc = RC_FILE_CLOSE_FAILED;
+  if (lsmIndex && lsm.close() < 0 && rc == 0) rc = RC_FILE_CLOSE_FAILED;
+  if (valueIndex && vidx.close() < 0 && rc == 0) rc = RC_FILE_CLOSE_FAILED;
+
+  if (rc == 0 &&
+      (rename((tmpTable + ".tbl").c_str(), (table + ".tbl").c_str()) != 0 ||
+       rename((tmpTable + ".idx").c_str(), (table + ".idx").c_str()) != 0 ||
+       (lsmIndex && (LsmIndex::drop(table + ".lsm") != 0 ||
+                     LsmIndex::rename(tmpTable + ".lsm", table + ".lsm") != 0)) ||
+       (valueIndex && rename((tmpTable + ".vdx").c_str(), (table + ".vdx").c_str()) != 0))) {
+    fprintf(stderr, "Error: cannot replace the files of table %s\n", table.c_str());
+    rc = RC_FILE_WRITE_FAILED;
+  }
+  if (rc < 0) {
+    remove((tmpTable + ".tbl").c_str());
+    remove((tmpTable + ".idx").c_str());
+    remove((tmpTable + ".vdx").c_str());
+    LsmIndex::drop(tmpTable + ".lsm");
+  }
+
+  return rc;
+}
+
+RC SqlEngine::reindex(const string& table, int fillPercent)
+{
+  BTreeIndex idx;     // the index as it is now
+  BTreeIndex out;     // the rebuilt index
+  IndexCursor cursor;
+  RecordId rid;
+  RC rc;
+  int key;
+  string tmpIndex = table + ".tmp.idx";
+
+  if (idx.open(table + ".idx", 'r') < 0) {
+    fprintf(stderr, "Error: table %s has no index\n", table.c_str());
+    return RC_FILE_OPEN_FAILED;
+  }
+
+  remove(tmpIndex.c_str());
+  if ((rc = out.open(tmpIndex, 'w')) < 0) {
+    fprintf(stderr, "Error: cannot create the new index of table %s\n", table.c_str());
+    idx.close();
+    return rc;
+  }
+  out.setCompressed(idx.isCompressed());
+  out.setClustered(idx.isClustered());
+  if ((rc = out.setFillFactor(fillPercent)) < 0) {
+    fprintf(stderr, "Error: the fill factor must be between 10 and 100\n");
+    goto exit_reindex;
+  }
+
+  // the leaf chain of the old index returns the entries in key order
+  rc = idx.locate(INT_MIN, cursor);
+  while (rc == 0) {
+    if ((rc = idx.readForward(cursor, key, rid)) < 0) break;
+    rc = out.bulkInsert(key, rid);
+  }
+  if (rc == RC_NO_SUCH_RECORD || rc == RC_END_OF_TREE) {
+    rc = out.finishBulkLoad();
+  }
+  if (rc < 0) {
+    fprintf(stderr, "Error: while rebuilding the index of table %s\n", table.c_str());
+  }
+
+  exit_reindex:
+  idx.close();
+  if (out.close() < 0 && rc == 0) rc = RC_FILE_CLOSE_FAILED;
+
+  if (rc == 0 && rename(tmpIndex.c_str(), (table + ".idx").c_str()) != 0) {
+    fprintf(stderr, "Error: cannot replace the index of table %s\n", table.c_str());
+    rc = RC_FILE_WRITE_FAILED;
+  }
+  if (rc < 0) remove(tmpIndex.c_str());
+
+  return rc;
+}
+
+RC SqlEngine::analyze(const string& table)
+{
+  RecordFile rf;
+  RecordId end;
+  TableStats stats;
+  RC rc;
+
+  if ((rc = rf.open(table + ".tbl", 'r')) < 0) {
+    fprintf(stderr, "Error: table %s does not exist\n", table.c_str());
+    return rc;
+  }
+  rc = collectStats(rf, stats);
+  end = rf.endRid();
+  rf.close();
+  if (rc < 0) {
+    fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+    return rc;
+  }
+
+  if ((rc = stats.save(table + ".stats", end)) < 0) {
+    fprintf(stderr, "Error: cannot save the statistics of table %s\n", table.c_str());
+  }
+  return rc;
+}
+
+bool SqlEngine::countFromStats(const string& table, int& count)
+{
+  struct stat tbl;
+  long long rows;
+  RecordId end;
+
+  // a load marks the statistics stale before it appends a tuple, and
+  // saves them with the new end when it is done
+  if (TableStats::readHeader(table + ".stats", rows, end) != 0 || end.pid < 0) {
+    return false;
+  }
+  if (rows != (long long) end.pid * RecordFile::RECORDS_PER_PAGE + end.sid) {
+    return false;
+  }
+
+  // the end must still be the end of the table file
+  if (stat((table + ".tbl").c_str(), &tbl) != 0 ||
+      tbl.st_size / PageFile::PAGE_SIZE != end.pid + (end.sid > 0 ? 1 : 0)) {
+    return false;
+  }
+  count = (int) rows;
+  return true;
+}
+
+RC SqlEngine::collectStats(RecordFile& rf, TableStats& stats)
+{
+  RecordId rid;
+  RC rc;
+  int key;
+  string value;
+
+  stats.clear();
+  for (rid.pid = rid.sid = 0; rid < rf.endRid(); ++rid) {
+    if ((rc = rf.read(rid, key, value)) < 0) return rc;
+    stats.add(key, value);
+  }
+  return 0;
+}
+
+RC SqlEngine::storeSorted(const string& table, TupleSorter& sorter, RecordFile& rf,
+                          BTreeIndex& idx, LsmIndex* lsm, ValueIndex* vidx)
+{
+  RC rc;
+  RecordId rid;
+  int key;
+  string value;
+
+  if ((rc = sorter.sort()) < 0) {
+    fprintf(stderr, "Error sorting the tuples of table %s\n", table.c_str());
+    return rc;
+  }
+
+  // the tuples come in key order, so the key index is built bottom-up
+  while ((rc = sorter.next(key, value)) == 0) {
+    rid = rf.endRid();
+    if ((rc = rf.append(key, value, rid)) < 0) {
+      fprintf(stderr, "Error appending data to table %s\n", table.c_str());
+      return rc;
+    }
+    if ((rc = idx.bulkInsert(key, rid)) < 0) {
+      fprintf(stderr, "Error inserting into index for table %s\n", table.c_str());
+      return rc;
+    }
+    if (lsm != NULL && (rc = lsm->insert(key, rid)) < 0) {
+      fprintf(stderr, "Error inserting into LSM index for table %s\n", table.c_str());
+      return rc;
+    }
+    if (vidx != NULL && (rc = vidx->insert(value, rid)) < 0) {
+      fprintf(stderr, "Error inserting into value index for table %s\n", table.c_str());
+      return rc;
+    }
+  }
+  if (rc != RC_END_OF_STREAM) {
+    fprintf(stderr, "Error sorting the tuples of table %s\n", table.c_str());
+    return rc;
+  }
+
+  if ((rc = idx.finishBulkLoad()) < 0) {
+    fprintf(stderr, "Error inserting into index for table %s\n", table.c_str());
+    return rc;
+  }
+  idx.setClustered(true);
+  return 0;
+}
+
+RC SqlEngine::appendTuple(const string& table, RecordFile& rf, BTreeIndex* idx,
+                          IndexBuilder* builder, LsmIndex* lsm, ValueIndex* vidx,
+                          int key, const string& value)
+{
+  RC rc;
+  RecordId rid;
+
+  rid = rf.endRid();
+  rc = rf.append(key, value, rid);
+  if (rc != 0) {
+    fprintf(stderr, "Error appending data to table %s\n", table.c_str());
+    return rc;
+  }
+  if (idx != NULL && (rc = idx->insert(key, rid)) != 0) {
+    fprintf(stderr, "Error inserting into index for table %s\n", table.c_str());
+    return rc;
+  }
+  if (builder != NULL) builder->add(key, rid);
+  if (lsm != NULL && (rc = lsm->insert(key, rid)) != 0) {
+    fprintf(stderr, "Error inserting into LSM index for table %s\n", table.c_str());
+    return rc;
+  }
+  if (vidx != NULL) {
+    rc = vidx->insert(value, rid);
+    if (rc != 0) {
+      fprintf(stderr, "Error inserting into value index for table %s\n", table.c_str());
+      return rc;
+    }
+  }
+  return 0;
+}
+
+RC SqlEngine::loadPipeline(const string& table, const string& loadfile, LoadFile& input,
+                           RecordFile& rf, IndexBuilder* builder, LsmIndex* lsm, ValueIndex* vidx,
+                           TupleSorter* sorter, TableStats& stats)
+{
+  RC rc = 0;
+  RC end;              // why the parsing stopped
+  long long count = 0; // # of tuples loaded
+  int key;
+  string_view value;
+  vector<int> keys;    // the tuples waiting to be appended
+  vector<string_view> values;
+  vector<string> lines; // the lines of a stream, reused from batch to batch.
+                        // never resized once filled, as the values point into them
+
+  // the tuples of a mapped file are parsed by a pool of threads and
+  // gathered in file order, so that they get the same record ids as with
+  // a serial load, and their values are views into the mapping. a stream is
+  // parsed a line at a time into the buffer of its slot in the batch
+  LoadTask task(input.data, input.size);
+  ParallelScan scan;
+  PageId blocks = (PageId) ((input.size + LoadTask::BLOCK_SIZE - 1) / LoadTask::BLOCK_SIZE);
+  end = (input.stream == NULL) ? scan.start(task, 0, blocks, ParallelScan::defaultThreads(), true) : 0;
+
+  chrono::steady_clock::time_point started = chrono::steady_clock::now();
+  chrono::steady_clock::time_point reported = started;
+  while (end == 0) {
+    if (input.stream != NULL) {
+      if (lines.empty()) lines.resize(RecordFile::RECORDS_PER_PAGE * ParallelScan::MORSEL_PAGES);
+      string& line = lines[keys.size()];
+      if ((end = input.next(key, line)) != 0) break;
+      value = line;
+    } else if ((end = scan.next(key, value)) != 0) {
+      break;
+    }
+
+    stats.add(key, value);
+    if (sorter != NULL) {
+      if ((rc = sorter->add(key, value)) != 0) {
+        fprintf(stderr, "Error sorting the tuples of table %s\n", table.c_str());
+        break;
+      }
+    } else {
+      keys.push_back(key);
+      values.push_back(value);
+      if ((int) keys.size() == RecordFile::RECORDS_PER_PAGE * ParallelScan::MORSEL_PAGES) {
+        if ((rc = appendBatch(table, rf, builder, lsm, vidx, keys, values)) < 0) break;
+      }
+    }
+
+    // a stream has no size to go by, so the progress is reported
+    // every PROGRESS_SECONDS
+    if (input.stream != NULL && ++count % PROGRESS_TUPLES == 0) {
+      chrono::steady_clock::time_point now = chrono::steady_clock::now();
+      if (chrono::duration<double>(now - reported).count() >= PROGRESS_SECONDS) {
+        reported = now;
+        reportLoad(count, input.bytes, chrono::duration<double>(now - started).count());
+      }
+    }
+  }
+  scan.finish();
+
+  // the tuples before an empty line or a line that cannot be parsed
+  // are stored, as by the serial load
+  if (rc == 0 && !keys.empty()) {
+    rc = appendBatch(table, rf, builder, lsm, vidx, keys, values);
+  }
+  if (end != RC_END_OF_STREAM && input.stream != NULL) input.skipTuples();
+  if (rc == 0 && end != RC_END_OF_STREAM) {
+    if (end == RC_INVALID_FILE_FORMAT) {
+      fprintf(stderr, "Error while parsing loadfile %s\n", loadfile.c_str());
+    } else {
+      fprintf(stderr, "Error while reading loadfile %s\n", loadfile.c_str());
+    }
+    rc = end;
+  }
+
+  if (input.stream != NULL) {
+    reportLoad(count, input.bytes, chrono::duration<double>(chrono::steady_clock::now() - started).count());
+  }
+  return rc;
+}
+
+void SqlEngine::reportLoad(long long count, long long bytes, double seconds)
+{
+  double mb = bytes / 1048576.0;
+  fprintf(stderr, "  -- %lld tuples, %.1f MB loaded in %.1f seconds (%.1f MB/s)\n",
+          count, mb, seconds, (seconds > 0) ? mb / seconds : 0.0);
+}
+
+RC SqlEngine::appendBatch(const string& table, RecordFile& rf,
+                          IndexBuilder* builder, LsmIndex* lsm, ValueIndex* vidx,
+                          vector<int>& keys, vector<string_view>& values)
+{
+  RC rc;
+  RecordId rid;
+  string value;
+
+  if ((rc = rf.append(keys.size(), &keys[0], &values[0], rid)) < 0) {
+    fprintf(stderr, "Error appending data to table %s\n", table.c_str());
+    return rc;
+  }
+
+  for (unsigned i = 0; i < keys.size(); i++, ++rid) {
+    if (builder != NULL) builder->add(keys[i], rid);
+    if (lsm != NULL && (rc = lsm->insert(keys[i], rid)) < 0) {
+      fprintf(stderr, "Error inserting into LSM index for table %s\n", table.c_str());
+      return rc;
+    }
+    if (vidx != NULL) {
+      value.assign(values[i].data(), values[i].size());
+      if ((rc = vidx->insert(value, rid)) < 0) {
+        fprintf(stderr, "Error inserting into value index for table %s\n", table.c_str());
+        return rc;
+      }
+    }
+  }
+  keys.clear();
+  values.clear();
+  return 0;
+}
+
+RC SqlEngine::createIndex(const string& table, int attr)
+{
+  RecordFile rf;
+  RecordId   rid;
+  BTreeIndex idx;
+  ValueIndex vidx;
+  PageFile   existing;
+  RC         rc;
+  int        key;
+  string     value;
+  string     indexname = table + ((attr == 1) ? ".idx" : ".vdx");
+
+  if ((rc = rf.open(table + ".tbl", 'r')) < 0) {
+    fprintf(stderr, "Error: table %s does not exist\n", table.c_str());
+    return rc;
+  }
+
+  // inserting the tuples again would duplicate every index entry
+  if (existing.open(indexname, 'r') == 0) {
+    existing.close();
+    rf.close();
+    fprintf(stderr, "Error: the index already exists for table %s\n", table.c_str());
+    return RC_FILE_OPEN_FAILED;
+  }
+
+  rc = (attr == 1) ? idx.open(indexname, 'w') : vidx.open(indexname, 'w');
+  if (rc < 0) {
+    fprintf(stderr, "Error opening index for table %s\n", table.c_str());
+    rf.close();
+    return rc;
+  }
+  if (attr == 1) idx.setBuffered(true);
+
+  // add every tuple of the table to the index
+  for (rid.pid = rid.sid = 0; rid < rf.endRid(); ++rid) {
+    if ((rc = rf.read(rid, key, value)) < 0) {
+      fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+      break;
+    }
+    rc = (attr == 1) ? idx.insert(key, rid) : vidx.insert(value, rid);
+    if (rc < 0) {
+      fprintf(stderr, "Error inserting into index for table %s\n", table.c_str());
+      break;
+    }
+  }
+
+  if (attr == 1) {
+    if (idx.close() < 0 && rc == 0) rc = RC_FILE_CLOSE_FAILED;
+  } else {
+    if (vidx.close() < 0 && rc == 0) rc = RC_FILE_CLOSE_FAILED;
+  }
+  rf.close();
+  return rc;
+}
+
+RC SqlEngine::parseLoadLine(const string& line, int& key, string& value)
+{
+    string_view view;
+    RC          rc;
+
+    if ((rc = parseLoadLine(line.data(), line.data() + line.size(), key, view)) < 0) { return rc; }
+    value.assign(view.data(), view.size());
+    return 0;
+}
+
+RC SqlEngine::parseLoadLine(const string& line, long long& key, string& value)
+{
+    string_view view;
+    RC          rc;
+
+    if ((rc = parseLoadLine(line.data(), line.data() + line.size(), key, view)) < 0) { return rc; }
+    value.assign(view.data(), view.size());
+    return 0;
+}
+
+RC SqlEngine::parseLoadLine(const char* line, const char* end, int& key, string_view& value)
+{
+    long long wide;
+    RC        rc;
+
+    if ((rc = parseLoadLine(line, end, wide, value)) < 0) { return rc; }
+
+    // the tables store 32-bit keys. atoi() used to wrap larger keys around
+    if (wide < INT_MIN || wide > INT_MAX) { return RC_INVALID_FILE_FORMAT; }
+    key = (int) wide;
+    return 0;
+}
+
+RC SqlEngine::parseLoadLine(const char* line, const char* end, long long& key, string_view& value)
+{
+    const char *s = line;
+    const char *quote;
     char        c;
-    string::size_type loc;
+    bool        negative = false;
+    unsigned long long magnitude = 0;
 
     // ignore beginning white spaces
-    c = *(s = line.c_str());
-    while (c == ' ' || c == '\t') { c = *++s; }
-
-    // get the integer key value
-    key = atoi(s);
+    while (s < end && (*s == ' ' || (*s >= '\t' && *s <= '\r'))) { s++; }
+
+    // get the integer key value. like strtoll(), a line without digits
+    // has the key 0, and a key that overflows 64 bits is an error
+    if (s < end && (*s == '+' || *s == '-')) { negative = (*s++ == '-'); }
+    while (s < end && *s >= '0' && *s <= '9') {
+        unsigned digit = *s++ - '0';
+        if (magnitude > (ULLONG_MAX - digit) / 10) { return RC_INVALID_FILE_FORMAT; }
+        magnitude = magnitude * 10 + digit;
+    }
+    if (magnitude > (unsigned long long) LLONG_MAX + (negative ? 1 : 0)) { return RC_INVALID_FILE_FORMAT; }
+    key = negative ? (long long) (0 - magnitude) : (long long) magnitude;
 
-    // look for comma
-    s = strchr(s, ',');
+    // look for comma. memchr() compares many bytes at a time
+    s = (const char*) memchr(s, ',', end - s);
     if (s == NULL) { return RC_INVALID_FILE_FORMAT; }
 
     // ignore white spaces
-    do { c = *++s; } while (c == ' ' || c == '\t');
+    do { s++; } while (s < end && (*s == ' ' || *s == '\t'));
 
     // if there is nothing left, set the value to empty string
-    if (c == 0) {
-        value.erase();
+    if (s == end) {
+        value = string_view();
         return 0;
     }
 
-    // is the value field delimited by ' or "?
+    // is the value field delimited by ' or "? it ends at the closing
+    // quote, or else at the end of the line
+    c = *s;
     if (c == '\'' || c == '"') {
         s++;
-    } else {
-        c = '\n';
+        quote = (const char*) memchr(s, c, end - s);
+        if (quote != NULL) { end = quote; }
     }
 
-    // get the value string
-    value.assign(s);
-    loc = value.find(c, 0);
-    if (loc != string::npos) { value.erase(loc); }
-
+    value = string_view(s, end - s);
     return 0;
 }
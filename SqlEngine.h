@@ -10,17 +10,92 @@
 #ifndef SQLENGINE_H
 #define SQLENGINE_H
 
+#include <string>
+#include <string_view>
 #include <vector>
 #include "Bruinbase.h"
 #include "RecordFile.h"
+#include "BTreeIndex.h"
+
+class TupleSorter;
+class HashAggregator;
+class TableJoin;
+class ValueIndex;
+class TableStats;
+class IndexBuilder;
+class LsmIndex;
+class LoadFile;
+
+/**
+ * data structure to represent a range of keys, from low to high inclusive
+ */
+struct KeyRange {
+  int low;
+  int high;
+};
 
 /**
  * data structure to represent a condition in the WHERE clause
  */
 struct SelCond {
   int attr;     // attribute: 1 - key column,  2 - value column
-  enum Comparator { EQ, NE, LT, GT, LE, GE } comp;
-  char* value;  // the value to compare
+  enum Comparator { EQ, NE, LT, GT, LE, GE, IN } comp;
+  char* value;  // the value to compare. NULL for a join condition and IN
+  char* table;  // the table of attr if it is qualified ("movie.key"). NULL otherwise
+  char* joinTable;  // join condition "table.attr = joinTable.joinAttr". NULL otherwise
+  int   joinAttr;
+  std::vector<KeyRange>* ranges;  // IN: the key is in one of these sorted,
+                                  // disjoint ranges ("key = 1 OR key > 5")
+};
+
+/**
+ * data structure to represent a qualified attribute ("movie.key")
+ * in the SELECT clause of a join
+ */
+struct SelAttr {
+  char* table;  // the table name
+  int attr;     // attribute: 1 - key column,  2 - value column
+};
+
+/**
+ * data structure to represent the optional clauses of a SELECT statement
+ */
+struct SelOpts {
+  int limit;    // max # of tuples to return. -1 if there is no LIMIT clause
+  int offset;   // # of matching tuples to skip before the first one returned
+  int orderAttr;  // ORDER BY attribute: 0 - none, 1 - key, 2 - value
+  bool desc;      // true if the tuples are returned in descending order
+  int groupAttr;  // GROUP BY attribute: 0 - none, 2 - value
+  bool showGroup; // true if the value of each group precedes its aggregate
+};
+
+/**
+ * data structure to represent the options of a LOAD statement
+ */
+struct LoadOpts {
+  bool index;       // build the key index ("WITH INDEX")
+  bool valueIndex;  // build the value index ("WITH value INDEX")
+  bool compressed;  // compress the leaves of the key index ("WITH compressed INDEX")
+  bool clustered;   // store the tuples in key order ("CLUSTERED"). implies index
+  bool append;      // add to an existing table and its indexes ("APPEND")
+  bool lsm;         // keep a write-optimized LSM key index ("WITH lsm INDEX")
+
+  LoadOpts() : index(false), valueIndex(false), compressed(false), clustered(false),
+               append(false), lsm(false) { }
+};
+
+/**
+ * running state of an aggregate function over the matching tuples
+ */
+struct AggState {
+  long long   count;     // # of tuples aggregated
+  long long   sum;       // sum of the keys
+  int         minKey;    // smallest key. valid only if count > 0
+  int         maxKey;    // largest key. valid only if count > 0
+  std::string minValue;  // smallest value. valid only if count > 0
+  std::string maxValue;  // largest value. valid only if count > 0
+
+  AggState() : count(0), sum(0), minKey(0), maxKey(0) { }
 };
 
 /**
@@ -43,12 +118,30 @@ class SqlEngine {
    * all conditions in conds must be ANDed together.
    * the result of the SELECT is printed on screen.
    * @param attr[IN] attribute in the SELECT clause
-   * (1: key, 2: value, 3: *, 4: count(*))
+   * (1: key, 2: value, 3: *, 4: count(*), 5: min(key), 6: max(key),
+   *  7: sum(key), 8: avg(key), 9: min(value), 10: max(value))
    * @param table[IN] the table name in the FROM clause
    * @param conds[IN] list of conditions in the WHERE clause
+   * @param opts[IN] GROUP BY, ORDER BY, LIMIT and OFFSET of the query
    * @return error code. 0 if no error
    */
-  static RC select(int attr, const std::string& table, const std::vector<SelCond>& conds);
+  static RC select(int attr, const std::string& table, const std::vector<SelCond>& conds, const SelOpts& opts);
+
+  /**
+   * executes a SELECT statement over two tables joined on their keys.
+   * conds must contain "table1.key = table2.key", and every other
+   * condition must be on a qualified attribute of one of the tables.
+   * the result of the SELECT is printed on screen.
+   * @param attr[IN] 3 for *, 4 for count(*), 0 to print attrs
+   * @param attrs[IN] the qualified attributes in the SELECT clause
+   * @param table1[IN] the first table in the FROM clause
+   * @param table2[IN] the second table in the FROM clause
+   * @param conds[IN] list of conditions in the WHERE clause
+   * @param opts[IN] LIMIT and OFFSET of the query
+   * @return error code. 0 if no error
+   */
+  static RC join(int attr, const std::vector<SelAttr>& attrs, const std::string& table1,
+                 const std::string& table2, const std::vector<SelCond>& conds, const SelOpts& opts);
 
   /**
    * load a table from a load file.
@@ -59,6 +152,62 @@ class SqlEngine {
    */
   static RC load(const std::string& table, const std::string& loadfile, bool index);
 
+  /**
+   * load a table from a load file.
+   * a CLUSTERED table must be new. its tuples are sorted by key before
+   * they are stored, and the key index records that the table is in
+   * key order.
+   * "WITH lsm INDEX" keeps the key index in table.lsm, an LsmIndex that
+   * suits tables with many inserts.
+   * APPEND needs an existing table, and adds the new tuples to the key,
+   * LSM and value indexes the table has. the new entries of a key index that
+   * has entries are sorted and inserted a leaf at a time.
+   * the load file "-" is the standard input, where the tuples follow
+   * the command up to an empty line or the end of the input. a pipe is
+   * read as a stream too.
+   * @param table[IN] the table name in the LOAD command
+   * @param loadfile[IN] the file name of the load file
+   * @param opts[IN] the indexes to build and the storage of the table
+   * @return error code. 0 if no error
+   */
+  static RC load(const std::string& table, const std::string& loadfile, const LoadOpts& opts);
+
+  /**
+   * build an index on a column of an existing table.
+   * the key index is stored in table.idx and the value index in table.vdx.
+   * @param table[IN] the table name in the CREATE INDEX command
+   * @param attr[IN] the indexed column. 1: key, 2: value
+   * @return error code. 0 if no error
+   */
+  static RC createIndex(const std::string& table, int attr);
+
+  /**
+   * rewrite a table in key order and rebuild its key index bottom-up.
+   * the key index is marked as clustered, so that its range scans read
+   * the table sequentially. a value index of the table is rebuilt as well.
+   * @param table[IN] the table name in the OPTIMIZE TABLE command
+   * @return error code. 0 if no error
+   */
+  static RC optimize(const std::string& table);
+
+  /**
+   * rebuild the key index of a table bottom-up. the leaves are stored on
+   * consecutive pages in key order, followed by the non-leaf nodes.
+   * @param table[IN] the table name in the REINDEX command
+   * @param fillPercent[IN] how full the nodes are made, from 10 to 100
+   * @return error code. 0 if no error
+   */
+  static RC reindex(const std::string& table, int fillPercent);
+
+  /**
+   * recompute the statistics of a table and save them in table.stats.
+   * LOAD keeps the statistics up to date, so ANALYZE is needed only if
+   * the file is lost or the table was changed by other means.
+   * @param table[IN] the table name in the ANALYZE command
+   * @return error code. 0 if no error
+   */
+  static RC analyze(const std::string& table);
+
   /**
    * parse a line from the load file into the (key, value) pair.
    * @param line[IN] a line from a load file
@@ -68,10 +217,280 @@ class SqlEngine {
    */
   static RC parseLoadLine(const std::string& line, int& key, std::string& value);
 
+  /**
+   * parse a line from the load file into a (key, value) pair with a
+   * 64-bit key. the int version above fails for keys out of the int range.
+   * @param line[IN] a line from a load file
+   * @param key[OUT] the key field of the tuple in the line
+   * @param value[OUT] the value field of the tuple in the line
+   * @return error code. RC_INVALID_FILE_FORMAT if the key overflows 64 bits
+   */
+  static RC parseLoadLine(const std::string& line, long long& key, std::string& value);
+
+  /**
+   * parse a line of a load file in place. the value is not copied but
+   * points into the line.
+   * @param line[IN] the first character of the line
+   * @param end[IN] the end of the line, without the newline
+   * @param key[OUT] the key field of the tuple in the line
+   * @param value[OUT] the value field of the tuple in the line
+   * @return error code. RC_INVALID_FILE_FORMAT if the key is out of the
+   * int range
+   */
+  static RC parseLoadLine(const char* line, const char* end, int& key, std::string_view& value);
+
+  /**
+   * parse a line of a load file in place, with a 64-bit key.
+   * @param line[IN] the first character of the line
+   * @param end[IN] the end of the line, without the newline
+   * @param key[OUT] the key field of the tuple in the line
+   * @param value[OUT] the value field of the tuple in the line
+   * @return error code. RC_INVALID_FILE_FORMAT if the key overflows 64 bits
+   */
+  static RC parseLoadLine(const char* line, const char* end, long long& key, std::string_view& value);
+
+  /**
+   * sort key ranges and merge the ones that overlap, so that they can be
+   * used by an IN condition.
+   * @param ranges[IN/OUT] the key ranges. empty ranges are dropped
+   */
+  static void mergeRanges(std::vector<KeyRange>& ranges);
+
+  /**
+   * compute the key ranges that satisfy every key condition.
+   * @param conds[IN] the conditions on the key column
+   * @param ranges[OUT] the sorted, disjoint key ranges. empty if no key
+   * can satisfy the conditions
+   */
+  static void keyRanges(const std::vector<SelCond>& conds, std::vector<KeyRange>& ranges);
+
 private:
-  static RC processConditions(const int attr, const std::vector<SelCond>& conds, std::vector<SelCond>& indexConds, std::vector<SelCond>& tableConds);
+  friend class TableJoin;
+  friend class ScanTask;
+  friend class LoadTask;
+
+  // the progress of a LOAD from a stream is reported every PROGRESS_SECONDS.
+  // the clock is checked every PROGRESS_TUPLES tuples
+  static const int PROGRESS_SECONDS = 5;
+  static const int PROGRESS_TUPLES = 65536;
+
+  /**
+   * split the conditions of a query into the key conditions that can be
+   * answered by the index (every comparator on key) and the rest.
+   * @param conds[IN] list of conditions in the WHERE clause
+   * @param indexConds[OUT] the conditions that the index can evaluate
+   * @param tableConds[OUT] the conditions that need the tuple itself
+   * @return error code. 0 if no error
+   */
+  static RC processConditions(const std::vector<SelCond>& conds, std::vector<SelCond>& indexConds, std::vector<SelCond>& tableConds);
+
+  /**
+   * check a tuple against a condition.
+   * when the tuples are visited in ascending order of the attribute of
+   * the condition, terminate is set if no later tuple can satisfy the
+   * condition either.
+   * @param cond[IN] the condition to check
+   * @param key[IN] the key of the tuple
+   * @param value[IN] the value of the tuple
+   * @param terminate[OUT] set to true if the scan can stop
+   * @return true if the tuple satisfies the condition
+   */
   static bool matchesCondition(const SelCond& cond, const int key, const std::string& value, bool& terminate);
 
+  /**
+   * print a tuple for "SELECT key", "SELECT value" or "SELECT *".
+   * @param attr[IN] attribute in the SELECT clause
+   * @param key[IN] the key of the tuple
+   * @param value[IN] the value of the tuple
+   */
+  static void printTuple(int attr, int key, const std::string& value);
+
+  /**
+   * compute the statistics of every tuple in a table.
+   * @param rf[IN] the record file of the table
+   * @param stats[OUT] the statistics
+   * @return error code. 0 if no error
+   */
+  static RC collectStats(RecordFile& rf, TableStats& stats);
+
+  /**
+   * find the # of tuples of a table from page 0 of its statistics,
+   * without reading a page of the table. the end RecordId saved with the
+   * statistics must still be the end of the table file.
+   * @param table[IN] the table name
+   * @param count[OUT] the # of tuples
+   * @return true if the statistics are current
+   */
+  static bool countFromStats(const std::string& table, int& count);
+
+  /**
+   * append the tuples of a sorter to an empty table in key order, build
+   * its key index bottom-up and mark the index as clustered.
+   * @param table[IN] the table name, for error messages
+   * @param sorter[IN] the sorter holding the tuples, sorted by key
+   * @param rf[IN] the record file of the table
+   * @param idx[IN] the empty key index of the table
+   * @param lsm[IN] the empty LSM key index. NULL if there is none
+   * @param vidx[IN] the value index. NULL if there is none
+   * @return error code. 0 if no error
+   */
+  static RC storeSorted(const std::string& table, TupleSorter& sorter, RecordFile& rf,
+                        BTreeIndex& idx, LsmIndex* lsm, ValueIndex* vidx);
+
+  /**
+   * append a loaded tuple to the table and add it to the indexes.
+   * @param table[IN] the table name, for error messages
+   * @param rf[IN] the record file of the table
+   * @param idx[IN] the key index. NULL if there is none or it is built
+   * @param builder[IN] the builder of the key index. NULL if there is none
+   * @param lsm[IN] the LSM key index. NULL if there is none
+   * @param vidx[IN] the value index. NULL if there is none
+   * @param key[IN] the key of the tuple
+   * @param value[IN] the value of the tuple
+   * @return error code. 0 if no error
+   */
+  static RC appendTuple(const std::string& table, RecordFile& rf, BTreeIndex* idx,
+                        IndexBuilder* builder, LsmIndex* lsm, ValueIndex* vidx,
+                        int key, const std::string& value);
+
+  /**
+   * load a large file or a stream with a pipeline: a pool of threads
+   * parses chunks of a mapped file, or the calling thread reads a stream
+   * a line at a time. the calling thread appends the tuples in file order,
+   * and hands their key index entries to the builder, which sorts them on
+   * a thread of its own. the progress of a stream is reported on stderr.
+   * @param table[IN] the table name, for error messages
+   * @param loadfile[IN] the name of the file to load, for error messages
+   * @param input[IN] the file to load
+   * @param rf[IN] the record file of the table
+   * @param builder[IN] the builder of the key index. NULL if there is none
+   * @param lsm[IN] the LSM key index. NULL if there is none
+   * @param vidx[IN] the value index. NULL if there is none
+   * @param sorter[IN] the sorter of a CLUSTERED table. NULL if not clustered
+   * @param stats[IN/OUT] the statistics of the table
+   * @return error code. 0 if no error
+   */
+  static RC loadPipeline(const std::string& table, const std::string& loadfile, LoadFile& input,
+                         RecordFile& rf, IndexBuilder* builder, LsmIndex* lsm, ValueIndex* vidx,
+                         TupleSorter* sorter, TableStats& stats);
+
+  /**
+   * print the progress of a load on stderr.
+   * @param count[IN] the # of tuples loaded so far
+   * @param bytes[IN] the # of bytes read so far
+   * @param seconds[IN] the time since the load started
+   */
+  static void reportLoad(long long count, long long bytes, double seconds);
+
+  /**
+   * append a batch of loaded tuples to the table and add them to the
+   * indexes. the batch is emptied.
+   * @param table[IN] the table name, for error messages
+   * @param rf[IN] the record file of the table
+   * @param builder[IN] the builder of the key index. NULL if there is none
+   * @param lsm[IN] the LSM key index. NULL if there is none
+   * @param vidx[IN] the value index. NULL if there is none
+   * @param keys[IN/OUT] the keys of the tuples
+   * @param values[IN/OUT] the values of the tuples
+   * @return error code. 0 if no error
+   */
+  static RC appendBatch(const std::string& table, RecordFile& rf,
+                        IndexBuilder* builder, LsmIndex* lsm, ValueIndex* vidx,
+                        std::vector<int>& keys, std::vector<std::string_view>& values);
+
+  /**
+   * pass a matching tuple on to GROUP BY, the aggregate, ORDER BY or
+   * the screen, whichever comes first.
+   * @param attr[IN] attribute in the SELECT clause
+   * @param key[IN] the key of the tuple
+   * @param value[IN] the value of the tuple
+   * @param agg[IN/OUT] the running state of the aggregate
+   * @param sorter[IN] the sorter for ORDER BY. NULL if there is no sort
+   * @param grouper[IN] the hash aggregation for GROUP BY. NULL if not grouped
+   * @return error code. 0 if no error
+   */
+  static RC emitTuple(int attr, int key, const std::string& value, AggState& agg,
+                      TupleSorter* sorter, HashAggregator* grouper);
+
+  /**
+   * add a tuple to the aggregate in the SELECT clause (attr 4 - 10).
+   * @param attr[IN] attribute in the SELECT clause
+   * @param key[IN] the key of the tuple
+   * @param value[IN] the value of the tuple
+   * @param agg[IN/OUT] the running state of the aggregate
+   */
+  static void accumulate(int attr, int key, const std::string& value, AggState& agg);
+
+  /**
+   * add the aggregate of some tuples to the aggregate of others.
+   * @param attr[IN] attribute in the SELECT clause
+   * @param part[IN] the aggregate of the tuples to add
+   * @param agg[IN/OUT] the aggregate the tuples are added to
+   */
+  static void mergeAggregate(int attr, const AggState& part, AggState& agg);
+
+  /**
+   * the table scan of select() on a pool of threads. each thread checks
+   * the conditions on the tuples of its pages and keeps its own partial
+   * aggregate; the other matching tuples are gathered in this thread and
+   * passed on within OFFSET and LIMIT, in table order unless they are
+   * sorted or grouped afterwards.
+   * @param attr[IN] attribute in the SELECT clause
+   * @param rf[IN] the record file of the table
+   * @param pid[IN] the first page to scan
+   * @param cond[IN] the conditions in the WHERE clause
+   * @param skip[IN/OUT] # of matching tuples still to skip for OFFSET
+   * @param limit[IN] the largest # of tuples to pass on. -1 for no limit
+   * @param count[IN/OUT] # of matching tuples passed on
+   * @param agg[IN/OUT] the running state of the aggregate
+   * @param sorter[IN] the sorter for ORDER BY. NULL if there is no sort
+   * @param grouper[IN] the hash aggregation for GROUP BY. NULL if not grouped
+   * @return error code. 0 if no error
+   */
+  static RC parallelScan(int attr, const RecordFile& rf, PageId pid,
+                         const std::vector<SelCond>& cond, int& skip, int limit,
+                         int& count, AggState& agg, TupleSorter* sorter,
+                         HashAggregator* grouper);
+
+  /**
+   * print the result of the aggregate in the SELECT clause (attr 4 - 10).
+   * @param attr[IN] attribute in the SELECT clause
+   * @param agg[IN] the state of the aggregate after the last tuple
+   */
+  static void printAggregate(int attr, const AggState& agg);
+
+  /**
+   * print the groups of "GROUP BY value" within OFFSET and LIMIT.
+   * @param attr[IN] attribute in the SELECT clause. 2 for the distinct
+   * values, or the aggregate of each group
+   * @param opts[IN] GROUP BY, ORDER BY, LIMIT and OFFSET of the query
+   * @param grouper[IN] the hash aggregation of the matching tuples
+   * @return error code. 0 if no error
+   */
+  static RC printGroups(int attr, const SelOpts& opts, HashAggregator& grouper);
+
+  /**
+   * create the sorter for ORDER BY unless the scan returns the tuples
+   * in order already. while sorting, OFFSET and LIMIT are applied
+   * to the sorted result, so skip and limit of the scan are reset.
+   * @param attr[IN] attribute in the SELECT clause
+   * @param opts[IN] ORDER BY, LIMIT and OFFSET of the query
+   * @param inOrder[IN] true if the scan returns the tuples in the ORDER BY order
+   * @param sorter[OUT] the new sorter. unchanged if no sort is needed
+   * @param skip[IN/OUT] # of tuples the scan skips for OFFSET
+   * @param limit[IN/OUT] max # of tuples the scan returns
+   */
+  static void startSort(int attr, const SelOpts& opts, bool inOrder, TupleSorter*& sorter, int& skip, int& limit);
+
+  /**
+   * print the sorted tuples within OFFSET and LIMIT.
+   * @param attr[IN] attribute in the SELECT clause
+   * @param opts[IN] ORDER BY, LIMIT and OFFSET of the query
+   * @param sorter[IN] the sorter holding the matching tuples
+   * @return error code. 0 if no error
+   */
+  static RC printSorted(int attr, const SelOpts& opts, TupleSorter& sorter);
+
 };
 
 #endif /* SQLENGINE_H */
@@ -1,14 +1,14 @@
-/* A Bison parser, made by GNU Bison 2.3.  */
+/* A Bison parser, made by GNU Bison 3.8.2.  */
 
-/* Skeleton implementation for Bison's Yacc-like parsers in C
+/* Bison implementation for Yacc-like parsers in C
 
-   Copyright (C) 1984, 1989, 1990, 2000, 2001, 2002, 2003, 2004, 2005, 2006
-   Free Software Foundation, Inc.
+   Copyright (C) 1984, 1989-1990, 2000-2015, 2018-2021 Free Software Foundation,
+   Inc.
 
-   This program is free software; you can redistribute it and/or modify
+   This program is free software: you can redistribute it and/or modify
    it under the terms of the GNU General Public License as published by
-   the Free Software Foundation; either version 2, or (at your option)
-   any later version.
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
 
    This program is distributed in the hope that it will be useful,
    but WITHOUT ANY WARRANTY; without even the implied warranty of
@@ -16,9 +16,7 @@
    GNU General Public License for more details.
 
    You should have received a copy of the GNU General Public License
-   along with this program; if not, write to the Free Software
-   Foundation, Inc., 51 Franklin Street, Fifth Floor,
-   Boston, MA 02110-1301, USA.  */
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
 
 /* As a special exception, you may create a larger work that contains
    part or all of the Bison parser skeleton and distribute that work
@@ -36,6 +34,10 @@
 /* C LALR(1) parser skeleton written by Richard Stallman, by
    simplifying the original so-called "semantic" parser.  */
 
+/* DO NOT RELY ON FEATURES THAT ARE NOT DOCUMENTED in the manual,
+   especially those whose name start with YY_ or yy_.  They are
+   private implementation details that can be changed or removed.  */
+
 /* All symbols defined below should begin with yy or YY, to avoid
    infringing on user name space.  This should be done even for local
    variables, as they might otherwise be expanded by user macros.
@@ -43,11 +45,11 @@
    define necessary library symbols; they are noted "INFRINGES ON
    USER NAME SPACE" below.  */
 
-/* Identify Bison output.  */
-#define YYBISON 1
+/* Identify Bison output, and Bison version.  */
+#define YYBISON 30802
 
-/* Bison version.  */
-#define YYBISON_VERSION "2.3"
+/* Bison version string.  */
+#define YYBISON_VERSION "3.8.2"
 
 /* Skeleton name.  */
 #define YYSKELETON_NAME "yacc.c"
@@ -55,82 +57,29 @@
 /* Pure parsers.  */
 #define YYPURE 0
 
-/* Using locations.  */
-#define YYLSP_NEEDED 0
+/* Push parsers.  */
+#define YYPUSH 0
+
+/* Pull parsers.  */
+#define YYPULL 1
+
 
 /* Substitute the variable and function names.  */
-#define yyparse sqlparse
-#define yylex   sqllex
-#define yyerror sqlerror
-#define yylval  sqllval
-#define yychar  sqlchar
-#define yydebug sqldebug
-#define yynerrs sqlnerrs
-
-
-/* Tokens.  */
-#ifndef YYTOKENTYPE
-# define YYTOKENTYPE
-   /* Put the tokens into the symbol table, so that GDB and other debuggers
-      know about them.  */
-   enum yytokentype {
-     SELECT = 258,
-     FROM = 259,
-     WHERE = 260,
-     LOAD = 261,
-     WITH = 262,
-     INDEX = 263,
-     QUIT = 264,
-     COUNT = 265,
-     AND = 266,
-     OR = 267,
-     COMMA = 268,
-     STAR = 269,
-     LF = 270,
-     INTEGER = 271,
-     STRING = 272,
-     ID = 273,
-     EQUAL = 274,
-     NEQUAL = 275,
-     LESS = 276,
-     LESSEQUAL = 277,
-     GREATER = 278,
-     GREATEREQUAL = 279
-   };
-#endif
-/* Tokens.  */
-#define SELECT 258
-#define FROM 259
-#define WHERE 260
-#define LOAD 261
-#define WITH 262
-#define INDEX 263
-#define QUIT 264
-#define COUNT 265
-#define AND 266
-#define OR 267
-#define COMMA 268
-#define STAR 269
-#define LF 270
-#define INTEGER 271
-#define STRING 272
-#define ID 273
-#define EQUAL 274
-#define NEQUAL 275
-#define LESS 276
-#define LESSEQUAL 277
-#define GREATER 278
-#define GREATEREQUAL 279
-
-
-
-
-/* Copy the first part of user declarations.  */
+#define yyparse         sqlparse
+#define yylex           sqllex
+#define yyerror         sqlerror
+#define yydebug         sqldebug
+#define yynerrs         sqlnerrs
+#define yylval          sqllval
+#define yychar          sqlchar
+
+/* First part of user prologue.  */
 #line 1 "SqlParser.y"
 
 #include <cstdio>
 #include <cstring>
 #include <sys/times.h>
+#include <unistd.h>
 #include <climits>
 #include <string>
 #include "Bruinbase.h"
@@ -141,95 +90,304 @@ int  sqllex(void);
 void sqlerror(const char *str) { fprintf(stderr, "Error: %s\n", str); }
 extern "C" { int  sqlwrap() { return 1; } }
 
-static void runSelect(int attr, const char* table, const std::vector<SelCond>& conds)
-{
-  struct tms tmsbuf;
-  clock_t btime, etime;
-  int     bpagecnt, epagecnt;
+static struct tms tmsbuf;
+static clock_t btime;
+static int     bpagecnt;
 
+static void startTimer()
+{
   btime = times(&tmsbuf);
   bpagecnt = PageFile::getPageReadCount();
-  SqlEngine::select(attr, table, conds);
-  etime = times(&tmsbuf);
-  epagecnt = PageFile::getPageReadCount();
+}
+
+static void stopTimer()
+{
+  clock_t etime = times(&tmsbuf);
+  int     epagecnt = PageFile::getPageReadCount();
 
   fprintf(stderr, "  -- %.3f seconds to run the select command. Read %d pages\n", ((float)(etime - btime))/sysconf(_SC_CLK_TCK), epagecnt - bpagecnt);
 }
 
+static void runSelect(int attr, const char* table, const std::vector<SelCond>& conds, const SelOpts& opts)
+{
+  startTimer();
+  SqlEngine::select(attr, table, conds, opts);
+  stopTimer();
+}
 
+static void runJoin(int attr, const std::vector<SelAttr>& attrs, const char* table1,
+                    const char* table2, const std::vector<SelCond>& conds, const SelOpts& opts)
+{
+  startTimer();
+  SqlEngine::join(attr, attrs, table1, table2, conds, opts);
+  stopTimer();
+}
 
-/* Enabling traces.  */
-#ifndef YYDEBUG
-# define YYDEBUG 0
-#endif
+static void runLoad(const char* table, const char* loadfile, int flags)
+{
+  LoadOpts opts;
+  opts.index = (flags & 1) != 0;
+  opts.valueIndex = (flags & 2) != 0;
+  opts.compressed = (flags & 4) != 0;
+  opts.clustered = (flags & 8) != 0;
+  opts.append = (flags & 16) != 0;
+  opts.lsm = (flags & 32) != 0;
+  SqlEngine::load(std::string(table), std::string(loadfile), opts);
+}
 
-/* Enabling verbose error messages.  */
-#ifdef YYERROR_VERBOSE
-# undef YYERROR_VERBOSE
-# define YYERROR_VERBOSE 1
-#else
-# define YYERROR_VERBOSE 0
-#endif
+static void freeConds(std::vector<SelCond>* conds)
+{
+  for (unsigned i = 0; i < conds->size(); i++) {
+    free((*conds)[i].value);
+    free((*conds)[i].table);
+    free((*conds)[i].joinTable);
+    delete (*conds)[i].ranges;
+  }
+  delete conds;
+}
 
-/* Enabling the token table.  */
-#ifndef YYTOKEN_TABLE
-# define YYTOKEN_TABLE 0
-#endif
+static SelCond makeCond(int attr, SelCond::Comparator comp, char* value)
+{
+  SelCond c;
+  c.attr = attr;
+  c.comp = comp;
+  c.value = value;
+  c.table = NULL;
+  c.joinTable = NULL;
+  c.joinAttr = 0;
+  c.ranges = NULL;
+  return c;
+}
 
-#if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
-typedef union YYSTYPE
-#line 32 "SqlParser.y"
+// the key ranges that satisfy one of the conjunctions in a chain of ORs.
+// NULL if a condition is not on the key of the table
+static std::vector<KeyRange>* makeRanges(std::vector<SelCond>* conds)
 {
-  int integer;
-  char* string;
-  SelCond* cond;
-  std::vector<SelCond>* conds;
+  std::vector<KeyRange>* ranges = NULL;
+  for (unsigned i = 0; i < conds->size(); i++) {
+    const SelCond& c = (*conds)[i];
+    if (c.attr != 1 || c.table != NULL || c.joinTable != NULL) {
+      freeConds(conds);
+      return NULL;
+    }
+  }
+  ranges = new std::vector<KeyRange>;
+  SqlEngine::keyRanges(*conds, *ranges);
+  freeConds(conds);
+  return ranges;
 }
-/* Line 187 of yacc.c.  */
+
+static void freeAttrs(std::vector<SelAttr>* attrs)
+{
+  for (unsigned i = 0; i < attrs->size(); i++) {
+    free((*attrs)[i].table);
+  }
+  delete attrs;
+}
+
+
 #line 190 "SqlParser.tab.c"
-	YYSTYPE;
-# define yystype YYSTYPE /* obsolescent; will be withdrawn */
-# define YYSTYPE_IS_DECLARED 1
-# define YYSTYPE_IS_TRIVIAL 1
-#endif
 
+# ifndef YY_CAST
+#  ifdef __cplusplus
+#   define YY_CAST(Type, Val) static_cast<Type> (Val)
+#   define YY_REINTERPRET_CAST(Type, Val) reinterpret_cast<Type> (Val)
+#  else
+#   define YY_CAST(Type, Val) ((Type) (Val))
+#   define YY_REINTERPRET_CAST(Type, Val) ((Type) (Val))
+#  endif
+# endif
+# ifndef YY_NULLPTR
+#  if defined __cplusplus
+#   if 201103L <= __cplusplus
+#    define YY_NULLPTR nullptr
+#   else
+#    define YY_NULLPTR 0
+#   endif
+#  else
+#   define YY_NULLPTR ((void*)0)
+#  endif
+# endif
 
+#include "SqlParser.tab.h"
+/* Symbol kind.  */
+enum yysymbol_kind_t
+{
+  YYSYMBOL_YYEMPTY = -2,
+  YYSYMBOL_YYEOF = 0,                      /* "end of file"  */
+  YYSYMBOL_YYerror = 1,                    /* error  */
+  YYSYMBOL_YYUNDEF = 2,                    /* "invalid token"  */
+  YYSYMBOL_SELECT = 3,                     /* SELECT  */
+  YYSYMBOL_FROM = 4,                       /* FROM  */
+  YYSYMBOL_WHERE = 5,                      /* WHERE  */
+  YYSYMBOL_LOAD = 6,                       /* LOAD  */
+  YYSYMBOL_APPEND = 7,                     /* APPEND  */
+  YYSYMBOL_WITH = 8,                       /* WITH  */
+  YYSYMBOL_INDEX = 9,                      /* INDEX  */
+  YYSYMBOL_CREATE = 10,                    /* CREATE  */
+  YYSYMBOL_ON = 11,                        /* ON  */
+  YYSYMBOL_CLUSTERED = 12,                 /* CLUSTERED  */
+  YYSYMBOL_OPTIMIZE = 13,                  /* OPTIMIZE  */
+  YYSYMBOL_TABLE = 14,                     /* TABLE  */
+  YYSYMBOL_REINDEX = 15,                   /* REINDEX  */
+  YYSYMBOL_FILLFACTOR = 16,                /* FILLFACTOR  */
+  YYSYMBOL_ANALYZE = 17,                   /* ANALYZE  */
+  YYSYMBOL_QUIT = 18,                      /* QUIT  */
+  YYSYMBOL_COUNT = 19,                     /* COUNT  */
+  YYSYMBOL_AND = 20,                       /* AND  */
+  YYSYMBOL_OR = 21,                        /* OR  */
+  YYSYMBOL_LIMIT = 22,                     /* LIMIT  */
+  YYSYMBOL_OFFSET = 23,                    /* OFFSET  */
+  YYSYMBOL_ORDER = 24,                     /* ORDER  */
+  YYSYMBOL_GROUP = 25,                     /* GROUP  */
+  YYSYMBOL_BY = 26,                        /* BY  */
+  YYSYMBOL_ASC = 27,                       /* ASC  */
+  YYSYMBOL_DESC = 28,                      /* DESC  */
+  YYSYMBOL_MIN = 29,                       /* MIN  */
+  YYSYMBOL_MAX = 30,                       /* MAX  */
+  YYSYMBOL_SUM = 31,                       /* SUM  */
+  YYSYMBOL_AVG = 32,                       /* AVG  */
+  YYSYMBOL_BETWEEN = 33,                   /* BETWEEN  */
+  YYSYMBOL_IN = 34,                        /* IN  */
+  YYSYMBOL_COMMA = 35,                     /* COMMA  */
+  YYSYMBOL_STAR = 36,                      /* STAR  */
+  YYSYMBOL_LF = 37,                        /* LF  */
+  YYSYMBOL_LPAREN = 38,                    /* LPAREN  */
+  YYSYMBOL_RPAREN = 39,                    /* RPAREN  */
+  YYSYMBOL_INTEGER = 40,                   /* INTEGER  */
+  YYSYMBOL_STRING = 41,                    /* STRING  */
+  YYSYMBOL_ID = 42,                        /* ID  */
+  YYSYMBOL_QID = 43,                       /* QID  */
+  YYSYMBOL_EQUAL = 44,                     /* EQUAL  */
+  YYSYMBOL_NEQUAL = 45,                    /* NEQUAL  */
+  YYSYMBOL_LESS = 46,                      /* LESS  */
+  YYSYMBOL_LESSEQUAL = 47,                 /* LESSEQUAL  */
+  YYSYMBOL_GREATER = 48,                   /* GREATER  */
+  YYSYMBOL_GREATEREQUAL = 49,              /* GREATEREQUAL  */
+  YYSYMBOL_YYACCEPT = 50,                  /* $accept  */
+  YYSYMBOL_commands = 51,                  /* commands  */
+  YYSYMBOL_command = 52,                   /* command  */
+  YYSYMBOL_quit_command = 53,              /* quit_command  */
+  YYSYMBOL_load_command = 54,              /* load_command  */
+  YYSYMBOL_load_opts = 55,                 /* load_opts  */
+  YYSYMBOL_append_opt = 56,                /* append_opt  */
+  YYSYMBOL_index_list = 57,                /* index_list  */
+  YYSYMBOL_index_item = 58,                /* index_item  */
+  YYSYMBOL_create_command = 59,            /* create_command  */
+  YYSYMBOL_optimize_command = 60,          /* optimize_command  */
+  YYSYMBOL_reindex_command = 61,           /* reindex_command  */
+  YYSYMBOL_analyze_command = 62,           /* analyze_command  */
+  YYSYMBOL_select_command = 63,            /* select_command  */
+  YYSYMBOL_select_opts = 64,               /* select_opts  */
+  YYSYMBOL_group_clause = 65,              /* group_clause  */
+  YYSYMBOL_order_clause = 66,              /* order_clause  */
+  YYSYMBOL_order_dir = 67,                 /* order_dir  */
+  YYSYMBOL_limit_clause = 68,              /* limit_clause  */
+  YYSYMBOL_conditions = 69,                /* conditions  */
+  YYSYMBOL_key_ranges = 70,                /* key_ranges  */
+  YYSYMBOL_conjunction = 71,               /* conjunction  */
+  YYSYMBOL_predicate = 72,                 /* predicate  */
+  YYSYMBOL_key_list = 73,                  /* key_list  */
+  YYSYMBOL_condition = 74,                 /* condition  */
+  YYSYMBOL_qattributes = 75,               /* qattributes  */
+  YYSYMBOL_qattribute = 76,                /* qattribute  */
+  YYSYMBOL_attributes = 77,                /* attributes  */
+  YYSYMBOL_aggregate = 78,                 /* aggregate  */
+  YYSYMBOL_attribute = 79,                 /* attribute  */
+  YYSYMBOL_value = 80,                     /* value  */
+  YYSYMBOL_table = 81,                     /* table  */
+  YYSYMBOL_comparator = 82                 /* comparator  */
+};
+typedef enum yysymbol_kind_t yysymbol_kind_t;
 
-/* Copy the second part of user declarations.  */
 
 
-/* Line 216 of yacc.c.  */
-#line 203 "SqlParser.tab.c"
 
 #ifdef short
 # undef short
 #endif
 
-#ifdef YYTYPE_UINT8
-typedef YYTYPE_UINT8 yytype_uint8;
-#else
-typedef unsigned char yytype_uint8;
+/* On compilers that do not define __PTRDIFF_MAX__ etc., make sure
+   <limits.h> and (if available) <stdint.h> are included
+   so that the code can choose integer types of a good width.  */
+
+#ifndef __PTRDIFF_MAX__
+# include <limits.h> /* INFRINGES ON USER NAME SPACE */
+# if defined __STDC_VERSION__ && 199901 <= __STDC_VERSION__
+#  include <stdint.h> /* INFRINGES ON USER NAME SPACE */
+#  define YY_STDINT_H
+# endif
 #endif
 
-#ifdef YYTYPE_INT8
-typedef YYTYPE_INT8 yytype_int8;
-#elif (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
+/* Narrow types that promote to a signed type and that can represent a
+   signed or unsigned integer of at least N bits.  In tables they can
+   save space and decrease cache pressure.  Promoting to a signed type
+   helps avoid bugs in integer arithmetic.  */
+
+#ifdef __INT_LEAST8_MAX__
+typedef __INT_LEAST8_TYPE__ yytype_int8;
+#elif defined YY_STDINT_H
+typedef int_least8_t yytype_int8;
+#else
 typedef signed char yytype_int8;
+#endif
+
+#ifdef __INT_LEAST16_MAX__
+typedef __INT_LEAST16_TYPE__ yytype_int16;
+#elif defined YY_STDINT_H
+typedef int_least16_t yytype_int16;
 #else
-typedef short int yytype_int8;
+typedef short yytype_int16;
+#endif
+
+/* Work around bug in HP-UX 11.23, which defines these macros
+   incorrectly for preprocessor constants.  This workaround can likely
+   be removed in 2023, as HPE has promised support for HP-UX 11.23
+   (aka HP-UX 11i v2) only through the end of 2022; see Table 2 of
+   <https://h20195.www2.hpe.com/V2/getpdf.aspx/4AA4-7673ENW.pdf>.  */
+#ifdef __hpux
+# undef UINT_LEAST8_MAX
+# undef UINT_LEAST16_MAX
+# define UINT_LEAST8_MAX 255
+# define UINT_LEAST16_MAX 65535
 #endif
 
-#ifdef YYTYPE_UINT16
-typedef YYTYPE_UINT16 yytype_uint16;
+#if defined __UINT_LEAST8_MAX__ && __UINT_LEAST8_MAX__ <= __INT_MAX__
+typedef __UINT_LEAST8_TYPE__ yytype_uint8;
+#elif (!defined __UINT_LEAST8_MAX__ && defined YY_STDINT_H \
+       && UINT_LEAST8_MAX <= INT_MAX)
+typedef uint_least8_t yytype_uint8;
+#elif !defined __UINT_LEAST8_MAX__ && UCHAR_MAX <= INT_MAX
+typedef unsigned char yytype_uint8;
 #else
-typedef unsigned short int yytype_uint16;
+typedef short yytype_uint8;
 #endif
 
-#ifdef YYTYPE_INT16
-typedef YYTYPE_INT16 yytype_int16;
+#if defined __UINT_LEAST16_MAX__ && __UINT_LEAST16_MAX__ <= __INT_MAX__
+typedef __UINT_LEAST16_TYPE__ yytype_uint16;
+#elif (!defined __UINT_LEAST16_MAX__ && defined YY_STDINT_H \
+       && UINT_LEAST16_MAX <= INT_MAX)
+typedef uint_least16_t yytype_uint16;
+#elif !defined __UINT_LEAST16_MAX__ && USHRT_MAX <= INT_MAX
+typedef unsigned short yytype_uint16;
 #else
-typedef short int yytype_int16;
+typedef int yytype_uint16;
+#endif
+
+#ifndef YYPTRDIFF_T
+# if defined __PTRDIFF_TYPE__ && defined __PTRDIFF_MAX__
+#  define YYPTRDIFF_T __PTRDIFF_TYPE__
+#  define YYPTRDIFF_MAXIMUM __PTRDIFF_MAX__
+# elif defined PTRDIFF_MAX
+#  ifndef ptrdiff_t
+#   include <stddef.h> /* INFRINGES ON USER NAME SPACE */
+#  endif
+#  define YYPTRDIFF_T ptrdiff_t
+#  define YYPTRDIFF_MAXIMUM PTRDIFF_MAX
+# else
+#  define YYPTRDIFF_T long
+#  define YYPTRDIFF_MAXIMUM LONG_MAX
+# endif
 #endif
 
 #ifndef YYSIZE_T
@@ -237,55 +395,106 @@ typedef short int yytype_int16;
 #  define YYSIZE_T __SIZE_TYPE__
 # elif defined size_t
 #  define YYSIZE_T size_t
-# elif ! defined YYSIZE_T && (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
+# elif defined __STDC_VERSION__ && 199901 <= __STDC_VERSION__
 #  include <stddef.h> /* INFRINGES ON USER NAME SPACE */
 #  define YYSIZE_T size_t
 # else
-#  define YYSIZE_T unsigned int
+#  define YYSIZE_T unsigned
 # endif
 #endif
 
-#define YYSIZE_MAXIMUM ((YYSIZE_T) -1)
+#define YYSIZE_MAXIMUM                                  \
+  YY_CAST (YYPTRDIFF_T,                                 \
+           (YYPTRDIFF_MAXIMUM < YY_CAST (YYSIZE_T, -1)  \
+            ? YYPTRDIFF_MAXIMUM                         \
+            : YY_CAST (YYSIZE_T, -1)))
+
+#define YYSIZEOF(X) YY_CAST (YYPTRDIFF_T, sizeof (X))
+
+
+/* Stored state numbers (used for stacks). */
+typedef yytype_uint8 yy_state_t;
+
+/* State numbers in computations.  */
+typedef int yy_state_fast_t;
 
 #ifndef YY_
-# if YYENABLE_NLS
+# if defined YYENABLE_NLS && YYENABLE_NLS
 #  if ENABLE_NLS
 #   include <libintl.h> /* INFRINGES ON USER NAME SPACE */
-#   define YY_(msgid) dgettext ("bison-runtime", msgid)
+#   define YY_(Msgid) dgettext ("bison-runtime", Msgid)
 #  endif
 # endif
 # ifndef YY_
-#  define YY_(msgid) msgid
+#  define YY_(Msgid) Msgid
+# endif
+#endif
+
+
+#ifndef YY_ATTRIBUTE_PURE
+# if defined __GNUC__ && 2 < __GNUC__ + (96 <= __GNUC_MINOR__)
+#  define YY_ATTRIBUTE_PURE __attribute__ ((__pure__))
+# else
+#  define YY_ATTRIBUTE_PURE
+# endif
+#endif
+
+#ifndef YY_ATTRIBUTE_UNUSED
+# if defined __GNUC__ && 2 < __GNUC__ + (7 <= __GNUC_MINOR__)
+#  define YY_ATTRIBUTE_UNUSED __attribute__ ((__unused__))
+# else
+#  define YY_ATTRIBUTE_UNUSED
 # endif
 #endif
 
 /* Suppress unused-variable warnings by "using" E.  */
 #if ! defined lint || defined __GNUC__
-# define YYUSE(e) ((void) (e))
+# define YY_USE(E) ((void) (E))
 #else
-# define YYUSE(e) /* empty */
+# define YY_USE(E) /* empty */
 #endif
 
-/* Identity function, used to suppress warnings about constant conditions.  */
-#ifndef lint
-# define YYID(n) (n)
-#else
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
-static int
-YYID (int i)
+/* Suppress an incorrect diagnostic about yylval being uninitialized.  */
+#if defined __GNUC__ && ! defined __ICC && 406 <= __GNUC__ * 100 + __GNUC_MINOR__
+# if __GNUC__ * 100 + __GNUC_MINOR__ < 407
+#  define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN                           \
+    _Pragma ("GCC diagnostic push")                                     \
+    _Pragma ("GCC diagnostic ignored \"-Wuninitialized\"")
+# else
+#  define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN                           \
+    _Pragma ("GCC diagnostic push")                                     \
+    _Pragma ("GCC diagnostic ignored \"-Wuninitialized\"")              \
+    _Pragma ("GCC diagnostic ignored \"-Wmaybe-uninitialized\"")
+# endif
+# define YY_IGNORE_MAYBE_UNINITIALIZED_END      \
+    _Pragma ("GCC diagnostic pop")
 #else
-static int
-YYID (i)
-    int i;
+# define YY_INITIAL_VALUE(Value) Value
 #endif
-{
-  return i;
-}
+#ifndef YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+# define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+# define YY_IGNORE_MAYBE_UNINITIALIZED_END
+#endif
+#ifndef YY_INITIAL_VALUE
+# define YY_INITIAL_VALUE(Value) /* Nothing. */
+#endif
+
+#if defined __cplusplus && defined __GNUC__ && ! defined __ICC && 6 <= __GNUC__
+# define YY_IGNORE_USELESS_CAST_BEGIN                          \
+    _Pragma ("GCC diagnostic push")                            \
+    _Pragma ("GCC diagnostic ignored \"-Wuseless-cast\"")
+# define YY_IGNORE_USELESS_CAST_END            \
+    _Pragma ("GCC diagnostic pop")
+#endif
+#ifndef YY_IGNORE_USELESS_CAST_BEGIN
+# define YY_IGNORE_USELESS_CAST_BEGIN
+# define YY_IGNORE_USELESS_CAST_END
 #endif
 
-#if ! defined yyoverflow || YYERROR_VERBOSE
+
+#define YY_ASSERT(E) ((void) (0 && (E)))
+
+#if !defined yyoverflow
 
 /* The parser invokes alloca or malloc; define the necessary symbols.  */
 
@@ -302,11 +511,11 @@ YYID (i)
 #    define alloca _alloca
 #   else
 #    define YYSTACK_ALLOC alloca
-#    if ! defined _ALLOCA_H && ! defined _STDLIB_H && (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
+#    if ! defined _ALLOCA_H && ! defined EXIT_SUCCESS
 #     include <stdlib.h> /* INFRINGES ON USER NAME SPACE */
-#     ifndef _STDLIB_H
-#      define _STDLIB_H 1
+      /* Use EXIT_SUCCESS as a witness for stdlib.h.  */
+#     ifndef EXIT_SUCCESS
+#      define EXIT_SUCCESS 0
 #     endif
 #    endif
 #   endif
@@ -314,8 +523,8 @@ YYID (i)
 # endif
 
 # ifdef YYSTACK_ALLOC
-   /* Pacify GCC's `empty if-body' warning.  */
-#  define YYSTACK_FREE(Ptr) do { /* empty */; } while (YYID (0))
+   /* Pacify GCC's 'empty if-body' warning.  */
+#  define YYSTACK_FREE(Ptr) do { /* empty */; } while (0)
 #  ifndef YYSTACK_ALLOC_MAXIMUM
     /* The OS might guarantee only one guard page at the bottom of the stack,
        and a page size can be as small as 4096 bytes.  So we cannot safely
@@ -329,111 +538,117 @@ YYID (i)
 #  ifndef YYSTACK_ALLOC_MAXIMUM
 #   define YYSTACK_ALLOC_MAXIMUM YYSIZE_MAXIMUM
 #  endif
-#  if (defined __cplusplus && ! defined _STDLIB_H \
+#  if (defined __cplusplus && ! defined EXIT_SUCCESS \
        && ! ((defined YYMALLOC || defined malloc) \
-	     && (defined YYFREE || defined free)))
+             && (defined YYFREE || defined free)))
 #   include <stdlib.h> /* INFRINGES ON USER NAME SPACE */
-#   ifndef _STDLIB_H
-#    define _STDLIB_H 1
+#   ifndef EXIT_SUCCESS
+#    define EXIT_SUCCESS 0
 #   endif
 #  endif
 #  ifndef YYMALLOC
 #   define YYMALLOC malloc
-#   if ! defined malloc && ! defined _STDLIB_H && (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
+#   if ! defined malloc && ! defined EXIT_SUCCESS
 void *malloc (YYSIZE_T); /* INFRINGES ON USER NAME SPACE */
 #   endif
 #  endif
 #  ifndef YYFREE
 #   define YYFREE free
-#   if ! defined free && ! defined _STDLIB_H && (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
+#   if ! defined free && ! defined EXIT_SUCCESS
 void free (void *); /* INFRINGES ON USER NAME SPACE */
 #   endif
 #  endif
 # endif
-#endif /* ! defined yyoverflow || YYERROR_VERBOSE */
-
+#endif /* !defined yyoverflow */
 
 #if (! defined yyoverflow \
      && (! defined __cplusplus \
-	 || (defined YYSTYPE_IS_TRIVIAL && YYSTYPE_IS_TRIVIAL)))
+         || (defined YYSTYPE_IS_TRIVIAL && YYSTYPE_IS_TRIVIAL)))
 
 /* A type that is properly aligned for any stack member.  */
 union yyalloc
 {
-  yytype_int16 yyss;
-  YYSTYPE yyvs;
-  };
+  yy_state_t yyss_alloc;
+  YYSTYPE yyvs_alloc;
+};
 
 /* The size of the maximum gap between one aligned stack and the next.  */
-# define YYSTACK_GAP_MAXIMUM (sizeof (union yyalloc) - 1)
+# define YYSTACK_GAP_MAXIMUM (YYSIZEOF (union yyalloc) - 1)
 
 /* The size of an array large to enough to hold all stacks, each with
    N elements.  */
 # define YYSTACK_BYTES(N) \
-     ((N) * (sizeof (yytype_int16) + sizeof (YYSTYPE)) \
+     ((N) * (YYSIZEOF (yy_state_t) + YYSIZEOF (YYSTYPE)) \
       + YYSTACK_GAP_MAXIMUM)
 
-/* Copy COUNT objects from FROM to TO.  The source and destination do
-   not overlap.  */
-# ifndef YYCOPY
-#  if defined __GNUC__ && 1 < __GNUC__
-#   define YYCOPY(To, From, Count) \
-      __builtin_memcpy (To, From, (Count) * sizeof (*(From)))
-#  else
-#   define YYCOPY(To, From, Count)		\
-      do					\
-	{					\
-	  YYSIZE_T yyi;				\
-	  for (yyi = 0; yyi < (Count); yyi++)	\
-	    (To)[yyi] = (From)[yyi];		\
-	}					\
-      while (YYID (0))
-#  endif
-# endif
+# define YYCOPY_NEEDED 1
 
 /* Relocate STACK from its old location to the new one.  The
    local variables YYSIZE and YYSTACKSIZE give the old and new number of
    elements in the stack, and YYPTR gives the new location of the
    stack.  Advance YYPTR to a properly aligned location for the next
    stack.  */
-# define YYSTACK_RELOCATE(Stack)					\
-    do									\
-      {									\
-	YYSIZE_T yynewbytes;						\
-	YYCOPY (&yyptr->Stack, Stack, yysize);				\
-	Stack = &yyptr->Stack;						\
-	yynewbytes = yystacksize * sizeof (*Stack) + YYSTACK_GAP_MAXIMUM; \
-	yyptr += yynewbytes / sizeof (*yyptr);				\
-      }									\
-    while (YYID (0))
+# define YYSTACK_RELOCATE(Stack_alloc, Stack)                           \
+    do                                                                  \
+      {                                                                 \
+        YYPTRDIFF_T yynewbytes;                                         \
+        YYCOPY (&yyptr->Stack_alloc, Stack, yysize);                    \
+        Stack = &yyptr->Stack_alloc;                                    \
+        yynewbytes = yystacksize * YYSIZEOF (*Stack) + YYSTACK_GAP_MAXIMUM; \
+        yyptr += yynewbytes / YYSIZEOF (*yyptr);                        \
+      }                                                                 \
+    while (0)
 
 #endif
 
+#if defined YYCOPY_NEEDED && YYCOPY_NEEDED
+/* Copy COUNT objects from SRC to DST.  The source and destination do
+   not overlap.  */
+# ifndef YYCOPY
+#  if defined __GNUC__ && 1 < __GNUC__
+#   define YYCOPY(Dst, Src, Count) \
+      __builtin_memcpy (Dst, Src, YY_CAST (YYSIZE_T, (Count)) * sizeof (*(Src)))
+#  else
+#   define YYCOPY(Dst, Src, Count)              \
+      do                                        \
+        {                                       \
+          YYPTRDIFF_T yyi;                      \
+          for (yyi = 0; yyi < (Count); yyi++)   \
+            (Dst)[yyi] = (Src)[yyi];            \
+        }                                       \
+      while (0)
+#  endif
+# endif
+#endif /* !YYCOPY_NEEDED */
+
 /* YYFINAL -- State number of the termination state.  */
 #define YYFINAL  2
 /* YYLAST -- Last index in YYTABLE.  */
-#define YYLAST   33
+#define YYLAST   157
 
 /* YYNTOKENS -- Number of terminals.  */
-#define YYNTOKENS  25
+#define YYNTOKENS  50
 /* YYNNTS -- Number of nonterminals.  */
-#define YYNNTS  13
+#define YYNNTS  33
 /* YYNRULES -- Number of rules.  */
-#define YYNRULES  29
-/* YYNRULES -- Number of states.  */
-#define YYNSTATES  46
+#define YYNRULES  82
+/* YYNSTATES -- Number of states.  */
+#define YYNSTATES  163
+
+/* YYMAXUTOK -- Last valid token kind.  */
+#define YYMAXUTOK   304
 
-/* YYTRANSLATE(YYLEX) -- Bison symbol number corresponding to YYLEX.  */
-#define YYUNDEFTOK  2
-#define YYMAXUTOK   279
 
-#define YYTRANSLATE(YYX)						\
-  ((unsigned int) (YYX) <= YYMAXUTOK ? yytranslate[YYX] : YYUNDEFTOK)
+/* YYTRANSLATE(TOKEN-NUM) -- Symbol number corresponding to TOKEN-NUM
+   as returned by yylex, with out-of-bounds checking.  */
+#define YYTRANSLATE(YYX)                                \
+  (0 <= (YYX) && (YYX) <= YYMAXUTOK                     \
+   ? YY_CAST (yysymbol_kind_t, yytranslate[YYX])        \
+   : YYSYMBOL_YYUNDEF)
 
-/* YYTRANSLATE[YYLEX] -- Bison symbol number corresponding to YYLEX.  */
-static const yytype_uint8 yytranslate[] =
+/* YYTRANSLATE[TOKEN-NUM] -- Symbol number corresponding to TOKEN-NUM
+   as returned by yylex.  */
+static const yytype_int8 yytranslate[] =
 {
        0,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
@@ -462,242 +677,267 @@ static const yytype_uint8 yytranslate[] =
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     1,     2,     3,     4,
        5,     6,     7,     8,     9,    10,    11,    12,    13,    14,
-      15,    16,    17,    18,    19,    20,    21,    22,    23,    24
+      15,    16,    17,    18,    19,    20,    21,    22,    23,    24,
+      25,    26,    27,    28,    29,    30,    31,    32,    33,    34,
+      35,    36,    37,    38,    39,    40,    41,    42,    43,    44,
+      45,    46,    47,    48,    49
 };
 
 #if YYDEBUG
-/* YYPRHS[YYN] -- Index of the first RHS symbol of rule number YYN in
-   YYRHS.  */
-static const yytype_uint8 yyprhs[] =
+/* YYRLINE[YYN] -- Source line where rule number YYN was defined.  */
+static const yytype_int16 yyrline[] =
 {
-       0,     0,     3,     6,     7,     9,    11,    13,    16,    18,
-      20,    26,    34,    40,    48,    50,    54,    58,    60,    62,
-      64,    66,    68,    70,    72,    74,    76,    78,    80,    82
+       0,   143,   143,   144,   148,   149,   150,   151,   152,   153,
+     154,   155,   156,   160,   164,   169,   180,   181,   182,   183,
+     188,   189,   193,   194,   200,   201,   212,   219,   226,   230,
+     238,   245,   251,   257,   266,   274,   282,   293,   304,   305,
+     309,   315,   324,   325,   326,   330,   336,   344,   358,   359,
+     373,   377,   387,   388,   396,   402,   408,   420,   426,   436,
+     446,   457,   473,   479,   487,   501,   502,   503,   504,   512,
+     513,   514,   515,   519,   527,   528,   532,   536,   537,   538,
+     539,   540,   541
 };
+#endif
 
-/* YYRHS -- A `-1'-separated list of the rules' RHS.  */
-static const yytype_int8 yyrhs[] =
-{
-      26,     0,    -1,    26,    27,    -1,    -1,    29,    -1,    30,
-      -1,    28,    -1,     1,    15,    -1,    15,    -1,     9,    -1,
-       6,    36,     4,    17,    15,    -1,     6,    36,     4,    17,
-       7,     8,    15,    -1,     3,    33,     4,    36,    15,    -1,
-       3,    33,     4,    36,     5,    31,    15,    -1,    32,    -1,
-      31,    11,    32,    -1,    34,    37,    35,    -1,    34,    -1,
-      14,    -1,    10,    -1,    18,    -1,    16,    -1,    17,    -1,
-      18,    -1,    19,    -1,    20,    -1,    21,    -1,    23,    -1,
-      22,    -1,    24,    -1
-};
+/** Accessing symbol of state STATE.  */
+#define YY_ACCESSING_SYMBOL(State) YY_CAST (yysymbol_kind_t, yystos[State])
 
-/* YYRLINE[YYN] -- source line where rule number YYN was defined.  */
-static const yytype_uint8 yyrline[] =
-{
-       0,    51,    51,    52,    56,    57,    58,    59,    60,    64,
-      68,    73,    81,    86,    97,   103,   111,   121,   122,   123,
-     127,   135,   136,   140,   144,   145,   146,   147,   148,   149
-};
-#endif
+#if YYDEBUG || 0
+/* The user-facing name of the symbol whose (internal) number is
+   YYSYMBOL.  No bounds checking.  */
+static const char *yysymbol_name (yysymbol_kind_t yysymbol) YY_ATTRIBUTE_UNUSED;
 
-#if YYDEBUG || YYERROR_VERBOSE || YYTOKEN_TABLE
 /* YYTNAME[SYMBOL-NUM] -- String name of the symbol SYMBOL-NUM.
    First, the terminals, then, starting at YYNTOKENS, nonterminals.  */
 static const char *const yytname[] =
 {
-  "$end", "error", "$undefined", "SELECT", "FROM", "WHERE", "LOAD",
-  "WITH", "INDEX", "QUIT", "COUNT", "AND", "OR", "COMMA", "STAR", "LF",
-  "INTEGER", "STRING", "ID", "EQUAL", "NEQUAL", "LESS", "LESSEQUAL",
-  "GREATER", "GREATEREQUAL", "$accept", "commands", "command",
-  "quit_command", "load_command", "select_command", "conditions",
-  "condition", "attributes", "attribute", "value", "table", "comparator", 0
+  "\"end of file\"", "error", "\"invalid token\"", "SELECT", "FROM",
+  "WHERE", "LOAD", "APPEND", "WITH", "INDEX", "CREATE", "ON", "CLUSTERED",
+  "OPTIMIZE", "TABLE", "REINDEX", "FILLFACTOR", "ANALYZE", "QUIT", "COUNT",
+  "AND", "OR", "LIMIT", "OFFSET", "ORDER", "GROUP", "BY", "ASC", "DESC",
+  "MIN", "MAX", "SUM", "AVG", "BETWEEN", "IN", "COMMA", "STAR", "LF",
+  "LPAREN", "RPAREN", "INTEGER", "STRING", "ID", "QID", "EQUAL", "NEQUAL",
+  "LESS", "LESSEQUAL", "GREATER", "GREATEREQUAL", "$accept", "commands",
+  "command", "quit_command", "load_command", "load_opts", "append_opt",
+  "index_list", "index_item", "create_command", "optimize_command",
+  "reindex_command", "analyze_command", "select_command", "select_opts",
+  "group_clause", "order_clause", "order_dir", "limit_clause",
+  "conditions", "key_ranges", "conjunction", "predicate", "key_list",
+  "condition", "qattributes", "qattribute", "attributes", "aggregate",
+  "attribute", "value", "table", "comparator", YY_NULLPTR
 };
-#endif
 
-# ifdef YYPRINT
-/* YYTOKNUM[YYLEX-NUM] -- Internal token number corresponding to
-   token YYLEX-NUM.  */
-static const yytype_uint16 yytoknum[] =
+static const char *
+yysymbol_name (yysymbol_kind_t yysymbol)
 {
-       0,   256,   257,   258,   259,   260,   261,   262,   263,   264,
-     265,   266,   267,   268,   269,   270,   271,   272,   273,   274,
-     275,   276,   277,   278,   279
-};
-# endif
+  return yytname[yysymbol];
+}
+#endif
+
+#define YYPACT_NINF (-104)
+
+#define yypact_value_is_default(Yyn) \
+  ((Yyn) == YYPACT_NINF)
+
+#define YYTABLE_NINF (-52)
 
-/* YYR1[YYN] -- Symbol number of symbol that rule YYN derives.  */
-static const yytype_uint8 yyr1[] =
+#define yytable_value_is_error(Yyn) \
+  0
+
+/* YYPACT[STATE-NUM] -- Index in YYTABLE of the portion describing
+   STATE-NUM.  */
+static const yytype_int8 yypact[] =
 {
-       0,    25,    26,    26,    27,    27,    27,    27,    27,    28,
-      29,    29,    30,    30,    31,    31,    32,    33,    33,    33,
-      34,    35,    35,    36,    37,    37,    37,    37,    37,    37
+    -104,     5,  -104,   -20,    42,   -23,    25,    10,   -23,   -23,
+    -104,  -104,  -104,  -104,  -104,  -104,  -104,  -104,  -104,  -104,
+    -104,  -104,  -104,  -104,  -104,  -104,  -104,  -104,  -104,     9,
+    -104,    61,    24,    34,  -104,    71,    66,   -23,    -7,    44,
+     -23,    36,   -23,    41,    57,   -15,   -23,    45,    50,  -104,
+    -104,    59,  -104,    11,    56,    92,  -104,    13,    13,    60,
+    -104,    64,   -23,     7,    82,   -23,    72,    73,  -104,   -23,
+       3,   102,   104,   104,    41,  -104,   114,    95,   100,    33,
+    -104,  -104,    69,    58,    41,   117,  -104,    97,   103,    23,
+    -104,   115,    91,  -104,     3,  -104,    90,    93,    89,     7,
+      94,     7,     7,    36,  -104,  -104,  -104,  -104,  -104,    15,
+      15,    96,  -104,    15,  -104,     7,    41,    98,  -104,     7,
+      99,  -104,     3,    91,  -104,  -104,   105,    95,  -104,    38,
+    -104,  -104,  -104,  -104,  -104,   109,   101,  -104,    95,    40,
+     110,    95,  -104,  -104,  -104,   106,    15,  -104,    -6,   107,
+    -104,  -104,  -104,   108,   112,  -104,  -104,   111,  -104,  -104,
+    -104,  -104,  -104
 };
 
-/* YYR2[YYN] -- Number of symbols composing right hand side of rule YYN.  */
-static const yytype_uint8 yyr2[] =
+/* YYDEFACT[STATE-NUM] -- Default reduction number in state STATE-NUM.
+   Performed when YYTABLE does not specify something else to do.  Zero
+   means the default is an error.  */
+static const yytype_int8 yydefact[] =
 {
-       0,     2,     2,     0,     1,     1,     1,     2,     1,     1,
-       5,     7,     5,     7,     1,     3,     3,     1,     1,     1,
-       1,     1,     1,     1,     1,     1,     1,     1,     1,     1
+       3,     0,     1,     0,     0,     0,     0,     0,     0,     0,
+      13,    12,     2,    10,     4,     5,     6,     7,     8,     9,
+      11,    67,    69,    70,    71,    72,    66,    73,    64,     0,
+      62,     0,     0,    65,    76,     0,     0,     0,     0,     0,
+       0,     0,     0,     0,     0,     0,     0,     0,     0,    28,
+      30,     0,    63,    38,     0,     0,    65,    16,    16,     0,
+      27,     0,     0,     0,     0,     0,     0,    40,    68,     0,
+       0,    18,    20,    20,     0,    29,     0,    38,     0,    48,
+      52,    54,     0,     0,     0,     0,    31,     0,    45,    38,
+      24,     0,    17,    22,     0,    21,     0,     0,     0,     0,
+       0,     0,     0,    77,    78,    79,    81,    80,    82,     0,
+       0,     0,    77,     0,    39,     0,     0,     0,    37,     0,
+       0,    25,     0,    19,    14,    15,     0,    38,    32,    49,
+      53,    61,    74,    75,    60,     0,     0,    59,    38,    42,
+      46,    38,    35,    23,    26,     0,     0,    57,     0,     0,
+      43,    44,    41,     0,     0,    34,    55,     0,    56,    33,
+      47,    36,    58
 };
 
-/* YYDEFACT[STATE-NAME] -- Default rule to reduce with in state
-   STATE-NUM when YYTABLE doesn't specify something else to do.  Zero
-   means the default is an error.  */
-static const yytype_uint8 yydefact[] =
+/* YYPGOTO[NTERM-NUM].  */
+static const yytype_int8 yypgoto[] =
 {
-       3,     0,     1,     0,     0,     0,     9,     8,     2,     6,
-       4,     5,     7,    19,    18,    20,     0,    17,    23,     0,
-       0,     0,     0,     0,     0,    12,     0,    10,     0,    14,
-       0,     0,     0,    13,    24,    25,    26,    28,    27,    29,
-       0,    11,    15,    21,    22,    16
+    -104,  -104,  -104,  -104,  -104,    74,    62,    43,    17,  -104,
+    -104,  -104,  -104,  -104,   -75,  -104,  -104,  -104,  -104,   -68,
+    -104,    39,    48,  -104,  -104,  -104,    -3,   113,  -104,    -4,
+    -103,    -5,    63
 };
 
 /* YYDEFGOTO[NTERM-NUM].  */
-static const yytype_int8 yydefgoto[] =
+static const yytype_uint8 yydefgoto[] =
 {
-      -1,     1,     8,     9,    10,    11,    28,    29,    16,    30,
-      45,    19,    40
+       0,     1,    12,    13,    14,    72,    96,    92,    93,    15,
+      16,    17,    18,    19,    66,    67,    88,   152,   118,    77,
+      78,    79,    80,   148,    81,    29,    82,    31,    32,    83,
+     134,    35,   109
 };
 
-/* YYPACT[STATE-NUM] -- Index in YYTABLE of the portion describing
-   STATE-NUM.  */
-#define YYPACT_NINF -14
-static const yytype_int8 yypact[] =
+/* YYTABLE[YYPACT[STATE-NUM]] -- What to do in state STATE-NUM.  If
+   positive, shift that token.  If negative, reduce the rule whose
+   number is the opposite.  If YYTABLE_NINF, syntax error.  */
+static const yytype_int16 yytable[] =
 {
-     -14,     0,   -14,    -5,     3,     2,   -14,   -14,   -14,   -14,
-     -14,   -14,   -14,   -14,   -14,   -14,    10,   -14,   -14,    14,
-       2,     5,    -3,     1,    11,   -14,    22,   -14,    -4,   -14,
-       4,    16,    11,   -14,   -14,   -14,   -14,   -14,   -14,   -14,
-     -12,   -14,   -14,   -14,   -14,   -14
+      33,    30,   100,    38,    39,     2,     3,   135,     4,    48,
+     137,     5,    90,    40,   120,     6,    63,    20,     7,    34,
+       8,    70,     9,    10,    37,    71,    57,    58,   119,   157,
+      49,   127,    47,   158,    36,    51,    64,    53,    52,    54,
+      56,    59,    11,   156,    41,    91,    65,   138,    64,    27,
+      28,   141,   145,   102,   -50,   132,   133,    76,   102,   -51,
+      85,    21,    43,   149,    89,    42,   154,   150,   151,    44,
+      98,    22,    23,    24,    25,    45,    21,    46,    26,    28,
+     114,    50,    60,    27,    27,    28,    22,    23,    24,    25,
+      61,   110,   111,    26,    62,    68,    69,    87,    74,    27,
+     131,    75,   112,   104,   105,   106,   107,   108,    84,    86,
+      94,    95,   139,   103,   104,   105,   106,   107,   108,    99,
+      64,   101,   115,   116,   121,   117,   122,   124,   126,   146,
+     125,   128,    73,   153,   136,    97,   142,   123,   140,   143,
+     129,   147,   144,   155,   159,     0,   113,     0,   160,   161,
+     130,   162,     0,     0,     0,     0,     0,    55
 };
 
-/* YYPGOTO[NTERM-NUM].  */
-static const yytype_int8 yypgoto[] =
+static const yytype_int16 yycheck[] =
 {
-     -14,   -14,   -14,   -14,   -14,   -14,   -14,   -13,   -14,    28,
-     -14,    13,   -14
+       4,     4,    77,     8,     9,     0,     1,   110,     3,    16,
+     113,     6,     9,     4,    89,    10,     5,    37,    13,    42,
+      15,     8,    17,    18,    14,    12,    41,    42,     5,    35,
+      37,    99,    37,    39,     9,    40,    25,    42,    41,    43,
+      44,    46,    37,   146,    35,    42,    35,   115,    25,    42,
+      43,   119,   127,    20,    21,    40,    41,    62,    20,    21,
+      65,    19,    38,   138,    69,     4,   141,    27,    28,    35,
+      74,    29,    30,    31,    32,     4,    19,    11,    36,    43,
+      84,    37,    37,    42,    42,    43,    29,    30,    31,    32,
+      40,    33,    34,    36,    35,    39,     4,    24,    38,    42,
+     103,    37,    44,    45,    46,    47,    48,    49,    26,    37,
+       8,     7,   116,    44,    45,    46,    47,    48,    49,     5,
+      25,    21,     5,    26,     9,    22,    35,    37,    39,    20,
+      37,    37,    58,    23,    38,    73,    37,    94,    40,   122,
+     101,    40,    37,    37,    37,    -1,    83,    -1,    40,    37,
+     102,    40,    -1,    -1,    -1,    -1,    -1,    44
 };
 
-/* YYTABLE[YYPACT[STATE-NUM]].  What to do in state STATE-NUM.  If
-   positive, shift that token.  If negative, reduce the rule which
-   number is the opposite.  If zero, do what YYDEFACT says.
-   If YYTABLE_NINF, syntax error.  */
-#define YYTABLE_NINF -1
-static const yytype_uint8 yytable[] =
+/* YYSTOS[STATE-NUM] -- The symbol kind of the accessing symbol of
+   state STATE-NUM.  */
+static const yytype_int8 yystos[] =
 {
-       2,     3,    24,     4,    43,    44,     5,    32,    26,     6,
-      12,    33,    25,    13,    20,     7,    27,    14,    21,    42,
-      18,    15,    23,    34,    35,    36,    37,    38,    39,    15,
-      31,    41,    17,    22
+       0,    51,     0,     1,     3,     6,    10,    13,    15,    17,
+      18,    37,    52,    53,    54,    59,    60,    61,    62,    63,
+      37,    19,    29,    30,    31,    32,    36,    42,    43,    75,
+      76,    77,    78,    79,    42,    81,     9,    14,    81,    81,
+       4,    35,     4,    38,    35,     4,    11,    81,    16,    37,
+      37,    81,    76,    81,    79,    77,    79,    41,    42,    81,
+      37,    40,    35,     5,    25,    35,    64,    65,    39,     4,
+       8,    12,    55,    55,    38,    37,    81,    69,    70,    71,
+      72,    74,    76,    79,    26,    81,    37,    24,    66,    81,
+       9,    42,    57,    58,     8,     7,    56,    56,    79,     5,
+      64,    21,    20,    44,    45,    46,    47,    48,    49,    82,
+      33,    34,    44,    82,    79,     5,    26,    22,    68,     5,
+      64,     9,    35,    57,    37,    37,    39,    69,    37,    71,
+      72,    76,    40,    41,    80,    80,    38,    80,    69,    79,
+      40,    69,    37,    58,    37,    64,    20,    40,    73,    64,
+      27,    28,    67,    23,    64,    37,    80,    35,    39,    37,
+      40,    37,    40
 };
 
-static const yytype_uint8 yycheck[] =
+/* YYR1[RULE-NUM] -- Symbol kind of the left-hand side of rule RULE-NUM.  */
+static const yytype_int8 yyr1[] =
 {
-       0,     1,     5,     3,    16,    17,     6,    11,     7,     9,
-      15,    15,    15,    10,     4,    15,    15,    14,     4,    32,
-      18,    18,    17,    19,    20,    21,    22,    23,    24,    18,
-       8,    15,     4,    20
+       0,    50,    51,    51,    52,    52,    52,    52,    52,    52,
+      52,    52,    52,    53,    54,    54,    55,    55,    55,    55,
+      56,    56,    57,    57,    58,    58,    59,    60,    61,    61,
+      62,    63,    63,    63,    63,    63,    63,    64,    65,    65,
+      66,    66,    67,    67,    67,    68,    68,    68,    69,    69,
+      70,    70,    71,    71,    72,    72,    72,    73,    73,    74,
+      74,    74,    75,    75,    76,    77,    77,    77,    77,    78,
+      78,    78,    78,    79,    80,    80,    81,    82,    82,    82,
+      82,    82,    82
 };
 
-/* YYSTOS[STATE-NUM] -- The (internal number of the) accessing
-   symbol of state STATE-NUM.  */
-static const yytype_uint8 yystos[] =
+/* YYR2[RULE-NUM] -- Number of symbols on the right-hand side of rule RULE-NUM.  */
+static const yytype_int8 yyr2[] =
 {
-       0,    26,     0,     1,     3,     6,     9,    15,    27,    28,
-      29,    30,    15,    10,    14,    18,    33,    34,    18,    36,
-       4,     4,    36,    17,     5,    15,     7,    15,    31,    32,
-      34,     8,    11,    15,    19,    20,    21,    22,    23,    24,
-      37,    15,    32,    16,    17,    35
+       0,     2,     2,     0,     1,     1,     1,     1,     1,     1,
+       1,     2,     1,     1,     7,     7,     0,     2,     1,     3,
+       0,     1,     1,     3,     1,     2,     8,     4,     3,     5,
+       3,     6,     8,    10,    10,     8,    10,     3,     0,     3,
+       0,     4,     0,     1,     1,     0,     2,     4,     1,     3,
+       1,     3,     1,     3,     1,     5,     5,     1,     3,     3,
+       3,     3,     1,     3,     1,     1,     1,     1,     4,     1,
+       1,     1,     1,     1,     1,     1,     1,     1,     1,     1,
+       1,     1,     1
 };
 
-#define yyerrok		(yyerrstatus = 0)
-#define yyclearin	(yychar = YYEMPTY)
-#define YYEMPTY		(-2)
-#define YYEOF		0
 
-#define YYACCEPT	goto yyacceptlab
-#define YYABORT		goto yyabortlab
-#define YYERROR		goto yyerrorlab
+enum { YYENOMEM = -2 };
 
+#define yyerrok         (yyerrstatus = 0)
+#define yyclearin       (yychar = YYEMPTY)
 
-/* Like YYERROR except do call yyerror.  This remains here temporarily
-   to ease the transition to the new meaning of YYERROR, for GCC.
-   Once GCC version 2 has supplanted version 1, this can go.  */
+#define YYACCEPT        goto yyacceptlab
+#define YYABORT         goto yyabortlab
+#define YYERROR         goto yyerrorlab
+#define YYNOMEM         goto yyexhaustedlab
 
-#define YYFAIL		goto yyerrlab
 
 #define YYRECOVERING()  (!!yyerrstatus)
 
-#define YYBACKUP(Token, Value)					\
-do								\
-  if (yychar == YYEMPTY && yylen == 1)				\
-    {								\
-      yychar = (Token);						\
-      yylval = (Value);						\
-      yytoken = YYTRANSLATE (yychar);				\
-      YYPOPSTACK (1);						\
-      goto yybackup;						\
-    }								\
-  else								\
-    {								\
-      yyerror (YY_("syntax error: cannot back up")); \
-      YYERROR;							\
-    }								\
-while (YYID (0))
-
-
-#define YYTERROR	1
-#define YYERRCODE	256
-
-
-/* YYLLOC_DEFAULT -- Set CURRENT to span from RHS[1] to RHS[N].
-   If N is 0, then set CURRENT to the empty location which ends
-   the previous symbol: RHS[0] (always defined).  */
-
-#define YYRHSLOC(Rhs, K) ((Rhs)[K])
-#ifndef YYLLOC_DEFAULT
-# define YYLLOC_DEFAULT(Current, Rhs, N)				\
-    do									\
-      if (YYID (N))                                                    \
-	{								\
-	  (Current).first_line   = YYRHSLOC (Rhs, 1).first_line;	\
-	  (Current).first_column = YYRHSLOC (Rhs, 1).first_column;	\
-	  (Current).last_line    = YYRHSLOC (Rhs, N).last_line;		\
-	  (Current).last_column  = YYRHSLOC (Rhs, N).last_column;	\
-	}								\
-      else								\
-	{								\
-	  (Current).first_line   = (Current).last_line   =		\
-	    YYRHSLOC (Rhs, 0).last_line;				\
-	  (Current).first_column = (Current).last_column =		\
-	    YYRHSLOC (Rhs, 0).last_column;				\
-	}								\
-    while (YYID (0))
-#endif
-
-
-/* YY_LOCATION_PRINT -- Print the location on the stream.
-   This macro was not mandated originally: define only if we know
-   we won't break user code: when these are the locations we know.  */
-
-#ifndef YY_LOCATION_PRINT
-# if YYLTYPE_IS_TRIVIAL
-#  define YY_LOCATION_PRINT(File, Loc)			\
-     fprintf (File, "%d.%d-%d.%d",			\
-	      (Loc).first_line, (Loc).first_column,	\
-	      (Loc).last_line,  (Loc).last_column)
-# else
-#  define YY_LOCATION_PRINT(File, Loc) ((void) 0)
-# endif
-#endif
-
+#define YYBACKUP(Token, Value)                                    \
+  do                                                              \
+    if (yychar == YYEMPTY)                                        \
+      {                                                           \
+        yychar = (Token);                                         \
+        yylval = (Value);                                         \
+        YYPOPSTACK (yylen);                                       \
+        yystate = *yyssp;                                         \
+        goto yybackup;                                            \
+      }                                                           \
+    else                                                          \
+      {                                                           \
+        yyerror (YY_("syntax error: cannot back up")); \
+        YYERROR;                                                  \
+      }                                                           \
+  while (0)
+
+/* Backward compatibility with an undocumented macro.
+   Use YYerror or YYUNDEF. */
+#define YYERRCODE YYUNDEF
 
-/* YYLEX -- calling `yylex' with the right arguments.  */
-
-#ifdef YYLEX_PARAM
-# define YYLEX yylex (YYLEX_PARAM)
-#else
-# define YYLEX yylex ()
-#endif
 
 /* Enable debugging if requested.  */
 #if YYDEBUG
@@ -707,80 +947,58 @@ while (YYID (0))
 #  define YYFPRINTF fprintf
 # endif
 
-# define YYDPRINTF(Args)			\
-do {						\
-  if (yydebug)					\
-    YYFPRINTF Args;				\
-} while (YYID (0))
-
-# define YY_SYMBOL_PRINT(Title, Type, Value, Location)			  \
-do {									  \
-  if (yydebug)								  \
-    {									  \
-      YYFPRINTF (stderr, "%s ", Title);					  \
-      yy_symbol_print (stderr,						  \
-		  Type, Value); \
-      YYFPRINTF (stderr, "\n");						  \
-    }									  \
-} while (YYID (0))
-
-
-/*--------------------------------.
-| Print this symbol on YYOUTPUT.  |
-`--------------------------------*/
-
-/*ARGSUSED*/
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
-static void
-yy_symbol_value_print (FILE *yyoutput, int yytype, YYSTYPE const * const yyvaluep)
-#else
+# define YYDPRINTF(Args)                        \
+do {                                            \
+  if (yydebug)                                  \
+    YYFPRINTF Args;                             \
+} while (0)
+
+
+
+
+# define YY_SYMBOL_PRINT(Title, Kind, Value, Location)                    \
+do {                                                                      \
+  if (yydebug)                                                            \
+    {                                                                     \
+      YYFPRINTF (stderr, "%s ", Title);                                   \
+      yy_symbol_print (stderr,                                            \
+                  Kind, Value); \
+      YYFPRINTF (stderr, "\n");                                           \
+    }                                                                     \
+} while (0)
+
+
+/*-----------------------------------.
+| Print this symbol's value on YYO.  |
+`-----------------------------------*/
+
 static void
-yy_symbol_value_print (yyoutput, yytype, yyvaluep)
-    FILE *yyoutput;
-    int yytype;
-    YYSTYPE const * const yyvaluep;
-#endif
+yy_symbol_value_print (FILE *yyo,
+                       yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep)
 {
+  FILE *yyoutput = yyo;
+  YY_USE (yyoutput);
   if (!yyvaluep)
     return;
-# ifdef YYPRINT
-  if (yytype < YYNTOKENS)
-    YYPRINT (yyoutput, yytoknum[yytype], *yyvaluep);
-# else
-  YYUSE (yyoutput);
-# endif
-  switch (yytype)
-    {
-      default:
-	break;
-    }
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+  YY_USE (yykind);
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
 }
 
 
-/*--------------------------------.
-| Print this symbol on YYOUTPUT.  |
-`--------------------------------*/
+/*---------------------------.
+| Print this symbol on YYO.  |
+`---------------------------*/
 
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
-static void
-yy_symbol_print (FILE *yyoutput, int yytype, YYSTYPE const * const yyvaluep)
-#else
 static void
-yy_symbol_print (yyoutput, yytype, yyvaluep)
-    FILE *yyoutput;
-    int yytype;
-    YYSTYPE const * const yyvaluep;
-#endif
+yy_symbol_print (FILE *yyo,
+                 yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep)
 {
-  if (yytype < YYNTOKENS)
-    YYFPRINTF (yyoutput, "token %s (", yytname[yytype]);
-  else
-    YYFPRINTF (yyoutput, "nterm %s (", yytname[yytype]);
+  YYFPRINTF (yyo, "%s %s (",
+             yykind < YYNTOKENS ? "token" : "nterm", yysymbol_name (yykind));
 
-  yy_symbol_value_print (yyoutput, yytype, yyvaluep);
-  YYFPRINTF (yyoutput, ")");
+  yy_symbol_value_print (yyo, yykind, yyvaluep);
+  YYFPRINTF (yyo, ")");
 }
 
 /*------------------------------------------------------------------.
@@ -788,80 +1006,68 @@ yy_symbol_print (yyoutput, yytype, yyvaluep)
 | TOP (included).                                                   |
 `------------------------------------------------------------------*/
 
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
-static void
-yy_stack_print (yytype_int16 *bottom, yytype_int16 *top)
-#else
 static void
-yy_stack_print (bottom, top)
-    yytype_int16 *bottom;
-    yytype_int16 *top;
-#endif
+yy_stack_print (yy_state_t *yybottom, yy_state_t *yytop)
 {
   YYFPRINTF (stderr, "Stack now");
-  for (; bottom <= top; ++bottom)
-    YYFPRINTF (stderr, " %d", *bottom);
+  for (; yybottom <= yytop; yybottom++)
+    {
+      int yybot = *yybottom;
+      YYFPRINTF (stderr, " %d", yybot);
+    }
   YYFPRINTF (stderr, "\n");
 }
 
-# define YY_STACK_PRINT(Bottom, Top)				\
-do {								\
-  if (yydebug)							\
-    yy_stack_print ((Bottom), (Top));				\
-} while (YYID (0))
+# define YY_STACK_PRINT(Bottom, Top)                            \
+do {                                                            \
+  if (yydebug)                                                  \
+    yy_stack_print ((Bottom), (Top));                           \
+} while (0)
 
 
 /*------------------------------------------------.
 | Report that the YYRULE is going to be reduced.  |
 `------------------------------------------------*/
 
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
 static void
-yy_reduce_print (YYSTYPE *yyvsp, int yyrule)
-#else
-static void
-yy_reduce_print (yyvsp, yyrule)
-    YYSTYPE *yyvsp;
-    int yyrule;
-#endif
+yy_reduce_print (yy_state_t *yyssp, YYSTYPE *yyvsp,
+                 int yyrule)
 {
+  int yylno = yyrline[yyrule];
   int yynrhs = yyr2[yyrule];
   int yyi;
-  unsigned long int yylno = yyrline[yyrule];
-  YYFPRINTF (stderr, "Reducing stack by rule %d (line %lu):\n",
-	     yyrule - 1, yylno);
+  YYFPRINTF (stderr, "Reducing stack by rule %d (line %d):\n",
+             yyrule - 1, yylno);
   /* The symbols being reduced.  */
   for (yyi = 0; yyi < yynrhs; yyi++)
     {
-      fprintf (stderr, "   $%d = ", yyi + 1);
-      yy_symbol_print (stderr, yyrhs[yyprhs[yyrule] + yyi],
-		       &(yyvsp[(yyi + 1) - (yynrhs)])
-		       		       );
-      fprintf (stderr, "\n");
+      YYFPRINTF (stderr, "   $%d = ", yyi + 1);
+      yy_symbol_print (stderr,
+                       YY_ACCESSING_SYMBOL (+yyssp[yyi + 1 - yynrhs]),
+                       &yyvsp[(yyi + 1) - (yynrhs)]);
+      YYFPRINTF (stderr, "\n");
     }
 }
 
-# define YY_REDUCE_PRINT(Rule)		\
-do {					\
-  if (yydebug)				\
-    yy_reduce_print (yyvsp, Rule); \
-} while (YYID (0))
+# define YY_REDUCE_PRINT(Rule)          \
+do {                                    \
+  if (yydebug)                          \
+    yy_reduce_print (yyssp, yyvsp, Rule); \
+} while (0)
 
 /* Nonzero means print parse trace.  It is left uninitialized so that
    multiple parsers can coexist.  */
 int yydebug;
 #else /* !YYDEBUG */
-# define YYDPRINTF(Args)
-# define YY_SYMBOL_PRINT(Title, Type, Value, Location)
+# define YYDPRINTF(Args) ((void) 0)
+# define YY_SYMBOL_PRINT(Title, Kind, Value, Location)
 # define YY_STACK_PRINT(Bottom, Top)
 # define YY_REDUCE_PRINT(Rule)
 #endif /* !YYDEBUG */
 
 
 /* YYINITDEPTH -- initial size of the parser's stacks.  */
-#ifndef	YYINITDEPTH
+#ifndef YYINITDEPTH
 # define YYINITDEPTH 200
 #endif
 
@@ -876,478 +1082,219 @@ int yydebug;
 # define YYMAXDEPTH 10000
 #endif
 
-
-
-#if YYERROR_VERBOSE
-
-# ifndef yystrlen
-#  if defined __GLIBC__ && defined _STRING_H
-#   define yystrlen strlen
-#  else
-/* Return the length of YYSTR.  */
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
-static YYSIZE_T
-yystrlen (const char *yystr)
-#else
-static YYSIZE_T
-yystrlen (yystr)
-    const char *yystr;
-#endif
-{
-  YYSIZE_T yylen;
-  for (yylen = 0; yystr[yylen]; yylen++)
-    continue;
-  return yylen;
-}
-#  endif
-# endif
-
-# ifndef yystpcpy
-#  if defined __GLIBC__ && defined _STRING_H && defined _GNU_SOURCE
-#   define yystpcpy stpcpy
-#  else
-/* Copy YYSRC to YYDEST, returning the address of the terminating '\0' in
-   YYDEST.  */
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
-static char *
-yystpcpy (char *yydest, const char *yysrc)
-#else
-static char *
-yystpcpy (yydest, yysrc)
-    char *yydest;
-    const char *yysrc;
-#endif
-{
-  char *yyd = yydest;
-  const char *yys = yysrc;
-
-  while ((*yyd++ = *yys++) != '\0')
-    continue;
-
-  return yyd - 1;
-}
-#  endif
-# endif
-
-# ifndef yytnamerr
-/* Copy to YYRES the contents of YYSTR after stripping away unnecessary
-   quotes and backslashes, so that it's suitable for yyerror.  The
-   heuristic is that double-quoting is unnecessary unless the string
-   contains an apostrophe, a comma, or backslash (other than
-   backslash-backslash).  YYSTR is taken from yytname.  If YYRES is
-   null, do not copy; instead, return the length of what the result
-   would have been.  */
-static YYSIZE_T
-yytnamerr (char *yyres, const char *yystr)
-{
-  if (*yystr == '"')
-    {
-      YYSIZE_T yyn = 0;
-      char const *yyp = yystr;
-
-      for (;;)
-	switch (*++yyp)
-	  {
-	  case '\'':
-	  case ',':
-	    goto do_not_strip_quotes;
-
-	  case '\\':
-	    if (*++yyp != '\\')
-	      goto do_not_strip_quotes;
-	    /* Fall through.  */
-	  default:
-	    if (yyres)
-	      yyres[yyn] = *yyp;
-	    yyn++;
-	    break;
-
-	  case '"':
-	    if (yyres)
-	      yyres[yyn] = '\0';
-	    return yyn;
-	  }
-    do_not_strip_quotes: ;
-    }
 
-  if (! yyres)
-    return yystrlen (yystr);
 
-  return yystpcpy (yyres, yystr) - yyres;
-}
-# endif
 
-/* Copy into YYRESULT an error message about the unexpected token
-   YYCHAR while in state YYSTATE.  Return the number of bytes copied,
-   including the terminating null byte.  If YYRESULT is null, do not
-   copy anything; just return the number of bytes that would be
-   copied.  As a special case, return 0 if an ordinary "syntax error"
-   message will do.  Return YYSIZE_MAXIMUM if overflow occurs during
-   size calculation.  */
-static YYSIZE_T
-yysyntax_error (char *yyresult, int yystate, int yychar)
-{
-  int yyn = yypact[yystate];
 
-  if (! (YYPACT_NINF < yyn && yyn <= YYLAST))
-    return 0;
-  else
-    {
-      int yytype = YYTRANSLATE (yychar);
-      YYSIZE_T yysize0 = yytnamerr (0, yytname[yytype]);
-      YYSIZE_T yysize = yysize0;
-      YYSIZE_T yysize1;
-      int yysize_overflow = 0;
-      enum { YYERROR_VERBOSE_ARGS_MAXIMUM = 5 };
-      char const *yyarg[YYERROR_VERBOSE_ARGS_MAXIMUM];
-      int yyx;
-
-# if 0
-      /* This is so xgettext sees the translatable formats that are
-	 constructed on the fly.  */
-      YY_("syntax error, unexpected %s");
-      YY_("syntax error, unexpected %s, expecting %s");
-      YY_("syntax error, unexpected %s, expecting %s or %s");
-      YY_("syntax error, unexpected %s, expecting %s or %s or %s");
-      YY_("syntax error, unexpected %s, expecting %s or %s or %s or %s");
-# endif
-      char *yyfmt;
-      char const *yyf;
-      static char const yyunexpected[] = "syntax error, unexpected %s";
-      static char const yyexpecting[] = ", expecting %s";
-      static char const yyor[] = " or %s";
-      char yyformat[sizeof yyunexpected
-		    + sizeof yyexpecting - 1
-		    + ((YYERROR_VERBOSE_ARGS_MAXIMUM - 2)
-		       * (sizeof yyor - 1))];
-      char const *yyprefix = yyexpecting;
-
-      /* Start YYX at -YYN if negative to avoid negative indexes in
-	 YYCHECK.  */
-      int yyxbegin = yyn < 0 ? -yyn : 0;
-
-      /* Stay within bounds of both yycheck and yytname.  */
-      int yychecklim = YYLAST - yyn + 1;
-      int yyxend = yychecklim < YYNTOKENS ? yychecklim : YYNTOKENS;
-      int yycount = 1;
-
-      yyarg[0] = yytname[yytype];
-      yyfmt = yystpcpy (yyformat, yyunexpected);
-
-      for (yyx = yyxbegin; yyx < yyxend; ++yyx)
-	if (yycheck[yyx + yyn] == yyx && yyx != YYTERROR)
-	  {
-	    if (yycount == YYERROR_VERBOSE_ARGS_MAXIMUM)
-	      {
-		yycount = 1;
-		yysize = yysize0;
-		yyformat[sizeof yyunexpected - 1] = '\0';
-		break;
-	      }
-	    yyarg[yycount++] = yytname[yyx];
-	    yysize1 = yysize + yytnamerr (0, yytname[yyx]);
-	    yysize_overflow |= (yysize1 < yysize);
-	    yysize = yysize1;
-	    yyfmt = yystpcpy (yyfmt, yyprefix);
-	    yyprefix = yyor;
-	  }
-
-      yyf = YY_(yyformat);
-      yysize1 = yysize + yystrlen (yyf);
-      yysize_overflow |= (yysize1 < yysize);
-      yysize = yysize1;
-
-      if (yysize_overflow)
-	return YYSIZE_MAXIMUM;
-
-      if (yyresult)
-	{
-	  /* Avoid sprintf, as that infringes on the user's name space.
-	     Don't have undefined behavior even if the translation
-	     produced a string with the wrong number of "%s"s.  */
-	  char *yyp = yyresult;
-	  int yyi = 0;
-	  while ((*yyp = *yyf) != '\0')
-	    {
-	      if (*yyp == '%' && yyf[1] == 's' && yyi < yycount)
-		{
-		  yyp += yytnamerr (yyp, yyarg[yyi++]);
-		  yyf += 2;
-		}
-	      else
-		{
-		  yyp++;
-		  yyf++;
-		}
-	    }
-	}
-      return yysize;
-    }
-}
-#endif /* YYERROR_VERBOSE */
-
 
 /*-----------------------------------------------.
 | Release the memory associated to this symbol.  |
 `-----------------------------------------------*/
 
-/*ARGSUSED*/
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
 static void
-yydestruct (const char *yymsg, int yytype, YYSTYPE *yyvaluep)
-#else
-static void
-yydestruct (yymsg, yytype, yyvaluep)
-    const char *yymsg;
-    int yytype;
-    YYSTYPE *yyvaluep;
-#endif
+yydestruct (const char *yymsg,
+            yysymbol_kind_t yykind, YYSTYPE *yyvaluep)
 {
-  YYUSE (yyvaluep);
-
+  YY_USE (yyvaluep);
   if (!yymsg)
     yymsg = "Deleting";
-  YY_SYMBOL_PRINT (yymsg, yytype, yyvaluep, yylocationp);
-
-  switch (yytype)
-    {
+  YY_SYMBOL_PRINT (yymsg, yykind, yyvaluep, yylocationp);
 
-      default:
-	break;
-    }
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+  YY_USE (yykind);
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
 }
-
-
-/* Prevent warnings from -Wmissing-prototypes.  */
-
-#ifdef YYPARSE_PARAM
-#if defined __STDC__ || defined __cplusplus
-int yyparse (void *YYPARSE_PARAM);
-#else
-int yyparse ();
-#endif
-#else /* ! YYPARSE_PARAM */
-#if defined __STDC__ || defined __cplusplus
-int yyparse (void);
-#else
-int yyparse ();
-#endif
-#endif /* ! YYPARSE_PARAM */
-
 
 
-/* The look-ahead symbol.  */
+/* Lookahead token kind.  */
 int yychar;
 
-/* The semantic value of the look-ahead symbol.  */
+/* The semantic value of the lookahead symbol.  */
 YYSTYPE yylval;
-
 /* Number of syntax errors so far.  */
 int yynerrs;
 
 
 
+
 /*----------.
 | yyparse.  |
 `----------*/
 
-#ifdef YYPARSE_PARAM
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
-int
-yyparse (void *YYPARSE_PARAM)
-#else
-int
-yyparse (YYPARSE_PARAM)
-    void *YYPARSE_PARAM;
-#endif
-#else /* ! YYPARSE_PARAM */
-#if (defined __STDC__ || defined __C99__FUNC__ \
-     || defined __cplusplus || defined _MSC_VER)
 int
 yyparse (void)
-#else
-int
-yyparse ()
-
-#endif
-#endif
 {
-  
-  int yystate;
-  int yyn;
-  int yyresult;
-  /* Number of tokens to shift before error messages enabled.  */
-  int yyerrstatus;
-  /* Look-ahead token as an internal (translated) token number.  */
-  int yytoken = 0;
-#if YYERROR_VERBOSE
-  /* Buffer for error messages, and its allocated size.  */
-  char yymsgbuf[128];
-  char *yymsg = yymsgbuf;
-  YYSIZE_T yymsg_alloc = sizeof yymsgbuf;
-#endif
-
-  /* Three stacks and their tools:
-     `yyss': related to states,
-     `yyvs': related to semantic values,
-     `yyls': related to locations.
-
-     Refer to the stacks thru separate pointers, to allow yyoverflow
-     to reallocate them elsewhere.  */
-
-  /* The state stack.  */
-  yytype_int16 yyssa[YYINITDEPTH];
-  yytype_int16 *yyss = yyssa;
-  yytype_int16 *yyssp;
+    yy_state_fast_t yystate = 0;
+    /* Number of tokens to shift before error messages enabled.  */
+    int yyerrstatus = 0;
 
-  /* The semantic value stack.  */
-  YYSTYPE yyvsa[YYINITDEPTH];
-  YYSTYPE *yyvs = yyvsa;
-  YYSTYPE *yyvsp;
+    /* Refer to the stacks through separate pointers, to allow yyoverflow
+       to reallocate them elsewhere.  */
 
+    /* Their size.  */
+    YYPTRDIFF_T yystacksize = YYINITDEPTH;
 
+    /* The state stack: array, bottom, top.  */
+    yy_state_t yyssa[YYINITDEPTH];
+    yy_state_t *yyss = yyssa;
+    yy_state_t *yyssp = yyss;
 
-#define YYPOPSTACK(N)   (yyvsp -= (N), yyssp -= (N))
-
-  YYSIZE_T yystacksize = YYINITDEPTH;
+    /* The semantic value stack: array, bottom, top.  */
+    YYSTYPE yyvsa[YYINITDEPTH];
+    YYSTYPE *yyvs = yyvsa;
+    YYSTYPE *yyvsp = yyvs;
 
+  int yyn;
+  /* The return value of yyparse.  */
+  int yyresult;
+  /* Lookahead symbol kind.  */
+  yysymbol_kind_t yytoken = YYSYMBOL_YYEMPTY;
   /* The variables used to return semantic value and location from the
      action routines.  */
   YYSTYPE yyval;
 
 
+
+#define YYPOPSTACK(N)   (yyvsp -= (N), yyssp -= (N))
+
   /* The number of symbols on the RHS of the reduced rule.
      Keep to zero when no symbol should be popped.  */
   int yylen = 0;
 
   YYDPRINTF ((stderr, "Starting parse\n"));
 
-  yystate = 0;
-  yyerrstatus = 0;
-  yynerrs = 0;
-  yychar = YYEMPTY;		/* Cause a token to be read.  */
-
-  /* Initialize stack pointers.
-     Waste one element of value and location stack
-     so that they stay on the same level as the state stack.
-     The wasted elements are never initialized.  */
-
-  yyssp = yyss;
-  yyvsp = yyvs;
+  yychar = YYEMPTY; /* Cause a token to be read.  */
 
   goto yysetstate;
 
+
 /*------------------------------------------------------------.
-| yynewstate -- Push a new state, which is found in yystate.  |
+| yynewstate -- push a new state, which is found in yystate.  |
 `------------------------------------------------------------*/
- yynewstate:
+yynewstate:
   /* In all cases, when you get here, the value and location stacks
      have just been pushed.  So pushing a state here evens the stacks.  */
   yyssp++;
 
- yysetstate:
-  *yyssp = yystate;
+
+/*--------------------------------------------------------------------.
+| yysetstate -- set current state (the top of the stack) to yystate.  |
+`--------------------------------------------------------------------*/
+yysetstate:
+  YYDPRINTF ((stderr, "Entering state %d\n", yystate));
+  YY_ASSERT (0 <= yystate && yystate < YYNSTATES);
+  YY_IGNORE_USELESS_CAST_BEGIN
+  *yyssp = YY_CAST (yy_state_t, yystate);
+  YY_IGNORE_USELESS_CAST_END
+  YY_STACK_PRINT (yyss, yyssp);
 
   if (yyss + yystacksize - 1 <= yyssp)
+#if !defined yyoverflow && !defined YYSTACK_RELOCATE
+    YYNOMEM;
+#else
     {
       /* Get the current used size of the three stacks, in elements.  */
-      YYSIZE_T yysize = yyssp - yyss + 1;
+      YYPTRDIFF_T yysize = yyssp - yyss + 1;
 
-#ifdef yyoverflow
+# if defined yyoverflow
       {
-	/* Give user a chance to reallocate the stack.  Use copies of
-	   these so that the &'s don't force the real ones into
-	   memory.  */
-	YYSTYPE *yyvs1 = yyvs;
-	yytype_int16 *yyss1 = yyss;
-
-
-	/* Each stack pointer address is followed by the size of the
-	   data in use in that stack, in bytes.  This used to be a
-	   conditional around just the two extra args, but that might
-	   be undefined if yyoverflow is a macro.  */
-	yyoverflow (YY_("memory exhausted"),
-		    &yyss1, yysize * sizeof (*yyssp),
-		    &yyvs1, yysize * sizeof (*yyvsp),
-
-		    &yystacksize);
-
-	yyss = yyss1;
-	yyvs = yyvs1;
+        /* Give user a chance to reallocate the stack.  Use copies of
+           these so that the &'s don't force the real ones into
+           memory.  */
+        yy_state_t *yyss1 = yyss;
+        YYSTYPE *yyvs1 = yyvs;
+
+        /* Each stack pointer address is followed by the size of the
+           data in use in that stack, in bytes.  This used to be a
+           conditional around just the two extra args, but that might
+           be undefined if yyoverflow is a macro.  */
+        yyoverflow (YY_("memory exhausted"),
+                    &yyss1, yysize * YYSIZEOF (*yyssp),
+                    &yyvs1, yysize * YYSIZEOF (*yyvsp),
+                    &yystacksize);
+        yyss = yyss1;
+        yyvs = yyvs1;
       }
-#else /* no yyoverflow */
-# ifndef YYSTACK_RELOCATE
-      goto yyexhaustedlab;
-# else
+# else /* defined YYSTACK_RELOCATE */
       /* Extend the stack our own way.  */
       if (YYMAXDEPTH <= yystacksize)
-	goto yyexhaustedlab;
+        YYNOMEM;
       yystacksize *= 2;
       if (YYMAXDEPTH < yystacksize)
-	yystacksize = YYMAXDEPTH;
+        yystacksize = YYMAXDEPTH;
 
       {
-	yytype_int16 *yyss1 = yyss;
-	union yyalloc *yyptr =
-	  (union yyalloc *) YYSTACK_ALLOC (YYSTACK_BYTES (yystacksize));
-	if (! yyptr)
-	  goto yyexhaustedlab;
-	YYSTACK_RELOCATE (yyss);
-	YYSTACK_RELOCATE (yyvs);
-
+        yy_state_t *yyss1 = yyss;
+        union yyalloc *yyptr =
+          YY_CAST (union yyalloc *,
+                   YYSTACK_ALLOC (YY_CAST (YYSIZE_T, YYSTACK_BYTES (yystacksize))));
+        if (! yyptr)
+          YYNOMEM;
+        YYSTACK_RELOCATE (yyss_alloc, yyss);
+        YYSTACK_RELOCATE (yyvs_alloc, yyvs);
 #  undef YYSTACK_RELOCATE
-	if (yyss1 != yyssa)
-	  YYSTACK_FREE (yyss1);
+        if (yyss1 != yyssa)
+          YYSTACK_FREE (yyss1);
       }
 # endif
-#endif /* no yyoverflow */
 
       yyssp = yyss + yysize - 1;
       yyvsp = yyvs + yysize - 1;
 
-
-      YYDPRINTF ((stderr, "Stack size increased to %lu\n",
-		  (unsigned long int) yystacksize));
+      YY_IGNORE_USELESS_CAST_BEGIN
+      YYDPRINTF ((stderr, "Stack size increased to %ld\n",
+                  YY_CAST (long, yystacksize)));
+      YY_IGNORE_USELESS_CAST_END
 
       if (yyss + yystacksize - 1 <= yyssp)
-	YYABORT;
+        YYABORT;
     }
+#endif /* !defined yyoverflow && !defined YYSTACK_RELOCATE */
 
-  YYDPRINTF ((stderr, "Entering state %d\n", yystate));
+
+  if (yystate == YYFINAL)
+    YYACCEPT;
 
   goto yybackup;
 
+
 /*-----------.
 | yybackup.  |
 `-----------*/
 yybackup:
-
   /* Do appropriate processing given the current state.  Read a
-     look-ahead token if we need one and don't already have one.  */
+     lookahead token if we need one and don't already have one.  */
 
-  /* First try to decide what to do without reference to look-ahead token.  */
+  /* First try to decide what to do without reference to lookahead token.  */
   yyn = yypact[yystate];
-  if (yyn == YYPACT_NINF)
+  if (yypact_value_is_default (yyn))
     goto yydefault;
 
-  /* Not known => get a look-ahead token if don't already have one.  */
+  /* Not known => get a lookahead token if don't already have one.  */
 
-  /* YYCHAR is either YYEMPTY or YYEOF or a valid look-ahead symbol.  */
+  /* YYCHAR is either empty, or end-of-input, or a valid lookahead.  */
   if (yychar == YYEMPTY)
     {
-      YYDPRINTF ((stderr, "Reading a token: "));
-      yychar = YYLEX;
+      YYDPRINTF ((stderr, "Reading a token\n"));
+      yychar = yylex ();
     }
 
   if (yychar <= YYEOF)
     {
-      yychar = yytoken = YYEOF;
+      yychar = YYEOF;
+      yytoken = YYSYMBOL_YYEOF;
       YYDPRINTF ((stderr, "Now at end of input.\n"));
     }
+  else if (yychar == YYerror)
+    {
+      /* The scanner already issued an error message, process directly
+         to error recovery.  But do not keep the error token as
+         lookahead, it is too special and may lead us to an endless
+         loop in error recovery. */
+      yychar = YYUNDEF;
+      yytoken = YYSYMBOL_YYerror;
+      goto yyerrlab1;
+    }
   else
     {
       yytoken = YYTRANSLATE (yychar);
@@ -1362,30 +1309,26 @@ yybackup:
   yyn = yytable[yyn];
   if (yyn <= 0)
     {
-      if (yyn == 0 || yyn == YYTABLE_NINF)
-	goto yyerrlab;
+      if (yytable_value_is_error (yyn))
+        goto yyerrlab;
       yyn = -yyn;
       goto yyreduce;
     }
 
-  if (yyn == YYFINAL)
-    YYACCEPT;
-
   /* Count tokens shifted since error; after three, turn off error
      status.  */
   if (yyerrstatus)
     yyerrstatus--;
 
-  /* Shift the look-ahead token.  */
+  /* Shift the lookahead token.  */
   YY_SYMBOL_PRINT ("Shifting", yytoken, &yylval, &yylloc);
-
-  /* Discard the shifted token unless it is eof.  */
-  if (yychar != YYEOF)
-    yychar = YYEMPTY;
-
   yystate = yyn;
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
   *++yyvsp = yylval;
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
 
+  /* Discard the shifted token.  */
+  yychar = YYEMPTY;
   goto yynewstate;
 
 
@@ -1400,14 +1343,14 @@ yydefault:
 
 
 /*-----------------------------.
-| yyreduce -- Do a reduction.  |
+| yyreduce -- do a reduction.  |
 `-----------------------------*/
 yyreduce:
   /* yyn is the number of a rule to reduce with.  */
   yylen = yyr2[yyn];
 
   /* If YYLEN is nonzero, implement the default value of the action:
-     `$$ = $1'.
+     '$$ = $1'.
 
      Otherwise, the following line sets YYVAL to garbage.
      This behavior is undocumented and Bison
@@ -1420,266 +1363,764 @@ yyreduce:
   YY_REDUCE_PRINT (yyn);
   switch (yyn)
     {
-        case 4:
-#line 56 "SqlParser.y"
-    { fprintf(stdout, "Bruinbase> "); ;}
+  case 4: /* command: load_command  */
+#line 148 "SqlParser.y"
+                     { fprintf(stdout, "Bruinbase> "); }
+#line 1370 "SqlParser.tab.c"
     break;
 
-  case 5:
-#line 57 "SqlParser.y"
-    { fprintf(stdout, "Bruinbase> "); ;}
+  case 5: /* command: create_command  */
+#line 149 "SqlParser.y"
+                         { fprintf(stdout, "Bruinbase> "); }
+#line 1376 "SqlParser.tab.c"
     break;
 
-  case 7:
-#line 59 "SqlParser.y"
-    { fprintf(stdout, "Bruinbase> "); ;}
+  case 6: /* command: optimize_command  */
+#line 150 "SqlParser.y"
+                           { fprintf(stdout, "Bruinbase> "); }
+#line 1382 "SqlParser.tab.c"
     break;
 
-  case 8:
-#line 60 "SqlParser.y"
-    { fprintf(stdout, "Bruinbase> "); ;}
+  case 7: /* command: reindex_command  */
+#line 151 "SqlParser.y"
+                          { fprintf(stdout, "Bruinbase> "); }
+#line 1388 "SqlParser.tab.c"
     break;
 
-  case 9:
-#line 64 "SqlParser.y"
-    { return 0; ;}
+  case 8: /* command: analyze_command  */
+#line 152 "SqlParser.y"
+                          { fprintf(stdout, "Bruinbase> "); }
+#line 1394 "SqlParser.tab.c"
     break;
 
-  case 10:
-#line 68 "SqlParser.y"
-    { 
-	  SqlEngine::load(std::string((yyvsp[(2) - (5)].string)), std::string((yyvsp[(4) - (5)].string)), false); 
-	  free((yyvsp[(2) - (5)].string));
-	  free((yyvsp[(4) - (5)].string));
-	;}
+  case 9: /* command: select_command  */
+#line 153 "SqlParser.y"
+                         { fprintf(stdout, "Bruinbase> "); }
+#line 1400 "SqlParser.tab.c"
     break;
 
-  case 11:
-#line 73 "SqlParser.y"
-    { 
-	  SqlEngine::load(std::string((yyvsp[(2) - (7)].string)), std::string((yyvsp[(4) - (7)].string)), true); 
-	  free((yyvsp[(2) - (7)].string));
-	  free((yyvsp[(4) - (7)].string));
-	;}
+  case 11: /* command: error LF  */
+#line 155 "SqlParser.y"
+                   { fprintf(stdout, "Bruinbase> "); }
+#line 1406 "SqlParser.tab.c"
     break;
 
-  case 12:
-#line 81 "SqlParser.y"
-    {
+  case 12: /* command: LF  */
+#line 156 "SqlParser.y"
+             { fprintf(stdout, "Bruinbase> "); }
+#line 1412 "SqlParser.tab.c"
+    break;
+
+  case 13: /* quit_command: QUIT  */
+#line 160 "SqlParser.y"
+             { return 0; }
+#line 1418 "SqlParser.tab.c"
+    break;
+
+  case 14: /* load_command: LOAD table FROM STRING load_opts append_opt LF  */
+#line 164 "SqlParser.y"
+                                                       { 
+	  runLoad((yyvsp[-5].string), (yyvsp[-3].string), (yyvsp[-2].integer) | (yyvsp[-1].integer));
+	  free((yyvsp[-5].string));
+	  free((yyvsp[-3].string));
+	}
+#line 1428 "SqlParser.tab.c"
+    break;
+
+  case 15: /* load_command: LOAD table FROM ID load_opts append_opt LF  */
+#line 169 "SqlParser.y"
+                                                     {
+	  /* the tuples follow the command on the standard input */
+	  if (strcasecmp((yyvsp[-3].string), "stdin") == 0) runLoad((yyvsp[-5].string), "-", (yyvsp[-2].integer) | (yyvsp[-1].integer));
+	  else sqlerror("a load file must be a quoted file name or STDIN");
+	  free((yyvsp[-5].string));
+	  free((yyvsp[-3].string));
+	}
+#line 1440 "SqlParser.tab.c"
+    break;
+
+  case 16: /* load_opts: %empty  */
+#line 180 "SqlParser.y"
+                                       { (yyval.integer) = 0; }
+#line 1446 "SqlParser.tab.c"
+    break;
+
+  case 17: /* load_opts: WITH index_list  */
+#line 181 "SqlParser.y"
+                                       { (yyval.integer) = (yyvsp[0].integer); }
+#line 1452 "SqlParser.tab.c"
+    break;
+
+  case 18: /* load_opts: CLUSTERED  */
+#line 182 "SqlParser.y"
+                                       { (yyval.integer) = 8; }
+#line 1458 "SqlParser.tab.c"
+    break;
+
+  case 19: /* load_opts: CLUSTERED WITH index_list  */
+#line 183 "SqlParser.y"
+                                       { (yyval.integer) = 8 | (yyvsp[0].integer); }
+#line 1464 "SqlParser.tab.c"
+    break;
+
+  case 20: /* append_opt: %empty  */
+#line 188 "SqlParser.y"
+                                       { (yyval.integer) = 0; }
+#line 1470 "SqlParser.tab.c"
+    break;
+
+  case 21: /* append_opt: APPEND  */
+#line 189 "SqlParser.y"
+                                       { (yyval.integer) = 16; }
+#line 1476 "SqlParser.tab.c"
+    break;
+
+  case 22: /* index_list: index_item  */
+#line 193 "SqlParser.y"
+                                       { (yyval.integer) = (yyvsp[0].integer); }
+#line 1482 "SqlParser.tab.c"
+    break;
+
+  case 23: /* index_list: index_list COMMA index_item  */
+#line 194 "SqlParser.y"
+                                       { (yyval.integer) = (yyvsp[-2].integer) | (yyvsp[0].integer); }
+#line 1488 "SqlParser.tab.c"
+    break;
+
+  case 24: /* index_item: INDEX  */
+#line 200 "SqlParser.y"
+                             { (yyval.integer) = 1; }
+#line 1494 "SqlParser.tab.c"
+    break;
+
+  case 25: /* index_item: ID INDEX  */
+#line 201 "SqlParser.y"
+                   {
+		if (strcasecmp((yyvsp[-1].string), "key") == 0) (yyval.integer) = 1;
+		else if (strcasecmp((yyvsp[-1].string), "value") == 0) (yyval.integer) = 2;
+		else if (strcasecmp((yyvsp[-1].string), "compressed") == 0) (yyval.integer) = 1 | 4;
+		else if (strcasecmp((yyvsp[-1].string), "lsm") == 0) (yyval.integer) = 32;
+		else { free((yyvsp[-1].string)); sqlerror("the index must be key, value, compressed or lsm"); YYERROR; }
+		free((yyvsp[-1].string));
+	}
+#line 1507 "SqlParser.tab.c"
+    break;
+
+  case 26: /* create_command: CREATE INDEX ON table LPAREN attribute RPAREN LF  */
+#line 212 "SqlParser.y"
+                                                         {
+	  SqlEngine::createIndex(std::string((yyvsp[-4].string)), (yyvsp[-2].integer));
+	  free((yyvsp[-4].string));
+	}
+#line 1516 "SqlParser.tab.c"
+    break;
+
+  case 27: /* optimize_command: OPTIMIZE TABLE table LF  */
+#line 219 "SqlParser.y"
+                                {
+	  SqlEngine::optimize(std::string((yyvsp[-1].string)));
+	  free((yyvsp[-1].string));
+	}
+#line 1525 "SqlParser.tab.c"
+    break;
+
+  case 28: /* reindex_command: REINDEX table LF  */
+#line 226 "SqlParser.y"
+                         {
+	  SqlEngine::reindex(std::string((yyvsp[-1].string)), 100);
+	  free((yyvsp[-1].string));
+	}
+#line 1534 "SqlParser.tab.c"
+    break;
+
+  case 29: /* reindex_command: REINDEX table FILLFACTOR INTEGER LF  */
+#line 230 "SqlParser.y"
+                                              {
+	  SqlEngine::reindex(std::string((yyvsp[-3].string)), atoi((yyvsp[-1].string)));
+	  free((yyvsp[-3].string));
+	  free((yyvsp[-1].string));
+	}
+#line 1544 "SqlParser.tab.c"
+    break;
+
+  case 30: /* analyze_command: ANALYZE table LF  */
+#line 238 "SqlParser.y"
+                         {
+	  SqlEngine::analyze(std::string((yyvsp[-1].string)));
+	  free((yyvsp[-1].string));
+	}
+#line 1553 "SqlParser.tab.c"
+    break;
+
+  case 31: /* select_command: SELECT attributes FROM table select_opts LF  */
+#line 245 "SqlParser.y"
+                                                    {
    	        std::vector<SelCond> conds;
-		runSelect((yyvsp[(2) - (5)].integer), (yyvsp[(4) - (5)].string), conds);
-		free((yyvsp[(4) - (5)].string));
-	;}
+		runSelect((yyvsp[-4].integer), (yyvsp[-2].string), conds, *(yyvsp[-1].opts));
+		free((yyvsp[-2].string));
+		delete (yyvsp[-1].opts);
+	}
+#line 1564 "SqlParser.tab.c"
     break;
 
-  case 13:
-#line 86 "SqlParser.y"
-    {
-	        runSelect((yyvsp[(2) - (7)].integer), (yyvsp[(4) - (7)].string), *(yyvsp[(6) - (7)].conds));
-	  	free((yyvsp[(4) - (7)].string));
-	  	for (unsigned i = 0; i < (yyvsp[(6) - (7)].conds)->size(); i++) {
-		    free((*(yyvsp[(6) - (7)].conds))[i].value);
-		}
-	  	delete (yyvsp[(6) - (7)].conds);
-	;}
+  case 32: /* select_command: SELECT attributes FROM table WHERE conditions select_opts LF  */
+#line 251 "SqlParser.y"
+                                                                       {
+	        runSelect((yyvsp[-6].integer), (yyvsp[-4].string), *(yyvsp[-2].conds), *(yyvsp[-1].opts));
+	  	free((yyvsp[-4].string));
+	  	freeConds((yyvsp[-2].conds));
+		delete (yyvsp[-1].opts);
+	}
+#line 1575 "SqlParser.tab.c"
     break;
 
-  case 14:
-#line 97 "SqlParser.y"
-    {
+  case 33: /* select_command: SELECT attributes FROM table COMMA table WHERE conditions select_opts LF  */
+#line 257 "SqlParser.y"
+                                                                                   {
+		std::vector<SelAttr> attrs;
+		if ((yyvsp[-8].integer) != 3 && (yyvsp[-8].integer) != 4) sqlerror("the attributes of a join must be qualified by their tables");
+		else runJoin((yyvsp[-8].integer), attrs, (yyvsp[-6].string), (yyvsp[-4].string), *(yyvsp[-2].conds), *(yyvsp[-1].opts));
+		free((yyvsp[-6].string));
+		free((yyvsp[-4].string));
+		freeConds((yyvsp[-2].conds));
+		delete (yyvsp[-1].opts);
+	}
+#line 1589 "SqlParser.tab.c"
+    break;
+
+  case 34: /* select_command: SELECT qattributes FROM table COMMA table WHERE conditions select_opts LF  */
+#line 266 "SqlParser.y"
+                                                                                    {
+		runJoin(0, *(yyvsp[-8].qattrs), (yyvsp[-6].string), (yyvsp[-4].string), *(yyvsp[-2].conds), *(yyvsp[-1].opts));
+		freeAttrs((yyvsp[-8].qattrs));
+		free((yyvsp[-6].string));
+		free((yyvsp[-4].string));
+		freeConds((yyvsp[-2].conds));
+		delete (yyvsp[-1].opts);
+	}
+#line 1602 "SqlParser.tab.c"
+    break;
+
+  case 35: /* select_command: SELECT attribute COMMA attributes FROM table select_opts LF  */
+#line 274 "SqlParser.y"
+                                                                      {
+   	        std::vector<SelCond> conds;
+		(yyvsp[-1].opts)->showGroup = true;
+		if ((yyvsp[-6].integer) != 2) sqlerror("only value can be selected with an aggregate");
+		else runSelect((yyvsp[-4].integer), (yyvsp[-2].string), conds, *(yyvsp[-1].opts));
+		free((yyvsp[-2].string));
+		delete (yyvsp[-1].opts);
+	}
+#line 1615 "SqlParser.tab.c"
+    break;
+
+  case 36: /* select_command: SELECT attribute COMMA attributes FROM table WHERE conditions select_opts LF  */
+#line 282 "SqlParser.y"
+                                                                                       {
+		(yyvsp[-1].opts)->showGroup = true;
+		if ((yyvsp[-8].integer) != 2) sqlerror("only value can be selected with an aggregate");
+		else runSelect((yyvsp[-6].integer), (yyvsp[-4].string), *(yyvsp[-2].conds), *(yyvsp[-1].opts));
+		free((yyvsp[-4].string));
+		freeConds((yyvsp[-2].conds));
+		delete (yyvsp[-1].opts);
+	}
+#line 1628 "SqlParser.tab.c"
+    break;
+
+  case 37: /* select_opts: group_clause order_clause limit_clause  */
+#line 293 "SqlParser.y"
+                                               {
+	  (yyvsp[-1].opts)->groupAttr = (yyvsp[-2].integer);
+	  (yyvsp[-1].opts)->showGroup = false;
+	  (yyvsp[-1].opts)->limit = (yyvsp[0].opts)->limit;
+	  (yyvsp[-1].opts)->offset = (yyvsp[0].opts)->offset;
+	  delete (yyvsp[0].opts);
+	  (yyval.opts) = (yyvsp[-1].opts);
+	}
+#line 1641 "SqlParser.tab.c"
+    break;
+
+  case 38: /* group_clause: %empty  */
+#line 304 "SqlParser.y"
+                                 { (yyval.integer) = 0; }
+#line 1647 "SqlParser.tab.c"
+    break;
+
+  case 39: /* group_clause: GROUP BY attribute  */
+#line 305 "SqlParser.y"
+                                 { (yyval.integer) = (yyvsp[0].integer); }
+#line 1653 "SqlParser.tab.c"
+    break;
+
+  case 40: /* order_clause: %empty  */
+#line 309 "SqlParser.y"
+                    {
+	  SelOpts* o = new SelOpts;
+	  o->orderAttr = 0;
+	  o->desc = false;
+	  (yyval.opts) = o;
+	}
+#line 1664 "SqlParser.tab.c"
+    break;
+
+  case 41: /* order_clause: ORDER BY attribute order_dir  */
+#line 315 "SqlParser.y"
+                                       {
+	  SelOpts* o = new SelOpts;
+	  o->orderAttr = (yyvsp[-1].integer);
+	  o->desc = ((yyvsp[0].integer) != 0);
+	  (yyval.opts) = o;
+	}
+#line 1675 "SqlParser.tab.c"
+    break;
+
+  case 42: /* order_dir: %empty  */
+#line 324 "SqlParser.y"
+                    { (yyval.integer) = 0; }
+#line 1681 "SqlParser.tab.c"
+    break;
+
+  case 43: /* order_dir: ASC  */
+#line 325 "SqlParser.y"
+                    { (yyval.integer) = 0; }
+#line 1687 "SqlParser.tab.c"
+    break;
+
+  case 44: /* order_dir: DESC  */
+#line 326 "SqlParser.y"
+                    { (yyval.integer) = 1; }
+#line 1693 "SqlParser.tab.c"
+    break;
+
+  case 45: /* limit_clause: %empty  */
+#line 330 "SqlParser.y"
+                    {
+	  SelOpts* o = new SelOpts;
+	  o->limit = -1;
+	  o->offset = 0;
+	  (yyval.opts) = o;
+	}
+#line 1704 "SqlParser.tab.c"
+    break;
+
+  case 46: /* limit_clause: LIMIT INTEGER  */
+#line 336 "SqlParser.y"
+                        {
+	  SelOpts* o = new SelOpts;
+	  o->limit = atoi((yyvsp[0].string));
+	  o->offset = 0;
+	  free((yyvsp[0].string));
+	  if (o->limit < 0) { delete o; sqlerror("LIMIT must not be negative"); YYERROR; }
+	  (yyval.opts) = o;
+	}
+#line 1717 "SqlParser.tab.c"
+    break;
+
+  case 47: /* limit_clause: LIMIT INTEGER OFFSET INTEGER  */
+#line 344 "SqlParser.y"
+                                       {
+	  SelOpts* o = new SelOpts;
+	  o->limit = atoi((yyvsp[-2].string));
+	  o->offset = atoi((yyvsp[0].string));
+	  free((yyvsp[-2].string));
+	  free((yyvsp[0].string));
+	  if (o->limit < 0 || o->offset < 0) { delete o; sqlerror("LIMIT and OFFSET must not be negative"); YYERROR; }
+	  (yyval.opts) = o;
+	}
+#line 1731 "SqlParser.tab.c"
+    break;
+
+  case 48: /* conditions: conjunction  */
+#line 358 "SqlParser.y"
+                    { (yyval.conds) = (yyvsp[0].conds); }
+#line 1737 "SqlParser.tab.c"
+    break;
+
+  case 49: /* conditions: key_ranges OR conjunction  */
+#line 359 "SqlParser.y"
+                                    {
+	  std::vector<KeyRange>* r = makeRanges((yyvsp[0].conds));
+	  if (r == NULL) { delete (yyvsp[-2].ranges); sqlerror("OR is supported between conditions on the key only"); YYERROR; }
+	  (yyvsp[-2].ranges)->insert((yyvsp[-2].ranges)->end(), r->begin(), r->end());
+	  delete r;
+	  SqlEngine::mergeRanges(*(yyvsp[-2].ranges));
 	  std::vector<SelCond>* v = new std::vector<SelCond>;
-	  v->push_back(*(yyvsp[(1) - (1)].cond));
+	  v->push_back(makeCond(1, SelCond::IN, NULL));
+	  v->back().ranges = (yyvsp[-2].ranges);
 	  (yyval.conds) = v;
-          delete (yyvsp[(1) - (1)].cond);
-	;}
+	}
+#line 1753 "SqlParser.tab.c"
     break;
 
-  case 15:
-#line 103 "SqlParser.y"
-    {
-	  (yyvsp[(1) - (3)].conds)->push_back(*(yyvsp[(3) - (3)].cond));
-	  (yyval.conds) = (yyvsp[(1) - (3)].conds);
-          delete (yyvsp[(3) - (3)].cond);
-	;}
+  case 50: /* key_ranges: conjunction  */
+#line 373 "SqlParser.y"
+                    {
+	  (yyval.ranges) = makeRanges((yyvsp[0].conds));
+	  if ((yyval.ranges) == NULL) { sqlerror("OR is supported between conditions on the key only"); YYERROR; }
+	}
+#line 1762 "SqlParser.tab.c"
+    break;
+
+  case 51: /* key_ranges: key_ranges OR conjunction  */
+#line 377 "SqlParser.y"
+                                    {
+	  std::vector<KeyRange>* r = makeRanges((yyvsp[0].conds));
+	  if (r == NULL) { delete (yyvsp[-2].ranges); sqlerror("OR is supported between conditions on the key only"); YYERROR; }
+	  (yyvsp[-2].ranges)->insert((yyvsp[-2].ranges)->end(), r->begin(), r->end());
+	  delete r;
+	  (yyval.ranges) = (yyvsp[-2].ranges);
+	}
+#line 1774 "SqlParser.tab.c"
+    break;
+
+  case 52: /* conjunction: predicate  */
+#line 387 "SqlParser.y"
+                  { (yyval.conds) = (yyvsp[0].conds); }
+#line 1780 "SqlParser.tab.c"
+    break;
+
+  case 53: /* conjunction: conjunction AND predicate  */
+#line 388 "SqlParser.y"
+                                    {
+	  (yyvsp[-2].conds)->insert((yyvsp[-2].conds)->end(), (yyvsp[0].conds)->begin(), (yyvsp[0].conds)->end());
+	  delete (yyvsp[0].conds);
+	  (yyval.conds) = (yyvsp[-2].conds);
+	}
+#line 1790 "SqlParser.tab.c"
+    break;
+
+  case 54: /* predicate: condition  */
+#line 396 "SqlParser.y"
+                  {
+	  std::vector<SelCond>* v = new std::vector<SelCond>;
+	  v->push_back(*(yyvsp[0].cond));
+	  (yyval.conds) = v;
+	  delete (yyvsp[0].cond);
+	}
+#line 1801 "SqlParser.tab.c"
+    break;
+
+  case 55: /* predicate: attribute BETWEEN value AND value  */
+#line 402 "SqlParser.y"
+                                            {
+	  std::vector<SelCond>* v = new std::vector<SelCond>;
+	  v->push_back(makeCond((yyvsp[-4].integer), SelCond::GE, (yyvsp[-2].string)));
+	  v->push_back(makeCond((yyvsp[-4].integer), SelCond::LE, (yyvsp[0].string)));
+	  (yyval.conds) = v;
+	}
+#line 1812 "SqlParser.tab.c"
+    break;
+
+  case 56: /* predicate: attribute IN LPAREN key_list RPAREN  */
+#line 408 "SqlParser.y"
+                                              {
+	  if ((yyvsp[-4].integer) != 1) { delete (yyvsp[-1].ranges); sqlerror("IN is supported on the key only"); YYERROR; }
+	  SqlEngine::mergeRanges(*(yyvsp[-1].ranges));
+	  std::vector<SelCond>* v = new std::vector<SelCond>;
+	  v->push_back(makeCond(1, SelCond::IN, NULL));
+	  v->back().ranges = (yyvsp[-1].ranges);
+	  (yyval.conds) = v;
+	}
+#line 1825 "SqlParser.tab.c"
+    break;
+
+  case 57: /* key_list: INTEGER  */
+#line 420 "SqlParser.y"
+                {
+	  KeyRange r;
+	  r.low = r.high = atoi((yyvsp[0].string));
+	  free((yyvsp[0].string));
+	  (yyval.ranges) = new std::vector<KeyRange>(1, r);
+	}
+#line 1836 "SqlParser.tab.c"
+    break;
+
+  case 58: /* key_list: key_list COMMA INTEGER  */
+#line 426 "SqlParser.y"
+                                 {
+	  KeyRange r;
+	  r.low = r.high = atoi((yyvsp[0].string));
+	  free((yyvsp[0].string));
+	  (yyvsp[-2].ranges)->push_back(r);
+	  (yyval.ranges) = (yyvsp[-2].ranges);
+	}
+#line 1848 "SqlParser.tab.c"
+    break;
+
+  case 59: /* condition: attribute comparator value  */
+#line 436 "SqlParser.y"
+                                   { 
+	  SelCond* c = new SelCond;
+	  c->attr = (yyvsp[-2].integer);
+	  c->comp = static_cast<SelCond::Comparator>((yyvsp[-1].integer));
+	  c->value = (yyvsp[0].string);
+	  c->table = NULL;
+	  c->joinTable = NULL;
+	  c->ranges = NULL;
+	  (yyval.cond) = c;
+        }
+#line 1863 "SqlParser.tab.c"
+    break;
+
+  case 60: /* condition: qattribute comparator value  */
+#line 446 "SqlParser.y"
+                                      {
+	  SelCond* c = new SelCond;
+	  c->attr = (yyvsp[-2].qattr)->attr;
+	  c->comp = static_cast<SelCond::Comparator>((yyvsp[-1].integer));
+	  c->value = (yyvsp[0].string);
+	  c->table = (yyvsp[-2].qattr)->table;
+	  c->joinTable = NULL;
+	  c->ranges = NULL;
+	  delete (yyvsp[-2].qattr);
+	  (yyval.cond) = c;
+	}
+#line 1879 "SqlParser.tab.c"
     break;
 
-  case 16:
-#line 111 "SqlParser.y"
-    { 
+  case 61: /* condition: qattribute EQUAL qattribute  */
+#line 457 "SqlParser.y"
+                                      {
 	  SelCond* c = new SelCond;
-	  c->attr = (yyvsp[(1) - (3)].integer);
-	  c->comp = static_cast<SelCond::Comparator>((yyvsp[(2) - (3)].integer));
-	  c->value = (yyvsp[(3) - (3)].string);
+	  c->attr = (yyvsp[-2].qattr)->attr;
+	  c->comp = SelCond::EQ;
+	  c->value = NULL;
+	  c->table = (yyvsp[-2].qattr)->table;
+	  c->joinTable = (yyvsp[0].qattr)->table;
+	  c->joinAttr = (yyvsp[0].qattr)->attr;
+	  c->ranges = NULL;
+	  delete (yyvsp[-2].qattr);
+	  delete (yyvsp[0].qattr);
 	  (yyval.cond) = c;
-        ;}
+	}
+#line 1897 "SqlParser.tab.c"
+    break;
+
+  case 62: /* qattributes: qattribute  */
+#line 473 "SqlParser.y"
+                   {
+	  std::vector<SelAttr>* v = new std::vector<SelAttr>;
+	  v->push_back(*(yyvsp[0].qattr));
+	  delete (yyvsp[0].qattr);
+	  (yyval.qattrs) = v;
+	}
+#line 1908 "SqlParser.tab.c"
+    break;
+
+  case 63: /* qattributes: qattributes COMMA qattribute  */
+#line 479 "SqlParser.y"
+                                       {
+	  (yyvsp[-2].qattrs)->push_back(*(yyvsp[0].qattr));
+	  delete (yyvsp[0].qattr);
+	  (yyval.qattrs) = (yyvsp[-2].qattrs);
+	}
+#line 1918 "SqlParser.tab.c"
+    break;
+
+  case 64: /* qattribute: QID  */
+#line 487 "SqlParser.y"
+            {
+	  // split "table.attribute"
+	  SelAttr* a = new SelAttr;
+	  char* dot = strchr((yyvsp[0].string), '.');
+	  *dot = 0;
+	  a->table = (yyvsp[0].string);
+	  if (strcasecmp(dot + 1, "key") == 0) a->attr = 1;
+	  else if (strcasecmp(dot + 1, "value") == 0) a->attr = 2;
+	  else { a->attr = 0; sqlerror("wrong attribute name. neither key or value"); }
+	  (yyval.qattr) = a;
+	}
+#line 1934 "SqlParser.tab.c"
+    break;
+
+  case 65: /* attributes: attribute  */
+#line 501 "SqlParser.y"
+                  { (yyval.integer) = (yyvsp[0].integer); }
+#line 1940 "SqlParser.tab.c"
+    break;
+
+  case 66: /* attributes: STAR  */
+#line 502 "SqlParser.y"
+                { (yyval.integer) = 3; }
+#line 1946 "SqlParser.tab.c"
     break;
 
-  case 17:
-#line 121 "SqlParser.y"
-    { (yyval.integer) = (yyvsp[(1) - (1)].integer); ;}
+  case 67: /* attributes: COUNT  */
+#line 503 "SqlParser.y"
+                { (yyval.integer) = 4; }
+#line 1952 "SqlParser.tab.c"
     break;
 
-  case 18:
-#line 122 "SqlParser.y"
-    { (yyval.integer) = 3; ;}
+  case 68: /* attributes: aggregate LPAREN attribute RPAREN  */
+#line 504 "SqlParser.y"
+                                            {
+		if ((yyvsp[-1].integer) == 1) (yyval.integer) = (yyvsp[-3].integer);
+		else if ((yyvsp[-3].integer) == 5 || (yyvsp[-3].integer) == 6) (yyval.integer) = (yyvsp[-3].integer) + 4;
+		else { sqlerror("SUM and AVG take the key column only"); YYERROR; }
+	}
+#line 1962 "SqlParser.tab.c"
+    break;
+
+  case 69: /* aggregate: MIN  */
+#line 512 "SqlParser.y"
+              { (yyval.integer) = 5; }
+#line 1968 "SqlParser.tab.c"
+    break;
+
+  case 70: /* aggregate: MAX  */
+#line 513 "SqlParser.y"
+              { (yyval.integer) = 6; }
+#line 1974 "SqlParser.tab.c"
+    break;
+
+  case 71: /* aggregate: SUM  */
+#line 514 "SqlParser.y"
+              { (yyval.integer) = 7; }
+#line 1980 "SqlParser.tab.c"
     break;
 
-  case 19:
-#line 123 "SqlParser.y"
-    { (yyval.integer) = 4; ;}
+  case 72: /* aggregate: AVG  */
+#line 515 "SqlParser.y"
+              { (yyval.integer) = 8; }
+#line 1986 "SqlParser.tab.c"
     break;
 
-  case 20:
-#line 127 "SqlParser.y"
-    { 
-		if (strcasecmp((yyvsp[(1) - (1)].string), "key") == 0) (yyval.integer)=1;
-		else if (strcasecmp((yyvsp[(1) - (1)].string), "value") == 0) (yyval.integer)=2;
+  case 73: /* attribute: ID  */
+#line 519 "SqlParser.y"
+           { 
+		if (strcasecmp((yyvsp[0].string), "key") == 0) (yyval.integer)=1;
+		else if (strcasecmp((yyvsp[0].string), "value") == 0) (yyval.integer)=2;
 		else sqlerror("wrong attribute name. neither key or value");
-		free((yyvsp[(1) - (1)].string));
-	;}
+		free((yyvsp[0].string));
+	}
+#line 1997 "SqlParser.tab.c"
     break;
 
-  case 21:
-#line 135 "SqlParser.y"
-    { (yyval.string) = (yyvsp[(1) - (1)].string); ;}
+  case 74: /* value: INTEGER  */
+#line 527 "SqlParser.y"
+                 { (yyval.string) = (yyvsp[0].string); }
+#line 2003 "SqlParser.tab.c"
     break;
 
-  case 22:
-#line 136 "SqlParser.y"
-    { (yyval.string) = (yyvsp[(1) - (1)].string); ;}
+  case 75: /* value: STRING  */
+#line 528 "SqlParser.y"
+                 { (yyval.string) = (yyvsp[0].string); }
+#line 2009 "SqlParser.tab.c"
     break;
 
-  case 23:
-#line 140 "SqlParser.y"
-    { (yyval.string) = (yyvsp[(1) - (1)].string); ;}
+  case 76: /* table: ID  */
+#line 532 "SqlParser.y"
+           { (yyval.string) = (yyvsp[0].string); }
+#line 2015 "SqlParser.tab.c"
     break;
 
-  case 24:
-#line 144 "SqlParser.y"
-    { (yyval.integer) = SelCond::EQ; ;}
+  case 77: /* comparator: EQUAL  */
+#line 536 "SqlParser.y"
+                       { (yyval.integer) = SelCond::EQ; }
+#line 2021 "SqlParser.tab.c"
     break;
 
-  case 25:
-#line 145 "SqlParser.y"
-    { (yyval.integer) = SelCond::NE; ;}
+  case 78: /* comparator: NEQUAL  */
+#line 537 "SqlParser.y"
+                       { (yyval.integer) = SelCond::NE; }
+#line 2027 "SqlParser.tab.c"
     break;
 
-  case 26:
-#line 146 "SqlParser.y"
-    { (yyval.integer) = SelCond::LT; ;}
+  case 79: /* comparator: LESS  */
+#line 538 "SqlParser.y"
+                       { (yyval.integer) = SelCond::LT; }
+#line 2033 "SqlParser.tab.c"
     break;
 
-  case 27:
-#line 147 "SqlParser.y"
-    { (yyval.integer) = SelCond::GT; ;}
+  case 80: /* comparator: GREATER  */
+#line 539 "SqlParser.y"
+                       { (yyval.integer) = SelCond::GT; }
+#line 2039 "SqlParser.tab.c"
     break;
 
-  case 28:
-#line 148 "SqlParser.y"
-    { (yyval.integer) = SelCond::LE; ;}
+  case 81: /* comparator: LESSEQUAL  */
+#line 540 "SqlParser.y"
+                       { (yyval.integer) = SelCond::LE; }
+#line 2045 "SqlParser.tab.c"
     break;
 
-  case 29:
-#line 149 "SqlParser.y"
-    { (yyval.integer) = SelCond::GE; ;}
+  case 82: /* comparator: GREATEREQUAL  */
+#line 541 "SqlParser.y"
+                       { (yyval.integer) = SelCond::GE; }
+#line 2051 "SqlParser.tab.c"
     break;
 
 
-/* Line 1267 of yacc.c.  */
-#line 1590 "SqlParser.tab.c"
+#line 2055 "SqlParser.tab.c"
+
       default: break;
     }
-  YY_SYMBOL_PRINT ("-> $$ =", yyr1[yyn], &yyval, &yyloc);
+  /* User semantic actions sometimes alter yychar, and that requires
+     that yytoken be updated with the new translation.  We take the
+     approach of translating immediately before every use of yytoken.
+     One alternative is translating here after every semantic action,
+     but that translation would be missed if the semantic action invokes
+     YYABORT, YYACCEPT, or YYERROR immediately after altering yychar or
+     if it invokes YYBACKUP.  In the case of YYABORT or YYACCEPT, an
+     incorrect destructor might then be invoked immediately.  In the
+     case of YYERROR or YYBACKUP, subsequent parser actions might lead
+     to an incorrect destructor call or verbose syntax error message
+     before the lookahead is translated.  */
+  YY_SYMBOL_PRINT ("-> $$ =", YY_CAST (yysymbol_kind_t, yyr1[yyn]), &yyval, &yyloc);
 
   YYPOPSTACK (yylen);
   yylen = 0;
-  YY_STACK_PRINT (yyss, yyssp);
 
   *++yyvsp = yyval;
 
-
-  /* Now `shift' the result of the reduction.  Determine what state
+  /* Now 'shift' the result of the reduction.  Determine what state
      that goes to, based on the state we popped back to and the rule
      number reduced by.  */
-
-  yyn = yyr1[yyn];
-
-  yystate = yypgoto[yyn - YYNTOKENS] + *yyssp;
-  if (0 <= yystate && yystate <= YYLAST && yycheck[yystate] == *yyssp)
-    yystate = yytable[yystate];
-  else
-    yystate = yydefgoto[yyn - YYNTOKENS];
+  {
+    const int yylhs = yyr1[yyn] - YYNTOKENS;
+    const int yyi = yypgoto[yylhs] + *yyssp;
+    yystate = (0 <= yyi && yyi <= YYLAST && yycheck[yyi] == *yyssp
+               ? yytable[yyi]
+               : yydefgoto[yylhs]);
+  }
 
   goto yynewstate;
 
 
-/*------------------------------------.
-| yyerrlab -- here on detecting error |
-`------------------------------------*/
+/*--------------------------------------.
+| yyerrlab -- here on detecting error.  |
+`--------------------------------------*/
 yyerrlab:
+  /* Make sure we have latest lookahead translation.  See comments at
+     user semantic actions for why this is necessary.  */
+  yytoken = yychar == YYEMPTY ? YYSYMBOL_YYEMPTY : YYTRANSLATE (yychar);
   /* If not already recovering from an error, report this error.  */
   if (!yyerrstatus)
     {
       ++yynerrs;
-#if ! YYERROR_VERBOSE
       yyerror (YY_("syntax error"));
-#else
-      {
-	YYSIZE_T yysize = yysyntax_error (0, yystate, yychar);
-	if (yymsg_alloc < yysize && yymsg_alloc < YYSTACK_ALLOC_MAXIMUM)
-	  {
-	    YYSIZE_T yyalloc = 2 * yysize;
-	    if (! (yysize <= yyalloc && yyalloc <= YYSTACK_ALLOC_MAXIMUM))
-	      yyalloc = YYSTACK_ALLOC_MAXIMUM;
-	    if (yymsg != yymsgbuf)
-	      YYSTACK_FREE (yymsg);
-	    yymsg = (char *) YYSTACK_ALLOC (yyalloc);
-	    if (yymsg)
-	      yymsg_alloc = yyalloc;
-	    else
-	      {
-		yymsg = yymsgbuf;
-		yymsg_alloc = sizeof yymsgbuf;
-	      }
-	  }
-
-	if (0 < yysize && yysize <= yymsg_alloc)
-	  {
-	    (void) yysyntax_error (yymsg, yystate, yychar);
-	    yyerror (yymsg);
-	  }
-	else
-	  {
-	    yyerror (YY_("syntax error"));
-	    if (yysize != 0)
-	      goto yyexhaustedlab;
-	  }
-      }
-#endif
     }
 
-
-
   if (yyerrstatus == 3)
     {
-      /* If just tried and failed to reuse look-ahead token after an
-	 error, discard it.  */
+      /* If just tried and failed to reuse lookahead token after an
+         error, discard it.  */
 
       if (yychar <= YYEOF)
-	{
-	  /* Return failure if at end of input.  */
-	  if (yychar == YYEOF)
-	    YYABORT;
-	}
+        {
+          /* Return failure if at end of input.  */
+          if (yychar == YYEOF)
+            YYABORT;
+        }
       else
-	{
-	  yydestruct ("Error: discarding",
-		      yytoken, &yylval);
-	  yychar = YYEMPTY;
-	}
+        {
+          yydestruct ("Error: discarding",
+                      yytoken, &yylval);
+          yychar = YYEMPTY;
+        }
     }
 
-  /* Else will try to reuse look-ahead token after shifting the error
+  /* Else will try to reuse lookahead token after shifting the error
      token.  */
   goto yyerrlab1;
 
@@ -1688,14 +2129,13 @@ yyerrlab:
 | yyerrorlab -- error raised explicitly by YYERROR.  |
 `---------------------------------------------------*/
 yyerrorlab:
+  /* Pacify compilers when the user code never invokes YYERROR and the
+     label yyerrorlab therefore never appears in user code.  */
+  if (0)
+    YYERROR;
+  ++yynerrs;
 
-  /* Pacify compilers like GCC when the user code never invokes
-     YYERROR and the label yyerrorlab therefore never appears in user
-     code.  */
-  if (/*CONSTCOND*/ 0)
-     goto yyerrorlab;
-
-  /* Do not reclaim the symbols of the rule which action triggered
+  /* Do not reclaim the symbols of the rule whose action triggered
      this YYERROR.  */
   YYPOPSTACK (yylen);
   yylen = 0;
@@ -1708,42 +2148,42 @@ yyerrorlab:
 | yyerrlab1 -- common code for both syntax error and YYERROR.  |
 `-------------------------------------------------------------*/
 yyerrlab1:
-  yyerrstatus = 3;	/* Each real token shifted decrements this.  */
+  yyerrstatus = 3;      /* Each real token shifted decrements this.  */
 
+  /* Pop stack until we find a state that shifts the error token.  */
   for (;;)
     {
       yyn = yypact[yystate];
-      if (yyn != YYPACT_NINF)
-	{
-	  yyn += YYTERROR;
-	  if (0 <= yyn && yyn <= YYLAST && yycheck[yyn] == YYTERROR)
-	    {
-	      yyn = yytable[yyn];
-	      if (0 < yyn)
-		break;
-	    }
-	}
+      if (!yypact_value_is_default (yyn))
+        {
+          yyn += YYSYMBOL_YYerror;
+          if (0 <= yyn && yyn <= YYLAST && yycheck[yyn] == YYSYMBOL_YYerror)
+            {
+              yyn = yytable[yyn];
+              if (0 < yyn)
+                break;
+            }
+        }
 
       /* Pop the current state because it cannot handle the error token.  */
       if (yyssp == yyss)
-	YYABORT;
+        YYABORT;
 
 
       yydestruct ("Error: popping",
-		  yystos[yystate], yyvsp);
+                  YY_ACCESSING_SYMBOL (yystate), yyvsp);
       YYPOPSTACK (1);
       yystate = *yyssp;
       YY_STACK_PRINT (yyss, yyssp);
     }
 
-  if (yyn == YYFINAL)
-    YYACCEPT;
-
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
   *++yyvsp = yylval;
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
 
 
   /* Shift the error token.  */
-  YY_SYMBOL_PRINT ("Shifting", yystos[yyn], yyvsp, yylsp);
+  YY_SYMBOL_PRINT ("Shifting", YY_ACCESSING_SYMBOL (yyn), yyvsp, yylsp);
 
   yystate = yyn;
   goto yynewstate;
@@ -1754,50 +2194,53 @@ yyerrlab1:
 `-------------------------------------*/
 yyacceptlab:
   yyresult = 0;
-  goto yyreturn;
+  goto yyreturnlab;
+
 
 /*-----------------------------------.
 | yyabortlab -- YYABORT comes here.  |
 `-----------------------------------*/
 yyabortlab:
   yyresult = 1;
-  goto yyreturn;
+  goto yyreturnlab;
 
-#ifndef yyoverflow
-/*-------------------------------------------------.
-| yyexhaustedlab -- memory exhaustion comes here.  |
-`-------------------------------------------------*/
+
+/*-----------------------------------------------------------.
+| yyexhaustedlab -- YYNOMEM (memory exhaustion) comes here.  |
+`-----------------------------------------------------------*/
 yyexhaustedlab:
   yyerror (YY_("memory exhausted"));
   yyresult = 2;
-  /* Fall through.  */
-#endif
+  goto yyreturnlab;
+
 
-yyreturn:
-  if (yychar != YYEOF && yychar != YYEMPTY)
-     yydestruct ("Cleanup: discarding lookahead",
-		 yytoken, &yylval);
-  /* Do not reclaim the symbols of the rule which action triggered
+/*----------------------------------------------------------.
+| yyreturnlab -- parsing is finished, clean up and return.  |
+`----------------------------------------------------------*/
+yyreturnlab:
+  if (yychar != YYEMPTY)
+    {
+      /* Make sure we have latest lookahead translation.  See comments at
+         user semantic actions for why this is necessary.  */
+      yytoken = YYTRANSLATE (yychar);
+      yydestruct ("Cleanup: discarding lookahead",
+                  yytoken, &yylval);
+    }
+  /* Do not reclaim the symbols of the rule whose action triggered
      this YYABORT or YYACCEPT.  */
   YYPOPSTACK (yylen);
   YY_STACK_PRINT (yyss, yyssp);
   while (yyssp != yyss)
     {
       yydestruct ("Cleanup: popping",
-		  yystos[*yyssp], yyvsp);
+                  YY_ACCESSING_SYMBOL (+*yyssp), yyvsp);
       YYPOPSTACK (1);
     }
 #ifndef yyoverflow
   if (yyss != yyssa)
     YYSTACK_FREE (yyss);
 #endif
-#if YYERROR_VERBOSE
-  if (yymsg != yymsgbuf)
-    YYSTACK_FREE (yymsg);
-#endif
-  /* Make sure YYID is used.  */
-  return YYID (yyresult);
-}
-
 
+  return yyresult;
+}
 
@@ -1,14 +1,14 @@
-/* A Bison parser, made by GNU Bison 2.3.  */
+/* A Bison parser, made by GNU Bison 3.8.2.  */
 
-/* Skeleton interface for Bison's Yacc-like parsers in C
+/* Bison interface for Yacc-like parsers in C
 
-   Copyright (C) 1984, 1989, 1990, 2000, 2001, 2002, 2003, 2004, 2005, 2006
-   Free Software Foundation, Inc.
+   Copyright (C) 1984, 1989-1990, 2000-2015, 2018-2021 Free Software Foundation,
+   Inc.
 
-   This program is free software; you can redistribute it and/or modify
+   This program is free software: you can redistribute it and/or modify
    it under the terms of the GNU General Public License as published by
-   the Free Software Foundation; either version 2, or (at your option)
-   any later version.
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
 
    This program is distributed in the hope that it will be useful,
    but WITHOUT ANY WARRANTY; without even the implied warranty of
@@ -16,9 +16,7 @@
    GNU General Public License for more details.
 
    You should have received a copy of the GNU General Public License
-   along with this program; if not, write to the Free Software
-   Foundation, Inc., 51 Franklin Street, Fifth Floor,
-   Boston, MA 02110-1301, USA.  */
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
 
 /* As a special exception, you may create a larger work that contains
    part or all of the Bison parser skeleton and distribute that work
@@ -33,79 +31,108 @@
    This special exception was added by the Free Software Foundation in
    version 2.2 of Bison.  */
 
-/* Tokens.  */
+/* DO NOT RELY ON FEATURES THAT ARE NOT DOCUMENTED in the manual,
+   especially those whose name start with YY_ or yy_.  They are
+   private implementation details that can be changed or removed.  */
+
+#ifndef YY_SQL_SQLPARSER_TAB_H_INCLUDED
+# define YY_SQL_SQLPARSER_TAB_H_INCLUDED
+/* Debug traces.  */
+#ifndef YYDEBUG
+# define YYDEBUG 0
+#endif
+#if YYDEBUG
+extern int sqldebug;
+#endif
+
+/* Token kinds.  */
 #ifndef YYTOKENTYPE
 # define YYTOKENTYPE
-   /* Put the tokens into the symbol table, so that GDB and other debuggers
-      know about them.  */
-   enum yytokentype {
-     SELECT = 258,
-     FROM = 259,
-     WHERE = 260,
-     LOAD = 261,
-     WITH = 262,
-     INDEX = 263,
-     QUIT = 264,
-     COUNT = 265,
-     AND = 266,
-     OR = 267,
-     COMMA = 268,
-     STAR = 269,
-     LF = 270,
-     INTEGER = 271,
-     STRING = 272,
-     ID = 273,
-     EQUAL = 274,
-     NEQUAL = 275,
-     LESS = 276,
-     LESSEQUAL = 277,
-     GREATER = 278,
-     GREATEREQUAL = 279
-   };
+  enum yytokentype
+  {
+    YYEMPTY = -2,
+    YYEOF = 0,                     /* "end of file"  */
+    YYerror = 256,                 /* error  */
+    YYUNDEF = 257,                 /* "invalid token"  */
+    SELECT = 258,                  /* SELECT  */
+    FROM = 259,                    /* FROM  */
+    WHERE = 260,                   /* WHERE  */
+    LOAD = 261,                    /* LOAD  */
+    APPEND = 262,                  /* APPEND  */
+    WITH = 263,                    /* WITH  */
+    INDEX = 264,                   /* INDEX  */
+    CREATE = 265,                  /* CREATE  */
+    ON = 266,                      /* ON  */
+    CLUSTERED = 267,               /* CLUSTERED  */
+    OPTIMIZE = 268,                /* OPTIMIZE  */
+    TABLE = 269,                   /* TABLE  */
+    REINDEX = 270,                 /* REINDEX  */
+    FILLFACTOR = 271,              /* FILLFACTOR  */
+    ANALYZE = 272,                 /* ANALYZE  */
+    QUIT = 273,                    /* QUIT  */
+    COUNT = 274,                   /* COUNT  */
+    AND = 275,                     /* AND  */
+    OR = 276,                      /* OR  */
+    LIMIT = 277,                   /* LIMIT  */
+    OFFSET = 278,                  /* OFFSET  */
+    ORDER = 279,                   /* ORDER  */
+    GROUP = 280,                   /* GROUP  */
+    BY = 281,                      /* BY  */
+    ASC = 282,                     /* ASC  */
+    DESC = 283,                    /* DESC  */
+    MIN = 284,                     /* MIN  */
+    MAX = 285,                     /* MAX  */
+    SUM = 286,                     /* SUM  */
+    AVG = 287,                     /* AVG  */
+    BETWEEN = 288,                 /* BETWEEN  */
+    IN = 289,                      /* IN  */
+    COMMA = 290,                   /* COMMA  */
+    STAR = 291,                    /* STAR  */
+    LF = 292,                      /* LF  */
+    LPAREN = 293,                  /* LPAREN  */
+    RPAREN = 294,                  /* RPAREN  */
+    INTEGER = 295,                 /* INTEGER  */
+    STRING = 296,                  /* STRING  */
+    ID = 297,                      /* ID  */
+    QID = 298,                     /* QID  */
+    EQUAL = 299,                   /* EQUAL  */
+    NEQUAL = 300,                  /* NEQUAL  */
+    LESS = 301,                    /* LESS  */
+    LESSEQUAL = 302,               /* LESSEQUAL  */
+    GREATER = 303,                 /* GREATER  */
+    GREATEREQUAL = 304             /* GREATEREQUAL  */
+  };
+  typedef enum yytokentype yytoken_kind_t;
 #endif
-/* Tokens.  */
-#define SELECT 258
-#define FROM 259
-#define WHERE 260
-#define LOAD 261
-#define WITH 262
-#define INDEX 263
-#define QUIT 264
-#define COUNT 265
-#define AND 266
-#define OR 267
-#define COMMA 268
-#define STAR 269
-#define LF 270
-#define INTEGER 271
-#define STRING 272
-#define ID 273
-#define EQUAL 274
-#define NEQUAL 275
-#define LESS 276
-#define LESSEQUAL 277
-#define GREATER 278
-#define GREATEREQUAL 279
-
-
-
 
+/* Value type.  */
 #if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
-typedef union YYSTYPE
-#line 32 "SqlParser.y"
+union YYSTYPE
 {
+#line 113 "SqlParser.y"
+
   int integer;
   char* string;
   SelCond* cond;
   std::vector<SelCond>* conds;
-}
-/* Line 1489 of yacc.c.  */
-#line 104 "SqlParser.tab.h"
-	YYSTYPE;
-# define yystype YYSTYPE /* obsolescent; will be withdrawn */
-# define YYSTYPE_IS_DECLARED 1
+  SelOpts* opts;
+  SelAttr* qattr;
+  std::vector<SelAttr>* qattrs;
+  std::vector<KeyRange>* ranges;
+
+#line 124 "SqlParser.tab.h"
+
+};
+typedef union YYSTYPE YYSTYPE;
 # define YYSTYPE_IS_TRIVIAL 1
+# define YYSTYPE_IS_DECLARED 1
 #endif
 
+
 extern YYSTYPE sqllval;
 
+
+int sqlparse (void);
+
+
+#endif /* !YY_SQL_SQLPARSER_TAB_H_INCLUDED  */
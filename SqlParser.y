@@ -2,6 +2,7 @@
 #include <cstdio>
 #include <cstring>
 #include <sys/times.h>
+#include <unistd.h>
 #include <climits>
 #include <string>
 #include "Bruinbase.h"
@@ -12,21 +13,101 @@ int  sqllex(void);
 void sqlerror(const char *str) { fprintf(stderr, "Error: %s\n", str); }
 extern "C" { int  sqlwrap() { return 1; } }
 
-static void runSelect(int attr, const char* table, const std::vector<SelCond>& conds)
-{
-  struct tms tmsbuf;
-  clock_t btime, etime;
-  int     bpagecnt, epagecnt;
+static struct tms tmsbuf;
+static clock_t btime;
+static int     bpagecnt;
 
+static void startTimer()
+{
   btime = times(&tmsbuf);
   bpagecnt = PageFile::getPageReadCount();
-  SqlEngine::select(attr, table, conds);
-  etime = times(&tmsbuf);
-  epagecnt = PageFile::getPageReadCount();
+}
+
+static void stopTimer()
+{
+  clock_t etime = times(&tmsbuf);
+  int     epagecnt = PageFile::getPageReadCount();
 
   fprintf(stderr, "  -- %.3f seconds to run the select command. Read %d pages\n", ((float)(etime - btime))/sysconf(_SC_CLK_TCK), epagecnt - bpagecnt);
 }
 
+static void runSelect(int attr, const char* table, const std::vector<SelCond>& conds, const SelOpts& opts)
+{
+  startTimer();
+  SqlEngine::select(attr, table, conds, opts);
+  stopTimer();
+}
+
+static void runJoin(int attr, const std::vector<SelAttr>& attrs, const char* table1,
+                    const char* table2, const std::vector<SelCond>& conds, const SelOpts& opts)
+{
+  startTimer();
+  SqlEngine::join(attr, attrs, table1, table2, conds, opts);
+  stopTimer();
+}
+
+static void runLoad(const char* table, const char* loadfile, int flags)
+{
+  LoadOpts opts;
+  opts.index = (flags & 1) != 0;
+  opts.valueIndex = (flags & 2) != 0;
+  opts.compressed = (flags & 4) != 0;
+  opts.clustered = (flags & 8) != 0;
+  opts.append = (flags & 16) != 0;
+  opts.lsm = (flags & 32) != 0;
+  SqlEngine::load(std::string(table), std::string(loadfile), opts);
+}
+
+static void freeConds(std::vector<SelCond>* conds)
+{
+  for (unsigned i = 0; i < conds->size(); i++) {
+    free((*conds)[i].value);
+    free((*conds)[i].table);
+    free((*conds)[i].joinTable);
+    delete (*conds)[i].ranges;
+  }
+  delete conds;
+}
+
+static SelCond makeCond(int attr, SelCond::Comparator comp, char* value)
+{
+  SelCond c;
+  c.attr = attr;
+  c.comp = comp;
+  c.value = value;
+  c.table = NULL;
+  c.joinTable = NULL;
+  c.joinAttr = 0;
+  c.ranges = NULL;
+  return c;
+}
+
+// the key ranges that satisfy one of the conjunctions in a chain of ORs.
+// NULL if a condition is not on the key of the table
+static std::vector<KeyRange>* makeRanges(std::vector<SelCond>* conds)
+{
+  std::vector<KeyRange>* ranges = NULL;
+  for (unsigned i = 0; i < conds->size(); i++) {
+    const SelCond& c = (*conds)[i];
+    if (c.attr != 1 || c.table != NULL || c.joinTable != NULL) {
+      freeConds(conds);
+      return NULL;
+    }
+  }
+  ranges = new std::vector<KeyRange>;
+  SqlEngine::keyRanges(*conds, *ranges);
+  freeConds(conds);
+  return ranges;
+}
+
+static void freeAttrs(std::vector<SelAttr>* attrs)
+{
+  for (unsigned i = 0; i < attrs->size(); i++) {
+    free((*attrs)[i].table);
+  }
+  delete attrs;
+}
+
 %}
 
 %union {
@@ -34,17 +115,28 @@ static void runSelect(int attr, const char* table, const std::vector<SelCond>& c
   char* string;
   SelCond* cond;
   std::vector<SelCond>* conds;
+  SelOpts* opts;
+  SelAttr* qattr;
+  std::vector<SelAttr>* qattrs;
+  std::vector<KeyRange>* ranges;
 }
 
-%token SELECT FROM WHERE LOAD WITH INDEX QUIT COUNT AND OR 
-%token COMMA STAR LF
-%token <string> INTEGER STRING ID
+%token SELECT FROM WHERE LOAD APPEND WITH INDEX CREATE ON CLUSTERED OPTIMIZE TABLE REINDEX FILLFACTOR ANALYZE QUIT COUNT AND OR LIMIT OFFSET
+%token ORDER GROUP BY ASC DESC MIN MAX SUM AVG BETWEEN IN
+%token COMMA STAR LF LPAREN RPAREN
+%token <string> INTEGER STRING ID QID
 %token EQUAL NEQUAL LESS LESSEQUAL GREATER GREATEREQUAL 
 
-%type <integer> attributes attribute comparator
+%type <integer> attributes attribute aggregate comparator group_clause
+%type <integer> load_opts append_opt index_list index_item
 %type <string> table value
 %type <cond> condition
-%type <conds> conditions
+%type <conds> conditions conjunction predicate
+%type <ranges> key_ranges key_list
+%type <qattr> qattribute
+%type <qattrs> qattributes
+%type <opts> select_opts order_clause limit_clause
+%type <integer> order_dir
 %%
 
 commands:
@@ -54,6 +146,10 @@ commands:
 
 command:
         load_command { fprintf(stdout, "Bruinbase> "); }
+	| create_command { fprintf(stdout, "Bruinbase> "); }
+	| optimize_command { fprintf(stdout, "Bruinbase> "); }
+	| reindex_command { fprintf(stdout, "Bruinbase> "); }
+	| analyze_command { fprintf(stdout, "Bruinbase> "); }
 	| select_command { fprintf(stdout, "Bruinbase> "); }
 	| quit_command
 	| error LF { fprintf(stdout, "Bruinbase> "); }
@@ -65,45 +161,274 @@ quit_command:
 	;
 
 load_command:
-	LOAD table FROM STRING LF { 
-	  SqlEngine::load(std::string($2), std::string($4), false); 
+	LOAD table FROM STRING load_opts append_opt LF { 
+	  runLoad($2, $4, $5 | $6);
 	  free($2);
 	  free($4);
 	}
-	| LOAD table FROM STRING WITH INDEX LF { 
-	  SqlEngine::load(std::string($2), std::string($4), true); 
+	| LOAD table FROM ID load_opts append_opt LF {
+	  /* the tuples follow the command on the standard input */
+	  if (strcasecmp($4, "stdin") == 0) runLoad($2, "-", $5 | $6);
+	  else sqlerror("a load file must be a quoted file name or STDIN");
 	  free($2);
 	  free($4);
 	}
 	;
 
+/* the index_item flags, and 8: the table is stored in key order */
+load_opts:
+	/* empty */                    { $$ = 0; }
+	| WITH index_list              { $$ = $2; }
+	| CLUSTERED                    { $$ = 8; }
+	| CLUSTERED WITH index_list    { $$ = 8 | $3; }
+	;
+
+/* 16: add to an existing table and all of its indexes */
+append_opt:
+	/* empty */                    { $$ = 0; }
+	| APPEND                       { $$ = 16; }
+	;
+
+index_list:
+	index_item                     { $$ = $1; }
+	| index_list COMMA index_item  { $$ = $1 | $3; }
+	;
+
+/* 1: key index, 2: value index, 4: key index with compressed leaves,
+   32: LSM key index */
+index_item:
+	INDEX                { $$ = 1; }
+	| ID INDEX {
+		if (strcasecmp($1, "key") == 0) $$ = 1;
+		else if (strcasecmp($1, "value") == 0) $$ = 2;
+		else if (strcasecmp($1, "compressed") == 0) $$ = 1 | 4;
+		else if (strcasecmp($1, "lsm") == 0) $$ = 32;
+		else { free($1); sqlerror("the index must be key, value, compressed or lsm"); YYERROR; }
+		free($1);
+	}
+	;
+
+create_command:
+	CREATE INDEX ON table LPAREN attribute RPAREN LF {
+	  SqlEngine::createIndex(std::string($4), $6);
+	  free($4);
+	}
+	;
+
+optimize_command:
+	OPTIMIZE TABLE table LF {
+	  SqlEngine::optimize(std::string($3));
+	  free($3);
+	}
+	;
+
+reindex_command:
+	REINDEX table LF {
+	  SqlEngine::reindex(std::string($2), 100);
+	  free($2);
+	}
+	| REINDEX table FILLFACTOR INTEGER LF {
+	  SqlEngine::reindex(std::string($2), atoi($4));
+	  free($2);
+	  free($4);
+	}
+	;
+
+analyze_command:
+	ANALYZE table LF {
+	  SqlEngine::analyze(std::string($2));
+	  free($2);
+	}
+	;
+
 select_command:
-	SELECT attributes FROM table LF {
+	SELECT attributes FROM table select_opts LF {
    	        std::vector<SelCond> conds;
-		runSelect($2, $4, conds);
+		runSelect($2, $4, conds, *$5);
 		free($4);
+		delete $5;
 	}
-	| SELECT attributes FROM table WHERE conditions LF {
-	        runSelect($2, $4, *$6);
+	| SELECT attributes FROM table WHERE conditions select_opts LF {
+	        runSelect($2, $4, *$6, *$7);
 	  	free($4);
-	  	for (unsigned i = 0; i < $6->size(); i++) {
-		    free((*$6)[i].value);
-		}
-	  	delete $6;
+	  	freeConds($6);
+		delete $7;
+	}
+	| SELECT attributes FROM table COMMA table WHERE conditions select_opts LF {
+		std::vector<SelAttr> attrs;
+		if ($2 != 3 && $2 != 4) sqlerror("the attributes of a join must be qualified by their tables");
+		else runJoin($2, attrs, $4, $6, *$8, *$9);
+		free($4);
+		free($6);
+		freeConds($8);
+		delete $9;
+	}
+	| SELECT qattributes FROM table COMMA table WHERE conditions select_opts LF {
+		runJoin(0, *$2, $4, $6, *$8, *$9);
+		freeAttrs($2);
+		free($4);
+		free($6);
+		freeConds($8);
+		delete $9;
+	}
+	| SELECT attribute COMMA attributes FROM table select_opts LF {
+   	        std::vector<SelCond> conds;
+		$7->showGroup = true;
+		if ($2 != 2) sqlerror("only value can be selected with an aggregate");
+		else runSelect($4, $6, conds, *$7);
+		free($6);
+		delete $7;
+	}
+	| SELECT attribute COMMA attributes FROM table WHERE conditions select_opts LF {
+		$9->showGroup = true;
+		if ($2 != 2) sqlerror("only value can be selected with an aggregate");
+		else runSelect($4, $6, *$8, *$9);
+		free($6);
+		freeConds($8);
+		delete $9;
+	}
+	;
+
+select_opts:
+	group_clause order_clause limit_clause {
+	  $2->groupAttr = $1;
+	  $2->showGroup = false;
+	  $2->limit = $3->limit;
+	  $2->offset = $3->offset;
+	  delete $3;
+	  $$ = $2;
+	}
+	;
+
+group_clause:
+	/* empty */              { $$ = 0; }
+	| GROUP BY attribute     { $$ = $3; }
+	;
+
+order_clause:
+	/* empty */ {
+	  SelOpts* o = new SelOpts;
+	  o->orderAttr = 0;
+	  o->desc = false;
+	  $$ = o;
+	}
+	| ORDER BY attribute order_dir {
+	  SelOpts* o = new SelOpts;
+	  o->orderAttr = $3;
+	  o->desc = ($4 != 0);
+	  $$ = o;
+	}
+	;
+
+order_dir:
+	/* empty */ { $$ = 0; }
+	| ASC       { $$ = 0; }
+	| DESC      { $$ = 1; }
+	;
+
+limit_clause:
+	/* empty */ {
+	  SelOpts* o = new SelOpts;
+	  o->limit = -1;
+	  o->offset = 0;
+	  $$ = o;
+	}
+	| LIMIT INTEGER {
+	  SelOpts* o = new SelOpts;
+	  o->limit = atoi($2);
+	  o->offset = 0;
+	  free($2);
+	  if (o->limit < 0) { delete o; sqlerror("LIMIT must not be negative"); YYERROR; }
+	  $$ = o;
+	}
+	| LIMIT INTEGER OFFSET INTEGER {
+	  SelOpts* o = new SelOpts;
+	  o->limit = atoi($2);
+	  o->offset = atoi($4);
+	  free($2);
+	  free($4);
+	  if (o->limit < 0 || o->offset < 0) { delete o; sqlerror("LIMIT and OFFSET must not be negative"); YYERROR; }
+	  $$ = o;
 	}
 	;
 
+/* AND binds tighter than OR. the branches of an OR may only compare the
+   key, and they become a single IN condition on the key */
 conditions:
+	conjunction { $$ = $1; }
+	| key_ranges OR conjunction {
+	  std::vector<KeyRange>* r = makeRanges($3);
+	  if (r == NULL) { delete $1; sqlerror("OR is supported between conditions on the key only"); YYERROR; }
+	  $1->insert($1->end(), r->begin(), r->end());
+	  delete r;
+	  SqlEngine::mergeRanges(*$1);
+	  std::vector<SelCond>* v = new std::vector<SelCond>;
+	  v->push_back(makeCond(1, SelCond::IN, NULL));
+	  v->back().ranges = $1;
+	  $$ = v;
+	}
+	;
+
+key_ranges:
+	conjunction {
+	  $$ = makeRanges($1);
+	  if ($$ == NULL) { sqlerror("OR is supported between conditions on the key only"); YYERROR; }
+	}
+	| key_ranges OR conjunction {
+	  std::vector<KeyRange>* r = makeRanges($3);
+	  if (r == NULL) { delete $1; sqlerror("OR is supported between conditions on the key only"); YYERROR; }
+	  $1->insert($1->end(), r->begin(), r->end());
+	  delete r;
+	  $$ = $1;
+	}
+	;
+
+conjunction:
+	predicate { $$ = $1; }
+	| conjunction AND predicate {
+	  $1->insert($1->end(), $3->begin(), $3->end());
+	  delete $3;
+	  $$ = $1;
+	}
+	;
+
+predicate:
 	condition {
 	  std::vector<SelCond>* v = new std::vector<SelCond>;
 	  v->push_back(*$1);
 	  $$ = v;
-          delete $1;
+	  delete $1;
 	}
-	| conditions AND condition {
-	  $1->push_back(*$3);
+	| attribute BETWEEN value AND value {
+	  std::vector<SelCond>* v = new std::vector<SelCond>;
+	  v->push_back(makeCond($1, SelCond::GE, $3));
+	  v->push_back(makeCond($1, SelCond::LE, $5));
+	  $$ = v;
+	}
+	| attribute IN LPAREN key_list RPAREN {
+	  if ($1 != 1) { delete $4; sqlerror("IN is supported on the key only"); YYERROR; }
+	  SqlEngine::mergeRanges(*$4);
+	  std::vector<SelCond>* v = new std::vector<SelCond>;
+	  v->push_back(makeCond(1, SelCond::IN, NULL));
+	  v->back().ranges = $4;
+	  $$ = v;
+	}
+	;
+
+/* the keys of an IN list, each one a range of a single key */
+key_list:
+	INTEGER {
+	  KeyRange r;
+	  r.low = r.high = atoi($1);
+	  free($1);
+	  $$ = new std::vector<KeyRange>(1, r);
+	}
+	| key_list COMMA INTEGER {
+	  KeyRange r;
+	  r.low = r.high = atoi($3);
+	  free($3);
+	  $1->push_back(r);
 	  $$ = $1;
-          delete $3;
 	}
 	;
 
@@ -113,14 +438,81 @@ condition:
 	  c->attr = $1;
 	  c->comp = static_cast<SelCond::Comparator>($2);
 	  c->value = $3;
+	  c->table = NULL;
+	  c->joinTable = NULL;
+	  c->ranges = NULL;
 	  $$ = c;
         }
+	| qattribute comparator value {
+	  SelCond* c = new SelCond;
+	  c->attr = $1->attr;
+	  c->comp = static_cast<SelCond::Comparator>($2);
+	  c->value = $3;
+	  c->table = $1->table;
+	  c->joinTable = NULL;
+	  c->ranges = NULL;
+	  delete $1;
+	  $$ = c;
+	}
+	| qattribute EQUAL qattribute {
+	  SelCond* c = new SelCond;
+	  c->attr = $1->attr;
+	  c->comp = SelCond::EQ;
+	  c->value = NULL;
+	  c->table = $1->table;
+	  c->joinTable = $3->table;
+	  c->joinAttr = $3->attr;
+	  c->ranges = NULL;
+	  delete $1;
+	  delete $3;
+	  $$ = c;
+	}
+	;
+
+qattributes:
+	qattribute {
+	  std::vector<SelAttr>* v = new std::vector<SelAttr>;
+	  v->push_back(*$1);
+	  delete $1;
+	  $$ = v;
+	}
+	| qattributes COMMA qattribute {
+	  $1->push_back(*$3);
+	  delete $3;
+	  $$ = $1;
+	}
+	;
+
+qattribute:
+	QID {
+	  // split "table.attribute"
+	  SelAttr* a = new SelAttr;
+	  char* dot = strchr($1, '.');
+	  *dot = 0;
+	  a->table = $1;
+	  if (strcasecmp(dot + 1, "key") == 0) a->attr = 1;
+	  else if (strcasecmp(dot + 1, "value") == 0) a->attr = 2;
+	  else { a->attr = 0; sqlerror("wrong attribute name. neither key or value"); }
+	  $$ = a;
+	}
 	;
 
 attributes:
 	attribute { $$ = $1; }
 	| STAR  { $$ = 3; }
 	| COUNT { $$ = 4; }
+	| aggregate LPAREN attribute RPAREN {
+		if ($3 == 1) $$ = $1;
+		else if ($1 == 5 || $1 == 6) $$ = $1 + 4;
+		else { sqlerror("SUM and AVG take the key column only"); YYERROR; }
+	}
+	;
+
+aggregate:
+	MIN   { $$ = 5; }
+	| MAX { $$ = 6; }
+	| SUM { $$ = 7; }
+	| AVG { $$ = 8; }
 	;
 
 attribute:
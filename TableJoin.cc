@@ -0,0 +1,537 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include "TableJoin.h"
+#include "BTreeNode.h"
+
+using std::string;
+using std::vector;
+
+// assumed average length of a value, to estimate the size of a hash table
+// when a table has no statistics
+static const int AVG_VALUE_LENGTH = 32;
+
+// hash value of a join key. the low bits pick the bucket of the
+// hash table, and the high bits the partition
+static unsigned hashKey(int key)
+{
+  unsigned h = (unsigned) key * 0x9e3779b1u;
+  return h ^ (h >> 15);
+}
+
+TableJoin::TableJoin(int memPages)
+{
+  if (memPages < 4) memPages = 4;
+
+  memBytes = memPages * PageFile::PAGE_SIZE;
+  low = INT_MIN;
+  high = INT_MAX;
+  opened[0] = opened[1] = false;
+  attr = 3;
+  skip = 0;
+  limit = -1;
+  count = 0;
+  done = false;
+}
+
+TableJoin::~TableJoin()
+{
+  for (int i = 0; i < 2; i++) {
+    if (!opened[i]) continue;
+    side[i].rf.close();
+    if (side[i].hasIndex) side[i].idx.close();
+  }
+}
+
+int TableJoin::findSide(const char* table) const
+{
+  if (table == NULL) return -1;
+  for (int i = 0; i < 2; i++) {
+    if (side[i].table == table) return i;
+  }
+  return -1;
+}
+
+RC TableJoin::open(const string& table1, const string& table2, const vector<SelCond>& conds)
+{
+  RC   rc;
+  bool joined = false;
+
+  side[0].table = table1;
+  side[1].table = table2;
+
+  for (int i = 0; i < 2; i++) {
+    Side& s = side[i];
+    if ((rc = s.rf.open(s.table + ".tbl", 'r')) < 0) {
+      fprintf(stderr, "Error: table %s does not exist\n", s.table.c_str());
+      return rc;
+    }
+    opened[i] = true;
+    s.hasIndex = (s.idx.open(s.table + ".idx", 'r') == 0);
+    s.needValue = false;
+    s.tupleCount = s.rf.endRid().pid * RecordFile::RECORDS_PER_PAGE + s.rf.endRid().sid;
+    s.hasStats = (s.stats.load(s.table + ".stats") == 0 && s.stats.getRowCount() == s.tupleCount);
+  }
+
+  for (unsigned i = 0; i < conds.size(); i++) {
+    const SelCond& c = conds[i];
+    int t = findSide(c.table);
+    if (t < 0) {
+      fprintf(stderr, "Error: the attributes of a join must be qualified by one of its tables\n");
+      return RC_INVALID_ATTRIBUTE;
+    }
+
+    // the join condition
+    if (c.joinTable != NULL) {
+      int u = findSide(c.joinTable);
+      if (u < 0 || u == t || c.attr != 1 || c.joinAttr != 1) {
+        fprintf(stderr, "Error: only the join on the keys of the two tables is supported\n");
+        return RC_INVALID_ATTRIBUTE;
+      }
+      joined = true;
+      continue;
+    }
+
+    side[t].conds.push_back(c);
+    if (c.attr == 2) side[t].needValue = true;
+  }
+
+  if (!joined) {
+    fprintf(stderr, "Error: a join needs the condition %s.key = %s.key\n",
+            table1.c_str(), table2.c_str());
+    return RC_INVALID_ATTRIBUTE;
+  }
+
+  // the keys of the joined tuples are the same, so a key condition on
+  // one table applies to the other as well
+  unsigned own[2];
+  own[0] = side[0].conds.size();
+  own[1] = side[1].conds.size();
+  for (int t = 0; t < 2; t++) {
+    for (unsigned i = 0; i < own[t]; i++) {
+      const SelCond c = side[t].conds[i];
+      if (c.attr != 1) continue;
+      if (c.comp != SelCond::NE) side[1 - t].conds.push_back(c);
+
+      int val = (c.value != NULL) ? atoi(c.value) : 0;
+      switch (c.comp) {
+      case SelCond::EQ:
+        if (val > low) low = val;
+        if (val < high) high = val;
+        break;
+      case SelCond::GT:
+        if (val == INT_MAX) {
+          low = INT_MAX;
+          high = INT_MIN;
+        } else if (val + 1 > low) {
+          low = val + 1;
+        }
+        break;
+      case SelCond::GE:
+        if (val > low) low = val;
+        break;
+      case SelCond::LT:
+        if (val == INT_MIN) {
+          low = INT_MAX;
+          high = INT_MIN;
+        } else if (val - 1 < high) {
+          high = val - 1;
+        }
+        break;
+      case SelCond::LE:
+        if (val < high) high = val;
+        break;
+      case SelCond::IN:
+        if (c.ranges->empty()) {
+          low = INT_MAX;
+          high = INT_MIN;
+        } else {
+          if (c.ranges->front().low > low) low = c.ranges->front().low;
+          if (c.ranges->back().high < high) high = c.ranges->back().high;
+        }
+        break;
+      default:
+        break;
+      }
+    }
+  }
+
+  return 0;
+}
+
+RC TableJoin::setOutput(int attr, const vector<SelAttr>& attrs, int offset, int limit)
+{
+  this->attr = attr;
+  this->attrs = attrs;
+  skip = offset;
+  this->limit = limit;
+
+  if (attr == 3) {
+    side[0].needValue = side[1].needValue = true;
+  }
+  for (unsigned i = 0; i < attrs.size(); i++) {
+    int t = findSide(attrs[i].table);
+    if (t < 0) {
+      fprintf(stderr, "Error: %s is not a table of the join\n", attrs[i].table);
+      return RC_INVALID_ATTRIBUTE;
+    }
+    if (attrs[i].attr == 2) side[t].needValue = true;
+  }
+
+  return 0;
+}
+
+TableJoin::Method TableJoin::plan(int& outer)
+{
+  double cost[2][3];  // [outer or build table][method], in page reads
+  int    pages[2];
+  int    height[2];
+  double rows[2];     // # of tuples in the key range
+  double length[2];   // average value length
+
+  for (int i = 0; i < 2; i++) {
+    Side& s = side[i];
+    pages[i] = s.rf.endRid().pid + 1;
+    height[i] = s.hasIndex ? s.idx.getTreeHeight() : 0;
+    rows[i] = s.hasStats ? s.stats.estimateKeyRange(low, high) : s.tupleCount;
+    length[i] = s.hasStats ? s.stats.getAvgValueLength() : AVG_VALUE_LENGTH;
+  }
+
+  for (int o = 0; o < 2; o++) {
+    int in = 1 - o;
+    const Side& so = side[o];
+    const Side& si = side[in];
+
+    // index nested-loop join: scan the outer table, and look up every
+    // outer tuple in the index of the inner table
+    if (si.hasIndex) {
+      cost[o][INDEX_NESTED_LOOP] = pages[o] +
+        rows[o] * (height[in] + (si.needValue ? 1 : 0));
+    } else {
+      cost[o][INDEX_NESTED_LOOP] = -1;
+    }
+
+    // hash join: scan both tables once if the build table fits in memory.
+    // otherwise, both are written to and read back from the partitions.
+    double bytes = rows[o] *
+      (sizeof(Entry) + sizeof(int) + (so.needValue ? length[o] : 0));
+    cost[o][HASH] = (bytes <= memBytes ? 1 : 3) * (double) (pages[0] + pages[1]);
+
+    // sort-merge join: scan the leaves of both indexes in key order, and
+    // read the tuples whose value is needed
+    if (side[0].hasIndex && side[1].hasIndex) {
+      cost[o][SORT_MERGE] = height[0] + height[1];
+      for (int i = 0; i < 2; i++) {
+        cost[o][SORT_MERGE] += rows[i] / BTLeafNode::MAX_KEY_COUNT;
+        if (side[i].needValue) cost[o][SORT_MERGE] += rows[i];
+      }
+    } else {
+      cost[o][SORT_MERGE] = -1;
+    }
+  }
+
+  Method best = HASH;
+  outer = (rows[0] <= rows[1]) ? 0 : 1;
+  for (int o = 0; o < 2; o++) {
+    for (int m = 0; m < 3; m++) {
+      if (cost[o][m] >= 0 && cost[o][m] < cost[outer][best]) {
+        best = (Method) m;
+        outer = o;
+      }
+    }
+  }
+
+  return best;
+}
+
+RC TableJoin::run(Method method, int outer)
+{
+  count = 0;
+  done = false;
+
+  // the key conditions contradict each other
+  if (low > high) return 0;
+
+  switch (method) {
+  case INDEX_NESTED_LOOP:
+    if (!side[1 - outer].hasIndex) return RC_INVALID_ATTRIBUTE;
+    return indexNestedLoop(outer);
+  case SORT_MERGE:
+    if (!side[0].hasIndex || !side[1].hasIndex) return RC_INVALID_ATTRIBUTE;
+    return sortMerge();
+  default:
+    return hashJoin(outer);
+  }
+}
+
+RC TableJoin::openScan(Side& s, bool ordered)
+{
+  RC rc;
+
+  // the index is used for a key range, or to return the tuples in key order
+  s.useIndex = s.hasIndex && (ordered || low != INT_MIN || high != INT_MAX);
+  s.rid.pid = s.rid.sid = 0;
+
+  if (s.useIndex) {
+    if ((rc = s.idx.locate(low, s.cursor)) < 0 && rc != RC_NO_SUCH_RECORD) return rc;
+  }
+  return 0;
+}
+
+RC TableJoin::nextTuple(Side& s, int& key, string& value)
+{
+  RC rc;
+
+  for (;;) {
+    if (s.useIndex) {
+      RecordId rid;
+      if ((rc = s.idx.readForward(s.cursor, key, rid)) < 0) {
+        return (rc == RC_END_OF_TREE) ? RC_END_OF_STREAM : rc;
+      }
+      if (key > high) {
+        s.cursor.pid = 0;
+        return RC_END_OF_STREAM;
+      }
+      if (s.needValue && (rc = s.rf.read(rid, key, value)) < 0) return rc;
+    } else {
+      if (!(s.rid < s.rf.endRid())) return RC_END_OF_STREAM;
+      if ((rc = s.rf.read(s.rid, key, value)) < 0) return rc;
+      ++s.rid;
+    }
+
+    bool matched = true;
+    for (unsigned i = 0; i < s.conds.size() && matched; i++) {
+      bool ignored = false;
+      matched = SqlEngine::matchesCondition(s.conds[i], key, value, ignored);
+    }
+    if (matched) return 0;
+  }
+}
+
+bool TableJoin::emit(int first, int key1, const string& value1, int key2, const string& value2)
+{
+  // print the tuples in the order of the FROM clause
+  int           key[2];
+  const string* value[2];
+  key[first] = key1;
+  value[first] = &value1;
+  key[1 - first] = key2;
+  value[1 - first] = &value2;
+
+  if (skip > 0) {
+    skip--;
+    return true;
+  }
+  count++;
+
+  if (attr == 3) {
+    fprintf(stdout, "%d '%s' %d '%s'\n", key[0], value[0]->c_str(), key[1], value[1]->c_str());
+  } else if (attr != 4) {
+    for (unsigned i = 0; i < attrs.size(); i++) {
+      int t = findSide(attrs[i].table);
+      if (i > 0) fputc(' ', stdout);
+      if (attrs[i].attr == 1) fprintf(stdout, "%d", key[t]);
+      else if (attrs.size() == 1) fprintf(stdout, "%s", value[t]->c_str());
+      else fprintf(stdout, "'%s'", value[t]->c_str());
+    }
+    fputc('\n', stdout);
+  }
+
+  done = (limit >= 0 && count >= limit);
+  return !done;
+}
+
+RC TableJoin::indexNestedLoop(int outer)
+{
+  RC     rc;
+  Side&  so = side[outer];
+  Side&  si = side[1 - outer];
+  int    key, innerKey;
+  string value, innerValue;
+
+  if ((rc = openScan(so, false)) < 0) return rc;
+
+  while ((rc = nextTuple(so, key, value)) == 0) {
+    IndexCursor cursor;
+    RecordId    rid;
+
+    rc = si.idx.locate(key, cursor);
+    if (rc == RC_NO_SUCH_RECORD) continue;
+    if (rc < 0) return rc;
+
+    // every inner entry with the same key joins with the outer tuple
+    while ((rc = si.idx.readForward(cursor, innerKey, rid)) == 0 && innerKey == key) {
+      if (si.needValue && (rc = si.rf.read(rid, innerKey, innerValue)) < 0) return rc;
+
+      bool matched = true;
+      for (unsigned i = 0; i < si.conds.size() && matched; i++) {
+        bool ignored = false;
+        matched = SqlEngine::matchesCondition(si.conds[i], innerKey, innerValue, ignored);
+      }
+      if (matched && !emit(outer, key, value, innerKey, innerValue)) return 0;
+    }
+    if (rc < 0 && rc != RC_END_OF_TREE) return rc;
+  }
+
+  return (rc == RC_END_OF_STREAM) ? 0 : rc;
+}
+
+void TableJoin::clearTable()
+{
+  arena.clear();
+  entries.clear();
+  buckets.assign(64, -1);
+}
+
+int TableJoin::tableBytes() const
+{
+  return arena.size() + entries.size() * sizeof(Entry) + buckets.size() * sizeof(int);
+}
+
+void TableJoin::addEntry(int key, const string& value)
+{
+  // keep at most one entry per bucket on average
+  if (entries.size() >= buckets.size()) {
+    buckets.assign(buckets.size() * 2, -1);
+    unsigned mask = buckets.size() - 1;
+    for (unsigned i = 0; i < entries.size(); i++) {
+      unsigned b = hashKey(entries[i].key) & mask;
+      entries[i].next = buckets[b];
+      buckets[b] = i;
+    }
+  }
+
+  Entry e;
+  unsigned b = hashKey(key) & (buckets.size() - 1);
+  e.key = key;
+  e.len = value.size();
+  e.offset = arena.size();
+  e.next = buckets[b];
+  arena.insert(arena.end(), value.begin(), value.end());
+  buckets[b] = entries.size();
+  entries.push_back(e);
+}
+
+bool TableJoin::probe(int build, int key, const string& value)
+{
+  string buildValue;
+  unsigned b = hashKey(key) & (buckets.size() - 1);
+
+  for (int i = buckets[b]; i >= 0; i = entries[i].next) {
+    if (entries[i].key != key) continue;
+    buildValue.assign(arena.data() + entries[i].offset, entries[i].len);
+    if (!emit(build, key, buildValue, key, value)) return false;
+  }
+  return true;
+}
+
+RC TableJoin::hashJoin(int build)
+{
+  RC     rc;
+  Side&  sb = side[build];
+  Side&  sp = side[1 - build];
+  int    key;
+  string value;
+  bool   partitioned = false;
+
+  TempFile buildParts[PARTITIONS];
+  TempFile probeParts[PARTITIONS];
+
+  // build the hash table. once it exceeds the memory budget, write its
+  // tuples and the rest of the build table to the partitions
+  clearTable();
+  if ((rc = openScan(sb, false)) < 0) return rc;
+  while ((rc = nextTuple(sb, key, value)) == 0) {
+    if (!partitioned && tableBytes() + (int) value.size() + (int) sizeof(Entry) > memBytes) {
+      partitioned = true;
+      for (int p = 0; p < PARTITIONS; p++) {
+        if ((rc = buildParts[p].create()) < 0 || (rc = probeParts[p].create()) < 0) return rc;
+      }
+      for (unsigned i = 0; i < entries.size(); i++) {
+        string v(arena.data() + entries[i].offset, entries[i].len);
+        rc = buildParts[(hashKey(entries[i].key) >> 27) % PARTITIONS].append(entries[i].key, v);
+        if (rc < 0) return rc;
+      }
+      clearTable();
+    }
+
+    if (partitioned) {
+      if ((rc = buildParts[(hashKey(key) >> 27) % PARTITIONS].append(key, value)) < 0) return rc;
+    } else {
+      addEntry(key, value);
+    }
+  }
+  if (rc != RC_END_OF_STREAM) return rc;
+
+  // probe the hash table directly, or write the probe table to the partitions
+  if ((rc = openScan(sp, false)) < 0) return rc;
+  while ((rc = nextTuple(sp, key, value)) == 0) {
+    if (partitioned) {
+      if ((rc = probeParts[(hashKey(key) >> 27) % PARTITIONS].append(key, value)) < 0) return rc;
+    } else if (!probe(build, key, value)) {
+      return 0;
+    }
+  }
+  if (rc != RC_END_OF_STREAM) return rc;
+  if (!partitioned) return 0;
+
+  // join each pair of partitions in memory. a skewed partition may
+  // exceed the memory budget
+  for (int p = 0; p < PARTITIONS && !done; p++) {
+    if (buildParts[p].getTupleCount() == 0 || probeParts[p].getTupleCount() == 0) continue;
+
+    clearTable();
+    if ((rc = buildParts[p].rewind()) < 0) return rc;
+    while ((rc = buildParts[p].next(key, value)) == 0) addEntry(key, value);
+    if (rc != RC_END_OF_STREAM) return rc;
+
+    if ((rc = probeParts[p].rewind()) < 0) return rc;
+    while ((rc = probeParts[p].next(key, value)) == 0) {
+      if (!probe(build, key, value)) return 0;
+    }
+    if (rc != RC_END_OF_STREAM) return rc;
+  }
+
+  return 0;
+}
+
+RC TableJoin::sortMerge()
+{
+  RC     rc0, rc1;
+  int    key0, key1;
+  string value0, value1;
+  vector<string> group;  // the values of the second table with the current key
+
+  if ((rc0 = openScan(side[0], true)) < 0) return rc0;
+  if ((rc1 = openScan(side[1], true)) < 0) return rc1;
+
+  rc0 = nextTuple(side[0], key0, value0);
+  rc1 = nextTuple(side[1], key1, value1);
+  while (rc0 == 0 && rc1 == 0) {
+    if (key0 < key1) {
+      rc0 = nextTuple(side[0], key0, value0);
+    } else if (key0 > key1) {
+      rc1 = nextTuple(side[1], key1, value1);
+    } else {
+      // join every tuple with this key in the first table with every
+      // tuple with this key in the second
+      int key = key0;
+      group.clear();
+      while (rc1 == 0 && key1 == key) {
+        group.push_back(value1);
+        rc1 = nextTuple(side[1], key1, value1);
+      }
+      while (rc0 == 0 && key0 == key) {
+        for (unsigned i = 0; i < group.size(); i++) {
+          if (!emit(0, key, value0, key, group[i])) return 0;
+        }
+        rc0 = nextTuple(side[0], key0, value0);
+      }
+    }
+  }
+
+  if (rc0 < 0 && rc0 != RC_END_OF_STREAM) return rc0;
+  if (rc1 < 0 && rc1 != RC_END_OF_STREAM) return rc1;
+  return 0;
+}
@@ -0,0 +1,143 @@
+#ifndef TABLEJOIN_H
+#define TABLEJOIN_H
+
+#include <string>
+#include <vector>
+#include "Bruinbase.h"
+#include "SqlEngine.h"
+#include "RecordFile.h"
+#include "BTreeIndex.h"
+#include "TempFile.h"
+#include "TableStats.h"
+
+/**
+ * Equi-join of two tables on their keys ("a.key = b.key").
+ * The conditions on each table are applied while the table is scanned,
+ * and the key conditions of one table also narrow down the key range
+ * of the other. The joined tuples are printed as they are produced,
+ * so LIMIT stops the join early. Three join methods are available:
+ * index nested-loop join probing the index of the inner table,
+ * Grace hash join that partitions both tables into TempFiles when the
+ * build table does not fit in memory, and sort-merge join over the
+ * leaf scans of both indexes. plan() picks the cheapest one from the
+ * sizes of the tables and their indexes. For a table with up-to-date
+ * statistics, it also uses the estimated # of tuples in the key range
+ * and the average value length.
+ */
+class TableJoin {
+ public:
+  enum Method { INDEX_NESTED_LOOP, HASH, SORT_MERGE };
+
+  // default memory budget, in pages, for the hash table of the hash join
+  static const int MEM_PAGES = 256;
+
+  // # of partitions of the hash join when the build table does not fit
+  static const int PARTITIONS = 32;
+
+  /**
+   * @param memPages[IN] the memory budget in pages for the hash join
+   */
+  TableJoin(int memPages = MEM_PAGES);
+  ~TableJoin();
+
+  /**
+   * open the two tables and their indexes and assign the conditions
+   * to the tables.
+   * @param table1[IN] the first table
+   * @param table2[IN] the second table
+   * @param conds[IN] the conditions in the WHERE clause
+   * @return error code. 0 if no error
+   */
+  RC open(const std::string& table1, const std::string& table2, const std::vector<SelCond>& conds);
+
+  /**
+   * set the attributes printed for each joined tuple.
+   * @param attr[IN] 3 for *, 4 for count(*) (nothing is printed), 0 for attrs
+   * @param attrs[IN] the qualified attributes to print
+   * @param offset[IN] # of joined tuples to skip
+   * @param limit[IN] max # of joined tuples to return. -1 for no limit
+   * @return error code. 0 if no error
+   */
+  RC setOutput(int attr, const std::vector<SelAttr>& attrs, int offset, int limit);
+
+  /**
+   * pick the join method with the least estimated # of page reads.
+   * @param outer[OUT] the outer table (0 or 1) of the index nested-loop
+   * join, or the build table of the hash join
+   * @return the join method
+   */
+  Method plan(int& outer);
+
+  /**
+   * join the tables and print the joined tuples.
+   * @param method[IN] the join method. SORT_MERGE needs both indexes, and
+   * INDEX_NESTED_LOOP the index of the inner table
+   * @param outer[IN] the outer or build table (0 or 1)
+   * @return error code. 0 if no error
+   */
+  RC run(Method method, int outer);
+
+  /**
+   * @return the number of joined tuples returned
+   */
+  int getCount() const { return count; }
+
+ private:
+  // a table of the join and the state of its scan
+  struct Side {
+    std::string table;
+    RecordFile  rf;
+    BTreeIndex  idx;
+    bool        hasIndex;
+    std::vector<SelCond> conds;  // the conditions on this table
+    bool        needValue;       // the value is printed or checked
+    int         tupleCount;      // # of tuples in the table
+    TableStats  stats;
+    bool        hasStats;        // the statistics cover every tuple
+
+    bool        useIndex;        // the scan goes through the index
+    IndexCursor cursor;
+    RecordId    rid;
+  };
+
+  // a tuple in the hash table of the hash join
+  struct Entry {
+    int key;
+    int len;
+    int offset;
+    int next;   // the next entry in the bucket. -1 at the end
+  };
+
+  int  findSide(const char* table) const;
+  RC   openScan(Side& s, bool ordered);
+  RC   nextTuple(Side& s, int& key, std::string& value);
+  bool emit(int side, int key1, const std::string& value1, int key2, const std::string& value2);
+
+  RC indexNestedLoop(int outer);
+  RC hashJoin(int build);
+  RC sortMerge();
+
+  void clearTable();
+  void addEntry(int key, const std::string& value);
+  int  tableBytes() const;
+  bool probe(int side, int key, const std::string& value);
+
+  Side side[2];
+  int  low;        // the key range of the join
+  int  high;
+  bool opened[2];
+
+  int  attr;
+  std::vector<SelAttr> attrs;
+  int  skip;
+  int  limit;
+  int  count;
+  bool done;       // LIMIT has been reached
+
+  int  memBytes;
+  std::vector<char>  arena;    // values in the hash table
+  std::vector<Entry> entries;  // tuples in the hash table
+  std::vector<int>   buckets;  // first entry of each bucket. the size is a power of 2
+};
+
+#endif // TABLEJOIN_H
@@ -0,0 +1,451 @@
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include "TableStats.h"
+#include "PageFile.h"
+
+using std::string;
+using std::string_view;
+using std::vector;
+
+//
+// Layout of a statistics file: the # of bytes written, FORMAT_TAG, the
+// end RecordId of the table, and then the fields of TableStats in the
+// order they are declared, one after another over as many pages as
+// needed.
+//
+
+// mix the bits of a 64-bit number (the finalizer of splitmix64)
+static unsigned long long mix(unsigned long long h)
+{
+  h ^= h >> 30;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 27;
+  h *= 0x94d049bb133111ebULL;
+  h ^= h >> 31;
+  return h;
+}
+
+// FNV-1a hash of a string, mixed to spread the bits
+static unsigned long long hashString(string_view s)
+{
+  unsigned long long h = 14695981039346656037ULL;
+  for (unsigned i = 0; i < s.size(); i++) {
+    h ^= (unsigned char) s[i];
+    h *= 1099511628211ULL;
+  }
+  return mix(h);
+}
+
+template <class T>
+static void put(string& buf, const T& v)
+{
+  buf.append((const char*) &v, sizeof(T));
+}
+
+template <class T>
+static bool get(const string& buf, unsigned& pos, T& v)
+{
+  if (pos + sizeof(T) > buf.size()) return false;
+  memcpy(&v, buf.data() + pos, sizeof(T));
+  pos += sizeof(T);
+  return true;
+}
+
+TableStats::TableStats()
+{
+  clear();
+}
+
+void TableStats::clear()
+{
+  rowCount = 0;
+  minKey = 0;
+  maxKey = 0;
+  totalLength = 0;
+  for (int i = 0; i < LENGTH_BUCKETS; i++) lengthCount[i] = 0;
+
+  sample.clear();
+  seed = 0x2545f4914f6cdd1dULL;
+  keyRegisters.assign(HLL_REGISTERS, 0);
+  valueRegisters.assign(HLL_REGISTERS, 0);
+  counters.clear();
+
+  histogram.clear();
+  histogramValid = false;
+}
+
+unsigned long long TableStats::random()
+{
+  seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+  return mix(seed);
+}
+
+void TableStats::addHash(vector<unsigned char>& registers, unsigned long long hash)
+{
+  // the first HLL_BITS bits pick the register, and the register keeps the
+  // longest run of leading zeros seen in the rest of the bits
+  unsigned r = hash >> (64 - HLL_BITS);
+  unsigned long long rest = hash << HLL_BITS;
+  unsigned char rank = 1;
+  while (rank <= 64 - HLL_BITS && (rest & (1ULL << 63)) == 0) {
+    rank++;
+    rest <<= 1;
+  }
+  if (rank > registers[r]) registers[r] = rank;
+}
+
+void TableStats::add(int key, string_view value)
+{
+  rowCount++;
+  if (rowCount == 1 || key < minKey) minKey = key;
+  if (rowCount == 1 || key > maxKey) maxKey = key;
+
+  int len = value.size();
+  totalLength += len;
+  lengthCount[std::min(len / 10, LENGTH_BUCKETS - 1)]++;
+
+  // reservoir sampling: every key stays in the sample with the same chance
+  if ((int) sample.size() < SAMPLE_SIZE) {
+    sample.push_back(key);
+  } else {
+    unsigned long long i = random() % rowCount;
+    if (i < (unsigned long long) SAMPLE_SIZE) sample[i] = key;
+  }
+  histogramValid = false;
+
+  addHash(keyRegisters, mix((unsigned long long) (unsigned) key));
+  unsigned long long h = hashString(value);
+  addHash(valueRegisters, h);
+
+  // SpaceSaving: a new value takes over the smallest counter once all
+  // counters are in use
+  unsigned hash = (unsigned) h;
+  int smallest = 0;
+  for (unsigned i = 0; i < counters.size(); i++) {
+    Counter& c = counters[i];
+    if (c.hash == hash && c.value == value) {
+      c.count++;
+      return;
+    }
+    if (c.count < counters[smallest].count) smallest = i;
+  }
+  if (counters.size() < (unsigned) COUNTERS) {
+    Counter c;
+    c.value = value;
+    c.hash = hash;
+    c.count = 1;
+    c.error = 0;
+    counters.push_back(c);
+  } else {
+    Counter& c = counters[smallest];
+    c.value = value;
+    c.hash = hash;
+    c.error = c.count;
+    c.count++;
+  }
+}
+
+long long TableStats::estimateDistinct(const vector<unsigned char>& registers)
+{
+  double sum = 0;
+  int zeros = 0;
+  double m = HLL_REGISTERS;
+
+  for (int i = 0; i < HLL_REGISTERS; i++) {
+    sum += ldexp(1.0, -registers[i]);
+    if (registers[i] == 0) zeros++;
+  }
+
+  double estimate = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+
+  // linear counting is more accurate for small sets
+  if (estimate <= 2.5 * m && zeros > 0) {
+    estimate = m * log(m / zeros);
+  }
+  return (long long) (estimate + 0.5);
+}
+
+long long TableStats::getDistinctKeys() const
+{
+  long long n = estimateDistinct(keyRegisters);
+  if (n > rowCount) n = rowCount;
+  if (n == 0 && rowCount > 0) n = 1;
+  return n;
+}
+
+long long TableStats::getDistinctValues() const
+{
+  long long n = estimateDistinct(valueRegisters);
+  if (n > rowCount) n = rowCount;
+  if (n == 0 && rowCount > 0) n = 1;
+  return n;
+}
+
+double TableStats::getAvgValueLength() const
+{
+  return (rowCount == 0) ? 0 : (double) totalLength / rowCount;
+}
+
+long long TableStats::getLengthCount(int bucket) const
+{
+  return (bucket < 0 || bucket >= LENGTH_BUCKETS) ? 0 : lengthCount[bucket];
+}
+
+const vector<int>& TableStats::getHistogram()
+{
+  if (histogramValid) return histogram;
+
+  histogram.clear();
+  if (!sample.empty()) {
+    vector<int> sorted(sample);
+    std::sort(sorted.begin(), sorted.end());
+
+    int n = sorted.size();
+    for (int i = 0; i <= HISTOGRAM_BUCKETS; i++) {
+      histogram.push_back(sorted[(long long) i * (n - 1) / HISTOGRAM_BUCKETS]);
+    }
+    // the sample may have missed the smallest and the largest key
+    histogram[0] = minKey;
+    histogram[HISTOGRAM_BUCKETS] = maxKey;
+  }
+  histogramValid = true;
+  return histogram;
+}
+
+static bool moreCommon(const TableStats::ValueCount& a, const TableStats::ValueCount& b)
+{
+  return a.count > b.count || (a.count == b.count && a.value < b.value);
+}
+
+void TableStats::getTopValues(vector<ValueCount>& top) const
+{
+  // only the occurrences counted since a value took over its counter are
+  // certain. a value seen once may just have replaced another one
+  top.clear();
+  for (unsigned i = 0; i < counters.size(); i++) {
+    ValueCount v;
+    v.value = counters[i].value;
+    v.count = counters[i].count - counters[i].error;
+    if (v.count > 1) top.push_back(v);
+  }
+  std::sort(top.begin(), top.end(), moreCommon);
+  if (top.size() > (unsigned) TOP_VALUES) top.resize(TOP_VALUES);
+}
+
+double TableStats::estimateKeyRange(long long low, long long high)
+{
+  if (rowCount == 0) return 0;
+  if (low < minKey) low = minKey;
+  if (high > maxKey) high = maxKey;
+  if (low > high) return 0;
+
+  // a single key: assume that every distinct key is equally common
+  if (low == high) return (double) rowCount / getDistinctKeys();
+
+  // the keys are assumed to be spread evenly within each bucket
+  const vector<int>& bounds = getHistogram();
+  double rows = 0;
+  for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+    long long lo = bounds[i];
+    long long hi = bounds[i + 1];
+    long long from = std::max(low, lo);
+    long long to = std::min(high, hi);
+    if (from > to) continue;
+    rows += (double) (to - from + 1) / (hi - lo + 1);
+  }
+  rows = rows * rowCount / HISTOGRAM_BUCKETS;
+  return std::min(rows, (double) rowCount);
+}
+
+double TableStats::estimateValueEqual(const string& value) const
+{
+  if (rowCount == 0) return 0;
+
+  // a value with a counter is likely among the most common ones
+  long long counted = 0;
+  unsigned hash = (unsigned) hashString(value);
+  for (unsigned i = 0; i < counters.size(); i++) {
+    const Counter& c = counters[i];
+    if (c.hash == hash && c.value == value) return c.count - c.error / 2.0;
+    counted += c.count - c.error;
+  }
+
+  // the rest of the tuples are spread over the rest of the values
+  long long others = getDistinctValues() - counters.size();
+  if (others < 1) others = 1;
+  double rows = (double) (rowCount - counted) / others;
+  return std::max(rows, 0.0);
+}
+
+RC TableStats::save(const string& filename, const RecordId& end)
+{
+  string buf;
+  int size = 0;
+  int tag = FORMAT_TAG;
+
+  put(buf, size);
+  put(buf, tag);
+  put(buf, end.pid);
+  put(buf, end.sid);
+  put(buf, rowCount);
+  put(buf, minKey);
+  put(buf, maxKey);
+  put(buf, totalLength);
+  for (int i = 0; i < LENGTH_BUCKETS; i++) put(buf, lengthCount[i]);
+
+  put(buf, (int) sample.size());
+  if (!sample.empty()) buf.append((const char*) &sample[0], sample.size() * sizeof(int));
+  put(buf, seed);
+  buf.append((const char*) &keyRegisters[0], HLL_REGISTERS);
+  buf.append((const char*) &valueRegisters[0], HLL_REGISTERS);
+
+  put(buf, (int) counters.size());
+  for (unsigned i = 0; i < counters.size(); i++) {
+    put(buf, counters[i].count);
+    put(buf, counters[i].error);
+    put(buf, (int) counters[i].value.size());
+    buf.append(counters[i].value);
+  }
+
+  size = buf.size();
+  memcpy(&buf[0], &size, sizeof(int));
+
+  // write the bytes page by page. the page file is not truncated, so a
+  // longer old file keeps pages that are never read again
+  PageFile pf;
+  RC rc;
+  if ((rc = pf.open(filename, 'w')) < 0) return rc;
+
+  buf.resize((buf.size() + PageFile::PAGE_SIZE - 1) / PageFile::PAGE_SIZE * PageFile::PAGE_SIZE, 0);
+  for (unsigned pid = 0; pid * PageFile::PAGE_SIZE < buf.size(); pid++) {
+    if ((rc = pf.write(pid, &buf[pid * PageFile::PAGE_SIZE])) < 0) {
+      pf.close();
+      return rc;
+    }
+  }
+  return pf.close();
+}
+
+RC TableStats::load(const string& filename)
+{
+  PageFile pf;
+  RC rc;
+  char page[PageFile::PAGE_SIZE];
+  int size;
+
+  clear();
+  if ((rc = pf.open(filename, 'r')) < 0) return rc;
+
+  // read the pages that hold the bytes
+  string buf;
+  if ((rc = pf.read(0, page)) < 0) {
+    pf.close();
+    return rc;
+  }
+  memcpy(&size, page, sizeof(int));
+  if (size < (int) sizeof(int) || size > pf.endPid() * PageFile::PAGE_SIZE) {
+    pf.close();
+    return RC_INVALID_FILE_FORMAT;
+  }
+  buf.append(page, PageFile::PAGE_SIZE);
+  for (PageId pid = 1; pid * PageFile::PAGE_SIZE < size; pid++) {
+    if ((rc = pf.read(pid, page)) < 0) {
+      pf.close();
+      return rc;
+    }
+    buf.append(page, PageFile::PAGE_SIZE);
+  }
+  pf.close();
+  buf.resize(size);
+
+  unsigned pos = sizeof(int);
+  int n;
+  RecordId end;
+  bool ok = get(buf, pos, n) && n == FORMAT_TAG && get(buf, pos, end.pid) && get(buf, pos, end.sid);
+  ok = ok && get(buf, pos, rowCount) && get(buf, pos, minKey) && get(buf, pos, maxKey) &&
+       get(buf, pos, totalLength);
+  for (int i = 0; ok && i < LENGTH_BUCKETS; i++) ok = get(buf, pos, lengthCount[i]);
+
+  ok = ok && get(buf, pos, n) && n >= 0 && n <= SAMPLE_SIZE &&
+       pos + n * sizeof(int) <= buf.size();
+  if (ok && n > 0) {
+    sample.resize(n);
+    memcpy(&sample[0], buf.data() + pos, n * sizeof(int));
+    pos += n * sizeof(int);
+  }
+  ok = ok && get(buf, pos, seed) && pos + 2 * HLL_REGISTERS <= buf.size();
+  if (ok) {
+    memcpy(&keyRegisters[0], buf.data() + pos, HLL_REGISTERS);
+    memcpy(&valueRegisters[0], buf.data() + pos + HLL_REGISTERS, HLL_REGISTERS);
+    pos += 2 * HLL_REGISTERS;
+  }
+
+  ok = ok && get(buf, pos, n) && n >= 0 && n <= COUNTERS;
+  for (int i = 0; ok && i < n; i++) {
+    Counter c;
+    int len;
+    ok = get(buf, pos, c.count) && get(buf, pos, c.error) && get(buf, pos, len) &&
+         len >= 0 && pos + len <= buf.size();
+    if (!ok) break;
+    c.value.assign(buf.data() + pos, len);
+    c.hash = (unsigned) hashString(c.value);
+    pos += len;
+    counters.push_back(c);
+  }
+
+  if (!ok) {
+    clear();
+    return RC_INVALID_FILE_FORMAT;
+  }
+  return 0;
+}
+
+RC TableStats::readHeader(const string& filename, long long& rows, RecordId& end)
+{
+  PageFile pf;
+  RC rc;
+  char page[PageFile::PAGE_SIZE];
+  int tag;
+
+  if ((rc = pf.open(filename, 'r')) < 0) return rc;
+  rc = pf.read(0, page);
+  pf.close();
+  if (rc < 0) return rc;
+
+  // the fields follow the byte count, as save() writes them
+  char* p = page + sizeof(int);
+  memcpy(&tag, p, sizeof(int));
+  if (tag != FORMAT_TAG) return RC_INVALID_FILE_FORMAT;
+  p += sizeof(int);
+  memcpy(&end.pid, p, sizeof(PageId));
+  p += sizeof(PageId);
+  memcpy(&end.sid, p, sizeof(int));
+  p += sizeof(int);
+  memcpy(&rows, p, sizeof(long long));
+  return 0;
+}
+
+RC TableStats::markStale(const string& filename)
+{
+  PageFile pf;
+  RC rc;
+  char page[PageFile::PAGE_SIZE];
+  int tag;
+  PageId stale = -1;
+
+  // a table without statistics has nothing to mark
+  if (pf.open(filename, 'r') < 0) return 0;
+  pf.close();
+
+  if ((rc = pf.open(filename, 'w')) < 0) return rc;
+  if ((rc = pf.read(0, page)) == 0) {
+    memcpy(&tag, page + sizeof(int), sizeof(int));
+    if (tag == FORMAT_TAG) {
+      memcpy(page + 2 * sizeof(int), &stale, sizeof(PageId));
+      rc = pf.write(0, page);
+    }
+  }
+  pf.close();
+  return rc;
+}
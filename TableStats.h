@@ -0,0 +1,197 @@
+#ifndef TABLESTATS_H
+#define TABLESTATS_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Bruinbase.h"
+#include "RecordFile.h"
+
+/**
+ * Statistics of a table, kept in the sidecar file table.stats.
+ * Every statistic is computed in one pass over the tuples, with a fixed
+ * amount of memory, and the state of that pass is what the file stores.
+ * LOAD can therefore continue adding the tuples it appends to a table:
+ *  - the row count, the smallest and largest key, and the value lengths
+ *    are exact.
+ *  - the distinct keys and values are estimated with HyperLogLog.
+ *  - the equi-depth key histogram is built from a reservoir sample.
+ *  - the most common values are found with SpaceSaving counters, whose
+ *    counts are at most the row count / COUNTERS too high.
+ * Page 0 of the file starts with the row count and the end RecordId of
+ * the table when the statistics were saved, so readHeader() can tell
+ * the row count of a table from one page.
+ */
+class TableStats {
+ public:
+  // # of buckets of the equi-depth key histogram
+  static const int HISTOGRAM_BUCKETS = 32;
+
+  // # of keys in the reservoir sample that the histogram is built from
+  static const int SAMPLE_SIZE = 1024;
+
+  // # of HyperLogLog registers (2^10). the standard error is about 3%
+  static const int HLL_BITS = 10;
+  static const int HLL_REGISTERS = 1 << HLL_BITS;
+
+  // # of SpaceSaving counters, and # of values returned as the most common
+  static const int COUNTERS = 64;
+  static const int TOP_VALUES = 10;
+
+  // value lengths are counted in buckets of 10: 0-9, 10-19, ..., 90-99
+  static const int LENGTH_BUCKETS = 10;
+
+  /**
+   * a value and its # of occurrences
+   */
+  struct ValueCount {
+    std::string value;
+    long long   count;
+  };
+
+  TableStats();
+
+  /**
+   * forget every tuple added so far.
+   */
+  void clear();
+
+  /**
+   * add a tuple of the table to the statistics.
+   * @param key[IN] the key of the tuple
+   * @param value[IN] the value of the tuple
+   */
+  void add(int key, std::string_view value);
+
+  /**
+   * read the statistics from a file.
+   * @param filename[IN] the name of the statistics file
+   * @return error code. 0 if no error
+   */
+  RC load(const std::string& filename);
+
+  /**
+   * read the row count and the end RecordId of the table from page 0 of
+   * a statistics file.
+   * @param filename[IN] the name of the statistics file
+   * @param rows[OUT] the # of tuples
+   * @param end[OUT] the end RecordId of the table. its pid is -1 if the
+   *                 table has changed since the statistics were saved
+   * @return error code. 0 if no error
+   */
+  static RC readHeader(const std::string& filename, long long& rows, RecordId& end);
+
+  /**
+   * record in a statistics file, if it exists, that its table is about
+   * to change, until the statistics are saved again.
+   * @param filename[IN] the name of the statistics file
+   * @return error code. 0 if no error
+   */
+  static RC markStale(const std::string& filename);
+
+  /**
+   * write the statistics to a file, replacing its content.
+   * @param filename[IN] the name of the statistics file
+   * @param end[IN] the end RecordId of the table
+   * @return error code. 0 if no error
+   */
+  RC save(const std::string& filename, const RecordId& end);
+
+  /**
+   * @return the # of tuples
+   */
+  long long getRowCount() const { return rowCount; }
+
+  /**
+   * @return the smallest key. undefined if there is no tuple
+   */
+  int getMinKey() const { return minKey; }
+
+  /**
+   * @return the largest key. undefined if there is no tuple
+   */
+  int getMaxKey() const { return maxKey; }
+
+  /**
+   * @return the estimated # of distinct keys
+   */
+  long long getDistinctKeys() const;
+
+  /**
+   * @return the estimated # of distinct values
+   */
+  long long getDistinctValues() const;
+
+  /**
+   * @return the average length of the values
+   */
+  double getAvgValueLength() const;
+
+  /**
+   * @param bucket[IN] the length bucket, from 0 to LENGTH_BUCKETS - 1
+   * @return the # of values whose length is in the bucket
+   */
+  long long getLengthCount(int bucket) const;
+
+  /**
+   * @return the bounds of the equi-depth key histogram. bucket i holds
+   * about the same # of keys, all between bound i and bound i + 1.
+   * empty if there is no tuple
+   */
+  const std::vector<int>& getHistogram();
+
+  /**
+   * @param top[OUT] at most TOP_VALUES of the most common values, the
+   * most common first, with the # of occurrences that are certain.
+   * values that may occur only once are left out
+   */
+  void getTopValues(std::vector<ValueCount>& top) const;
+
+  /**
+   * estimate the # of tuples whose key is between low and high.
+   * @param low[IN] the smallest key in the range
+   * @param high[IN] the largest key in the range
+   * @return the estimated # of tuples
+   */
+  double estimateKeyRange(long long low, long long high);
+
+  /**
+   * estimate the # of tuples with a value.
+   * @param value[IN] the value
+   * @return the estimated # of tuples
+   */
+  double estimateValueEqual(const std::string& value) const;
+
+ private:
+  // the int after the byte count of a statistics file in this layout
+  static const int FORMAT_TAG = 0x53544232;
+
+  // a SpaceSaving counter
+  struct Counter {
+    std::string   value;
+    unsigned      hash;
+    long long     count;
+    long long     error;  // count may be this much too high
+  };
+
+  static long long estimateDistinct(const std::vector<unsigned char>& registers);
+  static void addHash(std::vector<unsigned char>& registers, unsigned long long hash);
+  unsigned long long random();
+
+  long long rowCount;
+  int       minKey;
+  int       maxKey;
+  long long totalLength;   // sum of the value lengths
+  long long lengthCount[LENGTH_BUCKETS];
+
+  std::vector<int>           sample;          // reservoir sample of the keys
+  unsigned long long         seed;            // the state of random()
+  std::vector<unsigned char> keyRegisters;    // HyperLogLog of the keys
+  std::vector<unsigned char> valueRegisters;  // HyperLogLog of the values
+  std::vector<Counter>       counters;
+
+  std::vector<int> histogram;  // built from sample when needed
+  bool             histogramValid;
+};
+
+#endif /* TABLESTATS_H */
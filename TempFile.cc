@@ -0,0 +1,154 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include "TempFile.h"
+
+using std::string;
+
+//
+// Page layout of a temporary file:
+//   [# tuples in the page] [key len value] [key len value] ...
+// the value is stored without the terminating zero.
+//
+
+// the space taken by a tuple with the given value length
+static int tupleSize(int len)
+{
+  return 2 * sizeof(int) + len;
+}
+
+TempFile::TempFile()
+{
+  pid = 0;
+  offset = sizeof(int);
+  pageCount = 0;
+  readCount = 0;
+  tupleCount = 0;
+  writing = false;
+}
+
+TempFile::~TempFile()
+{
+  if (!name.empty()) close();
+}
+
+string TempFile::tempName()
+{
+  static int sequence = 0;
+  char buf[64];
+
+  const char* dir = getenv("TMPDIR");
+  if (dir == NULL || *dir == 0) dir = "/tmp";
+
+  snprintf(buf, sizeof(buf), "/bruinbase.%d.%d.tmp", (int) getpid(), sequence++);
+  return string(dir) + buf;
+}
+
+RC TempFile::create()
+{
+  RC rc;
+
+  if (!name.empty()) return RC_FILE_OPEN_FAILED;
+
+  name = tempName();
+  unlink(name.c_str());
+  if ((rc = pf.open(name, 'w')) < 0) {
+    name.erase();
+    return rc;
+  }
+
+  pid = 0;
+  offset = sizeof(int);
+  pageCount = 0;
+  tupleCount = 0;
+  writing = true;
+  return 0;
+}
+
+RC TempFile::close()
+{
+  if (name.empty()) return RC_FILE_CLOSE_FAILED;
+
+  RC rc = pf.close();
+  unlink(name.c_str());
+  name.erase();
+  writing = false;
+  return rc;
+}
+
+RC TempFile::append(int key, const string& value)
+{
+  RC  rc;
+  int len = value.size();
+
+  if (!writing) return RC_INVALID_FILE_MODE;
+  if (tupleSize(len) > PageFile::PAGE_SIZE - (int) sizeof(int)) return RC_INVALID_ATTRIBUTE;
+
+  // move on to a new page if the tuple does not fit in the current one
+  if (offset + tupleSize(len) > PageFile::PAGE_SIZE) {
+    if ((rc = flush()) < 0) return rc;
+    pid++;
+    offset = sizeof(int);
+    pageCount = 0;
+  }
+
+  memcpy(page + offset, &key, sizeof(int));
+  memcpy(page + offset + sizeof(int), &len, sizeof(int));
+  memcpy(page + offset + 2 * sizeof(int), value.data(), len);
+  offset += tupleSize(len);
+  pageCount++;
+  tupleCount++;
+
+  return 0;
+}
+
+RC TempFile::flush()
+{
+  memcpy(page, &pageCount, sizeof(int));
+  return pf.write(pid, page);
+}
+
+RC TempFile::rewind()
+{
+  RC rc;
+
+  if (name.empty()) return RC_INVALID_FILE_MODE;
+
+  // write out the last page
+  if (writing) {
+    if (pageCount > 0 && (rc = flush()) < 0) return rc;
+    writing = false;
+  }
+
+  // position the cursor before the first page
+  pid = -1;
+  pageCount = 0;
+  readCount = 0;
+  return 0;
+}
+
+RC TempFile::next(int& key, string& value)
+{
+  RC  rc;
+  int len;
+
+  if (writing || name.empty()) return RC_INVALID_FILE_MODE;
+
+  // read the next page once the current one is exhausted
+  while (readCount >= pageCount) {
+    if (pid + 1 >= pf.endPid()) return RC_END_OF_STREAM;
+    if ((rc = pf.read(++pid, page)) < 0) return rc;
+    memcpy(&pageCount, page, sizeof(int));
+    offset = sizeof(int);
+    readCount = 0;
+  }
+
+  memcpy(&key, page + offset, sizeof(int));
+  memcpy(&len, page + offset + sizeof(int), sizeof(int));
+  value.assign(page + offset + 2 * sizeof(int), len);
+  offset += tupleSize(len);
+  readCount++;
+
+  return 0;
+}
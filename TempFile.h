@@ -0,0 +1,81 @@
+#ifndef TEMPFILE_H
+#define TEMPFILE_H
+
+#include <string>
+#include "Bruinbase.h"
+#include "PageFile.h"
+
+/**
+ * A temporary file of (key, value) tuples, used by the operators that
+ * have to spill data to disk (e.g., sorted runs of an external sort).
+ * The tuples are appended first and then read back sequentially.
+ * Unlike RecordFile, the tuples are packed into the pages with their
+ * actual length, and a page is read only once when the file is scanned.
+ * The underlying unix file is removed when the TempFile is closed.
+ */
+class TempFile {
+ public:
+  TempFile();
+  ~TempFile();
+
+  /**
+   * create a new empty temporary file and open it for appending.
+   * @return error code. 0 if no error
+   */
+  RC create();
+
+  /**
+   * close the file and remove it from the disk.
+   * @return error code. 0 if no error
+   */
+  RC close();
+
+  /**
+   * append a tuple at the end of the file.
+   * @param key[IN] the key of the tuple
+   * @param value[IN] the value of the tuple
+   * @return error code. 0 if no error
+   */
+  RC append(int key, const std::string& value);
+
+  /**
+   * finish appending (if not done yet) and move the read cursor
+   * to the first tuple of the file.
+   * @return error code. 0 if no error
+   */
+  RC rewind();
+
+  /**
+   * read the tuple at the read cursor and move the cursor to the next one.
+   * @param key[OUT] the key of the tuple
+   * @param value[OUT] the value of the tuple
+   * @return error code. RC_END_OF_STREAM if all tuples have been read
+   */
+  RC next(int& key, std::string& value);
+
+  /**
+   * @return the number of tuples in the file
+   */
+  int getTupleCount() const { return tupleCount; }
+
+  /**
+   * @return the name of a new temporary file. the file is created
+   * in $TMPDIR (or /tmp) when it is opened in 'w' mode.
+   */
+  static std::string tempName();
+
+ private:
+  RC flush();
+
+  PageFile    pf;       // the PageFile used to store the tuples
+  std::string name;     // the name of the unix file
+  char   page[PageFile::PAGE_SIZE];  // the page being written or read
+  PageId pid;           // the page id of the page buffer
+  int    offset;        // the offset of the next tuple in the page buffer
+  int    pageCount;     // # tuples in the page buffer
+  int    readCount;     // # tuples read from the page buffer
+  int    tupleCount;    // # tuples in the file
+  bool   writing;       // true while tuples are appended
+};
+
+#endif // TEMPFILE_H
@@ -0,0 +1,237 @@
+#include <algorithm>
+#include <cstring>
+#include "TupleSorter.h"
+
+using std::string;
+using std::vector;
+
+// orders the buffered tuples for std::sort()
+struct TupleSorter::EntryLess {
+  const TupleSorter* sorter;
+  EntryLess(const TupleSorter* s) : sorter(s) { }
+  bool operator()(const Entry& e1, const Entry& e2) const {
+    const char* base = sorter->arena.data();
+    return sorter->less(e1.key, base + e1.offset, e1.len, e2.key, base + e2.offset, e2.len);
+  }
+};
+
+// turns the std heap functions into a min-heap in the sort order
+struct TupleSorter::HeadGreater {
+  const TupleSorter* sorter;
+  HeadGreater(const TupleSorter* s) : sorter(s) { }
+  bool operator()(const Head& h1, const Head& h2) const {
+    return sorter->less(h2.key, h2.value.data(), h2.value.size(),
+                        h1.key, h1.value.data(), h1.value.size());
+  }
+};
+
+TupleSorter::TupleSorter(Order order, int memPages)
+{
+  if (memPages < 3) memPages = 3;
+
+  this->order = order;
+  memBytes = memPages * PageFile::PAGE_SIZE;
+  fanIn = memPages - 1;
+  nextEntry = 0;
+  runCount = 0;
+  sorted = false;
+}
+
+TupleSorter::~TupleSorter()
+{
+  clearRuns(runs);
+}
+
+bool TupleSorter::less(int k1, const char* v1, int l1, int k2, const char* v2, int l2) const
+{
+  int diff;
+
+  switch (order) {
+  case KEY_ASC:
+    return k1 < k2;
+  case KEY_DESC:
+    return k1 > k2;
+  default:
+    // compare the values like strcmp(), and break ties by the key
+    diff = memcmp(v1, v2, std::min(l1, l2));
+    if (diff == 0) diff = l1 - l2;
+    if (diff == 0) return k1 < k2;
+    return (order == VALUE_ASC) ? diff < 0 : diff > 0;
+  }
+}
+
+RC TupleSorter::add(int key, std::string_view value)
+{
+  RC rc;
+
+  if (sorted) return RC_INVALID_FILE_MODE;
+
+  // write out a run when the buffer exceeds the memory budget
+  if (!entries.empty() &&
+      arena.size() + value.size() + (entries.size() + 1) * sizeof(Entry) > (unsigned) memBytes) {
+    if ((rc = writeRun()) < 0) return rc;
+  }
+
+  Entry e;
+  e.key = key;
+  e.len = value.size();
+  e.offset = arena.size();
+  arena.insert(arena.end(), value.begin(), value.end());
+  entries.push_back(e);
+
+  return 0;
+}
+
+RC TupleSorter::writeRun()
+{
+  RC rc;
+
+  std::sort(entries.begin(), entries.end(), EntryLess(this));
+
+  TempFile* run = new TempFile();
+  if ((rc = run->create()) < 0) {
+    delete run;
+    return rc;
+  }
+  runs.push_back(run);
+  runCount++;
+
+  for (unsigned i = 0; i < entries.size(); i++) {
+    string value(arena.data() + entries[i].offset, entries[i].len);
+    if ((rc = run->append(entries[i].key, value)) < 0) return rc;
+  }
+
+  arena.clear();
+  entries.clear();
+  return 0;
+}
+
+RC TupleSorter::sort()
+{
+  RC rc;
+
+  if (sorted) return 0;
+  sorted = true;
+
+  // everything fits in memory. next() reads the sorted buffer directly
+  if (runs.empty()) {
+    if (!entries.empty()) {
+      std::sort(entries.begin(), entries.end(), EntryLess(this));
+    }
+    nextEntry = 0;
+    return 0;
+  }
+
+  if (!entries.empty() && (rc = writeRun()) < 0) return rc;
+
+  // merge fanIn runs at a time until the rest can be merged at once
+  while ((int) runs.size() > fanIn) {
+    vector<TempFile*> merged;
+    for (unsigned i = 0; i < runs.size(); i += fanIn) {
+      vector<TempFile*> inputs(runs.begin() + i,
+                               runs.begin() + std::min((unsigned) runs.size(), i + fanIn));
+      TempFile* output = new TempFile();
+      if ((rc = output->create()) < 0) {
+        delete output;
+        clearRuns(merged);
+        return rc;
+      }
+      merged.push_back(output);
+      if ((rc = merge(inputs, output)) < 0) {
+        clearRuns(merged);
+        return rc;
+      }
+    }
+    clearRuns(runs);
+    runs = merged;
+  }
+
+  return openMerge(runs);
+}
+
+RC TupleSorter::openMerge(vector<TempFile*>& inputs)
+{
+  RC rc;
+
+  heap.clear();
+  for (unsigned i = 0; i < inputs.size(); i++) {
+    Head h;
+    h.input = i;
+    if ((rc = inputs[i]->rewind()) < 0) return rc;
+    rc = inputs[i]->next(h.key, h.value);
+    if (rc == RC_END_OF_STREAM) continue;
+    if (rc < 0) return rc;
+    heap.push_back(h);
+  }
+  std::make_heap(heap.begin(), heap.end(), HeadGreater(this));
+
+  return 0;
+}
+
+RC TupleSorter::merge(vector<TempFile*>& inputs, TempFile* output)
+{
+  RC rc;
+
+  if ((rc = openMerge(inputs)) < 0) return rc;
+
+  while (!heap.empty()) {
+    std::pop_heap(heap.begin(), heap.end(), HeadGreater(this));
+    Head& h = heap.back();
+    if ((rc = output->append(h.key, h.value)) < 0) return rc;
+
+    // replace the head with the next tuple of the same input
+    rc = inputs[h.input]->next(h.key, h.value);
+    if (rc == RC_END_OF_STREAM) {
+      heap.pop_back();
+    } else if (rc < 0) {
+      return rc;
+    } else {
+      std::push_heap(heap.begin(), heap.end(), HeadGreater(this));
+    }
+  }
+
+  return 0;
+}
+
+RC TupleSorter::next(int& key, string& value)
+{
+  RC rc;
+
+  if (!sorted && (rc = sort()) < 0) return rc;
+
+  // the tuples are still in memory
+  if (runs.empty()) {
+    if (nextEntry >= entries.size()) return RC_END_OF_STREAM;
+    const Entry& e = entries[nextEntry++];
+    key = e.key;
+    value.assign(arena.data() + e.offset, e.len);
+    return 0;
+  }
+
+  if (heap.empty()) return RC_END_OF_STREAM;
+
+  std::pop_heap(heap.begin(), heap.end(), HeadGreater(this));
+  Head& h = heap.back();
+  key = h.key;
+  value.swap(h.value);
+
+  rc = runs[h.input]->next(h.key, h.value);
+  if (rc == RC_END_OF_STREAM) {
+    heap.pop_back();
+  } else if (rc < 0) {
+    return rc;
+  } else {
+    std::push_heap(heap.begin(), heap.end(), HeadGreater(this));
+  }
+
+  return 0;
+}
+
+void TupleSorter::clearRuns(vector<TempFile*>& files)
+{
+  for (unsigned i = 0; i < files.size(); i++) {
+    files[i]->close();
+    delete files[i];
+  }
+  files.clear();
+}
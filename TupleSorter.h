@@ -0,0 +1,98 @@
+#ifndef TUPLESORTER_H
+#define TUPLESORTER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Bruinbase.h"
+#include "PageFile.h"
+#include "TempFile.h"
+
+/**
+ * External merge sort of (key, value) tuples.
+ * The tuples are added one by one and sorted in memory until the memory
+ * budget is used up. Then the sorted tuples are written to a TempFile as
+ * a run, and the runs are merged with (memPages - 1)-way merges until
+ * the last merge pass can be streamed by next().
+ */
+class TupleSorter {
+ public:
+  enum Order { KEY_ASC, KEY_DESC, VALUE_ASC, VALUE_DESC };
+
+  // default memory budget, in pages, for the in-memory sort and the merge
+  static const int MEM_PAGES = 256;
+
+  /**
+   * @param order[IN] the sort order of the tuples
+   * @param memPages[IN] the memory budget in pages. at least 3
+   */
+  TupleSorter(Order order, int memPages = MEM_PAGES);
+  ~TupleSorter();
+
+  /**
+   * add a tuple to sort. may write out a sorted run.
+   * @param key[IN] the key of the tuple
+   * @param value[IN] the value of the tuple
+   * @return error code. 0 if no error
+   */
+  RC add(int key, std::string_view value);
+
+  /**
+   * finish adding tuples and merge the runs. after sort(), the tuples
+   * are returned in the sort order by next().
+   * @return error code. 0 if no error
+   */
+  RC sort();
+
+  /**
+   * return the next tuple in the sort order.
+   * @param key[OUT] the key of the tuple
+   * @param value[OUT] the value of the tuple
+   * @return error code. RC_END_OF_STREAM if all tuples have been returned
+   */
+  RC next(int& key, std::string& value);
+
+  /**
+   * @return the number of runs written to disk
+   */
+  int getRunCount() const { return runCount; }
+
+ private:
+  // a tuple in the in-memory buffer. the value is stored in the arena.
+  struct Entry {
+    int key;
+    int len;
+    int offset;
+  };
+
+  // a tuple at the head of an input of a merge
+  struct Head {
+    int key;
+    std::string value;
+    int input;
+  };
+
+  struct EntryLess;
+  struct HeadGreater;
+
+  RC writeRun();
+  RC merge(std::vector<TempFile*>& inputs, TempFile* output);
+  RC openMerge(std::vector<TempFile*>& inputs);
+  bool less(int k1, const char* v1, int l1, int k2, const char* v2, int l2) const;
+  void clearRuns(std::vector<TempFile*>& runs);
+
+  Order order;
+  int   memBytes;    // the memory budget in bytes
+  int   fanIn;       // max # of runs merged at once
+
+  std::vector<char>  arena;    // values of the buffered tuples
+  std::vector<Entry> entries;  // the buffered tuples
+  unsigned           nextEntry;
+
+  std::vector<TempFile*> runs;   // the sorted runs on disk
+  std::vector<Head>      heap;   // the heads of the final merge
+  int  runCount;
+  bool sorted;
+};
+
+#endif // TUPLESORTER_H
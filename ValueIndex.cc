@@ -0,0 +1,403 @@
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "ValueIndex.h"
+
+using std::string;
+using std::vector;
+
+//
+// Page layout of a node:
+//   [# entries] [pointer] [offset of entry 0] [offset of entry 1] ...
+//   ... free space ... [entry] [entry] ... [entry]
+// the pointer is the next leaf in a leaf node, and the leftmost child in a
+// non-leaf node. the offsets are kept in (value, rid) order, while the
+// entries are packed from the end of the page in the order they arrived.
+// an entry is
+//   [len] [value without the terminating zero] [rid]         in a leaf node
+//   [len] [value without the terminating zero] [rid] [pid]   in a non-leaf node
+// where pid points to the child with the entries >= (value, rid).
+//
+
+typedef unsigned short Offset;
+
+static const int HEADER_SIZE = sizeof(int) + sizeof(PageId);
+
+// an entry decoded from a node, used while a node is split
+struct NodeEntry {
+  string   value;
+  RecordId rid;
+  PageId   pid;
+};
+
+static int getKeyCount(const char* page)
+{
+  int count;
+  memcpy(&count, page, sizeof(int));
+  return count;
+}
+
+static PageId getNodePtr(const char* page)
+{
+  PageId pid;
+  memcpy(&pid, page + sizeof(int), sizeof(PageId));
+  return pid;
+}
+
+// the start of entry eid of a node
+static const char* getEntry(const char* page, int eid)
+{
+  Offset offset;
+  memcpy(&offset, page + HEADER_SIZE + eid * sizeof(Offset), sizeof(Offset));
+  return page + offset;
+}
+
+// the space taken by an entry, including its offset
+static int entrySize(int len, bool leaf)
+{
+  return 2 * sizeof(Offset) + len + sizeof(RecordId) + (leaf ? 0 : sizeof(PageId));
+}
+
+static void readEntry(const char* entry, bool leaf, NodeEntry& e)
+{
+  Offset len;
+  memcpy(&len, entry, sizeof(Offset));
+  entry += sizeof(Offset);
+  e.value.assign(entry, len);
+  entry += len;
+  memcpy(&e.rid, entry, sizeof(RecordId));
+  e.pid = 0;
+  if (!leaf) memcpy(&e.pid, entry + sizeof(RecordId), sizeof(PageId));
+}
+
+// write an entry at the given position of a page
+static void writeEntry(char* page, int offset, const NodeEntry& e, bool leaf)
+{
+  Offset len = e.value.size();
+  char*  ptr = page + offset;
+  memcpy(ptr, &len, sizeof(Offset));
+  ptr += sizeof(Offset);
+  memcpy(ptr, e.value.data(), len);
+  ptr += len;
+  memcpy(ptr, &e.rid, sizeof(RecordId));
+  if (!leaf) memcpy(ptr + sizeof(RecordId), &e.pid, sizeof(PageId));
+}
+
+// compare the (value, rid) of an entry with the given pair, like strcmp()
+static int compareEntry(const char* entry, const string& value, const RecordId& rid)
+{
+  Offset   len;
+  RecordId erid;
+
+  memcpy(&len, entry, sizeof(Offset));
+  size_t n = (len < value.size()) ? len : value.size();
+  int diff = memcmp(entry + sizeof(Offset), value.data(), n);
+  if (diff != 0) return diff;
+  if (len != value.size()) return (len < value.size()) ? -1 : 1;
+
+  memcpy(&erid, entry + sizeof(Offset) + len, sizeof(RecordId));
+  if (erid.pid != rid.pid) return (erid.pid < rid.pid) ? -1 : 1;
+  if (erid.sid != rid.sid) return (erid.sid < rid.sid) ? -1 : 1;
+  return 0;
+}
+
+// the # of entries of a node smaller than (value, rid), or smaller than
+// or equal to it if inclusive is set
+static int findEntry(const char* page, const string& value, const RecordId& rid, bool inclusive)
+{
+  int low = 0;
+  int high = getKeyCount(page);
+  while (low < high) {
+    int mid = (low + high) / 2;
+    int diff = compareEntry(getEntry(page, mid), value, rid);
+    if (diff < 0 || (inclusive && diff == 0)) low = mid + 1;
+    else high = mid;
+  }
+  return low;
+}
+
+// insert an entry at position eid of a node if the node has enough space
+static bool insertEntry(char* page, int eid, const NodeEntry& e, bool leaf)
+{
+  int count = getKeyCount(page);
+  int end = PageFile::PAGE_SIZE;
+  for (int i = 0; i < count; i++) {
+    int offset = getEntry(page, i) - page;
+    if (offset < end) end = offset;
+  }
+
+  int size = entrySize(e.value.size(), leaf);
+  if (HEADER_SIZE + (int) sizeof(Offset) * count + size > end) return false;
+
+  Offset offset = end - (size - sizeof(Offset));
+  writeEntry(page, offset, e, leaf);
+
+  char* slot = page + HEADER_SIZE + eid * sizeof(Offset);
+  memmove(slot + sizeof(Offset), slot, (count - eid) * sizeof(Offset));
+  memcpy(slot, &offset, sizeof(Offset));
+  count++;
+  memcpy(page, &count, sizeof(int));
+  return true;
+}
+
+// build a node from the entries [begin, end)
+static void buildNode(char* page, PageId ptr, const vector<NodeEntry>& entries,
+                      int begin, int end, bool leaf)
+{
+  int count = end - begin;
+  int offset = PageFile::PAGE_SIZE;
+
+  memset(page, 0, PageFile::PAGE_SIZE);
+  memcpy(page, &count, sizeof(int));
+  memcpy(page + sizeof(int), &ptr, sizeof(PageId));
+  for (int i = begin; i < end; i++) {
+    offset -= entrySize(entries[i].value.size(), leaf) - sizeof(Offset);
+    writeEntry(page, offset, entries[i], leaf);
+
+    Offset o = offset;
+    memcpy(page + HEADER_SIZE + (i - begin) * sizeof(Offset), &o, sizeof(Offset));
+  }
+}
+
+ValueIndex::ValueIndex()
+{
+  rootPid = -1;
+  treeHeight = 0;
+  dirty = false;
+}
+
+RC ValueIndex::open(const string& indexname, char mode)
+{
+  RC rc;
+  char page[PageFile::PAGE_SIZE];
+
+  if ((rc = pf.open(indexname, mode)) < 0) return rc;
+
+  rootPid = -1;
+  treeHeight = 0;
+  dirty = false;
+
+  // page 0 stores rootPid and treeHeight. a new index file saves the
+  // empty header right away so that the tree nodes start from page 1.
+  if (pf.endPid() == 0) {
+    if (mode == 'w' || mode == 'W') return writeHeader();
+    return 0;
+  }
+
+  if ((rc = pf.read(0, page)) < 0) {
+    pf.close();
+    return rc;
+  }
+  memcpy(&rootPid, page, sizeof(PageId));
+  memcpy(&treeHeight, page + sizeof(PageId), sizeof(int));
+  return 0;
+}
+
+RC ValueIndex::close()
+{
+  if (dirty && writeHeader() < 0) {
+    pf.close();
+    return RC_FILE_WRITE_FAILED;
+  }
+  return pf.close();
+}
+
+RC ValueIndex::writeHeader()
+{
+  char page[PageFile::PAGE_SIZE];
+
+  memset(page, 0, PageFile::PAGE_SIZE);
+  memcpy(page, &rootPid, sizeof(PageId));
+  memcpy(page + sizeof(PageId), &treeHeight, sizeof(int));
+  if (pf.write(0, page) < 0) return RC_FILE_WRITE_FAILED;
+
+  dirty = false;
+  return 0;
+}
+
+RC ValueIndex::insert(const string& value, const RecordId& rid)
+{
+  RC       rc;
+  char     page[PageFile::PAGE_SIZE];
+  PageId   siblingPid;
+  string   siblingValue;
+  RecordId siblingRid;
+
+  // the table keeps the first MAX_VALUE_LENGTH - 1 bytes of a value,
+  // so the index does the same
+  string stored = value.substr(0, RecordFile::MAX_VALUE_LENGTH - 1);
+
+  // the first entry creates a root that is also a leaf
+  if (treeHeight == 0) {
+    vector<NodeEntry> entries(1);
+    entries[0].value = stored;
+    entries[0].rid = rid;
+    entries[0].pid = 0;
+    buildNode(page, 0, entries, 0, 1, true);
+
+    rootPid = pf.endPid();
+    if ((rc = pf.write(rootPid, page)) < 0) return rc;
+    treeHeight = 1;
+    dirty = true;
+    return 0;
+  }
+
+  rc = insertHelper(rootPid, 1, stored, rid, siblingPid, siblingValue, siblingRid);
+  if (rc != RC_NODE_FULL) return rc;
+
+  // the root was split. grow the tree by one level
+  vector<NodeEntry> entries(1);
+  entries[0].value = siblingValue;
+  entries[0].rid = siblingRid;
+  entries[0].pid = siblingPid;
+  buildNode(page, rootPid, entries, 0, 1, false);
+
+  PageId newRootPid = pf.endPid();
+  if ((rc = pf.write(newRootPid, page)) < 0) return rc;
+  rootPid = newRootPid;
+  treeHeight++;
+  dirty = true;
+  return 0;
+}
+
+RC ValueIndex::insertHelper(PageId pid, int curHeight, const string& value, const RecordId& rid,
+                            PageId& siblingPid, string& siblingValue, RecordId& siblingRid)
+{
+  RC        rc;
+  char      page[PageFile::PAGE_SIZE];
+  bool      leaf = (curHeight == treeHeight);
+  NodeEntry entry;
+
+  if ((rc = pf.read(pid, page)) < 0) return rc;
+
+  if (leaf) {
+    entry.value = value;
+    entry.rid = rid;
+    entry.pid = 0;
+  } else {
+    // descend to the child whose range covers (value, rid)
+    int    eid = findEntry(page, value, rid, true);
+    PageId childPid = getNodePtr(page);
+    if (eid > 0) {
+      NodeEntry e;
+      readEntry(getEntry(page, eid - 1), false, e);
+      childPid = e.pid;
+    }
+
+    rc = insertHelper(childPid, curHeight + 1, value, rid, siblingPid, siblingValue, siblingRid);
+    if (rc != RC_NODE_FULL) return rc;
+
+    // the child was split. add the new sibling to this node
+    entry.value = siblingValue;
+    entry.rid = siblingRid;
+    entry.pid = siblingPid;
+  }
+
+  int eid = findEntry(page, entry.value, entry.rid, true);
+  if (insertEntry(page, eid, entry, leaf)) return pf.write(pid, page);
+
+  // the node is full. split the entries in half by their size
+  vector<NodeEntry> entries(getKeyCount(page));
+  for (unsigned i = 0; i < entries.size(); i++) {
+    readEntry(getEntry(page, i), leaf, entries[i]);
+  }
+  entries.insert(entries.begin() + eid, entry);
+
+  int n = entries.size();
+  int total = 0;
+  for (int i = 0; i < n; i++) total += entrySize(entries[i].value.size(), leaf);
+
+  // a non-leaf node moves its middle entry up to the parent, so each
+  // half keeps at least one entry
+  int mid = 1;
+  int size = entrySize(entries[0].value.size(), leaf);
+  int last = leaf ? n - 1 : n - 2;
+  while (mid < last && 2 * (size + entrySize(entries[mid].value.size(), leaf)) <= total) {
+    size += entrySize(entries[mid++].value.size(), leaf);
+  }
+
+  char sibling[PageFile::PAGE_SIZE];
+  siblingPid = pf.endPid();
+  siblingValue = entries[mid].value;
+  siblingRid = entries[mid].rid;
+  if (leaf) {
+    // link the sibling between this leaf and the next one
+    buildNode(sibling, getNodePtr(page), entries, mid, n, true);
+    buildNode(page, siblingPid, entries, 0, mid, true);
+  } else {
+    buildNode(sibling, entries[mid].pid, entries, mid + 1, n, false);
+    buildNode(page, getNodePtr(page), entries, 0, mid, false);
+  }
+
+  if ((rc = pf.write(siblingPid, sibling)) < 0) return rc;
+  if ((rc = pf.write(pid, page)) < 0) return rc;
+  return RC_NODE_FULL;
+}
+
+RC ValueIndex::locate(const string& searchValue, IndexCursor& cursor)
+{
+  RC   rc;
+  char page[PageFile::PAGE_SIZE];
+
+  // every real entry is larger than (searchValue, first) when its value
+  // is searchValue, so the search finds the first of the duplicates
+  RecordId first;
+  first.pid = first.sid = -1;
+
+  // the cursor is past the end of the tree unless we find an entry
+  cursor.pid = 0;
+  cursor.eid = 0;
+  if (treeHeight == 0) return RC_NO_SUCH_RECORD;
+
+  PageId pid = rootPid;
+  for (int curHeight = 1; curHeight < treeHeight; curHeight++) {
+    if ((rc = pf.read(pid, page)) < 0) return rc;
+
+    int eid = findEntry(page, searchValue, first, false);
+    if (eid == 0) {
+      pid = getNodePtr(page);
+    } else {
+      NodeEntry e;
+      readEntry(getEntry(page, eid - 1), false, e);
+      pid = e.pid;
+    }
+  }
+
+  if ((rc = pf.read(pid, page)) < 0) return rc;
+
+  // if every value in this leaf is smaller, the first entry of the next
+  // leaf is the answer
+  int eid = findEntry(page, searchValue, first, false);
+  if (eid == getKeyCount(page)) {
+    cursor.pid = getNodePtr(page);
+    return (cursor.pid == 0) ? RC_NO_SUCH_RECORD : 0;
+  }
+
+  cursor.pid = pid;
+  cursor.eid = eid;
+  return 0;
+}
+
+RC ValueIndex::readForward(IndexCursor& cursor, string& value, RecordId& rid)
+{
+  RC        rc;
+  char      page[PageFile::PAGE_SIZE];
+  NodeEntry e;
+
+  // pid 0 is the header page, so it marks the end of the leaf chain
+  if (cursor.pid <= 0) return RC_END_OF_TREE;
+  if ((rc = pf.read(cursor.pid, page)) < 0) return rc;
+
+  int count = getKeyCount(page);
+  if (cursor.eid < 0 || cursor.eid >= count) return RC_INVALID_CURSOR;
+
+  readEntry(getEntry(page, cursor.eid), true, e);
+  value = e.value;
+  rid = e.rid;
+
+  if (++cursor.eid >= count) {
+    cursor.pid = getNodePtr(page);
+    cursor.eid = 0;
+  }
+  return 0;
+}
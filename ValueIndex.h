@@ -0,0 +1,95 @@
+#ifndef VALUEINDEX_H
+#define VALUEINDEX_H
+
+#include <string>
+#include "Bruinbase.h"
+#include "PageFile.h"
+#include "RecordFile.h"
+#include "BTreeIndex.h"
+
+/**
+ * Implements a secondary B+tree index on the value column.
+ * Values are variable-length strings, so every node is a slotted page:
+ * an array of entry offsets follows the node header, and the entries
+ * themselves are packed from the end of the page.
+ * Entries are ordered by (value, rid), which makes every entry unique
+ * even when many tuples share a value. Values compare like strcmp().
+ */
+class ValueIndex {
+ public:
+  ValueIndex();
+
+  /**
+   * Open the index file in read or write mode.
+   * Under 'w' mode, the index file is created if it does not exist.
+   * @param indexname[IN] the name of the index file
+   * @param mode[IN] 'r' for read, 'w' for write
+   * @return error code. 0 if no error
+   */
+  RC open(const std::string& indexname, char mode);
+
+  /**
+   * Close the index file.
+   * @return error code. 0 if no error
+   */
+  RC close();
+
+  /**
+   * Insert (value, RecordId) pair to the index.
+   * @param value[IN] the value of the record. at most
+   * RecordFile::MAX_VALUE_LENGTH bytes
+   * @param rid[IN] the RecordId of the record
+   * @return error code. 0 if no error
+   */
+  RC insert(const std::string& value, const RecordId& rid);
+
+  /**
+   * Find the first leaf-node entry whose value is larger than or equal to
+   * searchValue and output its location in cursor.
+   * Call readForward() with the cursor to scan the values in ascending order.
+   * @param searchValue[IN] the value to find
+   * @param cursor[OUT] the cursor pointing to the first entry with a
+   * value &gt;= searchValue
+   * @return error code. RC_NO_SUCH_RECORD if every value is smaller
+   */
+  RC locate(const std::string& searchValue, IndexCursor& cursor);
+
+  /**
+   * Read the (value, rid) pair at the location specified by the index
+   * cursor, and move the cursor forward to the next entry.
+   * @param cursor[IN/OUT] the cursor pointing to a leaf-node entry
+   * @param value[OUT] the value stored at the cursor location
+   * @param rid[OUT] the RecordId stored at the cursor location
+   * @return error code. RC_END_OF_TREE if the cursor is past the last entry
+   */
+  RC readForward(IndexCursor& cursor, std::string& value, RecordId& rid);
+
+  /**
+   * @return the height of the tree. 0 if the tree is empty
+   */
+  int getTreeHeight() const { return treeHeight; }
+
+ private:
+  /**
+   * Recursive helper. Inserts (value, rid) into the subtree rooted at pid,
+   * which sits at level curHeight (the root is at level 1).
+   * Returns RC_NODE_FULL if the node at pid was split; the first entry
+   * of the new sibling is then (siblingValue, siblingRid), and it must be
+   * inserted into the parent together with siblingPid.
+   */
+  RC insertHelper(PageId pid, int curHeight, const std::string& value, const RecordId& rid,
+                  PageId& siblingPid, std::string& siblingValue, RecordId& siblingRid);
+
+  /**
+   * Save rootPid and treeHeight to page 0 of the index file.
+   * @return error code. 0 if no error
+   */
+  RC writeHeader();
+
+  PageFile pf;         /// the PageFile that stores the b+tree
+  PageId   rootPid;    /// the PageId of the root node
+  int      treeHeight; /// the height of the tree. 0 if empty
+  bool     dirty;      /// true if rootPid or treeHeight must be saved on close
+};
+
+#endif /* VALUEINDEX_H */
@@ -363,8 +363,8 @@ static void yy_fatal_error (yyconst char msg[]  );
 	*yy_cp = '\0'; \
 	(yy_c_buf_p) = yy_cp;
 
-#define YY_NUM_RULES 26
-#define YY_END_OF_BUFFER 27
+#define YY_NUM_RULES 52
+#define YY_END_OF_BUFFER 53
 /* This struct is not used in this scanner,
    but its presence is necessary. */
 struct yy_trans_info
@@ -372,149 +372,313 @@ struct yy_trans_info
 	flex_int32_t yy_verify;
 	flex_int32_t yy_nxt;
 	};
-static yyconst flex_int16_t yy_accept[113] =
+static yyconst flex_int16_t yy_accept[328] =
     {   0,
-        0,    0,   27,   26,   25,   23,   26,   26,   22,   21,
-       26,   18,   24,   15,   12,   14,   20,   20,   20,   20,
-       20,   20,   20,   20,   20,   20,   20,   20,   20,   20,
-       20,   20,   20,   20,   20,   20,   20,   25,   23,    0,
-       19,   18,   17,   13,   16,   20,   20,   20,   20,   20,
-       20,   20,   11,   20,   20,   20,   20,   20,   20,   20,
-       20,   20,   20,   20,   20,   20,   20,   10,   20,   20,
-       20,   20,   20,   20,   20,   20,   20,   20,   20,   20,
-       20,   20,   20,   20,   20,   20,   20,    8,    2,   20,
-        4,    7,   20,   20,    5,   20,   20,   20,   20,   20,
-
-        6,   20,    3,   20,   20,    0,    1,    0,    0,    0,
-        9,    0
+    0,    0,   53,   52,   51,   49,   52,   52,   46,   47,
+   48,   45,   52,   41,   50,   38,   35,   37,   43,   43,
+   43,   43,   43,   43,   43,   43,   43,   43,   43,   43,
+   43,   43,   43,   43,   43,   43,   43,   43,   43,   43,
+   43,   43,   43,   43,   43,   43,   43,   43,   43,   43,
+   43,   51,   49,    0,   42,   41,   40,   36,   39,   43,
+    0,   43,   43,   43,   43,   43,   21,   43,   43,   43,
+   43,   43,   43,   43,   43,   29,   43,   43,   43,   43,
+   43,    9,   43,   34,   43,   43,   43,   43,   43,   43,
+   43,   43,   43,   43,   43,   43,   21,   43,   43,   43,
+
+   43,   43,   43,   43,   43,   29,   43,   43,   43,   43,
+   43,    9,   43,   34,   43,   43,   43,   43,   43,   43,
+   43,   44,   43,   33,   43,   22,   27,   43,   43,   43,
+   43,   43,   43,   43,   43,   43,   43,   43,   43,   25,
+   24,   43,   43,   43,   43,   43,   43,   43,   26,   43,
+   43,   43,   43,   33,   43,   22,   27,   43,   43,   43,
+   43,   43,   43,   43,   43,   43,   43,   43,   43,   25,
+   24,   43,   43,   43,   43,   43,   43,   43,   26,   43,
+   43,   43,   43,   43,   43,   43,   43,   43,   23,   31,
+   43,    2,   43,   43,   43,    4,   43,   43,   43,   30,
+
+   43,   43,   43,   43,   43,    6,   43,   43,   43,   43,
+   43,   43,   23,   31,   43,    2,   43,   43,   43,    4,
+   43,   43,   43,   30,   43,   43,   43,   43,   43,    6,
+   43,   43,   43,   43,   43,   43,   43,   20,    7,   17,
+   43,   43,   19,   43,   43,   43,   13,    3,   43,   43,
+   43,   43,   43,   43,   43,   20,    7,   17,   43,   43,
+   19,   43,   43,   43,   13,    3,   43,    5,   43,   43,
+    0,    8,   43,   18,   43,   43,   43,    1,   43,    5,
+   43,   43,    0,    8,   43,   18,   43,   43,   43,    1,
+   16,   28,   43,    0,   43,   43,   14,   43,   16,   28,
+
+   43,    0,   43,   43,   14,   43,   43,   32,   43,   11,
+   43,   43,   32,   43,   11,   43,   10,   43,   43,   10,
+   43,   43,   15,   12,   15,   12,    0
     } ;
 
 static yyconst flex_int32_t yy_ec[256] =
     {   0,
-        1,    1,    1,    1,    1,    1,    1,    1,    2,    3,
-        1,    1,    4,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    2,    1,    1,    1,    1,    1,    1,    5,    6,
-        7,    8,    1,    9,   10,    1,    1,   11,   11,   11,
-       11,   11,   11,   11,   11,   11,   11,    1,   12,   13,
-       14,   15,    1,    1,   16,   17,   18,   19,   20,   21,
-       17,   22,   23,   17,   17,   24,   25,   26,   27,   17,
-       28,   29,   30,   31,   32,   17,   33,   34,   17,   17,
-        1,    1,    1,    1,   35,    1,   36,   17,   37,   38,
-
-       39,   40,   17,   41,   42,   17,   17,   43,   44,   45,
-       46,   17,   47,   48,   49,   50,   51,   17,   52,   53,
-       17,   17,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1
+    1,    1,    1,    1,    1,    1,    1,    1,    2,    3,
+    1,    1,    4,    1,    1,    1,    1,    1,    1,    1,
+    1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+    1,    2,    1,    1,    1,    1,    1,    1,    5,    6,
+    7,    8,    1,    9,   10,   11,    1,   12,   12,   12,
+   12,   12,   12,   12,   12,   12,   12,    1,   13,   14,
+   15,   16,    1,    1,   17,   18,   19,   20,   21,   22,
+   23,   24,   25,   26,   26,   27,   28,   29,   30,   31,
+   32,   33,   34,   35,   36,   37,   38,   39,   40,   41,
+    1,    1,    1,    1,   42,    1,   43,   44,   45,   46,
+
+   47,   48,   49,   50,   51,   26,   26,   52,   53,   54,
+   55,   56,   57,   58,   59,   60,   61,   62,   63,   64,
+   65,   66,    1,    1,    1,    1,    1,    1,    1,    1,
+    1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+    1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+    1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+    1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+    1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+    1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+    1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+
+    1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+    1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+    1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+    1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+    1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+    1,    1,    1,    1,    1
     } ;
 
-static yyconst flex_int32_t yy_meta[54] =
+static yyconst flex_int32_t yy_meta[67] =
     {   0,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    2,
-        2,    1,    1,    1,    1,    2,    2,    2,    2,    2,
-        2,    2,    2,    2,    2,    2,    2,    2,    2,    2,
-        2,    2,    2,    2,    2,    2,    2,    2,    2,    2,
-        2,    2,    2,    2,    2,    2,    2,    2,    2,    2,
-        2,    2,    2
+    1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+    1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+    1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+    1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+    1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+    1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+    1,    1,    1,    1,    1,    1
     } ;
 
-static yyconst flex_int16_t yy_base[115] =
+static yyconst flex_int16_t yy_base[328] =
     {   0,
-        0,    0,  144,  145,  141,  145,  139,  136,  145,  145,
-      129,  128,  145,   40,  145,  124,  111,    0,  109,  101,
-      105,  107,  105,  102,   98,  109,   34,   83,   81,   73,
-       77,   79,   77,   74,   70,   81,   17,  117,  145,  113,
-      145,  106,  145,  145,  145,    0,   97,   83,   91,   86,
-       93,   95,    0,   87,   85,   88,   76,   68,   54,   62,
-       57,   64,   65,   58,   56,   59,   47,    0,   70,   64,
-       69,   73,   73,   60,   70,   60,   66,   42,   36,   41,
-       45,   45,   32,   42,   32,   38,   47,    0,    0,   43,
-        0,    0,   58,   55,    0,   24,   20,   35,   32,   64,
-
-        0,   38,    0,   62,   17,   58,    0,   57,   57,   56,
-      145,  145,   59,   60
+    1,    2,   68,  561,   67,  561,   69,   72,  561,  561,
+  561,  561,   58,    3,  561,  124,  561,   56,  131,  177,
+  180,  178,  182,  179,  194,  123,  116,  198,  199,  200,
+  110,  126,  204,  185,  210,  183,  189,  186,  158,  145,
+  168,  172,  192,  196,  205,  201,  171,  203,  206,  209,
+  211,    4,  561,    5,  561,    6,  561,  561,  561,    7,
+  251,  243,  212,  239,  241,  230,    8,  257,  282,  245,
+  285,  295,  294,  292,  293,  304,  297,  309,  288,  299,
+  307,    9,  296,  310,  308,  311,  305,  306,  317,  316,
+  303,  300,  283,  302,  291,  284,   10,  281,  287,  298,
+
+  290,  301,  312,  313,  314,  315,  318,  319,  286,  320,
+  322,   11,  321,  326,  324,  325,  327,  329,  323,  330,
+  328,   12,  331,   13,  332,   14,   15,  335,  344,  334,
+  337,  336,  348,  333,  338,  349,  363,  340,  339,   16,
+   17,  352,  362,  368,  355,  364,  358,  371,   18,  367,
+  365,  372,  343,   19,  350,   20,   21,  341,  342,  345,
+  357,  360,  346,  351,  354,  347,  366,  359,  356,   22,
+   23,  353,  369,  370,  361,  373,  374,  375,   24,  376,
+  377,  379,  378,  380,  390,  381,  384,  388,   25,   26,
+  392,   27,  393,  386,  391,   28,  394,  402,  398,   29,
+
+  413,  411,  417,  416,  418,   30,  382,  387,  395,  383,
+  385,  389,   31,   32,  396,   33,  397,  399,  400,   34,
+  401,  403,  404,   35,  405,  406,  407,  410,  412,   36,
+  409,  420,  425,  433,  432,  437,  444,   37,   38,   39,
+  429,  440,   40,  445,  450,  434,   41,   42,  408,  422,
+  423,  424,  466,  426,  435,   43,   44,   45,  415,  428,
+   46,  430,  438,  427,   47,   48,  455,   49,  451,  449,
+  475,   50,  465,   51,  447,  446,  457,   52,  442,   53,
+  436,  439,  483,   54,  448,   55,  441,  431,  452,   57,
+   59,   60,  471,  487,  461,  477,   61,  474,   62,   63,
+
+  453,  494,  443,  458,   64,  459,  482,  561,  478,   65,
+  463,  467,  561,  454,   66,  456,   70,  479,  490,   71,
+  460,  468,   73,   74,   75,   76,  561
     } ;
 
-static yyconst flex_int16_t yy_def[115] =
+static yyconst flex_int16_t yy_def[328] =
     {   0,
-      112,    1,  112,  112,  112,  112,  112,  113,  112,  112,
-      112,  112,  112,  112,  112,  112,  114,  114,  114,  114,
-      114,  114,  114,  114,  114,  114,  114,  114,  114,  114,
-      114,  114,  114,  114,  114,  114,  114,  112,  112,  113,
-      112,  112,  112,  112,  112,  114,  114,  114,  114,  114,
-      114,  114,  114,  114,  114,  114,  114,  114,  114,  114,
-      114,  114,  114,  114,  114,  114,  114,  114,  114,  114,
-      114,  114,  114,  114,  114,  114,  114,  114,  114,  114,
-      114,  114,  114,  114,  114,  114,  114,  114,  114,  114,
-      114,  114,  114,  114,  114,  114,  114,  114,  114,  114,
-
-      114,  114,  114,  114,  114,  112,  114,  112,  112,  112,
-      112,    0,  112,  112
+  327,    1,  327,  327,  327,  327,  327,  327,  327,  327,
+  327,  327,  327,   13,  327,  327,  327,  327,  327,   19,
+   20,   20,   22,   22,   22,   22,   26,   26,   26,   25,
+   26,   22,   22,   26,   26,   26,   26,   26,   26,   26,
+   26,   26,   26,   26,   26,   26,   26,   26,   26,   26,
+   26,    5,  327,    8,  327,   13,  327,  327,  327,   26,
+  327,   26,   26,   26,   26,   26,   26,   26,   26,   22,
+   26,   26,   26,   26,   26,   26,   26,   26,   23,   26,
+   26,   26,   26,   26,   26,   26,   26,   26,   26,   22,
+   26,   26,   26,   26,   26,   26,   26,   26,   26,   26,
+
+   26,   26,   26,   26,   26,   26,   26,   26,   26,   26,
+   26,   26,   26,   26,   26,   26,   26,   26,   26,   26,
+   26,   61,   26,   26,   22,   26,   26,   26,   26,   26,
+   26,   26,   26,   26,   26,   26,   22,   26,   26,   26,
+   26,   26,   26,   22,   26,   26,   25,   22,   26,   26,
+   25,   26,   26,   26,   26,   26,   26,   26,   26,   26,
+   26,   26,   26,   26,   26,   26,   26,   26,   26,   26,
+   26,   26,   26,   26,   26,   26,   26,   26,   26,   26,
+   26,   26,   26,   26,   22,   26,   26,   26,   26,   26,
+   26,   26,   26,   23,   26,   26,   22,   26,   25,   26,
+
+   26,   26,   26,   22,   22,   26,   26,   26,   26,   26,
+   26,   26,   26,   26,   26,   26,   26,   26,   26,   26,
+   26,   26,   26,   26,   26,   26,   26,   26,   26,   26,
+   26,   26,   22,   22,   26,   22,   26,   26,   26,   26,
+   26,   26,   26,   22,   26,   26,   26,   26,   26,   26,
+   26,   26,   26,   26,   26,   26,   26,   26,   26,   26,
+   26,   26,   26,   26,   26,   26,   22,   26,   26,   25,
+  327,   26,   26,   26,   26,   23,   26,   26,   26,   26,
+   26,   26,  327,   26,   26,   26,   26,   26,   26,   26,
+   26,   26,   22,  327,   26,   22,   26,   26,   26,   26,
+
+   26,  327,   26,   26,   26,   26,   26,  327,   26,   26,
+   26,   26,  327,   26,   26,   26,   26,   25,   22,   26,
+   26,   26,   26,   26,   26,   26,    0
     } ;
 
-static yyconst flex_int16_t yy_nxt[199] =
+static yyconst flex_int16_t yy_nxt[628] =
     {   0,
-        4,    5,    6,    7,    8,    4,    4,    9,   10,   11,
-       12,   13,   14,   15,   16,   17,   18,   19,   18,   20,
-       21,   18,   22,   23,   18,   18,   24,   25,   18,   26,
-       18,   18,   27,   18,    4,   28,   29,   18,   30,   31,
-       18,   32,   33,   18,   18,   34,   35,   18,   36,   18,
-       18,   37,   18,   43,   44,   56,   57,   66,   67,   40,
-       40,   46,  111,  111,  110,  109,  107,  108,  107,  106,
-      103,  105,  101,  104,  103,  102,  101,  100,   95,   99,
-       98,   92,   91,   97,   89,   88,   96,   95,   94,   93,
-       92,   91,   90,   89,   88,   87,   86,   85,   84,   83,
-
-       82,   81,   80,   79,   78,   68,   77,   76,   75,   74,
-       73,   72,   71,   70,   69,   68,   42,   41,   38,   65,
-       64,   53,   63,   62,   61,   60,   59,   58,   55,   54,
-       53,   52,   51,   50,   49,   48,   47,   45,   42,   42,
-       41,   39,   38,  112,    3,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112
-
+    0,    4,    5,    6,    7,    8,    9,   10,   11,   12,
+   13,    4,   14,   15,   16,   17,   18,   19,   20,   21,
+   22,   23,   24,   25,   26,   27,   26,   28,   29,   26,
+   30,   26,   31,   32,   33,   34,   26,   26,   35,   26,
+   26,   26,    4,   36,   37,   38,   39,   40,   41,   42,
+   26,   43,   44,   45,   26,   46,   26,   47,   48,   49,
+   50,   26,   26,   51,   26,   26,   26,  327,   52,   56,
+   59,   53,   54,   54,   54,   54,   55,   54,   54,   54,
+   54,   54,   54,   54,   54,   54,   54,   54,   54,   54,
+   54,   54,   54,   54,   54,   54,   54,   54,   54,   54,
+
+   54,   54,   54,   54,   54,   54,   54,   54,   54,   54,
+   54,   54,   54,   54,   54,   54,   54,   54,   54,   54,
+   54,   54,   54,   54,   54,   54,   54,   54,   54,   54,
+   54,   54,   54,   54,   54,   54,   54,   54,   57,   58,
+   60,   61,   60,   60,   76,   85,   86,   60,   60,   60,
+   60,   60,   60,   60,   60,   60,   60,   60,   60,   62,
+   60,   63,   60,   60,   64,   60,   60,   65,   60,   60,
+   60,   60,   60,   60,   60,   60,   60,   60,   60,   60,
+   60,   60,   60,   60,   60,   60,   60,   60,   60,   60,
+   60,   60,   60,   60,   60,   60,   60,   66,   71,   60,
+
+   60,   89,   60,   73,  101,   60,   68,   60,  102,   69,
+   60,   74,   70,   60,   60,   79,   67,   60,  103,   60,
+   72,   81,   77,   80,   87,  104,   75,   78,   82,  105,
+   83,  115,   84,   90,   91,   96,   92,   98,   93,   88,
+   99,   94,  125,  100,   95,  106,  107,  109,  111,  116,
+  108,  119,  117,   97,  112,  110,  113,  126,  114,  123,
+  120,  121,  124,  127,  128,  131,  118,  122,  122,  122,
+  122,  122,  122,  122,  122,  122,  122,  122,  122,  122,
+  122,  122,  122,  122,  122,  122,  122,  122,  122,  122,
+  122,  122,  129,  122,  122,  122,  122,  122,  122,  122,
+
+  122,  122,  122,  122,  122,  122,  122,  122,  122,  122,
+  122,  122,  122,  122,  122,  122,  122,  130,  132,  133,
+  134,  135,  136,  137,  138,  139,  140,  141,  142,  144,
+  143,  148,  145,  149,  150,  146,  151,  152,  155,  157,
+  147,  159,  153,  158,  161,  154,  156,  160,  162,  170,
+    0,  163,  184,  188,  189,    0,    0,  183,  196,  191,
+  167,  169,  187,  164,  195,  192,  180,  165,  166,  172,
+  168,  174,  185,  171,  175,  176,  181,  186,  178,  177,
+  173,  179,  190,  194,  193,  197,  198,  182,  199,  200,
+  202,  203,  201,  204,  207,  206,  208,  205,  211,  212,
+
+  210,  220,  215,  209,  213,  214,  216,  217,  232,  219,
+  233,  221,  218,  237,  241,  234,  223,  231,  235,  222,
+  224,  227,  236,  238,  239,  240,  225,  228,  230,  242,
+  243,  226,  244,  245,  229,  246,  247,  271,  248,  268,
+  250,  251,  252,  255,  253,  269,  249,  259,  254,  267,
+  262,  264,  256,  270,  263,  260,  265,  272,  266,  258,
+  273,  261,  257,  274,  275,  276,  277,  280,  278,  281,
+  282,  283,  284,  279,  286,  291,  288,  285,  287,  292,
+  289,  293,  294,  295,  297,  298,  290,  296,  299,  300,
+  302,  307,  303,  308,  305,  309,  301,  310,  311,  312,
+
+  313,  317,  314,  319,  315,  306,  304,  318,  321,  316,
+  324,  323,  320,    0,  326,    0,    0,  325,    0,    0,
+    0,  322,    0,    0,    0,    0,    0,    0,    0,    0,
+    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+    3,  327,  327,  327,  327,  327,  327,  327,  327,  327,
+  327,  327,  327,  327,  327,  327,  327,  327,  327,  327,
+  327,  327,  327,  327,  327,  327,  327,  327,  327,  327,
+  327,  327,  327,  327,  327,  327,  327,  327,  327,  327,
+
+  327,  327,  327,  327,  327,  327,  327,  327,  327,  327,
+  327,  327,  327,  327,  327,  327,  327,  327,  327,  327,
+  327,  327,  327,  327,  327,  327,  327
     } ;
 
-static yyconst flex_int16_t yy_chk[199] =
+static yyconst flex_int16_t yy_chk[628] =
     {   0,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,   14,   14,   27,   27,   37,   37,  113,
-      113,  114,  110,  109,  108,  106,  105,  104,  102,  100,
-       99,   98,   97,   96,   94,   93,   90,   87,   86,   85,
-       84,   83,   82,   81,   80,   79,   78,   77,   76,   75,
-       74,   73,   72,   71,   70,   69,   67,   66,   65,   64,
-
-       63,   62,   61,   60,   59,   58,   57,   56,   55,   54,
-       52,   51,   50,   49,   48,   47,   42,   40,   38,   36,
-       35,   34,   33,   32,   31,   30,   29,   28,   26,   25,
-       24,   23,   22,   21,   20,   19,   17,   16,   12,   11,
-        8,    7,    5,    3,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112
-
+    0,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+    1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+    1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+    1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+    1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+    1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+    1,    1,    1,    1,    1,    1,    1,    3,    5,   13,
+   18,    7,    8,    8,    8,    8,    8,    8,    8,    8,
+    8,    8,    8,    8,    8,    8,    8,    8,    8,    8,
+    8,    8,    8,    8,    8,    8,    8,    8,    8,    8,
+
+    8,    8,    8,    8,    8,    8,    8,    8,    8,    8,
+    8,    8,    8,    8,    8,    8,    8,    8,    8,    8,
+    8,    8,    8,    8,    8,    8,    8,    8,    8,    8,
+    8,    8,    8,    8,    8,    8,    8,    8,   16,   16,
+   19,   19,   19,   26,   27,   31,   32,   19,   19,   19,
+   19,   19,   19,   19,   19,   19,   19,   19,   19,   19,
+   19,   19,   19,   19,   19,   19,   19,   19,   19,   19,
+   19,   19,   19,   19,   19,   19,   19,   19,   19,   19,
+   19,   19,   19,   19,   19,   19,   19,   19,   19,   19,
+   19,   19,   19,   19,   19,   19,   19,   20,   22,   24,
+
+   21,   34,   23,   24,   39,   20,   21,   20,   40,   21,
+   20,   24,   21,   20,   25,   29,   20,   22,   41,   21,
+   23,   30,   28,   29,   33,   41,   25,   28,   30,   42,
+   30,   47,   30,   35,   35,   37,   36,   38,   36,   33,
+   38,   36,   63,   38,   36,   43,   44,   45,   46,   48,
+   44,   50,   49,   37,   46,   45,   46,   64,   46,   62,
+   51,   51,   62,   65,   66,   70,   49,   61,   61,   61,
+   61,   61,   61,   61,   61,   61,   61,   61,   61,   61,
+   61,   61,   61,   61,   61,   61,   61,   61,   61,   61,
+   61,   61,   68,   61,   61,   61,   61,   61,   61,   61,
+
+   61,   61,   61,   61,   61,   61,   61,   61,   61,   61,
+   61,   61,   61,   61,   61,   61,   61,   69,   71,   72,
+   73,   74,   75,   76,   77,   78,   79,   80,   81,   84,
+   83,   87,   85,   88,   89,   86,   90,   91,   93,   95,
+   86,   98,   92,   96,  100,   92,   94,   99,  101,  109,
+    0,  102,  125,  131,  132,    0,    0,  123,  139,  134,
+  106,  108,  130,  103,  138,  135,  119,  104,  105,  111,
+  107,  114,  128,  110,  115,  116,  120,  129,  117,  116,
+  113,  118,  133,  137,  136,  142,  143,  121,  144,  145,
+  147,  148,  146,  150,  153,  152,  155,  151,  160,  161,
+
+  159,  169,  164,  158,  162,  163,  165,  166,  184,  168,
+  185,  172,  167,  191,  197,  186,  174,  183,  187,  173,
+  175,  178,  188,  193,  194,  195,  176,  180,  182,  198,
+  199,  177,  201,  202,  181,  203,  204,  235,  205,  232,
+  208,  209,  210,  215,  211,  233,  207,  221,  212,  231,
+  225,  227,  217,  234,  226,  222,  228,  236,  229,  219,
+  237,  223,  218,  241,  242,  244,  245,  250,  246,  251,
+  252,  253,  254,  249,  259,  267,  262,  255,  260,  269,
+  263,  270,  271,  273,  276,  277,  264,  275,  279,  281,
+  283,  293,  285,  294,  288,  295,  282,  296,  298,  301,
+
+  302,  307,  303,  311,  304,  289,  287,  309,  314,  306,
+  319,  318,  312,    0,  322,    0,    0,  321,    0,    0,
+    0,  316,    0,    0,    0,    0,    0,    0,    0,    0,
+    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+  327,  327,  327,  327,  327,  327,  327,  327,  327,  327,
+  327,  327,  327,  327,  327,  327,  327,  327,  327,  327,
+  327,  327,  327,  327,  327,  327,  327,  327,  327,  327,
+  327,  327,  327,  327,  327,  327,  327,  327,  327,  327,
+
+  327,  327,  327,  327,  327,  327,  327,  327,  327,  327,
+  327,  327,  327,  327,  327,  327,  327,  327,  327,  327,
+  327,  327,  327,  327,  327,  327,  327
     } ;
 
 static yy_state_type yy_last_accepting_state;
@@ -537,6 +701,21 @@ char *sqltext;
 #include "SqlEngine.h"
 #include "SqlParser.tab.h"
 
+/* read the input a line at a time, as flex does for a terminal, so that
+   the tuples that follow LOAD ... FROM STDIN are left for the loader */
+#define YY_INPUT(buf, result, max_size) \
+	{ \
+	int c = '*'; \
+	size_t n; \
+	for (n = 0; n < (size_t) max_size && (c = getc(sqlin)) != EOF && c != '\n'; ++n) \
+		buf[n] = (char) c; \
+	if (c == '\n') \
+		buf[n++] = (char) c; \
+	if (c == EOF && ferror(sqlin)) \
+		YY_FATAL_ERROR("input in flex scanner failed"); \
+	result = n; \
+	}
+
 char* strlower(char* s)
 {
 	char* i = s;
@@ -546,7 +725,7 @@ char* strlower(char* s)
         }
 	return s;
 }
-#line 550 "lex.sql.c"
+#line 729 "lex.sql.c"
 
 #define INITIAL 0
 
@@ -699,10 +878,10 @@ YY_DECL
 	register char *yy_cp, *yy_bp;
 	register int yy_act;
     
-#line 17 "SqlParser.l"
+#line 32 "SqlParser.l"
 
 
-#line 706 "lex.sql.c"
+#line 885 "lex.sql.c"
 
 	if ( !(yy_init) )
 		{
@@ -755,13 +934,13 @@ yy_match:
 			while ( yy_chk[yy_base[yy_current_state] + yy_c] != yy_current_state )
 				{
 				yy_current_state = (int) yy_def[yy_current_state];
-				if ( yy_current_state >= 113 )
+				if ( yy_current_state >= 328 )
 					yy_c = yy_meta[(unsigned int) yy_c];
 				}
 			yy_current_state = yy_nxt[yy_base[yy_current_state] + (unsigned int) yy_c];
 			++yy_cp;
 			}
-		while ( yy_base[yy_current_state] != 145 );
+		while ( yy_base[yy_current_state] != 561 );
 
 yy_find_action:
 		yy_act = yy_accept[yy_current_state];
@@ -787,137 +966,267 @@ do_action:	/* This label is used only to access EOF actions. */
 
 case 1:
 YY_RULE_SETUP
-#line 19 "SqlParser.l"
+#line 34 "SqlParser.l"
 return SELECT;
 	YY_BREAK
 case 2:
 YY_RULE_SETUP
-#line 20 "SqlParser.l"
+#line 35 "SqlParser.l"
 return FROM;
 	YY_BREAK
 case 3:
 YY_RULE_SETUP
-#line 21 "SqlParser.l"
+#line 36 "SqlParser.l"
 return WHERE;
 	YY_BREAK
 case 4:
 YY_RULE_SETUP
-#line 22 "SqlParser.l"
+#line 37 "SqlParser.l"
 return LOAD;
 	YY_BREAK
 case 5:
 YY_RULE_SETUP
-#line 23 "SqlParser.l"
-return WITH;
+#line 38 "SqlParser.l"
+return APPEND;
 	YY_BREAK
 case 6:
 YY_RULE_SETUP
-#line 24 "SqlParser.l"
-return INDEX;
+#line 39 "SqlParser.l"
+return WITH;
 	YY_BREAK
 case 7:
 YY_RULE_SETUP
-#line 25 "SqlParser.l"
-return QUIT;
+#line 40 "SqlParser.l"
+return INDEX;
 	YY_BREAK
 case 8:
 YY_RULE_SETUP
-#line 26 "SqlParser.l"
-return QUIT;
+#line 41 "SqlParser.l"
+return CREATE;
 	YY_BREAK
 case 9:
 YY_RULE_SETUP
-#line 27 "SqlParser.l"
-return COUNT;
+#line 42 "SqlParser.l"
+return ON;
 	YY_BREAK
 case 10:
 YY_RULE_SETUP
-#line 29 "SqlParser.l"
-return AND;
+#line 43 "SqlParser.l"
+return CLUSTERED;
 	YY_BREAK
 case 11:
 YY_RULE_SETUP
-#line 30 "SqlParser.l"
-return OR;
+#line 44 "SqlParser.l"
+return OPTIMIZE;
 	YY_BREAK
 case 12:
 YY_RULE_SETUP
-#line 31 "SqlParser.l"
-return EQUAL;
+#line 45 "SqlParser.l"
+return OPTIMIZE;
 	YY_BREAK
 case 13:
 YY_RULE_SETUP
-#line 32 "SqlParser.l"
-return NEQUAL;
+#line 46 "SqlParser.l"
+return TABLE;
 	YY_BREAK
 case 14:
 YY_RULE_SETUP
-#line 33 "SqlParser.l"
-return GREATER;
+#line 47 "SqlParser.l"
+return REINDEX;
 	YY_BREAK
 case 15:
 YY_RULE_SETUP
-#line 34 "SqlParser.l"
-return LESS;
+#line 48 "SqlParser.l"
+return FILLFACTOR;
 	YY_BREAK
 case 16:
 YY_RULE_SETUP
-#line 35 "SqlParser.l"
-return GREATEREQUAL;
+#line 49 "SqlParser.l"
+return ANALYZE;
 	YY_BREAK
 case 17:
 YY_RULE_SETUP
-#line 36 "SqlParser.l"
-return LESSEQUAL;
+#line 50 "SqlParser.l"
+return LIMIT;
 	YY_BREAK
 case 18:
 YY_RULE_SETUP
-#line 38 "SqlParser.l"
-sqllval.string = strdup(sqltext); return INTEGER;
+#line 51 "SqlParser.l"
+return OFFSET;
 	YY_BREAK
 case 19:
-/* rule 19 can match eol */
 YY_RULE_SETUP
-#line 39 "SqlParser.l"
-sqllval.string = strdup(sqltext+1); sqllval.string[sqlleng-2] = 0; return STRING;
+#line 52 "SqlParser.l"
+return ORDER;
 	YY_BREAK
 case 20:
 YY_RULE_SETUP
-#line 40 "SqlParser.l"
-sqllval.string = strlower(strdup(sqltext)); return ID;
+#line 53 "SqlParser.l"
+return GROUP;
 	YY_BREAK
 case 21:
 YY_RULE_SETUP
-#line 41 "SqlParser.l"
-return COMMA;
+#line 54 "SqlParser.l"
+return BY;
 	YY_BREAK
 case 22:
 YY_RULE_SETUP
-#line 42 "SqlParser.l"
-return STAR;
+#line 55 "SqlParser.l"
+return ASC;
 	YY_BREAK
 case 23:
-/* rule 23 can match eol */
 YY_RULE_SETUP
-#line 43 "SqlParser.l"
-return LF;
+#line 56 "SqlParser.l"
+return DESC;
 	YY_BREAK
 case 24:
 YY_RULE_SETUP
-#line 44 "SqlParser.l"
-/* ignore semicolon */
+#line 57 "SqlParser.l"
+return MIN;
 	YY_BREAK
 case 25:
 YY_RULE_SETUP
-#line 45 "SqlParser.l"
-/* ignore white space */
+#line 58 "SqlParser.l"
+return MAX;
 	YY_BREAK
 case 26:
 YY_RULE_SETUP
-#line 47 "SqlParser.l"
+#line 59 "SqlParser.l"
+return SUM;
+	YY_BREAK
+case 27:
+YY_RULE_SETUP
+#line 60 "SqlParser.l"
+return AVG;
+	YY_BREAK
+case 28:
+YY_RULE_SETUP
+#line 61 "SqlParser.l"
+return BETWEEN;
+	YY_BREAK
+case 29:
+YY_RULE_SETUP
+#line 62 "SqlParser.l"
+return IN;
+	YY_BREAK
+case 30:
+YY_RULE_SETUP
+#line 63 "SqlParser.l"
+return QUIT;
+	YY_BREAK
+case 31:
+YY_RULE_SETUP
+#line 64 "SqlParser.l"
+return QUIT;
+	YY_BREAK
+case 32:
+YY_RULE_SETUP
+#line 65 "SqlParser.l"
+return COUNT;
+	YY_BREAK
+case 33:
+YY_RULE_SETUP
+#line 67 "SqlParser.l"
+return AND;
+	YY_BREAK
+case 34:
+YY_RULE_SETUP
+#line 68 "SqlParser.l"
+return OR;
+	YY_BREAK
+case 35:
+YY_RULE_SETUP
+#line 69 "SqlParser.l"
+return EQUAL;
+	YY_BREAK
+case 36:
+YY_RULE_SETUP
+#line 70 "SqlParser.l"
+return NEQUAL;
+	YY_BREAK
+case 37:
+YY_RULE_SETUP
+#line 71 "SqlParser.l"
+return GREATER;
+	YY_BREAK
+case 38:
+YY_RULE_SETUP
+#line 72 "SqlParser.l"
+return LESS;
+	YY_BREAK
+case 39:
+YY_RULE_SETUP
+#line 73 "SqlParser.l"
+return GREATEREQUAL;
+	YY_BREAK
+case 40:
+YY_RULE_SETUP
+#line 74 "SqlParser.l"
+return LESSEQUAL;
+	YY_BREAK
+case 41:
+YY_RULE_SETUP
+#line 76 "SqlParser.l"
+sqllval.string = strdup(sqltext); return INTEGER;
+	YY_BREAK
+case 42:
+/* rule 42 can match eol */
+YY_RULE_SETUP
+#line 77 "SqlParser.l"
+sqllval.string = strdup(sqltext+1); sqllval.string[sqlleng-2] = 0; return STRING;
+	YY_BREAK
+case 43:
+YY_RULE_SETUP
+#line 78 "SqlParser.l"
+sqllval.string = strlower(strdup(sqltext)); return ID;
+	YY_BREAK
+case 44:
+YY_RULE_SETUP
+#line 79 "SqlParser.l"
+sqllval.string = strlower(strdup(sqltext)); return QID;
+	YY_BREAK
+case 45:
+YY_RULE_SETUP
+#line 80 "SqlParser.l"
+return COMMA;
+	YY_BREAK
+case 46:
+YY_RULE_SETUP
+#line 81 "SqlParser.l"
+return LPAREN;
+	YY_BREAK
+case 47:
+YY_RULE_SETUP
+#line 82 "SqlParser.l"
+return RPAREN;
+	YY_BREAK
+case 48:
+YY_RULE_SETUP
+#line 83 "SqlParser.l"
+return STAR;
+	YY_BREAK
+case 49:
+/* rule 49 can match eol */
+YY_RULE_SETUP
+#line 84 "SqlParser.l"
+return LF;
+	YY_BREAK
+case 50:
+YY_RULE_SETUP
+#line 85 "SqlParser.l"
+/* ignore semicolon */
+	YY_BREAK
+case 51:
+YY_RULE_SETUP
+#line 86 "SqlParser.l"
+/* ignore white space */
+	YY_BREAK
+case 52:
+YY_RULE_SETUP
+#line 88 "SqlParser.l"
 ECHO;
 	YY_BREAK
-#line 921 "lex.sql.c"
+#line 1230 "lex.sql.c"
 case YY_STATE_EOF(INITIAL):
 	yyterminate();
 
@@ -1201,7 +1510,7 @@ static int yy_get_next_buffer (void)
 		while ( yy_chk[yy_base[yy_current_state] + yy_c] != yy_current_state )
 			{
 			yy_current_state = (int) yy_def[yy_current_state];
-			if ( yy_current_state >= 113 )
+			if ( yy_current_state >= 328 )
 				yy_c = yy_meta[(unsigned int) yy_c];
 			}
 		yy_current_state = yy_nxt[yy_base[yy_current_state] + (unsigned int) yy_c];
@@ -1229,11 +1538,11 @@ static int yy_get_next_buffer (void)
 	while ( yy_chk[yy_base[yy_current_state] + yy_c] != yy_current_state )
 		{
 		yy_current_state = (int) yy_def[yy_current_state];
-		if ( yy_current_state >= 113 )
+		if ( yy_current_state >= 328 )
 			yy_c = yy_meta[(unsigned int) yy_c];
 		}
 	yy_current_state = yy_nxt[yy_base[yy_current_state] + (unsigned int) yy_c];
-	yy_is_jam = (yy_current_state == 112);
+	yy_is_jam = (yy_current_state == 327);
 
 	return yy_is_jam ? 0 : yy_current_state;
 }